@@ -0,0 +1,216 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * A sample address translation plugin, which performs stateless NAT64-like translation using an IPv6 /96 prefix read
+ *  from the file whose path is passed as the plugin's argument ('addressing.plugin.argument'). The file is re-read when
+ *  the plugin is reloaded (i.e. when Tundra receives the SIGUSR1 signal), so the prefix can be changed at runtime.
+ *
+ * Since the 'reload' hook is run concurrently with the translation callbacks, the current prefix is protected by a
+ *  mutex; to avoid locking it for every translated packet, each translator thread keeps its own copy of the prefix,
+ *  which is only refreshed when the (atomic) generation counter changes.
+ */
+
+#define _GNU_SOURCE
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdatomic.h>
+#include<pthread.h>
+#include<arpa/inet.h>
+
+#include"tundra_addr_xlat_plugin.h"
+
+
+typedef struct _plugin_data {
+    pthread_mutex_t mutex;
+    char *prefix_file_path;
+    uint8_t prefix[16]; // Protected by 'mutex'
+    atomic_uint_fast32_t generation; // Incremented each time 'prefix' changes
+} _plugin_data;
+
+typedef struct _thread_data {
+    _plugin_data *plugin_data;
+    uint8_t prefix[16];
+    uint_fast32_t generation;
+} _thread_data;
+
+
+static bool _init(const char *argument, void **out_plugin_data);
+static bool _thread_init(void *plugin_data, size_t thread_id, void **out_thread_data);
+static bool _reload(void *plugin_data);
+static void _thread_finalize(void *plugin_data, void *thread_data);
+static void _finalize(void *plugin_data);
+static bool _translate_4to6(void *thread_data, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+static bool _translate_6to4(void *thread_data, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+static const uint8_t *_get_current_prefix(_thread_data *thread_data);
+static bool _read_prefix_from_file(const char *prefix_file_path, uint8_t *out_prefix);
+
+
+const tundra_addr_xlat_plugin tundra_addr_xlat_plugin_definition = {
+    .api_version = TUNDRA_ADDR_XLAT_PLUGIN_API_VERSION,
+    .init = _init,
+    .thread_init = _thread_init,
+    .reload = _reload,
+    .thread_finalize = _thread_finalize,
+    .finalize = _finalize,
+    .translate_4to6_addr_for_main_packet = _translate_4to6,
+    .translate_4to6_addr_for_icmp_error_packet = _translate_4to6,
+    .translate_6to4_addr_for_main_packet = _translate_6to4,
+    .translate_6to4_addr_for_icmp_error_packet = _translate_6to4
+};
+
+
+static bool _init(const char *argument, void **out_plugin_data) {
+    _plugin_data *plugin_data = calloc(1, sizeof(_plugin_data));
+    if(plugin_data == NULL)
+        return false;
+
+    if(!_read_prefix_from_file(argument, plugin_data->prefix) || (plugin_data->prefix_file_path = strdup(argument)) == NULL) {
+        free(plugin_data);
+        return false;
+    }
+
+    if(pthread_mutex_init(&plugin_data->mutex, NULL) != 0) {
+        free(plugin_data->prefix_file_path);
+        free(plugin_data);
+        return false;
+    }
+
+    atomic_init(&plugin_data->generation, 0);
+
+    *out_plugin_data = plugin_data;
+    return true;
+}
+
+static bool _thread_init(void *plugin_data, __attribute__((unused)) size_t thread_id, void **out_thread_data) {
+    _thread_data *thread_data = calloc(1, sizeof(_thread_data));
+    if(thread_data == NULL)
+        return false;
+
+    thread_data->plugin_data = plugin_data;
+    thread_data->generation = (atomic_load(&thread_data->plugin_data->generation) - 1); // Forces the prefix to be copied on first use
+
+    *out_thread_data = thread_data;
+    return true;
+}
+
+static bool _reload(void *plugin_data) {
+    _plugin_data *const data = plugin_data;
+
+    uint8_t new_prefix[16];
+    if(!_read_prefix_from_file(data->prefix_file_path, new_prefix))
+        return false; // The old prefix stays in use
+
+    pthread_mutex_lock(&data->mutex);
+    memcpy(data->prefix, new_prefix, 16);
+    atomic_fetch_add(&data->generation, 1);
+    pthread_mutex_unlock(&data->mutex);
+
+    return true;
+}
+
+static void _thread_finalize(__attribute__((unused)) void *plugin_data, void *thread_data) {
+    free(thread_data);
+}
+
+static void _finalize(void *plugin_data) {
+    _plugin_data *const data = plugin_data;
+
+    pthread_mutex_destroy(&data->mutex);
+    free(data->prefix_file_path);
+    free(data);
+}
+
+static bool _translate_4to6(void *thread_data, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    const uint8_t *const prefix = _get_current_prefix(thread_data);
+
+    memcpy(out_src_ipv6, prefix, 12);
+    memcpy(out_src_ipv6 + 12, in_src_ipv4, 4);
+    memcpy(out_dst_ipv6, prefix, 12);
+    memcpy(out_dst_ipv6 + 12, in_dst_ipv4, 4);
+
+    return true;
+}
+
+static bool _translate_6to4(void *thread_data, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    const uint8_t *const prefix = _get_current_prefix(thread_data);
+
+    if(memcmp(in_src_ipv6, prefix, 12) != 0 || memcmp(in_dst_ipv6, prefix, 12) != 0)
+        return false;
+
+    memcpy(out_src_ipv4, in_src_ipv6 + 12, 4);
+    memcpy(out_dst_ipv4, in_dst_ipv6 + 12, 4);
+
+    return true;
+}
+
+static const uint8_t *_get_current_prefix(_thread_data *thread_data) {
+    _plugin_data *const plugin_data = thread_data->plugin_data;
+
+    const uint_fast32_t current_generation = atomic_load_explicit(&plugin_data->generation, memory_order_acquire);
+    if(thread_data->generation != current_generation) {
+        pthread_mutex_lock(&plugin_data->mutex);
+        memcpy(thread_data->prefix, plugin_data->prefix, 16);
+        thread_data->generation = atomic_load(&plugin_data->generation);
+        pthread_mutex_unlock(&plugin_data->mutex);
+    }
+
+    return thread_data->prefix;
+}
+
+static bool _read_prefix_from_file(const char *prefix_file_path, uint8_t *out_prefix) {
+    FILE *prefix_file = fopen(prefix_file_path, "r");
+    if(prefix_file == NULL) {
+        fprintf(stderr, "[sample plugin] Failed to open the prefix file '%s'!\n", prefix_file_path);
+        return false;
+    }
+
+    char line[INET6_ADDRSTRLEN + 8];
+    const bool was_line_read = (fgets(line, sizeof(line), prefix_file) != NULL);
+    fclose(prefix_file);
+
+    if(!was_line_read) {
+        fprintf(stderr, "[sample plugin] Failed to read the prefix file '%s'!\n", prefix_file_path);
+        return false;
+    }
+
+    // The file contains the prefix in the 'address/96' format
+    char *const slash = strchr(line, '/');
+    if(slash == NULL || strncmp(slash, "/96", 3) != 0) {
+        fprintf(stderr, "[sample plugin] The prefix file '%s' does not contain a /96 prefix!\n", prefix_file_path);
+        return false;
+    }
+    *slash = '\0';
+
+    if(inet_pton(AF_INET6, line, out_prefix) != 1) {
+        fprintf(stderr, "[sample plugin] The prefix file '%s' contains an invalid IPv6 address!\n", prefix_file_path);
+        return false;
+    }
+
+    if(memcmp(out_prefix + 12, "\0\0\0\0", 4) != 0) {
+        fprintf(stderr, "[sample plugin] The prefix in the file '%s' has non-zero host bits!\n", prefix_file_path);
+        return false;
+    }
+
+    return true;
+}
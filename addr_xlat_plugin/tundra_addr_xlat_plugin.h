@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * The API of address translation plugins - shared objects which are loaded by Tundra into its own process when the
+ *  'plugin' addressing mode is used, and which then perform the address translation using direct function calls.
+ *
+ * A plugin has to export a non-static object named 'tundra_addr_xlat_plugin_definition' (see the
+ *  TUNDRA_ADDR_XLAT_PLUGIN_DEFINITION_SYMBOL macro) of the 'tundra_addr_xlat_plugin' type, whose 'api_version' member
+ *  is set to TUNDRA_ADDR_XLAT_PLUGIN_API_VERSION. See 'sample_plugin.c' for an example.
+ *
+ * The 'init' and 'thread_init' hooks are called from Tundra's main thread before any packets are translated, and
+ *  before Tundra drops its privileges (if it is configured to do so). Then, the translation callbacks are called
+ *  concurrently from all the translator threads; each thread always passes its own 'thread_data' to them. The
+ *  'reload' hook is called from the main thread when Tundra receives the SIGUSR1 signal, which means that it is run
+ *  concurrently with the translation callbacks! Finally, after all the translator threads have terminated, the
+ *  'thread_finalize' hooks and the 'finalize' hook are called from the main thread.
+ *
+ * The hooks (but not the translation callbacks) may be NULL, if the plugin does not need them. If a hook returns
+ *  false, Tundra exits with an error (except for 'reload' - in that case, the error is just logged).
+ *
+ * The translation callbacks have the same semantics as Tundra's built-in addressing modes: all the addresses are in
+ *  network byte order, and if a callback returns false, the packet which is being translated is dropped.
+ */
+
+#pragma once
+
+
+#include<stddef.h>
+#include<stdint.h>
+#include<stdbool.h>
+
+
+#define TUNDRA_ADDR_XLAT_PLUGIN_API_VERSION ((uint32_t) 1)
+#define TUNDRA_ADDR_XLAT_PLUGIN_DEFINITION_SYMBOL "tundra_addr_xlat_plugin_definition"
+
+
+typedef struct tundra_addr_xlat_plugin {
+    uint32_t api_version;
+
+    // 'argument' is the value of the 'addressing.plugin.argument' configuration option (it may be an empty string)
+    bool (*init)(const char *argument, void **out_plugin_data);
+    // 'thread_id' is unique for each translator thread, starting from 1
+    bool (*thread_init)(void *plugin_data, size_t thread_id, void **out_thread_data);
+    bool (*reload)(void *plugin_data);
+    void (*thread_finalize)(void *plugin_data, void *thread_data);
+    void (*finalize)(void *plugin_data);
+
+    bool (*translate_4to6_addr_for_main_packet)(void *thread_data, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+    bool (*translate_4to6_addr_for_icmp_error_packet)(void *thread_data, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+    bool (*translate_6to4_addr_for_main_packet)(void *thread_data, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+    bool (*translate_6to4_addr_for_icmp_error_packet)(void *thread_data, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+} tundra_addr_xlat_plugin;
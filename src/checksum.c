@@ -105,6 +105,14 @@ uint16_t checksum__recalculate_checksum_6to4(const uint16_t old_checksum, const
     return (uint16_t) ~_pack_into_16bits(intermed_sum_2);
 }
 
+// See RFC 1624 - https://datatracker.ietf.org/doc/html/rfc1624 (both the words must be in the same byte order as the
+//  checksummed data, i.e. usually in network byte order)
+uint16_t checksum__recalculate_checksum_for_changed_16bit_word(const uint16_t old_checksum, const uint16_t old_word, const uint16_t new_word) {
+    // new_checksum = ~(~old_checksum + ~old_word + new_word)
+    const uint32_t sum = ((uint32_t) (uint16_t) ~old_checksum + (uint32_t) (uint16_t) ~old_word + (uint32_t) new_word);
+    return (uint16_t) ~_pack_into_16bits(sum);
+}
+
 static inline uint32_t _sum_ipv4_pseudo_header(const struct iphdr *ipv4_header, const size_t transport_header_and_data_length) {
     const uint16_t length_big_endian = htons((uint16_t) transport_header_and_data_length);
     uint8_t pseudo_header[12];
@@ -28,3 +28,4 @@ extern uint16_t checksum__calculate_checksum_ipv4(const uint8_t *payload1_ptr, c
 extern uint16_t checksum__calculate_checksum_ipv6(const uint8_t *payload1_ptr, const size_t payload1_size, const uint8_t *nullable_payload2_ptr, const size_t zeroable_payload2_size, const struct ipv6hdr *nullable_ipv6_header, const uint8_t carried_protocol);
 extern uint16_t checksum__recalculate_checksum_4to6(const uint16_t old_checksum, const struct iphdr *old_ipv4_header, const struct ipv6hdr *new_ipv6_header);
 extern uint16_t checksum__recalculate_checksum_6to4(const uint16_t old_checksum, const struct ipv6hdr *old_ipv6_header, const struct iphdr *new_ipv4_header);
+extern uint16_t checksum__recalculate_checksum_for_changed_16bit_word(const uint16_t old_checksum, const uint16_t old_word, const uint16_t new_word);
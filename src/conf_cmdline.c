@@ -46,6 +46,15 @@ Options:\n\
     Specifies the file descriptors to be used in the 'inherited-fds' I/O mode. Ignored otherwise.\n\
   -F, --addressing-external-inherited-fds=THREAD1_IN,THREAD1_OUT[;THREAD2_IN,THREAD2_OUT]...\n\
     Specifies the file descriptors to be used for the 'inherited-fds' transport of the 'external' addressing mode. Ignored otherwise.\n\
+  -i, --instance=NAME:CONFIG_FILE_PATH\n\
+    Adds another translation instance, configured by the specified file, to the 'translate' mode of operation. Can be specified multiple times.\n\
+    NOTE: The translator threads are shared by all the instances, including the main one (configured by '-c').\n\
+  -I, --instance-io-inherited-fds=THREAD1_IN,THREAD1_OUT[;THREAD2_IN,THREAD2_OUT]...\n\
+    Specifies the file descriptors to be used by the most recently added instance (see '-i') in the 'inherited-fds' I/O mode.\n\
+  -H, --handover-socket=SOCKET_PATH\n\
+    Takes the packet I/O file descriptors over from the translator listening on the specified UNIX socket (if there is one), and then listens on it for the next one.\n\
+  -C, --handover-external-cache\n\
+    Takes the contents of the external address translation caches over as well (see '-H').\n\
 \n\
 Modes of operation:\n\
   translate\n\
@@ -90,6 +99,8 @@ static noreturn void _print_help_and_exit(const char *const argv_0);
 static noreturn void _print_version_and_exit(void);
 static noreturn void _print_license_and_exit(void);
 static tundra__operation_mode _get_operation_mode_from_string(const char *const operation_mode_string);
+static void _add_instance(tundra__conf_cmdline *const cmdline_config, const char *const instance_string);
+static bool _is_instance_name_valid(const char *const name);
 
 
 tundra__conf_cmdline *conf_cmdline__parse_cmdline_config(int argc, char **argv) {
@@ -100,6 +111,9 @@ tundra__conf_cmdline *conf_cmdline__parse_cmdline_config(int argc, char **argv)
     cmdline_config->config_file_path = NULL;
     cmdline_config->io_inherited_fds = NULL;
     cmdline_config->addressing_external_inherited_fds = NULL;
+    cmdline_config->instance_count = 0; // All the 'instance_*' pointers are NULL (the memory is zeroed out)
+    cmdline_config->handover_socket_path = NULL;
+    cmdline_config->handover_external_cache = false;
     cmdline_config->mode_of_operation = TUNDRA__OPERATION_MODE_TRANSLATE;
 
     _parse_cmdline_opts(cmdline_config, argc, argv);
@@ -112,7 +126,7 @@ tundra__conf_cmdline *conf_cmdline__parse_cmdline_config(int argc, char **argv)
 }
 
 static void _parse_cmdline_opts(tundra__conf_cmdline *const cmdline_config, int argc, char **argv) {
-    static const char *const option_string = "hvlc:f:F:";
+    static const char *const option_string = "hvlc:f:F:i:I:H:C";
     static const struct option long_options[] = {
             {"help",                              no_argument,       NULL, 'h'},
             {"version",                           no_argument,       NULL, 'v'},
@@ -120,6 +134,10 @@ static void _parse_cmdline_opts(tundra__conf_cmdline *const cmdline_config, int
             {"config-file",                       required_argument, NULL, 'c'},
             {"io-inherited-fds",                  required_argument, NULL, 'f'},
             {"addressing-external-inherited-fds", required_argument, NULL, 'F'},
+            {"instance",                          required_argument, NULL, 'i'},
+            {"instance-io-inherited-fds",         required_argument, NULL, 'I'},
+            {"handover-socket",                   required_argument, NULL, 'H'},
+            {"handover-external-cache",           no_argument,       NULL, 'C'},
             {NULL,                                no_argument,       NULL, 0},
     };
 
@@ -153,6 +171,28 @@ static void _parse_cmdline_opts(tundra__conf_cmdline *const cmdline_config, int
                 cmdline_config->addressing_external_inherited_fds = utils__duplicate_string(optarg);
                 break;
 
+            case 'i':
+                _add_instance(cmdline_config, optarg);
+                break;
+
+            case 'I':
+                if(cmdline_config->instance_count == 0)
+                    log__crash(false, "The list of inherited file descriptors for packet I/O of an instance has been specified before any instance has been added (using '-i' / '--instance')!");
+                if(cmdline_config->instance_io_inherited_fds[cmdline_config->instance_count - 1] != NULL)
+                    log__crash(false, "The list of inherited file descriptors for packet I/O of the instance '%s' has already been set: %s", cmdline_config->instance_names[cmdline_config->instance_count - 1], cmdline_config->instance_io_inherited_fds[cmdline_config->instance_count - 1]);
+                cmdline_config->instance_io_inherited_fds[cmdline_config->instance_count - 1] = utils__duplicate_string(optarg);
+                break;
+
+            case 'H':
+                if(cmdline_config->handover_socket_path != NULL)
+                    log__crash(false, "The handover socket path has already been set: %s", cmdline_config->handover_socket_path);
+                cmdline_config->handover_socket_path = utils__duplicate_string(optarg);
+                break;
+
+            case 'C':
+                cmdline_config->handover_external_cache = true;
+                break;
+
             case '?':
                 // getopt_long() prints an informative error message automatically
                 log__crash(false, "An invalid command-line option has been passed to the program - see '--help' for more information!");
@@ -215,6 +255,49 @@ static tundra__operation_mode _get_operation_mode_from_string(const char *const
     log__crash(false, "Invalid mode of operation string: %s", operation_mode_string);
 }
 
+static void _add_instance(tundra__conf_cmdline *const cmdline_config, const char *const instance_string) {
+    if(cmdline_config->instance_count >= (TUNDRA__MAX_XLAT_INSTANCES - 1))
+        log__crash(false, "Too many translation instances have been specified (at most %zu instances can be added to the main one)!", (TUNDRA__MAX_XLAT_INSTANCES - 1));
+
+    const char *const separator_ptr = strchr(instance_string, ':');
+    if(separator_ptr == NULL || separator_ptr[1] == '\0')
+        log__crash(false, "Invalid translation instance specification (it must be in the 'NAME:CONFIG_FILE_PATH' format): %s", instance_string);
+
+    char *const name = utils__duplicate_string(instance_string);
+    name[separator_ptr - instance_string] = '\0';
+
+    if(!_is_instance_name_valid(name))
+        log__crash(false, "Invalid translation instance name (it must consist of 1 to %zu letters, digits, underscores and dashes, and it must not be 'main'): %s", TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH, name);
+
+    for(size_t i = 0; i < cmdline_config->instance_count; i++) {
+        if(UTILS__STR_EQ(cmdline_config->instance_names[i], name))
+            log__crash(false, "A translation instance named '%s' has already been added!", name);
+    }
+
+    // The configuration of the additional instances is always loaded from a file, since the standard input can only be
+    //  read once (and the main instance may be using it)
+    if(UTILS__STR_EQ(separator_ptr + 1, "-"))
+        log__crash(false, "The configuration of the translation instance '%s' cannot be loaded from the standard input!", name);
+
+    cmdline_config->instance_names[cmdline_config->instance_count] = name;
+    cmdline_config->instance_config_file_paths[cmdline_config->instance_count] = utils__duplicate_string(separator_ptr + 1);
+    cmdline_config->instance_io_inherited_fds[cmdline_config->instance_count] = NULL;
+    cmdline_config->instance_count++;
+}
+
+static bool _is_instance_name_valid(const char *const name) {
+    const size_t name_length = strlen(name);
+    if(name_length < 1 || name_length > TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH || UTILS__STR_EQ(name, "main"))
+        return false;
+
+    for(size_t i = 0; i < name_length; i++) {
+        if(!isalnum((unsigned char) name[i]) && name[i] != '_' && name[i] != '-')
+            return false;
+    }
+
+    return true;
+}
+
 void conf_cmdline__free_cmdline_config(tundra__conf_cmdline *const cmdline_config) {
     utils__free_memory(cmdline_config->config_file_path);
 
@@ -224,6 +307,17 @@ void conf_cmdline__free_cmdline_config(tundra__conf_cmdline *const cmdline_confi
     if(cmdline_config->addressing_external_inherited_fds != NULL)
         utils__free_memory(cmdline_config->addressing_external_inherited_fds);
 
+    if(cmdline_config->handover_socket_path != NULL)
+        utils__free_memory(cmdline_config->handover_socket_path);
+
+    for(size_t i = 0; i < cmdline_config->instance_count; i++) {
+        utils__free_memory(cmdline_config->instance_names[i]);
+        utils__free_memory(cmdline_config->instance_config_file_paths[i]);
+
+        if(cmdline_config->instance_io_inherited_fds[i] != NULL)
+            utils__free_memory(cmdline_config->instance_io_inherited_fds[i]);
+    }
+
     utils__free_memory(cmdline_config);
 }
 
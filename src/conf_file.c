@@ -29,92 +29,123 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"conf_rfc7050.h"
 
 
-static tundra__conf_file *_parse_config_file(conf_file_load__conf_entry **entries);
-static void _parse_program_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_io_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_io_tun_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_router_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_nat64_clat_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_nat64_clat_siit_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_external_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_external_unix_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_external_tcp_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_addressing_external_unix_tcp_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static void _parse_translator_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config);
-static uid_t _get_uid_by_username(const char *const username);
-static gid_t _get_gid_by_groupname(const char *const groupname);
-static tundra__io_mode _get_io_mode_from_string(const char *const io_mode_string);
-static tundra__addressing_mode _get_addressing_mode_from_string(const char *const addressing_mode_string);
-static tundra__addressing_external_transport _get_addressing_external_transport_from_string(const char *const addressing_external_transport_string);
+static tundra__conf_file *_parse_config_file(conf_file_load__conf_file *const loaded_file, const tundra__conf_file *const current_file_config);
+static void _parse_program_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_io_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_io_tun_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_router_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config, const tundra__conf_file *const current_file_config);
+static void _parse_addressing_nat64_clat_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_nat64_clat_siit_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config, const tundra__conf_file *const current_file_config);
+static void _parse_addressing_clat_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_siit_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_nat64_stateful_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_external_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_external_unix_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_external_tcp_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_external_unix_tcp_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_plugin_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_bpf_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_addressing_map_t_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static void _parse_translator_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config);
+static uid_t _get_uid_by_username(conf_file_load__conf_file *const loaded_file, const char *const username);
+static gid_t _get_gid_by_groupname(conf_file_load__conf_file *const loaded_file, const char *const groupname);
+static tundra__io_mode _get_io_mode_from_string(conf_file_load__conf_file *const loaded_file, const char *const io_mode_string);
+static tundra__addressing_mode _get_addressing_mode_from_string(conf_file_load__conf_file *const loaded_file, const char *const addressing_mode_string);
+static tundra__addressing_external_transport _get_addressing_external_transport_from_string(conf_file_load__conf_file *const loaded_file, const char *const addressing_external_transport_string);
+static size_t _split_comma_separated_list(conf_file_load__conf_file *const loaded_file, char *list_string, char **out_item_strings, const size_t max_items, const bool allow_empty_list, const char *const option_name);
+static uint32_t _get_addressing_external_server_hash_seed(const char *server_string);
 static uint64_t _get_fallback_translator_threads(void);
 
 
 tundra__conf_file *conf_file__read_and_parse_config_file(const char *const filepath) {
-    conf_file_load__conf_entry **entries = conf_file_load__read_config_file(filepath);
+    char error_message[CONF_FILE_LOAD__ERROR_MESSAGE_SIZE];
 
-    tundra__conf_file *const file_config = _parse_config_file(entries);
+    tundra__conf_file *const file_config = conf_file__try_read_and_parse_config_file(filepath, NULL, error_message, CONF_FILE_LOAD__ERROR_MESSAGE_SIZE);
+    if(file_config == NULL)
+        log__crash(false, "%s", error_message);
 
-    conf_file_load__free_config_file(entries);
+    return file_config;
+}
+
+/*
+ * Unlike conf_file__read_and_parse_config_file(), this function does not crash the program if the file cannot be read
+ * or is invalid - it returns NULL, and the reason is stored into 'error_message'. The file is read and parsed only
+ * once, so the returned configuration is exactly the one which has been validated.
+ * If 'current_file_config' is not NULL, the file is being reloaded while the translator is running; if the translation
+ * prefix is to be auto-discovered, the one which is currently in use (possibly rediscovered in the background) is
+ * reused, as the discovery might block the caller for a long time.
+ */
+tundra__conf_file *conf_file__try_read_and_parse_config_file(const char *const filepath, const tundra__conf_file *const current_file_config, char *error_message, const size_t error_message_size) {
+    conf_file_load__conf_file *const loaded_file = conf_file_load__read_config_file(filepath);
+
+    tundra__conf_file *file_config = _parse_config_file(loaded_file, current_file_config);
+    if(conf_file_load__has_failed(loaded_file)) {
+        snprintf(error_message, error_message_size, "%s", loaded_file->error_message);
+        conf_file__free_parsed_config_file(file_config);
+        file_config = NULL;
+    }
+
+    conf_file_load__free_config_file(loaded_file);
 
     return file_config;
 }
 
-static tundra__conf_file *_parse_config_file(conf_file_load__conf_entry **entries) {
+static tundra__conf_file *_parse_config_file(conf_file_load__conf_file *const loaded_file, const tundra__conf_file *const current_file_config) {
     tundra__conf_file *const file_config = utils__alloc_zeroed_out_memory(1, sizeof(tundra__conf_file));
 
-    _parse_program_config(entries, file_config);
-    _parse_io_config(entries, file_config);
-    _parse_router_config(entries, file_config);
-    _parse_addressing_config(entries, file_config);
-    _parse_translator_config(entries, file_config);
+    _parse_program_config(loaded_file, file_config);
+    _parse_io_config(loaded_file, file_config);
+    _parse_router_config(loaded_file, file_config);
+    _parse_addressing_config(loaded_file, file_config, current_file_config);
+    _parse_translator_config(loaded_file, file_config);
 
     return file_config;
 }
 
-static void _parse_program_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_program_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     // --- program.translator_threads ---
     file_config->program_translator_threads = (size_t) conf_file_load__find_integer(
-        entries, "program.translator_threads", 1, TUNDRA__MAX_XLAT_THREADS, &_get_fallback_translator_threads
+        loaded_file, "program.translator_threads", 1, TUNDRA__MAX_XLAT_THREADS, &_get_fallback_translator_threads
     );
 
     // --- program.privilege_drop_user ---
     {
         const char *const username = conf_file_load__find_string(
-            entries, "program.privilege_drop_user", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
+            loaded_file, "program.privilege_drop_user", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
         );
         if(UTILS__STR_EMPTY(username)) {
             file_config->program_privilege_drop_user_perform = false;
             file_config->program_privilege_drop_user_uid = 0; // Not used
         } else {
             file_config->program_privilege_drop_user_perform = true;
-            file_config->program_privilege_drop_user_uid = _get_uid_by_username(username);
+            file_config->program_privilege_drop_user_uid = _get_uid_by_username(loaded_file, username);
         }
     }
 
     // --- program.privilege_drop_group ---
     {
         const char *const groupname = conf_file_load__find_string(
-            entries, "program.privilege_drop_group", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
+            loaded_file, "program.privilege_drop_group", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
         );
         if(UTILS__STR_EMPTY(groupname)) {
             file_config->program_privilege_drop_group_perform = false;
             file_config->program_privilege_drop_group_gid = 0; // Not used
         } else {
             file_config->program_privilege_drop_group_perform = true;
-            file_config->program_privilege_drop_group_gid = _get_gid_by_groupname(groupname);
+            file_config->program_privilege_drop_group_gid = _get_gid_by_groupname(loaded_file, groupname);
         }
     }
 }
 
-static void _parse_io_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_io_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     // --- io.mode ---
     file_config->io_mode = _get_io_mode_from_string(
-        conf_file_load__find_string(entries, "io.mode", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
+        loaded_file, conf_file_load__find_string(loaded_file, "io.mode", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
     );
 
     if(file_config->io_mode == TUNDRA__IO_MODE_TUN) {
-        _parse_io_tun_config(entries, file_config);
+        _parse_io_tun_config(loaded_file, file_config);
     } else {
         file_config->io_tun_device_path = NULL; // Not used
         file_config->io_tun_interface_name = NULL; // Not used
@@ -126,10 +157,10 @@ static void _parse_io_config(conf_file_load__conf_entry **entries, tundra__conf_
     }
 }
 
-static void _parse_io_tun_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_io_tun_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     // --- io.tun.device_path ---
     {
-        const char *const tun_device_path = conf_file_load__find_string(entries, "io.tun.device_path", PATH_MAX - 1, false);
+        const char *const tun_device_path = conf_file_load__find_string(loaded_file, "io.tun.device_path", PATH_MAX - 1, false);
         file_config->io_tun_device_path = utils__duplicate_string(
             (UTILS__STR_EMPTY(tun_device_path)) ? TUNDRA__DEFAULT_TUN_DEVICE_PATH : tun_device_path
         );
@@ -137,79 +168,85 @@ static void _parse_io_tun_config(conf_file_load__conf_entry **entries, tundra__c
 
     // --- io.tun.interface_name ---
     file_config->io_tun_interface_name = utils__duplicate_string(
-        conf_file_load__find_string(entries, "io.tun.interface_name", IFNAMSIZ - 1, true)
+        conf_file_load__find_string(loaded_file, "io.tun.interface_name", IFNAMSIZ - 1, true)
     );
 
     // --- io.tun.owner_user ---
     {
         const char *const owner_username = conf_file_load__find_string(
-            entries, "io.tun.owner_user", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
+            loaded_file, "io.tun.owner_user", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
         );
         if(UTILS__STR_EMPTY(owner_username)) {
             file_config->io_tun_owner_user_set = false;
             file_config->io_tun_owner_user_uid = 0; // Not used
         } else {
             file_config->io_tun_owner_user_set = true;
-            file_config->io_tun_owner_user_uid = _get_uid_by_username(owner_username);
+            file_config->io_tun_owner_user_uid = _get_uid_by_username(loaded_file, owner_username);
         }
     }
 
     // --- io.tun.owner_group ---
     {
         const char *const owner_groupname = conf_file_load__find_string(
-            entries, "io.tun.owner_group", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
+            loaded_file, "io.tun.owner_group", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false
         );
         if(UTILS__STR_EMPTY(owner_groupname)) {
             file_config->io_tun_owner_group_set = false;
             file_config->io_tun_owner_group_gid = 0; // Not used
         } else {
             file_config->io_tun_owner_group_set = true;
-            file_config->io_tun_owner_group_gid = _get_gid_by_groupname(owner_groupname);
+            file_config->io_tun_owner_group_gid = _get_gid_by_groupname(loaded_file, owner_groupname);
         }
     }
 
     // --- io.tun.multi_queue ---
-    file_config->io_tun_multi_queue = conf_file_load__find_boolean(entries, "io.tun.multi_queue", NULL);
+    file_config->io_tun_multi_queue = conf_file_load__find_boolean(loaded_file, "io.tun.multi_queue", NULL);
 }
 
-static void _parse_router_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_router_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     // --- router.ipv4 ---
-    conf_file_load__find_ipv4_address(entries, "router.ipv4", file_config->router_ipv4, NULL);
+    conf_file_load__find_ipv4_address(loaded_file, "router.ipv4", file_config->router_ipv4, NULL);
 
     // --- router.ipv6 ---
-    conf_file_load__find_ipv6_address(entries, "router.ipv6", file_config->router_ipv6, NULL);
+    conf_file_load__find_ipv6_address(loaded_file, "router.ipv6", file_config->router_ipv6, NULL);
 
     // --- router.generated_packet_ttl ---
     file_config->router_generated_packet_ttl = (uint8_t) conf_file_load__find_integer(
-        entries, "router.generated_packet_ttl", TUNDRA__MIN_GENERATED_PACKET_TTL, TUNDRA__MAX_GENERATED_PACKET_TTL, NULL
+        loaded_file, "router.generated_packet_ttl", TUNDRA__MIN_GENERATED_PACKET_TTL, TUNDRA__MAX_GENERATED_PACKET_TTL, NULL
     );
 }
 
-static void _parse_addressing_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_addressing_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config, const tundra__conf_file *const current_file_config) {
     // --- addressing.mode ---
     file_config->addressing_mode = _get_addressing_mode_from_string(
-        conf_file_load__find_string(entries, "addressing.mode", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
+        loaded_file, conf_file_load__find_string(loaded_file, "addressing.mode", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
     );
 
-    _parse_addressing_nat64_clat_config(entries, file_config);
-    _parse_addressing_nat64_clat_siit_config(entries, file_config);
-    _parse_addressing_external_config(entries, file_config);
-    _parse_addressing_external_unix_config(entries, file_config);
-    _parse_addressing_external_tcp_config(entries, file_config);
-    _parse_addressing_external_unix_tcp_config(entries, file_config);
+    _parse_addressing_nat64_clat_config(loaded_file, file_config);
+    _parse_addressing_nat64_clat_siit_config(loaded_file, file_config, current_file_config);
+    _parse_addressing_clat_config(loaded_file, file_config);
+    _parse_addressing_siit_config(loaded_file, file_config);
+    _parse_addressing_nat64_stateful_config(loaded_file, file_config);
+    _parse_addressing_external_config(loaded_file, file_config);
+    _parse_addressing_external_unix_config(loaded_file, file_config);
+    _parse_addressing_external_tcp_config(loaded_file, file_config);
+    _parse_addressing_external_unix_tcp_config(loaded_file, file_config);
+    _parse_addressing_plugin_config(loaded_file, file_config);
+    _parse_addressing_bpf_config(loaded_file, file_config);
+    _parse_addressing_map_t_config(loaded_file, file_config);
 }
 
-static void _parse_addressing_nat64_clat_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_addressing_nat64_clat_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_NAT64 || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_CLAT) {
         // --- addressing.nat64_clat.ipv4 ---
-        conf_file_load__find_ipv4_address(entries, "addressing.nat64_clat.ipv4", file_config->addressing_nat64_clat_ipv4, NULL);
+        conf_file_load__find_ipv4_address(loaded_file, "addressing.nat64_clat.ipv4", file_config->addressing_nat64_clat_ipv4, NULL);
         if(UTILS_IP__IPV4_ADDR_EQ(file_config->addressing_nat64_clat_ipv4, file_config->router_ipv4))
-            log__crash(false, "'addressing.nat64_clat.ipv4' must not be the same as 'router.ipv4'!");
+            conf_file_load__fail(loaded_file, false, "'addressing.nat64_clat.ipv4' must not be the same as 'router.ipv4'!");
 
         // --- addressing.nat64_clat.ipv6 ---
-        conf_file_load__find_ipv6_address(entries, "addressing.nat64_clat.ipv6", file_config->addressing_nat64_clat_ipv6, NULL);
+        conf_file_load__find_ipv6_address(loaded_file, "addressing.nat64_clat.ipv6", file_config->addressing_nat64_clat_ipv6, NULL);
         if(UTILS_IP__IPV6_ADDR_EQ(file_config->addressing_nat64_clat_ipv6, file_config->router_ipv6))
-            log__crash(false, "'addressing.nat64_clat.ipv6' must not be the same as 'router.ipv6'!");
+            conf_file_load__fail(loaded_file, false, "'addressing.nat64_clat.ipv6' must not be the same as 'router.ipv6'!");
 
     } else {
         UTILS__MEM_ZERO_OUT(file_config->addressing_nat64_clat_ipv4, 4);
@@ -217,145 +254,467 @@ static void _parse_addressing_nat64_clat_config(conf_file_load__conf_entry **ent
     }
 }
 
-static void _parse_addressing_nat64_clat_siit_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
-    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_NAT64 || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_CLAT || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_SIIT) {
+static void _parse_addressing_nat64_clat_siit_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config, const tundra__conf_file *const current_file_config) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_NAT64 || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_CLAT || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_SIIT || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL || file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_MAP_T) {
         // --- addressing.nat64_clat_siit.prefix ---
-        conf_file_load__find_ipv6_prefix(
-            entries, "addressing.nat64_clat_siit.prefix", file_config->addressing_nat64_clat_siit_prefix, &conf_rfc7050__autodiscover_ipv6_prefix
-        );
+        const char *const prefix = conf_file_load__find_string(loaded_file, "addressing.nat64_clat_siit.prefix", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
+        if(UTILS__STR_EMPTY(prefix)) {
+            // --- addressing.nat64_clat_siit.rfc7050.rediscovery ---
+            file_config->addressing_nat64_clat_siit_rfc7050_rediscovery = conf_file_load__find_boolean(
+                loaded_file, "addressing.nat64_clat_siit.rfc7050.rediscovery", NULL
+            );
+
+            // --- addressing.nat64_clat_siit.rfc7050.cache_file ---
+            if(file_config->addressing_nat64_clat_siit_rfc7050_rediscovery) {
+                const char *const cache_file = conf_file_load__find_string(loaded_file, "addressing.nat64_clat_siit.rfc7050.cache_file", PATH_MAX - 1, false);
+                file_config->addressing_nat64_clat_siit_rfc7050_cache_file = (UTILS__STR_EMPTY(cache_file) ? NULL : utils__duplicate_string(cache_file));
+            } else {
+                file_config->addressing_nat64_clat_siit_rfc7050_cache_file = NULL;
+            }
+
+            file_config->addressing_nat64_clat_siit_prefix_autodiscovered = true;
+            if(current_file_config != NULL) {
+                if(current_file_config->addressing_nat64_clat_siit_prefix_autodiscovered) {
+                    memcpy(file_config->addressing_nat64_clat_siit_prefix, current_file_config->addressing_nat64_clat_siit_prefix, 16);
+                    file_config->addressing_nat64_clat_siit_prefix_length = current_file_config->addressing_nat64_clat_siit_prefix_length;
+                } else {
+                    conf_file_load__fail(loaded_file, false, "The translation prefix cannot start being auto-discovered ('addressing.nat64_clat_siit.prefix' has been emptied) without restarting the translator!");
+                }
+            } else if(!conf_file_load__has_failed(loaded_file)) {
+                conf_rfc7050__autodiscover_ipv6_prefix(file_config->addressing_nat64_clat_siit_rfc7050_cache_file, file_config->addressing_nat64_clat_siit_prefix, &file_config->addressing_nat64_clat_siit_prefix_length);
+            }
+        } else {
+            conf_file_load__find_ipv6_prefix(
+                loaded_file, "addressing.nat64_clat_siit.prefix", file_config->addressing_nat64_clat_siit_prefix, &file_config->addressing_nat64_clat_siit_prefix_length, NULL
+            );
+
+            file_config->addressing_nat64_clat_siit_prefix_autodiscovered = false;
+            file_config->addressing_nat64_clat_siit_rfc7050_rediscovery = false;
+            file_config->addressing_nat64_clat_siit_rfc7050_cache_file = NULL;
+        }
 
         // --- addressing.nat64_clat_siit.allow_translation_of_private_ips ---
         file_config->addressing_nat64_clat_siit_allow_translation_of_private_ips = conf_file_load__find_boolean(
-            entries, "addressing.nat64_clat_siit.allow_translation_of_private_ips", NULL
+            loaded_file, "addressing.nat64_clat_siit.allow_translation_of_private_ips", NULL
         );
     } else {
         UTILS__MEM_ZERO_OUT(file_config->addressing_nat64_clat_siit_prefix, 16);
+        file_config->addressing_nat64_clat_siit_prefix_length = 0;
         file_config->addressing_nat64_clat_siit_allow_translation_of_private_ips = false;
+        file_config->addressing_nat64_clat_siit_prefix_autodiscovered = false;
+        file_config->addressing_nat64_clat_siit_rfc7050_rediscovery = false;
+        file_config->addressing_nat64_clat_siit_rfc7050_cache_file = NULL;
+    }
+}
+
+static void _parse_addressing_clat_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_CLAT) {
+        // --- addressing.clat.nat44 ---
+        file_config->addressing_clat_nat44 = conf_file_load__find_boolean(loaded_file, "addressing.clat.nat44", NULL);
+
+    } else {
+        file_config->addressing_clat_nat44 = false;
+    }
+}
+
+static void _parse_addressing_siit_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_SIIT) {
+        // --- addressing.siit.eam_file ---
+        const char *const eam_file = conf_file_load__find_string(loaded_file, "addressing.siit.eam_file", PATH_MAX - 1, false);
+        file_config->addressing_siit_eam_file = (UTILS__STR_EMPTY(eam_file) ? NULL : utils__duplicate_string(eam_file));
+
+    } else {
+        file_config->addressing_siit_eam_file = NULL;
+    }
+}
+
+static void _parse_addressing_nat64_stateful_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL) {
+        // --- addressing.nat64_stateful.pool_ipv4 ---
+        conf_file_load__find_ipv4_address(loaded_file, "addressing.nat64_stateful.pool_ipv4", file_config->addressing_nat64_stateful_pool_ipv4, NULL);
+
+        // --- addressing.nat64_stateful.pool_size ---
+        file_config->addressing_nat64_stateful_pool_size = (uint32_t) conf_file_load__find_integer(
+            loaded_file, "addressing.nat64_stateful.pool_size", 1, TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_POOL_SIZE, NULL
+        );
+
+        uint32_t pool_ipv4_host_order, router_ipv4_host_order;
+        memcpy(&pool_ipv4_host_order, file_config->addressing_nat64_stateful_pool_ipv4, 4);
+        memcpy(&router_ipv4_host_order, file_config->router_ipv4, 4);
+        pool_ipv4_host_order = ntohl(pool_ipv4_host_order);
+        router_ipv4_host_order = ntohl(router_ipv4_host_order);
+
+        if(((uint64_t) pool_ipv4_host_order + file_config->addressing_nat64_stateful_pool_size) > ((uint64_t) UINT32_MAX + 1))
+            conf_file_load__fail(loaded_file, false, "The pool specified by 'addressing.nat64_stateful.pool_ipv4' and 'addressing.nat64_stateful.pool_size' extends beyond the end of the IPv4 address space!");
+        if((router_ipv4_host_order - pool_ipv4_host_order) < file_config->addressing_nat64_stateful_pool_size)
+            conf_file_load__fail(loaded_file, false, "The pool specified by 'addressing.nat64_stateful.pool_ipv4' and 'addressing.nat64_stateful.pool_size' must not contain 'router.ipv4'!");
+
+        // --- addressing.nat64_stateful.max_sessions ---
+        file_config->addressing_nat64_stateful_max_sessions = (size_t) conf_file_load__find_integer(
+            loaded_file, "addressing.nat64_stateful.max_sessions", 1, TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_SESSIONS, NULL
+        );
+
+        // --- addressing.nat64_stateful.udp_timeout ---
+        file_config->addressing_nat64_stateful_udp_timeout = (time_t) conf_file_load__find_integer(
+            loaded_file, "addressing.nat64_stateful.udp_timeout", 1, TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_TIMEOUT_SECONDS, NULL
+        );
+
+        // --- addressing.nat64_stateful.tcp_established_timeout ---
+        file_config->addressing_nat64_stateful_tcp_established_timeout = (time_t) conf_file_load__find_integer(
+            loaded_file, "addressing.nat64_stateful.tcp_established_timeout", 1, TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_TIMEOUT_SECONDS, NULL
+        );
+
+        // --- addressing.nat64_stateful.tcp_transitory_timeout ---
+        file_config->addressing_nat64_stateful_tcp_transitory_timeout = (time_t) conf_file_load__find_integer(
+            loaded_file, "addressing.nat64_stateful.tcp_transitory_timeout", 1, TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_TIMEOUT_SECONDS, NULL
+        );
+
+        // --- addressing.nat64_stateful.icmp_timeout ---
+        file_config->addressing_nat64_stateful_icmp_timeout = (time_t) conf_file_load__find_integer(
+            loaded_file, "addressing.nat64_stateful.icmp_timeout", 1, TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_TIMEOUT_SECONDS, NULL
+        );
+    } else {
+        UTILS__MEM_ZERO_OUT(file_config->addressing_nat64_stateful_pool_ipv4, 4);
+        file_config->addressing_nat64_stateful_pool_size = 0;
+        file_config->addressing_nat64_stateful_max_sessions = 0;
+        file_config->addressing_nat64_stateful_udp_timeout = 0;
+        file_config->addressing_nat64_stateful_tcp_established_timeout = 0;
+        file_config->addressing_nat64_stateful_tcp_transitory_timeout = 0;
+        file_config->addressing_nat64_stateful_icmp_timeout = 0;
     }
 }
 
-static void _parse_addressing_external_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_addressing_external_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL) {
         // --- addressing.external.transport ---
         file_config->addressing_external_transport = _get_addressing_external_transport_from_string(
-            conf_file_load__find_string(entries, "addressing.external.transport", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
+            loaded_file, conf_file_load__find_string(loaded_file, "addressing.external.transport", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
+        );
+
+        // The socket-based transports support multiple servers - their count is determined when the transport-specific
+        //  options are parsed
+        file_config->addressing_external_server_count = (file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS ? 1 : 0);
+        UTILS__MEM_ZERO_OUT(file_config->addressing_external_server_hash_seeds, TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS * sizeof(uint32_t));
+
+        // --- addressing.external.protocol_version ---
+        file_config->addressing_external_protocol_version = (uint8_t) conf_file_load__find_integer(
+            loaded_file, "addressing.external.protocol_version", 1, 2, NULL
         );
 
         // --- addressing.external.cache_size.main_addresses ---
         file_config->addressing_external_cache_size_main_addresses = (size_t) conf_file_load__find_integer(
-            entries, "addressing.external.cache_size.main_addresses", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_SIZE, NULL
+            loaded_file, "addressing.external.cache_size.main_addresses", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_SIZE, NULL
         );
 
         // --- addressing.external.cache_size.icmp_error_addresses ---
         file_config->addressing_external_cache_size_icmp_error_addresses = (size_t) conf_file_load__find_integer(
-            entries, "addressing.external.cache_size.icmp_error_addresses", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_SIZE, NULL
+            loaded_file, "addressing.external.cache_size.icmp_error_addresses", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_SIZE, NULL
+        );
+
+        // --- addressing.external.cache_size.prefix_mappings ---
+        file_config->addressing_external_cache_size_prefix_mappings = (size_t) conf_file_load__find_integer(
+            loaded_file, "addressing.external.cache_size.prefix_mappings", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_SIZE, NULL
         );
+
+        // --- addressing.external.cache_grace_period_seconds ---
+        file_config->addressing_external_cache_grace_period = (time_t) conf_file_load__find_integer(
+            loaded_file, "addressing.external.cache_grace_period_seconds", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_GRACE_PERIOD_SECONDS, NULL
+        );
+
+        // --- addressing.external.query_rate_limit.per_second ---
+        file_config->addressing_external_query_rate_limit_per_second = (uint32_t) conf_file_load__find_integer(
+            loaded_file, "addressing.external.query_rate_limit.per_second", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_QUERY_RATE_LIMIT, NULL
+        );
+
+        if(file_config->addressing_external_query_rate_limit_per_second > 0) {
+            // --- addressing.external.query_rate_limit.burst ---
+            file_config->addressing_external_query_rate_limit_burst = (uint32_t) conf_file_load__find_integer(
+                loaded_file, "addressing.external.query_rate_limit.burst", 1, TUNDRA__MAX_ADDRESSING_EXTERNAL_QUERY_RATE_LIMIT, NULL
+            );
+
+            // --- addressing.external.query_rate_limit.ipv4_prefix_length ---
+            file_config->addressing_external_query_rate_limit_ipv4_prefix_length = (uint8_t) conf_file_load__find_integer(
+                loaded_file, "addressing.external.query_rate_limit.ipv4_prefix_length", 0, 32, NULL
+            );
+
+            // --- addressing.external.query_rate_limit.ipv6_prefix_length ---
+            file_config->addressing_external_query_rate_limit_ipv6_prefix_length = (uint8_t) conf_file_load__find_integer(
+                loaded_file, "addressing.external.query_rate_limit.ipv6_prefix_length", 0, 128, NULL
+            );
+
+            // --- addressing.external.query_rate_limit.icmp ---
+            file_config->addressing_external_query_rate_limit_icmp = conf_file_load__find_boolean(
+                loaded_file, "addressing.external.query_rate_limit.icmp", NULL
+            );
+        } else {
+            file_config->addressing_external_query_rate_limit_burst = 0;
+            file_config->addressing_external_query_rate_limit_ipv4_prefix_length = 0;
+            file_config->addressing_external_query_rate_limit_ipv6_prefix_length = 0;
+            file_config->addressing_external_query_rate_limit_icmp = false;
+        }
+
+        // --- addressing.external.cache_file ---
+        {
+            const char *const cache_file = conf_file_load__find_string(loaded_file, "addressing.external.cache_file", PATH_MAX - 1, false);
+            file_config->addressing_external_cache_file = (UTILS__STR_EMPTY(cache_file) ? NULL : utils__duplicate_string(cache_file));
+        }
+
+        // --- addressing.external.cache_preload_file ---
+        {
+            const char *const cache_preload_file = conf_file_load__find_string(loaded_file, "addressing.external.cache_preload_file", PATH_MAX - 1, false);
+            file_config->addressing_external_cache_preload_file = (UTILS__STR_EMPTY(cache_preload_file) ? NULL : utils__duplicate_string(cache_preload_file));
+        }
     } else {
         file_config->addressing_external_transport = TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_NONE;
+        file_config->addressing_external_server_count = 0;
+        UTILS__MEM_ZERO_OUT(file_config->addressing_external_server_hash_seeds, TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS * sizeof(uint32_t));
+        file_config->addressing_external_protocol_version = 0;
         file_config->addressing_external_cache_size_main_addresses = 0;
         file_config->addressing_external_cache_size_icmp_error_addresses = 0;
+        file_config->addressing_external_cache_size_prefix_mappings = 0;
+        file_config->addressing_external_cache_grace_period = 0;
+        file_config->addressing_external_query_rate_limit_per_second = 0;
+        file_config->addressing_external_query_rate_limit_burst = 0;
+        file_config->addressing_external_query_rate_limit_ipv4_prefix_length = 0;
+        file_config->addressing_external_query_rate_limit_ipv6_prefix_length = 0;
+        file_config->addressing_external_query_rate_limit_icmp = false;
+        file_config->addressing_external_cache_file = NULL;
+        file_config->addressing_external_cache_preload_file = NULL;
     }
 }
 
-static void _parse_addressing_external_unix_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
-    UTILS__MEM_ZERO_OUT(&file_config->addressing_external_unix_socket_info, sizeof(struct sockaddr_un));
+static void _parse_addressing_external_unix_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    UTILS__MEM_ZERO_OUT(file_config->addressing_external_unix_socket_info, TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS * sizeof(struct sockaddr_un));
 
-    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && (file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX || file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM)) {
         // --- addressing.external.unix.path ---
-        file_config->addressing_external_unix_socket_info.sun_family = AF_UNIX;
-        strcpy(
-            file_config->addressing_external_unix_socket_info.sun_path,
-            conf_file_load__find_string(entries, "addressing.external.unix.path", sizeof(file_config->addressing_external_unix_socket_info.sun_path) - 1, true)
-        );
+        char *const paths = utils__duplicate_string(conf_file_load__find_string(loaded_file, "addressing.external.unix.path", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, true));
+        char *path_list[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS];
+        file_config->addressing_external_server_count = _split_comma_separated_list(loaded_file, paths, path_list, TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS, false, "addressing.external.unix.path");
+
+        for(size_t i = 0; i < file_config->addressing_external_server_count; i++) {
+            if(strlen(path_list[i]) > (sizeof(file_config->addressing_external_unix_socket_info[i].sun_path) - 1)) {
+                conf_file_load__fail(loaded_file, false, "The Unix socket path '%s' in the 'addressing.external.unix.path' option is too long!", path_list[i]);
+                continue;
+            }
+
+            file_config->addressing_external_unix_socket_info[i].sun_family = AF_UNIX;
+            strcpy(file_config->addressing_external_unix_socket_info[i].sun_path, path_list[i]);
+            file_config->addressing_external_server_hash_seeds[i] = _get_addressing_external_server_hash_seed(path_list[i]);
+        }
+
+        utils__free_memory(paths);
     }
 }
 
-static void _parse_addressing_external_tcp_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
-    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP) {
-        // --- addressing.external.tcp.host ---
-        const char *const host = conf_file_load__find_string(
-            entries, "addressing.external.tcp.host", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, true
-        );
+static void _parse_addressing_external_tcp_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    for(size_t i = 0; i < TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS; i++)
+        file_config->addressing_external_tcp_socket_info[i] = NULL;
+
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && (file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP || file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP)) {
+        // The 'udp' transport is configured in the same way as the 'tcp' one, just using its own options
+        const bool is_udp = (file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP);
+        const char *const host_option_name = (is_udp ? "addressing.external.udp.host" : "addressing.external.tcp.host");
+        const char *const port_option_name = (is_udp ? "addressing.external.udp.port" : "addressing.external.tcp.port");
+
+        // --- addressing.external.tcp.host / addressing.external.udp.host ---
+        char *const hosts = utils__duplicate_string(conf_file_load__find_string(
+            loaded_file, host_option_name, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, true
+        ));
+        char *host_list[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS];
+        file_config->addressing_external_server_count = _split_comma_separated_list(loaded_file, hosts, host_list, TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS, false, host_option_name);
 
-        // --- addressing.external.tcp.port ---
+        // --- addressing.external.tcp.port / addressing.external.udp.port ---
         const char *const port = conf_file_load__find_string(
-            entries, "addressing.external.tcp.port", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, true
+            loaded_file, port_option_name, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, true
         );
 
         struct addrinfo hints;
         UTILS__MEM_ZERO_OUT(&hints, sizeof(struct addrinfo));
         hints.ai_family = AF_UNSPEC;
-        hints.ai_socktype = SOCK_STREAM;
-        hints.ai_protocol = IPPROTO_TCP;
-
-        const int gai_return_value = getaddrinfo(host, port, (const struct addrinfo *) &hints, &file_config->addressing_external_tcp_socket_info);
-        if(gai_return_value != 0)
-            log__crash(false, "Failed to resolve the external TCP host ('%s') or port ('%s') using getaddrinfo(): %s", host, port, gai_strerror(gai_return_value));
-
-        if(file_config->addressing_external_tcp_socket_info == NULL)
-            log__crash(false, "Even though getaddrinfo() was successful, it saved NULL into the \"result\" variable!");
+        hints.ai_socktype = (is_udp ? SOCK_DGRAM : SOCK_STREAM);
+        hints.ai_protocol = (is_udp ? IPPROTO_UDP : IPPROTO_TCP);
+
+        // The hosts are not resolved if the file is already known to be invalid, as it might take a long time
+        for(size_t i = 0; i < file_config->addressing_external_server_count && !conf_file_load__has_failed(loaded_file); i++) {
+            const int gai_return_value = getaddrinfo(host_list[i], port, (const struct addrinfo *) &hints, &file_config->addressing_external_tcp_socket_info[i]);
+            if(gai_return_value != 0) {
+                file_config->addressing_external_tcp_socket_info[i] = NULL;
+                conf_file_load__fail(loaded_file, false, "Failed to resolve the external %s host ('%s') or port ('%s') using getaddrinfo(): %s", (is_udp ? "UDP" : "TCP"), host_list[i], port, gai_strerror(gai_return_value));
+                break;
+            }
+
+            if(file_config->addressing_external_tcp_socket_info[i] == NULL) {
+                conf_file_load__fail(loaded_file, false, "Even though getaddrinfo() was successful, it saved NULL into the \"result\" variable!");
+                break;
+            }
+
+            file_config->addressing_external_server_hash_seeds[i] = _get_addressing_external_server_hash_seed(host_list[i]);
+        }
 
-    } else {
-        file_config->addressing_external_tcp_socket_info = NULL;
+        utils__free_memory(hosts);
     }
 }
 
-static void _parse_addressing_external_unix_tcp_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_addressing_external_unix_tcp_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     UTILS__MEM_ZERO_OUT(&file_config->addressing_external_unix_tcp_timeout, sizeof(struct timeval));
 
-    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && (file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX || file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP)) {
+    // Despite their name, the 'unix_tcp' options apply to all the socket-based transports, including the datagram ones
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->addressing_external_transport != TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS) {
         // --- addressing.external.unix_tcp.timeout_milliseconds ---
         uint64_t timeout_milliseconds = conf_file_load__find_integer(
-            entries, "addressing.external.unix_tcp.timeout_milliseconds", TUNDRA__MIN_TIMEOUT_MILLISECONDS, TUNDRA__MAX_TIMEOUT_MILLISECONDS, NULL
+            loaded_file, "addressing.external.unix_tcp.timeout_milliseconds", TUNDRA__MIN_TIMEOUT_MILLISECONDS, TUNDRA__MAX_TIMEOUT_MILLISECONDS, NULL
         );
 
         file_config->addressing_external_unix_tcp_timeout.tv_sec = (time_t) (timeout_milliseconds / 1000);
         file_config->addressing_external_unix_tcp_timeout.tv_usec = (suseconds_t) ((timeout_milliseconds % 1000) * 1000);
+
+        // --- addressing.external.unix_tcp.circuit_breaker.failure_threshold ---
+        file_config->addressing_external_unix_tcp_circuit_breaker_failure_threshold = (uint32_t) conf_file_load__find_integer(
+            loaded_file, "addressing.external.unix_tcp.circuit_breaker.failure_threshold", 0, TUNDRA__MAX_CIRCUIT_BREAKER_FAILURE_THRESHOLD, NULL
+        );
+
+        if(file_config->addressing_external_unix_tcp_circuit_breaker_failure_threshold > 0) {
+            // --- addressing.external.unix_tcp.circuit_breaker.open_interval_seconds ---
+            file_config->addressing_external_unix_tcp_circuit_breaker_open_interval = (time_t) conf_file_load__find_integer(
+                loaded_file, "addressing.external.unix_tcp.circuit_breaker.open_interval_seconds", 1, TUNDRA__MAX_CIRCUIT_BREAKER_OPEN_INTERVAL_SECONDS, NULL
+            );
+
+            // --- addressing.external.unix_tcp.circuit_breaker.icmp ---
+            file_config->addressing_external_unix_tcp_circuit_breaker_icmp = conf_file_load__find_boolean(
+                loaded_file, "addressing.external.unix_tcp.circuit_breaker.icmp", NULL
+            );
+        } else {
+            file_config->addressing_external_unix_tcp_circuit_breaker_open_interval = 0;
+            file_config->addressing_external_unix_tcp_circuit_breaker_icmp = false;
+        }
+
+        if(file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM || file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP) {
+            // --- addressing.external.dgram.retransmissions ---
+            file_config->addressing_external_dgram_retransmissions = (uint32_t) conf_file_load__find_integer(
+                loaded_file, "addressing.external.dgram.retransmissions", 0, TUNDRA__MAX_ADDRESSING_EXTERNAL_DGRAM_RETRANSMISSIONS, NULL
+            );
+        } else {
+            file_config->addressing_external_dgram_retransmissions = 0;
+        }
+    } else {
+        file_config->addressing_external_unix_tcp_circuit_breaker_failure_threshold = 0;
+        file_config->addressing_external_unix_tcp_circuit_breaker_open_interval = 0;
+        file_config->addressing_external_unix_tcp_circuit_breaker_icmp = false;
+        file_config->addressing_external_dgram_retransmissions = 0;
+    }
+}
+
+static void _parse_addressing_plugin_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_PLUGIN) {
+        // --- addressing.plugin.path ---
+        file_config->addressing_plugin_path = utils__duplicate_string(
+            conf_file_load__find_string(loaded_file, "addressing.plugin.path", PATH_MAX - 1, true)
+        );
+
+        // --- addressing.plugin.argument ---
+        file_config->addressing_plugin_argument = utils__duplicate_string(
+            conf_file_load__find_string(loaded_file, "addressing.plugin.argument", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false)
+        );
+    } else {
+        file_config->addressing_plugin_path = NULL;
+        file_config->addressing_plugin_argument = NULL;
+    }
+}
+
+static void _parse_addressing_bpf_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    for(size_t i = 0; i < TUNDRA__MAX_ADDRESSING_BPF_MAPS; i++)
+        file_config->addressing_bpf_map_files[i] = NULL;
+
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_BPF) {
+        // --- addressing.bpf.program ---
+        file_config->addressing_bpf_program_file = utils__duplicate_string(
+            conf_file_load__find_string(loaded_file, "addressing.bpf.program", PATH_MAX - 1, true)
+        );
+
+        // --- addressing.bpf.maps ---
+        char *const maps = utils__duplicate_string(conf_file_load__find_string(loaded_file, "addressing.bpf.maps", CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false));
+        char *map_list[TUNDRA__MAX_ADDRESSING_BPF_MAPS];
+        file_config->addressing_bpf_map_count = _split_comma_separated_list(loaded_file, maps, map_list, TUNDRA__MAX_ADDRESSING_BPF_MAPS, true, "addressing.bpf.maps");
+
+        for(size_t i = 0; i < file_config->addressing_bpf_map_count; i++) {
+            if(strlen(map_list[i]) > (PATH_MAX - 1)) {
+                conf_file_load__fail(loaded_file, false, "The map file path '%s' in the 'addressing.bpf.maps' option is too long!", map_list[i]);
+                continue;
+            }
+
+            file_config->addressing_bpf_map_files[i] = utils__duplicate_string(map_list[i]);
+        }
+
+        utils__free_memory(maps);
+    } else {
+        file_config->addressing_bpf_program_file = NULL;
+        file_config->addressing_bpf_map_count = 0;
     }
 }
 
-static void _parse_translator_config(conf_file_load__conf_entry **entries, tundra__conf_file *const file_config) {
+static void _parse_addressing_map_t_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_MAP_T) {
+        // --- addressing.map_t.rules_file ---
+        file_config->addressing_map_t_rules_file = utils__duplicate_string(
+            conf_file_load__find_string(loaded_file, "addressing.map_t.rules_file", PATH_MAX - 1, true)
+        );
+    } else {
+        file_config->addressing_map_t_rules_file = NULL;
+    }
+}
+
+static void _parse_translator_config(conf_file_load__conf_file *const loaded_file, tundra__conf_file *const file_config) {
     // --- translator.ipv4.outbound_mtu ---
-    file_config->translator_ipv4_outbound_mtu = (size_t) conf_file_load__find_integer(entries, "translator.ipv4.outbound_mtu", TUNDRA__MIN_MTU_IPV4, TUNDRA__MAX_MTU_IPV4, NULL);
+    file_config->translator_ipv4_outbound_mtu = (size_t) conf_file_load__find_integer(loaded_file, "translator.ipv4.outbound_mtu", TUNDRA__MIN_MTU_IPV4, TUNDRA__MAX_MTU_IPV4, NULL);
 
     // --- translator.ipv6.outbound_mtu ---
-    file_config->translator_ipv6_outbound_mtu = (size_t) conf_file_load__find_integer(entries, "translator.ipv6.outbound_mtu", TUNDRA__MIN_MTU_IPV6, TUNDRA__MAX_MTU_IPV6, NULL);
+    file_config->translator_ipv6_outbound_mtu = (size_t) conf_file_load__find_integer(loaded_file, "translator.ipv6.outbound_mtu", TUNDRA__MIN_MTU_IPV6, TUNDRA__MAX_MTU_IPV6, NULL);
 
 
     // --- translator.6to4.copy_dscp_and_ecn ---
-    file_config->translator_6to4_copy_dscp_and_ecn = conf_file_load__find_boolean(entries, "translator.6to4.copy_dscp_and_ecn", NULL);
+    file_config->translator_6to4_copy_dscp_and_ecn = conf_file_load__find_boolean(loaded_file, "translator.6to4.copy_dscp_and_ecn", NULL);
 
     // --- translator.4to6.copy_dscp_and_ecn ---
-    file_config->translator_4to6_copy_dscp_and_ecn = conf_file_load__find_boolean(entries, "translator.4to6.copy_dscp_and_ecn", NULL);
+    file_config->translator_4to6_copy_dscp_and_ecn = conf_file_load__find_boolean(loaded_file, "translator.4to6.copy_dscp_and_ecn", NULL);
+
+
+    // --- translator.hairpinning ---
+    file_config->translator_hairpinning = conf_file_load__find_boolean(loaded_file, "translator.hairpinning", NULL);
 }
 
-static uid_t _get_uid_by_username(const char *const username) {
+static uid_t _get_uid_by_username(conf_file_load__conf_file *const loaded_file, const char *const username) {
     struct passwd *passwd_entry = getpwnam(username);
-    if(passwd_entry == NULL)
-        log__crash(false, "A user named '%s' could not be found!", username);
+    if(passwd_entry == NULL) {
+        conf_file_load__fail(loaded_file, false, "A user named '%s' could not be found!", username);
+        return 0;
+    }
 
     return passwd_entry->pw_uid;
 }
 
-static gid_t _get_gid_by_groupname(const char *const groupname) {
+static gid_t _get_gid_by_groupname(conf_file_load__conf_file *const loaded_file, const char *const groupname) {
     struct group *group_entry = getgrnam(groupname);
-    if(group_entry == NULL)
-        log__crash(false, "A group named '%s' could not be found!", groupname);
+    if(group_entry == NULL) {
+        conf_file_load__fail(loaded_file, false, "A group named '%s' could not be found!", groupname);
+        return 0;
+    }
 
     return group_entry->gr_gid;
 }
 
-static tundra__io_mode _get_io_mode_from_string(const char *const io_mode_string) {
+static tundra__io_mode _get_io_mode_from_string(conf_file_load__conf_file *const loaded_file, const char *const io_mode_string) {
     if(UTILS__STR_EQ(io_mode_string, "inherited-fds"))
         return TUNDRA__IO_MODE_INHERITED_FDS;
 
     if(UTILS__STR_EQ(io_mode_string, "tun"))
         return TUNDRA__IO_MODE_TUN;
 
-    log__crash(false, "Invalid I/O mode string: '%s'", io_mode_string);
+    conf_file_load__fail(loaded_file, false, "Invalid I/O mode string: '%s'", io_mode_string);
+    return TUNDRA__IO_MODE_INHERITED_FDS;
 }
 
-static tundra__addressing_mode _get_addressing_mode_from_string(const char *const addressing_mode_string) {
+static tundra__addressing_mode _get_addressing_mode_from_string(conf_file_load__conf_file *const loaded_file, const char *const addressing_mode_string) {
     if(UTILS__STR_EQ(addressing_mode_string, "nat64"))
         return TUNDRA__ADDRESSING_MODE_NAT64;
 
@@ -368,10 +727,23 @@ static tundra__addressing_mode _get_addressing_mode_from_string(const char *cons
     if(UTILS__STR_EQ(addressing_mode_string, "external"))
         return TUNDRA__ADDRESSING_MODE_EXTERNAL;
 
-    log__crash(false, "Invalid addressing mode string: '%s'", addressing_mode_string);
+    if(UTILS__STR_EQ(addressing_mode_string, "plugin"))
+        return TUNDRA__ADDRESSING_MODE_PLUGIN;
+
+    if(UTILS__STR_EQ(addressing_mode_string, "bpf"))
+        return TUNDRA__ADDRESSING_MODE_BPF;
+
+    if(UTILS__STR_EQ(addressing_mode_string, "nat64-stateful"))
+        return TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL;
+
+    if(UTILS__STR_EQ(addressing_mode_string, "map-t"))
+        return TUNDRA__ADDRESSING_MODE_MAP_T;
+
+    conf_file_load__fail(loaded_file, false, "Invalid addressing mode string: '%s'", addressing_mode_string);
+    return TUNDRA__ADDRESSING_MODE_NAT64;
 }
 
-static tundra__addressing_external_transport _get_addressing_external_transport_from_string(const char *const addressing_external_transport_string) {
+static tundra__addressing_external_transport _get_addressing_external_transport_from_string(conf_file_load__conf_file *const loaded_file, const char *const addressing_external_transport_string) {
     if(UTILS__STR_EQ(addressing_external_transport_string, "inherited-fds"))
         return TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS;
 
@@ -381,7 +753,61 @@ static tundra__addressing_external_transport _get_addressing_external_transport_
     if(UTILS__STR_EQ(addressing_external_transport_string, "tcp"))
         return TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP;
 
-    log__crash(false, "Invalid addressing external transport string: '%s'", addressing_external_transport_string);
+    if(UTILS__STR_EQ(addressing_external_transport_string, "unix-dgram"))
+        return TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM;
+
+    if(UTILS__STR_EQ(addressing_external_transport_string, "udp"))
+        return TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP;
+
+    conf_file_load__fail(loaded_file, false, "Invalid addressing external transport string: '%s'", addressing_external_transport_string);
+    return TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS;
+}
+
+// Splits the comma-separated list in-place; the whitespace surrounding the items is stripped
+static size_t _split_comma_separated_list(conf_file_load__conf_file *const loaded_file, char *list_string, char **out_item_strings, const size_t max_items, const bool allow_empty_list, const char *const option_name) {
+    size_t item_count = 0;
+    char *save_ptr = NULL;
+
+    for(char *item_string = strtok_r(list_string, ",", &save_ptr); item_string != NULL; item_string = strtok_r(NULL, ",", &save_ptr)) {
+        while(isspace(*item_string))
+            item_string++;
+
+        char *end = item_string + strlen(item_string) - 1;
+        while(end >= item_string && isspace(*end))
+            *(end--) = '\0';
+
+        if(UTILS__STR_EMPTY(item_string)) {
+            if(allow_empty_list && item_count == 0 && strtok_r(NULL, ",", &save_ptr) == NULL)
+                break;  // A list consisting only of whitespace is empty
+
+            conf_file_load__fail(loaded_file, false, "The '%s' option contains an empty item!", option_name);
+            return item_count;
+        }
+
+        if(item_count >= max_items) {
+            conf_file_load__fail(loaded_file, false, "The '%s' option must not contain more than %zu items!", option_name, max_items);
+            return item_count;
+        }
+
+        out_item_strings[item_count++] = item_string;
+    }
+
+    if(item_count == 0 && !allow_empty_list)
+        conf_file_load__fail(loaded_file, false, "The '%s' option does not contain any items!", option_name);
+
+    return item_count;
+}
+
+static uint32_t _get_addressing_external_server_hash_seed(const char *server_string) {
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261;
+
+    for(; *server_string != '\0'; server_string++) {
+        hash ^= (uint32_t) (uint8_t) *server_string;
+        hash *= 16777619;
+    }
+
+    return hash;
 }
 
 static uint64_t _get_fallback_translator_threads(void) {
@@ -395,8 +821,39 @@ void conf_file__free_parsed_config_file(tundra__conf_file *const file_config) {
     if(file_config->io_tun_interface_name != NULL)
         utils__free_memory(file_config->io_tun_interface_name);
 
-    if(file_config->addressing_external_tcp_socket_info != NULL)
-        freeaddrinfo(file_config->addressing_external_tcp_socket_info);
+    if(file_config->addressing_external_cache_file != NULL)
+        utils__free_memory(file_config->addressing_external_cache_file);
+
+    if(file_config->addressing_external_cache_preload_file != NULL)
+        utils__free_memory(file_config->addressing_external_cache_preload_file);
+
+    if(file_config->addressing_plugin_path != NULL)
+        utils__free_memory(file_config->addressing_plugin_path);
+
+    if(file_config->addressing_plugin_argument != NULL)
+        utils__free_memory(file_config->addressing_plugin_argument);
+
+    if(file_config->addressing_bpf_program_file != NULL)
+        utils__free_memory(file_config->addressing_bpf_program_file);
+
+    for(size_t i = 0; i < TUNDRA__MAX_ADDRESSING_BPF_MAPS; i++) {
+        if(file_config->addressing_bpf_map_files[i] != NULL)
+            utils__free_memory(file_config->addressing_bpf_map_files[i]);
+    }
+
+    if(file_config->addressing_map_t_rules_file != NULL)
+        utils__free_memory(file_config->addressing_map_t_rules_file);
+
+    if(file_config->addressing_siit_eam_file != NULL)
+        utils__free_memory(file_config->addressing_siit_eam_file);
+
+    if(file_config->addressing_nat64_clat_siit_rfc7050_cache_file != NULL)
+        utils__free_memory(file_config->addressing_nat64_clat_siit_rfc7050_cache_file);
+
+    for(size_t i = 0; i < TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS; i++) {
+        if(file_config->addressing_external_tcp_socket_info[i] != NULL)
+            freeaddrinfo(file_config->addressing_external_tcp_socket_info[i]);
+    }
 
     utils__free_memory(file_config);
 }
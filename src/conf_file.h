@@ -24,4 +24,5 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 extern tundra__conf_file *conf_file__read_and_parse_config_file(const char *const filepath);
+extern tundra__conf_file *conf_file__try_read_and_parse_config_file(const char *const filepath, const tundra__conf_file *const current_file_config, char *error_message, const size_t error_message_size);
 extern void conf_file__free_parsed_config_file(tundra__conf_file *const file_config);
@@ -24,50 +24,54 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include"utils.h"
 #include"utils_ip.h"
-#include"log.h"
 
 
 #define _LINE_BUFFER_SIZE 4096
 
 
-static conf_file_load__conf_entry **_read_open_config_file(FILE *const conf_file_stream);
+static void _read_open_config_file(conf_file_load__conf_file *const loaded_file, FILE *const conf_file_stream);
 static char *_strip_whitespace(char *string);
 static const char *_get_entry_value_by_key(conf_file_load__conf_entry **entries, const char *const key);
 
 
-conf_file_load__conf_entry **conf_file_load__read_config_file(const char *const filepath) {
-    conf_file_load__conf_entry **entries = NULL;
+// Always returns a loaded file - if the file cannot be read, the error is recorded in it (see conf_file_load.h)
+conf_file_load__conf_file *conf_file_load__read_config_file(const char *const filepath) {
+    conf_file_load__conf_file *loaded_file = utils__alloc_zeroed_out_memory(1, sizeof(conf_file_load__conf_file));
+    loaded_file->entries = utils__alloc_zeroed_out_memory(1, sizeof(conf_file_load__conf_entry *));
+    *loaded_file->entries = NULL;
+    loaded_file->error_message[0] = '\0';
 
     if(UTILS__STR_EQ(filepath, "-")) {
-        entries = _read_open_config_file(stdin);
-    } else {
-        FILE *const conf_file_stream = fopen(filepath, "r");
-        if(conf_file_stream == NULL)
-            log__crash(true, "Failed to open the configuration file: %s", filepath);
-
-        const int conf_file_fd = fileno(conf_file_stream);
-        if(conf_file_fd < 0)
-            log__crash(true, "Failed to get the file descriptor of the open configuration file: %s", filepath);
+        _read_open_config_file(loaded_file, stdin);
+        return loaded_file;
+    }
 
-        if(flock(conf_file_fd, LOCK_SH) != 0)
-            log__crash(true, "Failed to lock the open configuration file: %s", filepath);
+    FILE *const conf_file_stream = fopen(filepath, "r");
+    if(conf_file_stream == NULL) {
+        conf_file_load__fail(loaded_file, true, "Failed to open the configuration file: %s", filepath);
+        return loaded_file;
+    }
 
-        entries = _read_open_config_file(conf_file_stream);
+    const int conf_file_fd = fileno(conf_file_stream);
+    if(conf_file_fd < 0) {
+        conf_file_load__fail(loaded_file, true, "Failed to get the file descriptor of the open configuration file: %s", filepath);
+    } else if(flock(conf_file_fd, LOCK_SH) != 0) {
+        conf_file_load__fail(loaded_file, true, "Failed to lock the open configuration file: %s", filepath);
+    } else {
+        _read_open_config_file(loaded_file, conf_file_stream);
 
         if(flock(conf_file_fd, LOCK_UN) != 0)
-            log__crash(true, "Failed to unlock the open configuration file: %s", filepath);
-
-        if(fclose(conf_file_stream) != 0)
-            log__crash(true, "Failed to close the configuration file: %s", filepath);
+            conf_file_load__fail(loaded_file, true, "Failed to unlock the open configuration file: %s", filepath);
     }
 
-    return entries;
+    if(fclose(conf_file_stream) != 0)
+        conf_file_load__fail(loaded_file, true, "Failed to close the configuration file: %s", filepath);
+
+    return loaded_file;
 }
 
-static conf_file_load__conf_entry** _read_open_config_file(FILE *const conf_file_stream) {
+static void _read_open_config_file(conf_file_load__conf_file *const loaded_file, FILE *const conf_file_stream) {
     size_t entry_index = 0;
-    conf_file_load__conf_entry **entries = utils__alloc_zeroed_out_memory(1, sizeof(conf_file_load__conf_entry *));
-    *entries = NULL;
 
     char line_buffer[_LINE_BUFFER_SIZE];
     for(int line_number = 1; fgets(line_buffer, _LINE_BUFFER_SIZE, conf_file_stream) != NULL; line_number++) {
@@ -78,28 +82,32 @@ static conf_file_load__conf_entry** _read_open_config_file(FILE *const conf_file
             break;
 
         char *value_ptr = strchr(key_ptr, '=');
-        if(value_ptr == NULL)
-            log__crash(false, "Line %d of the configuration file does not contain a '=' character!", line_number);
+        if(value_ptr == NULL) {
+            conf_file_load__fail(loaded_file, false, "Line %d of the configuration file does not contain a '=' character!", line_number);
+            return;
+        }
         *(value_ptr++) = '\0';
 
         key_ptr = _strip_whitespace(key_ptr);
         value_ptr = _strip_whitespace(value_ptr);
-        if(UTILS__STR_EMPTY(key_ptr))
-            log__crash(false, "The entry on line %d of the configuration file does not have a key!", line_number);
+        if(UTILS__STR_EMPTY(key_ptr)) {
+            conf_file_load__fail(loaded_file, false, "The entry on line %d of the configuration file does not have a key!", line_number);
+            return;
+        }
 
-        if(_get_entry_value_by_key(entries, key_ptr) != NULL)
-            log__crash(false, "The key '%s' is specified more than once in the configuration file!", key_ptr);
+        if(_get_entry_value_by_key(loaded_file->entries, key_ptr) != NULL) {
+            conf_file_load__fail(loaded_file, false, "The key '%s' is specified more than once in the configuration file!", key_ptr);
+            return;
+        }
 
         conf_file_load__conf_entry *new_entry = utils__alloc_zeroed_out_memory(1, sizeof(conf_file_load__conf_entry));
         new_entry->key = utils__duplicate_string(key_ptr);
         new_entry->value = utils__duplicate_string(value_ptr);
 
-        entries = utils__realloc_memory(entries, entry_index + 2, sizeof(conf_file_load__conf_entry *));
-        entries[entry_index++] = new_entry;
-        entries[entry_index] = NULL;
+        loaded_file->entries = utils__realloc_memory(loaded_file->entries, entry_index + 2, sizeof(conf_file_load__conf_entry *));
+        loaded_file->entries[entry_index++] = new_entry;
+        loaded_file->entries[entry_index] = NULL;
     }
-
-    return entries;
 }
 
 static char *_strip_whitespace(char *string) {
@@ -116,14 +124,37 @@ static char *_strip_whitespace(char *string) {
     return string;
 }
 
-void conf_file_load__free_config_file(conf_file_load__conf_entry **entries) {
-    for(conf_file_load__conf_entry **current_entry = entries; *current_entry != NULL; current_entry++) {
+void conf_file_load__free_config_file(conf_file_load__conf_file *loaded_file) {
+    for(conf_file_load__conf_entry **current_entry = loaded_file->entries; *current_entry != NULL; current_entry++) {
         utils__free_memory((*current_entry)->key);
         utils__free_memory((*current_entry)->value);
         utils__free_memory(*current_entry);
     }
 
-    utils__free_memory(entries);
+    utils__free_memory(loaded_file->entries);
+    utils__free_memory(loaded_file);
+}
+
+// Only the first error is recorded, as the following ones are usually just its consequences
+void conf_file_load__fail(conf_file_load__conf_file *const loaded_file, const bool print_errno, const char *format, ...) {
+    const int saved_errno = errno;
+
+    if(conf_file_load__has_failed(loaded_file))
+        return;
+
+    va_list argument_list;
+    va_start(argument_list, format);
+    vsnprintf(loaded_file->error_message, CONF_FILE_LOAD__ERROR_MESSAGE_SIZE, format, argument_list);
+    va_end(argument_list);
+
+    if(print_errno) {
+        const size_t message_length = strlen(loaded_file->error_message);
+        snprintf(loaded_file->error_message + message_length, CONF_FILE_LOAD__ERROR_MESSAGE_SIZE - message_length, " [Errno %d: %s]", saved_errno, strerror(saved_errno));
+    }
+}
+
+bool conf_file_load__has_failed(const conf_file_load__conf_file *const loaded_file) {
+    return !UTILS__STR_EMPTY(loaded_file->error_message);
 }
 
 static const char *_get_entry_value_by_key(conf_file_load__conf_entry **entries, const char *const key) {
@@ -137,42 +168,55 @@ static const char *_get_entry_value_by_key(conf_file_load__conf_entry **entries,
     return NULL;
 }
 
-const char *conf_file_load__find_string(conf_file_load__conf_entry **entries, const char *const key, const size_t max_chars, const bool empty_string_forbidden) {
-    const char *const string_value = _get_entry_value_by_key(entries, key);
+// On failure, an empty string is returned
+const char *conf_file_load__find_string(conf_file_load__conf_file *const loaded_file, const char *const key, const size_t max_chars, const bool empty_string_forbidden) {
+    const char *const string_value = _get_entry_value_by_key(loaded_file->entries, key);
 
-    if(string_value == NULL)
-        log__crash(false, "The key '%s' could not be found in the configuration file!", key);
+    if(string_value == NULL) {
+        conf_file_load__fail(loaded_file, false, "The key '%s' could not be found in the configuration file!", key);
+        return "";
+    }
 
     if(empty_string_forbidden && UTILS__STR_EMPTY(string_value))
-        log__crash(false, "The '%s' configuration file option's string value must not be empty!", key);
+        conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's string value must not be empty!", key);
 
     size_t string_length = strlen(string_value);
-    if(string_length > max_chars)
-        log__crash(false, "The '%s' configuration file option's string value must not have more than %zu characters (got %zu)!", key, max_chars, string_length);
+    if(string_length > max_chars) {
+        conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's string value must not have more than %zu characters (got %zu)!", key, max_chars, string_length);
+        return "";
+    }
 
     return string_value;
 }
 
-uint64_t conf_file_load__find_integer(conf_file_load__conf_entry **entries, const char *const key, const uint64_t min_value, const uint64_t max_value, uint64_t (*const fallback_value_getter)(void)) {
-    const char *const string_value = conf_file_load__find_string(entries, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
+// On failure, 'min_value' is returned
+uint64_t conf_file_load__find_integer(conf_file_load__conf_file *const loaded_file, const char *const key, const uint64_t min_value, const uint64_t max_value, uint64_t (*const fallback_value_getter)(void)) {
+    const char *const string_value = conf_file_load__find_string(loaded_file, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
 
     uint64_t integer_value;
-    if(UTILS__STR_EMPTY(string_value) && fallback_value_getter != NULL)
+    if(UTILS__STR_EMPTY(string_value) && fallback_value_getter != NULL) {
         integer_value = (*fallback_value_getter)();
-    else if(sscanf(string_value, "%"SCNu64, &integer_value) != 1)
-        log__crash(false, "The '%s' configuration file option's value is not a valid integer: '%s'", key, string_value);
+    } else if(sscanf(string_value, "%"SCNu64, &integer_value) != 1) {
+        conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's value is not a valid integer: '%s'", key, string_value);
+        return min_value;
+    }
 
-    if(integer_value < min_value)
-        log__crash(false, "The '%s' configuration file option's integer value must not be less than %"PRIu64" (got %"PRIu64")!", key, min_value, integer_value);
+    if(integer_value < min_value) {
+        conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's integer value must not be less than %"PRIu64" (got %"PRIu64")!", key, min_value, integer_value);
+        return min_value;
+    }
 
-    if(integer_value > max_value)
-        log__crash(false, "The '%s' configuration file option's integer value must not be more than %"PRIu64" (got %"PRIu64")!", key, max_value, integer_value);
+    if(integer_value > max_value) {
+        conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's integer value must not be more than %"PRIu64" (got %"PRIu64")!", key, max_value, integer_value);
+        return min_value;
+    }
 
     return integer_value;
 }
 
-bool conf_file_load__find_boolean(conf_file_load__conf_entry **entries, const char *const key, bool (*const fallback_value_getter)(void)) {
-    const char *const string_value = conf_file_load__find_string(entries, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
+// On failure, false is returned
+bool conf_file_load__find_boolean(conf_file_load__conf_file *const loaded_file, const char *const key, bool (*const fallback_value_getter)(void)) {
+    const char *const string_value = conf_file_load__find_string(loaded_file, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
 
     if(UTILS__STR_EMPTY(string_value) && fallback_value_getter != NULL)
         return (*fallback_value_getter)();
@@ -193,48 +237,100 @@ bool conf_file_load__find_boolean(conf_file_load__conf_entry **entries, const ch
         UTILS__STR_EQ_CI(string_value, "off")
     ) return false;
 
-    log__crash(false, "The '%s' configuration file option's value is not a valid boolean: '%s'", key, string_value);
+    conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's value is not a valid boolean: '%s'", key, string_value);
+    return false;
 }
 
-void conf_file_load__find_ipv4_address(conf_file_load__conf_entry **entries, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination)) {
-    const char *const string_value = conf_file_load__find_string(entries, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
+// On failure, the destination is zeroed out
+void conf_file_load__find_ipv4_address(conf_file_load__conf_file *const loaded_file, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination)) {
+    const char *const string_value = conf_file_load__find_string(loaded_file, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
 
     if(UTILS__STR_EMPTY(string_value) && fallback_value_getter != NULL) {
         (*fallback_value_getter)(destination);
     } else {
         struct in_addr ipv4_address_value;
-        if(inet_aton(string_value, &ipv4_address_value) == 0)
-            log__crash(false, "The '%s' configuration file option's value is not a valid IPv4 address: '%s'", key, string_value);
+        if(inet_aton(string_value, &ipv4_address_value) == 0) {
+            conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's value is not a valid IPv4 address: '%s'", key, string_value);
+            UTILS__MEM_ZERO_OUT(destination, 4);
+            return;
+        }
 
         memcpy(destination, &ipv4_address_value.s_addr, 4);
     }
 
-    if(utils_ip__is_ipv4_addr_unusable(destination))
-        log__crash(false, "The IPv4 address specified in the '%s' configuration file option is valid, but not usable: '%s'", key, string_value);
+    if(utils_ip__is_ipv4_addr_unusable(destination)) {
+        conf_file_load__fail(loaded_file, false, "The IPv4 address specified in the '%s' configuration file option is valid, but not usable: '%s'", key, string_value);
+        UTILS__MEM_ZERO_OUT(destination, 4);
+    }
 }
 
-void conf_file_load__find_ipv6_address(conf_file_load__conf_entry **entries, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination)) {
-    const char *const string_value = conf_file_load__find_string(entries, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
+// On failure, the destination is zeroed out
+void conf_file_load__find_ipv6_address(conf_file_load__conf_file *const loaded_file, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination)) {
+    const char *const string_value = conf_file_load__find_string(loaded_file, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
 
     if(UTILS__STR_EMPTY(string_value) && fallback_value_getter != NULL) {
         (*fallback_value_getter)(destination);
     } else {
         struct in6_addr ipv6_address_value;
-        if(inet_pton(AF_INET6, string_value, &ipv6_address_value) != 1)
-            log__crash(false, "The '%s' configuration file option's value is not a valid IPv6 address: '%s'", key, string_value);
+        if(inet_pton(AF_INET6, string_value, &ipv6_address_value) != 1) {
+            conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's value is not a valid IPv6 address: '%s'", key, string_value);
+            UTILS__MEM_ZERO_OUT(destination, 16);
+            return;
+        }
 
         memcpy(destination, ipv6_address_value.s6_addr, 16);
     }
 
-    if(utils_ip__is_ipv6_addr_unusable(destination))
-        log__crash(false, "The IPv6 address specified in the '%s' configuration file option is valid, but not usable: '%s'", key, string_value);
+    if(utils_ip__is_ipv6_addr_unusable(destination)) {
+        conf_file_load__fail(loaded_file, false, "The IPv6 address specified in the '%s' configuration file option is valid, but not usable: '%s'", key, string_value);
+        UTILS__MEM_ZERO_OUT(destination, 16);
+    }
 }
 
-void conf_file_load__find_ipv6_prefix(conf_file_load__conf_entry **entries, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination)) {
-    conf_file_load__find_ipv6_address(entries, key, destination, fallback_value_getter);
+// If the value does not contain a prefix length, /96 is assumed. On failure, a zeroed-out /96 prefix is returned.
+void conf_file_load__find_ipv6_prefix(conf_file_load__conf_file *const loaded_file, const char *const key, uint8_t *destination, uint8_t *out_prefix_length, void (*const fallback_value_getter)(uint8_t *destination, uint8_t *out_prefix_length)) {
+    const char *const string_value = conf_file_load__find_string(loaded_file, key, CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS, false);
+
+    bool is_prefix_valid = true;
+    if(UTILS__STR_EMPTY(string_value) && fallback_value_getter != NULL) {
+        (*fallback_value_getter)(destination, out_prefix_length);
+    } else if(strchr(string_value, '/') == NULL) {
+        struct in6_addr ipv6_address_value;
+        if(inet_pton(AF_INET6, string_value, &ipv6_address_value) != 1) {
+            conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's value is not a valid IPv6 prefix: '%s'", key, string_value);
+            is_prefix_valid = false;
+        } else {
+            memcpy(destination, ipv6_address_value.s6_addr, 16);
+            *out_prefix_length = 96;
+
+            if(!UTILS__MEM_EQ((destination + 12), "\x00\x00\x00\x00", 4)) {
+                conf_file_load__fail(loaded_file, false, "The last 4 bytes of '%s' must be 0, as it is supposed to be an IPv6 /96 prefix (if no prefix length is specified)!", key);
+                is_prefix_valid = false;
+            }
+        }
+    } else {
+        char *const prefix_string = utils__duplicate_string(string_value);
+        is_prefix_valid = utils_ip__parse_prefix_string(prefix_string, AF_INET6, destination, out_prefix_length);
+        utils__free_memory(prefix_string);
+
+        if(!is_prefix_valid)
+            conf_file_load__fail(loaded_file, false, "The '%s' configuration file option's value is not a valid IPv6 prefix (or its bits following its length are not zero): '%s'", key, string_value);
+    }
 
-    if(!UTILS__MEM_EQ((destination + 12), "\x00\x00\x00\x00", 4))
-        log__crash(false, "The last 4 bytes of '%s' must be 0, as it is supposed to be an IPv6 /96 prefix!", key);
+    if(is_prefix_valid && !utils_ip__is_rfc6052_prefix_length_valid(*out_prefix_length)) {
+        conf_file_load__fail(loaded_file, false, "The length of '%s' must be 32, 40, 48, 56, 64 or 96 bits (see RFC 6052)!", key);
+        is_prefix_valid = false;
+    }
+
+    if(is_prefix_valid && utils_ip__is_ipv6_addr_unusable(destination)) {
+        conf_file_load__fail(loaded_file, false, "The IPv6 prefix specified in the '%s' configuration file option is valid, but not usable: '%s'", key, string_value);
+        is_prefix_valid = false;
+    }
+
+    if(!is_prefix_valid) {
+        UTILS__MEM_ZERO_OUT(destination, 16);
+        *out_prefix_length = 96;
+    }
 }
 
 
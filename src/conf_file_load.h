@@ -26,6 +26,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define CONF_FILE_LOAD__FIND_STRING_NO_MAX_CHARS SIZE_MAX
 #define CONF_FILE_LOAD__FIND_INTEGER_NO_MIN_VALUE 0
 #define CONF_FILE_LOAD__FIND_INTEGER_NO_MAX_VALUE UINT64_MAX
+#define CONF_FILE_LOAD__ERROR_MESSAGE_SIZE ((size_t) 512)
 
 
 typedef struct conf_file_load__conf_entry {
@@ -33,12 +34,24 @@ typedef struct conf_file_load__conf_entry {
     char *value;
 } conf_file_load__conf_entry;
 
-
-extern conf_file_load__conf_entry **conf_file_load__read_config_file(const char *const filepath);
-extern void conf_file_load__free_config_file(conf_file_load__conf_entry **entries);
-extern const char *conf_file_load__find_string(conf_file_load__conf_entry **entries, const char *const key, const size_t max_chars, const bool empty_string_forbidden);
-extern uint64_t conf_file_load__find_integer(conf_file_load__conf_entry **entries, const char *const key, const uint64_t min_value, const uint64_t max_value, uint64_t (*const fallback_value_getter)(void));
-extern bool conf_file_load__find_boolean(conf_file_load__conf_entry **entries, const char *const key, bool (*const fallback_value_getter)(void));
-extern void conf_file_load__find_ipv4_address(conf_file_load__conf_entry **entries, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination));
-extern void conf_file_load__find_ipv6_address(conf_file_load__conf_entry **entries, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination));
-extern void conf_file_load__find_ipv6_prefix(conf_file_load__conf_entry **entries, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination));
+// The functions below do not crash the program when the configuration file is invalid, as the file may also be
+//  (re)loaded while the translator is running. Instead, the first error is recorded, and the function which has
+//  encountered it returns a placeholder value, so that the parser does not have to check for an error after every
+//  option; it is supposed to call conf_file_load__has_failed() once it has finished (and before it does anything
+//  expensive, e.g. resolving hostnames).
+typedef struct conf_file_load__conf_file {
+    conf_file_load__conf_entry **entries;
+    char error_message[CONF_FILE_LOAD__ERROR_MESSAGE_SIZE]; // Empty if no error has occurred
+} conf_file_load__conf_file;
+
+
+extern conf_file_load__conf_file *conf_file_load__read_config_file(const char *const filepath);
+extern void conf_file_load__free_config_file(conf_file_load__conf_file *loaded_file);
+extern void conf_file_load__fail(conf_file_load__conf_file *const loaded_file, const bool print_errno, const char *format, ...);
+extern bool conf_file_load__has_failed(const conf_file_load__conf_file *const loaded_file);
+extern const char *conf_file_load__find_string(conf_file_load__conf_file *const loaded_file, const char *const key, const size_t max_chars, const bool empty_string_forbidden);
+extern uint64_t conf_file_load__find_integer(conf_file_load__conf_file *const loaded_file, const char *const key, const uint64_t min_value, const uint64_t max_value, uint64_t (*const fallback_value_getter)(void));
+extern bool conf_file_load__find_boolean(conf_file_load__conf_file *const loaded_file, const char *const key, bool (*const fallback_value_getter)(void));
+extern void conf_file_load__find_ipv4_address(conf_file_load__conf_file *const loaded_file, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination));
+extern void conf_file_load__find_ipv6_address(conf_file_load__conf_file *const loaded_file, const char *const key, uint8_t *destination, void (*const fallback_value_getter)(uint8_t *destination));
+extern void conf_file_load__find_ipv6_prefix(conf_file_load__conf_file *const loaded_file, const char *const key, uint8_t *destination, uint8_t *out_prefix_length, void (*const fallback_value_getter)(uint8_t *destination, uint8_t *out_prefix_length));
@@ -0,0 +1,388 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include"tundra.h"
+#include"conf_reload.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"log.h"
+#include"conf_file.h"
+#include"xlat_addr_siit_eam.h"
+
+
+#define _ERROR_MESSAGE_SIZE ((size_t) 512)
+
+
+static tundra__conf_file_version *_create_version(const tundra__conf_file *const config, tundra__conf_file *owned_config, tundra__siit_eam_state *siit_eam_state);
+static void _free_version(tundra__conf_reload_state *conf_reload_state, tundra__conf_file_version *version);
+static const char *_find_changed_non_reloadable_option(const tundra__conf_file *const old_config, const tundra__conf_file *const new_config);
+static bool _are_strings_different(const char *const string1, const char *const string2);
+static bool _are_external_servers_different(const tundra__conf_file *const old_config, const tundra__conf_file *const new_config);
+
+
+// This function must be called before the program's working directory is changed, as the configuration file's path
+//  may be relative. The initial version takes ownership of 'siit_eam_state', but not of 'file_config'.
+tundra__conf_reload_state *conf_reload__create_state(const char *const config_file_path, const tundra__conf_file *const file_config, tundra__siit_eam_state *siit_eam_state) {
+    tundra__conf_reload_state *conf_reload_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__conf_reload_state));
+    if(pthread_mutex_init(&conf_reload_state->mutex, NULL) != 0)
+        exit(TUNDRA__EXIT_MUTEX_FAILURE);
+
+    conf_reload_state->current_version = _create_version(file_config, NULL, siit_eam_state);  // The state holds a reference to its current version
+    conf_reload_state->generation = 0;
+
+    if(UTILS__STR_EQ(config_file_path, "-")) {
+        conf_reload_state->config_file_path = NULL;
+    } else {
+        char *absolute_path = realpath(config_file_path, NULL);
+        if(absolute_path == NULL)
+            log__crash(true, "Failed to resolve the absolute path of the configuration file '%s'!", config_file_path);
+
+        // The string is copied, so that it is allocated (and later freed) in the same way as the program's other strings
+        conf_reload_state->config_file_path = utils__duplicate_string(absolute_path);
+        free(absolute_path);
+    }
+
+    return conf_reload_state;
+}
+
+// This function must be called after all the translator threads have been terminated and have released their versions!
+void conf_reload__free_state(tundra__conf_reload_state *conf_reload_state) {
+    conf_reload__release_version(conf_reload_state, conf_reload_state->current_version);
+
+    pthread_mutex_destroy(&conf_reload_state->mutex);
+
+    if(conf_reload_state->config_file_path != NULL)
+        utils__free_memory(conf_reload_state->config_file_path);
+
+    utils__free_memory(conf_reload_state);
+}
+
+/*
+ * Reads the configuration file again, and makes the translator threads switch to the new configuration without
+ * interrupting the translation - the same RCU-like scheme as in xlat_addr_bpf__reload() is used: the new version is
+ * published by incrementing the generation counter, which each thread checks between packets, and the old version is
+ * freed once the last thread has stopped using it.
+ * Only the options which are consulted while packets are being translated can be changed this way (for example, the
+ * router's addresses, the translation prefix, the MTUs or the explicit address mapping file). If any other option has
+ * been changed (for instance, the number of threads or the sizes of the caches, which would have to be reallocated),
+ * the configuration is not reloaded at all, and the current one stays in use.
+ * If the translation prefix is auto-discovered, it is not discovered again (the discovery may block for a long time);
+ * the current one stays in use. Keep in mind that the files are re-read after the program's working directory has been
+ * changed and its privileges have been dropped.
+ */
+void conf_reload__reload(tundra__conf_reload_state *conf_reload_state) {
+    if(conf_reload_state->config_file_path == NULL) {
+        log__info("A configuration reload signal was received, but the configuration has been read from the standard input, so it cannot be reloaded.");
+        return;
+    }
+
+    char error_message[_ERROR_MESSAGE_SIZE];
+    tundra__conf_file_version *current_version = conf_reload__acquire_current_version(conf_reload_state, NULL);
+
+    tundra__conf_file *new_config = conf_file__try_read_and_parse_config_file(conf_reload_state->config_file_path, current_version->config, error_message, _ERROR_MESSAGE_SIZE);
+    if(new_config == NULL) {
+        conf_reload__release_version(conf_reload_state, current_version);
+        log__info("Failed to reload the configuration file '%s' (the current configuration stays in use): %s", conf_reload_state->config_file_path, error_message);
+        return;
+    }
+
+    const char *changed_option = _find_changed_non_reloadable_option(current_version->config, new_config);
+    conf_reload__release_version(conf_reload_state, current_version);
+    if(changed_option != NULL) {
+        log__info("Failed to reload the configuration file '%s' (the current configuration stays in use): The option '%s' cannot be changed without restarting the translator.", conf_reload_state->config_file_path, changed_option);
+        conf_file__free_parsed_config_file(new_config);
+        return;
+    }
+
+    tundra__siit_eam_state *new_siit_eam_state = NULL;
+    if(new_config->addressing_mode == TUNDRA__ADDRESSING_MODE_SIIT && new_config->addressing_siit_eam_file != NULL) {
+        new_siit_eam_state = xlat_addr_siit_eam__load_state(new_config, error_message, _ERROR_MESSAGE_SIZE);
+        if(new_siit_eam_state == NULL) {
+            log__info("Failed to reload the configuration file '%s' (the current configuration stays in use): %s", conf_reload_state->config_file_path, error_message);
+            conf_file__free_parsed_config_file(new_config);
+            return;
+        }
+    }
+
+    tundra__conf_file_version *new_version = _create_version(new_config, new_config, new_siit_eam_state);
+
+    pthread_mutex_lock(&conf_reload_state->mutex);
+    tundra__conf_file_version *old_version = conf_reload_state->current_version;
+    if(new_config->addressing_nat64_clat_siit_prefix_autodiscovered) {
+        // The prefix might have been rediscovered in the background (see conf_rfc7050.c) while the file was being parsed
+        memcpy(new_config->addressing_nat64_clat_siit_prefix, old_version->config->addressing_nat64_clat_siit_prefix, 16);
+        new_config->addressing_nat64_clat_siit_prefix_length = old_version->config->addressing_nat64_clat_siit_prefix_length;
+    }
+    conf_reload_state->current_version = new_version;
+    __atomic_store_n(&conf_reload_state->generation, conf_reload_state->generation + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&conf_reload_state->mutex);
+
+    conf_reload__release_version(conf_reload_state, old_version);
+
+    log__info("The configuration file '%s' has been reloaded.", conf_reload_state->config_file_path);
+}
+
+// 'out_generation' may be NULL
+tundra__conf_file_version *conf_reload__acquire_current_version(tundra__conf_reload_state *conf_reload_state, uint32_t *out_generation) {
+    pthread_mutex_lock(&conf_reload_state->mutex);
+
+    tundra__conf_file_version *version = conf_reload_state->current_version;
+    version->reference_count++;
+    if(out_generation != NULL)
+        *out_generation = conf_reload_state->generation;
+
+    pthread_mutex_unlock(&conf_reload_state->mutex);
+
+    return version;
+}
+
+void conf_reload__release_version(tundra__conf_reload_state *conf_reload_state, tundra__conf_file_version *version) {
+    pthread_mutex_lock(&conf_reload_state->mutex);
+    const bool is_version_unused = (--version->reference_count == 0);
+    pthread_mutex_unlock(&conf_reload_state->mutex);
+
+    if(is_version_unused)
+        _free_version(conf_reload_state, version);
+}
+
+/*
+ * Publishes a version of the current configuration which only differs in the translation prefix; it is used when the
+ * prefix is auto-discovered again (see conf_rfc7050.c), so that the threads switch to the new prefix in the same way as
+ * when the configuration file is reloaded. The new version is a shallow copy of the current one - the (possibly large)
+ * data the configuration points to are shared with it. Returns false if the current configuration already uses the
+ * prefix.
+ */
+bool conf_reload__replace_ipv6_prefix(tundra__conf_reload_state *conf_reload_state, const uint8_t *prefix, const uint8_t prefix_length) {
+    pthread_mutex_lock(&conf_reload_state->mutex);
+
+    tundra__conf_file_version *old_version = conf_reload_state->current_version;
+    if(UTILS_IP__IPV6_ADDR_EQ(old_version->config->addressing_nat64_clat_siit_prefix, prefix) && old_version->config->addressing_nat64_clat_siit_prefix_length == prefix_length) {
+        pthread_mutex_unlock(&conf_reload_state->mutex);
+        return false;
+    }
+
+    // The copies are always based on a version which owns its data, so that they do not form ever-growing chains
+    tundra__conf_file_version *base_version = ((old_version->base_version != NULL) ? old_version->base_version : old_version);
+    base_version->reference_count++;
+
+    tundra__conf_file *new_config = utils__alloc_zeroed_out_memory(1, sizeof(tundra__conf_file));
+    memcpy(new_config, old_version->config, sizeof(tundra__conf_file));
+    memcpy(new_config->addressing_nat64_clat_siit_prefix, prefix, 16);
+    new_config->addressing_nat64_clat_siit_prefix_length = prefix_length;
+
+    tundra__conf_file_version *new_version = _create_version(new_config, new_config, old_version->siit_eam_state);
+    new_version->base_version = base_version;
+
+    conf_reload_state->current_version = new_version;
+    __atomic_store_n(&conf_reload_state->generation, conf_reload_state->generation + 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&conf_reload_state->mutex);
+
+    conf_reload__release_version(conf_reload_state, old_version);
+
+    return true;
+}
+
+// Called by translator threads (between packets) once they find out that the generation counter has changed
+void conf_reload__switch_thread_to_current_version(tundra__thread_ctx *const ctx) {
+    conf_reload__release_version(ctx->conf_reload_state, ctx->conf_file_version);
+
+    ctx->conf_file_version = conf_reload__acquire_current_version(ctx->conf_reload_state, &ctx->conf_file_version_generation);
+    ctx->config = ctx->conf_file_version->config;
+    ctx->siit_eam_state = ctx->conf_file_version->siit_eam_state;
+}
+
+static tundra__conf_file_version *_create_version(const tundra__conf_file *const config, tundra__conf_file *owned_config, tundra__siit_eam_state *siit_eam_state) {
+    tundra__conf_file_version *version = utils__alloc_zeroed_out_memory(1, sizeof(tundra__conf_file_version));
+
+    version->config = config;
+    version->owned_config = owned_config;
+    version->siit_eam_state = siit_eam_state;
+    version->base_version = NULL;
+    version->reference_count = 1;
+
+    return version;
+}
+
+static void _free_version(tundra__conf_reload_state *conf_reload_state, tundra__conf_file_version *version) {
+    if(version->base_version != NULL) {
+        utils__free_memory(version->owned_config); // A shallow copy
+        conf_reload__release_version(conf_reload_state, version->base_version);
+        utils__free_memory(version);
+        return;
+    }
+
+    if(version->siit_eam_state != NULL)
+        xlat_addr_siit_eam__free_state(version->siit_eam_state);
+
+    if(version->owned_config != NULL)
+        conf_file__free_parsed_config_file(version->owned_config);
+
+    utils__free_memory(version);
+}
+
+// Returns the name of an option which has been changed, but whose value cannot be changed while the translator is
+//  running (as it has been used to set up the threads, their I/O or their state), or NULL if there is no such option
+static const char *_find_changed_non_reloadable_option(const tundra__conf_file *const old_config, const tundra__conf_file *const new_config) {
+    if(old_config->program_translator_threads != new_config->program_translator_threads)
+        return "program.translator_threads";
+
+    if(old_config->program_privilege_drop_user_perform != new_config->program_privilege_drop_user_perform || (new_config->program_privilege_drop_user_perform && old_config->program_privilege_drop_user_uid != new_config->program_privilege_drop_user_uid))
+        return "program.privilege_drop_user";
+
+    if(old_config->program_privilege_drop_group_perform != new_config->program_privilege_drop_group_perform || (new_config->program_privilege_drop_group_perform && old_config->program_privilege_drop_group_gid != new_config->program_privilege_drop_group_gid))
+        return "program.privilege_drop_group";
+
+    if(old_config->io_mode != new_config->io_mode)
+        return "io.mode";
+
+    if(_are_strings_different(old_config->io_tun_device_path, new_config->io_tun_device_path))
+        return "io.tun.device_path";
+
+    if(_are_strings_different(old_config->io_tun_interface_name, new_config->io_tun_interface_name))
+        return "io.tun.interface_name";
+
+    if(old_config->io_tun_multi_queue != new_config->io_tun_multi_queue)
+        return "io.tun.multi_queue";
+
+    if(old_config->addressing_mode != new_config->addressing_mode)
+        return "addressing.mode";
+
+    if(old_config->addressing_clat_nat44 != new_config->addressing_clat_nat44)
+        return "addressing.clat.nat44";
+
+    if(!UTILS_IP__IPV4_ADDR_EQ(old_config->addressing_nat64_stateful_pool_ipv4, new_config->addressing_nat64_stateful_pool_ipv4))
+        return "addressing.nat64_stateful.pool_ipv4";
+
+    if(old_config->addressing_nat64_stateful_pool_size != new_config->addressing_nat64_stateful_pool_size)
+        return "addressing.nat64_stateful.pool_size";
+
+    if(old_config->addressing_nat64_stateful_max_sessions != new_config->addressing_nat64_stateful_max_sessions)
+        return "addressing.nat64_stateful.max_sessions";
+
+    if(old_config->addressing_external_transport != new_config->addressing_external_transport)
+        return "addressing.external.transport";
+
+    if(_are_external_servers_different(old_config, new_config)) {
+        if(new_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP)
+            return "addressing.external.tcp.host";
+
+        if(new_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP)
+            return "addressing.external.udp.host";
+
+        return "addressing.external.unix.path";
+    }
+
+    if(old_config->addressing_external_protocol_version != new_config->addressing_external_protocol_version)
+        return "addressing.external.protocol_version";
+
+    if(old_config->addressing_external_cache_size_main_addresses != new_config->addressing_external_cache_size_main_addresses)
+        return "addressing.external.cache_size.main_addresses";
+
+    if(old_config->addressing_external_cache_size_icmp_error_addresses != new_config->addressing_external_cache_size_icmp_error_addresses)
+        return "addressing.external.cache_size.icmp_error_addresses";
+
+    if(old_config->addressing_external_cache_size_prefix_mappings != new_config->addressing_external_cache_size_prefix_mappings)
+        return "addressing.external.cache_size.prefix_mappings";
+
+    if(_are_strings_different(old_config->addressing_external_cache_file, new_config->addressing_external_cache_file))
+        return "addressing.external.cache_file";
+
+    if(_are_strings_different(old_config->addressing_external_cache_preload_file, new_config->addressing_external_cache_preload_file))
+        return "addressing.external.cache_preload_file";
+
+    // The circuit breaker and the rate limiters are only created if they are enabled, but their parameters are consulted at runtime
+    if((old_config->addressing_external_unix_tcp_circuit_breaker_failure_threshold > 0) != (new_config->addressing_external_unix_tcp_circuit_breaker_failure_threshold > 0))
+        return "addressing.external.unix_tcp.circuit_breaker.failure_threshold";
+
+    if((old_config->addressing_external_query_rate_limit_per_second > 0) != (new_config->addressing_external_query_rate_limit_per_second > 0))
+        return "addressing.external.query_rate_limit.per_second";
+
+    if(_are_strings_different(old_config->addressing_plugin_path, new_config->addressing_plugin_path))
+        return "addressing.plugin.path";
+
+    if(_are_strings_different(old_config->addressing_plugin_argument, new_config->addressing_plugin_argument))
+        return "addressing.plugin.argument";
+
+    if(_are_strings_different(old_config->addressing_bpf_program_file, new_config->addressing_bpf_program_file))
+        return "addressing.bpf.program";
+
+    if(old_config->addressing_bpf_map_count != new_config->addressing_bpf_map_count)
+        return "addressing.bpf.maps";
+
+    for(size_t i = 0; i < new_config->addressing_bpf_map_count; i++) {
+        if(_are_strings_different(old_config->addressing_bpf_map_files[i], new_config->addressing_bpf_map_files[i]))
+            return "addressing.bpf.maps";
+    }
+
+    if(_are_strings_different(old_config->addressing_map_t_rules_file, new_config->addressing_map_t_rules_file))
+        return "addressing.map_t.rules_file";
+
+    // The background thread which re-runs the prefix discovery is only started (and the cache file is only opened) at startup
+    if(old_config->addressing_nat64_clat_siit_rfc7050_rediscovery != new_config->addressing_nat64_clat_siit_rfc7050_rediscovery)
+        return "addressing.nat64_clat_siit.rfc7050.rediscovery";
+
+    if(_are_strings_different(old_config->addressing_nat64_clat_siit_rfc7050_cache_file, new_config->addressing_nat64_clat_siit_rfc7050_cache_file))
+        return "addressing.nat64_clat_siit.rfc7050.cache_file";
+
+    if(old_config->translator_hairpinning != new_config->translator_hairpinning)
+        return "translator.hairpinning";
+
+    return NULL;
+}
+
+// Either of the strings may be NULL
+static bool _are_strings_different(const char *const string1, const char *const string2) {
+    if(string1 == NULL || string2 == NULL)
+        return (string1 != string2);
+
+    return !UTILS__STR_EQ(string1, string2);
+}
+
+static bool _are_external_servers_different(const tundra__conf_file *const old_config, const tundra__conf_file *const new_config) {
+    if(old_config->addressing_external_server_count != new_config->addressing_external_server_count)
+        return true;
+
+    for(size_t i = 0; i < new_config->addressing_external_server_count; i++) {
+        if(old_config->addressing_external_server_hash_seeds[i] != new_config->addressing_external_server_hash_seeds[i])
+            return true;
+
+        // The hash seeds are derived from the servers' paths & hosts, but not from their ports
+        const struct addrinfo *old_socket_info = old_config->addressing_external_tcp_socket_info[i];
+        const struct addrinfo *new_socket_info = new_config->addressing_external_tcp_socket_info[i];
+        if(old_socket_info == NULL || new_socket_info == NULL) {
+            if(old_socket_info != new_socket_info)
+                return true;
+
+            continue;
+        }
+
+        if(old_socket_info->ai_addrlen != new_socket_info->ai_addrlen || memcmp(old_socket_info->ai_addr, new_socket_info->ai_addr, old_socket_info->ai_addrlen) != 0)
+            return true;
+    }
+
+    return false;
+}
+
+
+#undef _ERROR_MESSAGE_SIZE
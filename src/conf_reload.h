@@ -0,0 +1,33 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+#include"tundra.h"
+
+
+extern tundra__conf_reload_state *conf_reload__create_state(const char *const config_file_path, const tundra__conf_file *const file_config, tundra__siit_eam_state *siit_eam_state);
+extern void conf_reload__free_state(tundra__conf_reload_state *conf_reload_state);
+extern void conf_reload__reload(tundra__conf_reload_state *conf_reload_state);
+extern tundra__conf_file_version *conf_reload__acquire_current_version(tundra__conf_reload_state *conf_reload_state, uint32_t *out_generation);
+extern void conf_reload__release_version(tundra__conf_reload_state *conf_reload_state, tundra__conf_file_version *version);
+extern bool conf_reload__replace_ipv6_prefix(tundra__conf_reload_state *conf_reload_state, const uint8_t *prefix, const uint8_t prefix_length);
+extern void conf_reload__switch_thread_to_current_version(tundra__thread_ctx *const ctx);
@@ -25,20 +25,44 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"utils.h"
 #include"utils_ip.h"
 #include"log.h"
+#include"signals.h"
+#include"conf_reload.h"
 
 
 #define _IPV4ONLY_DNS_NAME "ipv4only.arpa."
 #define _TARGET_IPV4_1 "\xc0\x00\x00\xaa" // 192.0.0.170
 #define _TARGET_IPV4_2 "\xc0\x00\x00\xab" // 192.0.0.171
 #define _RETRY_INTERVAL_SECONDS ((unsigned int) 3)
+#define _REDISCOVERY_RETRY_INTERVAL_SECONDS ((unsigned int) 30)
+#define _REDISCOVERY_MIN_INTERVAL_SECONDS ((uint32_t) 30)  // DNS64 servers may synthesize records with very low TTLs
+#define _REDISCOVERY_MAX_INTERVAL_SECONDS ((uint32_t) 86400)
+#define _DNS_RESPONSE_BUFFER_SIZE ((size_t) 4096)
+#define _CACHE_FILE_LINE_BUFFER_SIZE ((size_t) 128)
 #define _LOG_MESSAGE_BANNER "RFC 7050"
 
 
 static inline void _print_start_info_message(void);
-static inline void _print_finish_info_message(const uint8_t *found_ipv6_prefix);
+static bool _load_cached_ipv6_prefix(const char *const cache_file, uint8_t *destination, uint8_t *out_prefix_length);
+static void *_run_rediscovery_thread(void *arg);
+static bool _query_ipv6_prefix(uint8_t *destination, uint8_t *out_prefix_length, uint32_t *out_ttl);
+static void _save_ipv6_prefix_to_cache_file(const int cache_file_fd, const uint8_t *ipv6_prefix, const uint8_t prefix_length);
+static bool _detect_ipv6_prefix(const uint8_t *ipv6_address, uint8_t *destination, uint8_t *out_prefix_length);
+static bool _convert_ipv6_prefix_to_string(const uint8_t *ipv6_prefix, char *out_string);
+static inline void _print_finish_info_message(const uint8_t *found_ipv6_prefix, const uint8_t found_prefix_length);
 
 
-void conf_rfc7050__autodiscover_ipv6_prefix(uint8_t *destination) {
+// If 'cache_file' is not NULL and contains a prefix, the prefix is used right away - the discovery is then performed
+//  in the background (see conf_rfc7050__start_rediscovery_thread()), so the program's startup is not stalled by DNS.
+void conf_rfc7050__autodiscover_ipv6_prefix(const char *const cache_file, uint8_t *destination, uint8_t *out_prefix_length) {
+    if(cache_file != NULL && _load_cached_ipv6_prefix(cache_file, destination, out_prefix_length)) {
+        char cached_ipv6_prefix_string[INET6_ADDRSTRLEN] = {'\0'};
+        if(!_convert_ipv6_prefix_to_string(destination, cached_ipv6_prefix_string))
+            log__crash(true, "["_LOG_MESSAGE_BANNER"] Failed to convert the cached translation prefix from binary to string form!");
+
+        log__info("["_LOG_MESSAGE_BANNER"] The translation prefix '%s/%u' has been loaded from the cache file '%s' (it will be auto-discovered again in the background).", cached_ipv6_prefix_string, (unsigned int) *out_prefix_length, cache_file);
+        return;
+    }
+
     struct addrinfo hints;
     UTILS__MEM_ZERO_OUT(&hints, sizeof(struct addrinfo));
     hints.ai_family = AF_INET6;
@@ -68,12 +92,9 @@ void conf_rfc7050__autodiscover_ipv6_prefix(uint8_t *destination) {
             #pragma GCC diagnostic pop
 
             const uint8_t *ipv6_address = (const uint8_t *) (addr_struct->sin6_addr.s6_addr);
-            if(UTILS_IP__IPV4_ADDR_EQ(ipv6_address + 12, _TARGET_IPV4_1) || UTILS_IP__IPV4_ADDR_EQ(ipv6_address + 12, _TARGET_IPV4_2)) {
-                memcpy(destination, ipv6_address, 12);
-                UTILS__MEM_ZERO_OUT(destination + 12, 4);
-
+            if(_detect_ipv6_prefix(ipv6_address, destination, out_prefix_length)) {
                 freeaddrinfo(results);
-                _print_finish_info_message(destination);
+                _print_finish_info_message(destination, *out_prefix_length);
 
                 return;
             }
@@ -84,21 +105,203 @@ void conf_rfc7050__autodiscover_ipv6_prefix(uint8_t *destination) {
     }
 }
 
+// This function must be called before the program's working directory is changed and its privileges are dropped.
+tundra__rfc7050_rediscovery_state *conf_rfc7050__create_rediscovery_state(const tundra__conf_file *const file_config, tundra__conf_reload_state *conf_reload_state) {
+    tundra__rfc7050_rediscovery_state *rediscovery_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__rfc7050_rediscovery_state));
+    rediscovery_state->conf_reload_state = conf_reload_state;
+    rediscovery_state->cache_file_fd = -1;
+
+    if(file_config->addressing_nat64_clat_siit_rfc7050_cache_file != NULL) {
+        // The file is only read when the program starts (a configuration reload keeps the current prefix), i.e. before the
+        //  privileges are dropped, so no one else needs to be able to read it
+        rediscovery_state->cache_file_fd = open(file_config->addressing_nat64_clat_siit_rfc7050_cache_file, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+        if(rediscovery_state->cache_file_fd < 0)
+            log__crash(true, "["_LOG_MESSAGE_BANNER"] Failed to open the translation prefix cache file '%s'!", file_config->addressing_nat64_clat_siit_rfc7050_cache_file);
+    }
+
+    return rediscovery_state;
+}
+
+void conf_rfc7050__free_rediscovery_state(tundra__rfc7050_rediscovery_state *rediscovery_state) {
+    if(rediscovery_state->cache_file_fd >= 0)
+        close(rediscovery_state->cache_file_fd);
+
+    utils__free_memory(rediscovery_state);
+}
+
+void conf_rfc7050__start_rediscovery_thread(tundra__rfc7050_rediscovery_state *rediscovery_state) {
+    const int pthread_errno = pthread_create(&rediscovery_state->thread, NULL, _run_rediscovery_thread, rediscovery_state);
+    if(pthread_errno != 0) {
+        errno = pthread_errno;
+        log__crash(true, "["_LOG_MESSAGE_BANNER"] Failed to create the translation prefix rediscovery thread!");
+    }
+}
+
+void conf_rfc7050__stop_rediscovery_thread(tundra__rfc7050_rediscovery_state *rediscovery_state) {
+    // The thread may be blocked in a DNS query or in sleep(), so it is signalled repeatedly (the same way as the
+    //  translator threads are - see _terminate_threads() in opmode_translate.c) until it terminates
+    for(;;) {
+        const int pthread_errno = pthread_tryjoin_np(rediscovery_state->thread, NULL);
+        if(pthread_errno == 0)
+            return;
+
+        if(pthread_errno != EBUSY)
+            log__crash(false, "["_LOG_MESSAGE_BANNER"] Failed to join the translation prefix rediscovery thread!");
+
+        if(pthread_kill(rediscovery_state->thread, SIGNALS__XLAT_THREAD_TERM_SIGNAL) != 0)
+            log__crash(false, "["_LOG_MESSAGE_BANNER"] Failed to inform the translation prefix rediscovery thread that it should terminate (using a signal)!");
+
+        usleep(TUNDRA__XLAT_THREAD_TERM_INTERVAL_MICROSECONDS);
+    }
+}
+
+// The file contains a single line with the prefix in the 'address/length' form
+static bool _load_cached_ipv6_prefix(const char *const cache_file, uint8_t *destination, uint8_t *out_prefix_length) {
+    FILE *cache_file_ptr = fopen(cache_file, "r");
+    if(cache_file_ptr == NULL)
+        return false;
+
+    char line_buffer[_CACHE_FILE_LINE_BUFFER_SIZE] = {'\0'};
+    const bool is_line_read = (fgets(line_buffer, (int) _CACHE_FILE_LINE_BUFFER_SIZE, cache_file_ptr) != NULL);
+    fclose(cache_file_ptr);
+    if(!is_line_read)
+        return false;
+
+    line_buffer[strcspn(line_buffer, "\r\n")] = '\0';
+
+    return (
+        utils_ip__parse_prefix_string(line_buffer, AF_INET6, destination, out_prefix_length) &&
+        utils_ip__is_rfc6052_prefix_length_valid(*out_prefix_length) &&
+        !utils_ip__is_ipv6_addr_unusable(destination)
+    );
+}
+
+/*
+ * RFC 7050, section 5 says that the discovery should be repeated once the TTL of the synthesized record expires, as the
+ * prefix may change (e.g. when the network is renumbered). The thread queries the DNS directly (instead of using
+ * getaddrinfo()) to learn the TTL, and publishes a changed prefix to the translator threads as a new version of the
+ * configuration (see conf_reload__replace_ipv6_prefix()), i.e. without interrupting the translation.
+ */
+static void *_run_rediscovery_thread(void *arg) {
+    tundra__rfc7050_rediscovery_state *const rediscovery_state = (tundra__rfc7050_rediscovery_state *const) arg;
+    bool is_cache_file_up_to_date = false;
+
+    while(signals__should_this_thread_keep_running()) {
+        uint8_t ipv6_prefix[16];
+        uint8_t prefix_length;
+        uint32_t ttl;
+        unsigned int remaining_seconds = _REDISCOVERY_RETRY_INTERVAL_SECONDS;
+
+        if(_query_ipv6_prefix(ipv6_prefix, &prefix_length, &ttl)) {
+            if(conf_reload__replace_ipv6_prefix(rediscovery_state->conf_reload_state, ipv6_prefix, prefix_length)) {
+                _print_finish_info_message(ipv6_prefix, prefix_length);
+                is_cache_file_up_to_date = false;
+            }
+
+            if(rediscovery_state->cache_file_fd >= 0 && !is_cache_file_up_to_date) {
+                _save_ipv6_prefix_to_cache_file(rediscovery_state->cache_file_fd, ipv6_prefix, prefix_length);
+                is_cache_file_up_to_date = true;
+            }
+
+            remaining_seconds = (unsigned int) UTILS__MINIMUM_UNSAFE(UTILS__MAXIMUM_UNSAFE(ttl, _REDISCOVERY_MIN_INTERVAL_SECONDS), _REDISCOVERY_MAX_INTERVAL_SECONDS);
+        }
+
+        // sleep() is interrupted by the termination signal
+        while(remaining_seconds > 0 && signals__should_this_thread_keep_running())
+            remaining_seconds = sleep(remaining_seconds);
+    }
+
+    return NULL;
+}
+
+static bool _query_ipv6_prefix(uint8_t *destination, uint8_t *out_prefix_length, uint32_t *out_ttl) {
+    unsigned char response[_DNS_RESPONSE_BUFFER_SIZE];
+    const int response_size = res_query(_IPV4ONLY_DNS_NAME, ns_c_in, ns_t_aaaa, response, (int) _DNS_RESPONSE_BUFFER_SIZE);
+    if(response_size < 0)
+        return false;
+
+    ns_msg message;
+    if(ns_initparse(response, response_size, &message) < 0)
+        return false;
+
+    for(int i = 0; i < ns_msg_count(message, ns_s_an); i++) {
+        ns_rr record;
+        if(ns_parserr(&message, ns_s_an, i, &record) < 0)
+            return false;
+
+        if(ns_rr_class(record) != ns_c_in || ns_rr_type(record) != ns_t_aaaa || ns_rr_rdlen(record) != 16)
+            continue;
+
+        if(_detect_ipv6_prefix(ns_rr_rdata(record), destination, out_prefix_length)) {
+            *out_ttl = ns_rr_ttl(record);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Failures are not fatal - the cache only speeds up the program's next startup
+static void _save_ipv6_prefix_to_cache_file(const int cache_file_fd, const uint8_t *ipv6_prefix, const uint8_t prefix_length) {
+    char ipv6_prefix_string[INET6_ADDRSTRLEN] = {'\0'};
+    if(!_convert_ipv6_prefix_to_string(ipv6_prefix, ipv6_prefix_string))
+        return;
+
+    char line_buffer[_CACHE_FILE_LINE_BUFFER_SIZE] = {'\0'};
+    const int line_length = snprintf(line_buffer, _CACHE_FILE_LINE_BUFFER_SIZE, "%s/%u\n", ipv6_prefix_string, (unsigned int) prefix_length);
+    if(line_length < 0 || (size_t) line_length >= _CACHE_FILE_LINE_BUFFER_SIZE)
+        return;
+
+    if(ftruncate(cache_file_fd, 0) < 0 || pwrite(cache_file_fd, line_buffer, (size_t) line_length, 0) != (ssize_t) line_length)
+        log__info("["_LOG_MESSAGE_BANNER"] Failed to save the auto-discovered translation prefix to its cache file!");
+}
+
+// As per RFC 7050, section 3, the prefix length is determined by searching for one of the well-known IPv4 addresses
+//  at the positions defined by RFC 6052, starting with the most common /96 prefix. The extraction fails if the 'u'
+//  octet or the suffix of the address is not zero, which rules out most of the false positives.
+static bool _detect_ipv6_prefix(const uint8_t *ipv6_address, uint8_t *destination, uint8_t *out_prefix_length) {
+    static const uint8_t prefix_lengths[] = {96, 64, 56, 48, 40, 32};
+
+    for(size_t i = 0; i < (sizeof(prefix_lengths) / sizeof(uint8_t)); i++) {
+        const uint8_t prefix_length = prefix_lengths[i];
+
+        uint8_t prefix[16] = {0};
+        memcpy(prefix, ipv6_address, (prefix_length / 8));
+
+        uint8_t ipv4_address[4];
+        if(!utils_ip__extract_ipv4_from_rfc6052_address(ipv6_address, prefix, prefix_length, ipv4_address))
+            continue;
+
+        if(UTILS_IP__IPV4_ADDR_EQ(ipv4_address, _TARGET_IPV4_1) || UTILS_IP__IPV4_ADDR_EQ(ipv4_address, _TARGET_IPV4_2)) {
+            memcpy(destination, prefix, 16);
+            *out_prefix_length = prefix_length;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static inline void _print_start_info_message(void) {
     // For future extension and code consistency.
     log__info("["_LOG_MESSAGE_BANNER"] Trying to auto-discover a translation prefix - waiting until a DNS query for '"_IPV4ONLY_DNS_NAME"' returns a sensible result...");
 }
 
-static inline void _print_finish_info_message(const uint8_t *found_ipv6_prefix) {
+// 'out_string' must be at least INET6_ADDRSTRLEN characters long
+static bool _convert_ipv6_prefix_to_string(const uint8_t *ipv6_prefix, char *out_string) {
     struct in6_addr address_struct;
     UTILS__MEM_ZERO_OUT(&address_struct, sizeof(struct in6_addr));
-    memcpy(address_struct.s6_addr, found_ipv6_prefix, 16);
+    memcpy(address_struct.s6_addr, ipv6_prefix, 16);
+
+    return (inet_ntop(AF_INET6, &address_struct, out_string, INET6_ADDRSTRLEN) != NULL);
+}
 
+static inline void _print_finish_info_message(const uint8_t *found_ipv6_prefix, const uint8_t found_prefix_length) {
     char found_ipv6_prefix_string[INET6_ADDRSTRLEN] = {'\0'};
-    if(inet_ntop(AF_INET6, &address_struct, found_ipv6_prefix_string, INET6_ADDRSTRLEN) == NULL)
+    if(!_convert_ipv6_prefix_to_string(found_ipv6_prefix, found_ipv6_prefix_string))
         log__crash(true, "["_LOG_MESSAGE_BANNER"] Failed to convert the auto-discovered translation prefix from binary to string form!");
 
-    log__info("["_LOG_MESSAGE_BANNER"] The translation prefix '%s/96' has been auto-discovered!", found_ipv6_prefix_string);
+    log__info("["_LOG_MESSAGE_BANNER"] The translation prefix '%s/%u' has been auto-discovered!", found_ipv6_prefix_string, (unsigned int) found_prefix_length);
 }
 
 
@@ -106,4 +309,9 @@ static inline void _print_finish_info_message(const uint8_t *found_ipv6_prefix)
 #undef _TARGET_IPV4_1
 #undef _TARGET_IPV4_2
 #undef _RETRY_INTERVAL_SECONDS
+#undef _REDISCOVERY_RETRY_INTERVAL_SECONDS
+#undef _REDISCOVERY_MIN_INTERVAL_SECONDS
+#undef _REDISCOVERY_MAX_INTERVAL_SECONDS
+#undef _DNS_RESPONSE_BUFFER_SIZE
+#undef _CACHE_FILE_LINE_BUFFER_SIZE
 #undef _LOG_MESSAGE_BANNER
@@ -23,4 +23,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"tundra.h"
 
 
-extern void conf_rfc7050__autodiscover_ipv6_prefix(uint8_t *destination);
+extern void conf_rfc7050__autodiscover_ipv6_prefix(const char *const cache_file, uint8_t *destination, uint8_t *out_prefix_length);
+extern tundra__rfc7050_rediscovery_state *conf_rfc7050__create_rediscovery_state(const tundra__conf_file *const file_config, tundra__conf_reload_state *conf_reload_state);
+extern void conf_rfc7050__free_rediscovery_state(tundra__rfc7050_rediscovery_state *rediscovery_state);
+extern void conf_rfc7050__start_rediscovery_thread(tundra__rfc7050_rediscovery_state *rediscovery_state);
+extern void conf_rfc7050__stop_rediscovery_thread(tundra__rfc7050_rediscovery_state *rediscovery_state);
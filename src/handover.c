@@ -0,0 +1,558 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"handover.h"
+
+#include"utils.h"
+#include"log.h"
+#include"xlat_addr_external_cache_file.h"
+
+
+#define _MESSAGE_MAGIC "THOV"
+#define _MESSAGE_VERSION ((uint8_t) 2)
+#define _MAX_ATTACHED_FDS TUNDRA__MAX_XLAT_INSTANCES  // No message carries more file descriptors than the cache message
+#define _HANDED_OVER_CACHE_DESCRIPTION "<handed over by the previous process>"
+
+
+static void _receive_instance(tundra__handover_state *handover_state, const int socket_fd, const tundra__xlat_instance *const instance, const size_t instance_index, const bool is_last_instance);
+static bool _send_instance(const int socket_fd, const tundra__xlat_instance *const instance, const bool is_last_instance);
+static bool _wait_for_successor_ack(tundra__handover_state *handover_state, const int timeout_milliseconds);
+static size_t _find_or_add_fd(int *fds, size_t *fd_count, const int fd, int *new_fds, size_t *new_fd_count);
+static bool _is_peer_trusted(const int socket_fd);
+static bool _set_socket_timeouts(const int socket_fd);
+static struct sockaddr_un _generate_socket_address(const char *const socket_path);
+static void _initialize_message_header(uint8_t *magic, uint8_t *version);
+static bool _is_message_header_valid(const uint8_t *magic, const uint8_t version);
+static bool _send_message(const int socket_fd, const void *message, const size_t message_size, const int *fds, const size_t fd_count);
+static bool _receive_message(const int socket_fd, void *message, const size_t message_size, int *fds, const size_t max_fd_count, size_t *fd_count);
+
+
+tundra__handover_state *handover__create_state(const char *const socket_path) {
+    if(strlen(socket_path) < 1 || strlen(socket_path) >= sizeof(((struct sockaddr_un *) NULL)->sun_path))
+        log__crash(false, "The handover socket path is either empty or too long: %s", socket_path);
+
+    tundra__handover_state *handover_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__handover_state));
+    handover_state->socket_path = utils__duplicate_string(socket_path);
+    handover_state->listening_fd = -1;
+    handover_state->connection_fd = -1;
+    handover_state->successor_ack_deadline = 0;
+    handover_state->has_taken_over = false;
+    handover_state->has_handed_over = false;
+    handover_state->should_transfer_external_addr_xlat_caches = false;
+
+    for(size_t i = 0; i < TUNDRA__MAX_XLAT_INSTANCES; i++)
+        handover_state->instance_fds[i].external_addr_xlat_cache_file_fd = -1;
+
+    return handover_state;
+}
+
+// The file descriptors which have been taken over belong to the translator threads' contexts, so they are not closed here
+void handover__free_state(tundra__handover_state *handover_state) {
+    if(handover_state->listening_fd >= 0)
+        close(handover_state->listening_fd);
+
+    if(handover_state->connection_fd >= 0)
+        close(handover_state->connection_fd);
+
+    utils__free_memory(handover_state->socket_path);
+    utils__free_memory(handover_state);
+}
+
+// Returns false if there is no running translator to take the file descriptors over from (i.e. they are to be opened
+//  normally); if the running translator's instances differ from this process's ones, the program crashes, which
+//  makes the running translator carry on as if nothing happened. This function must be called before the instances'
+//  thread contexts are initialized!
+bool handover__take_over(tundra__handover_state *handover_state, const tundra__xlat_instance *const instances, const size_t instance_count) {
+    const int socket_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(socket_fd < 0)
+        log__crash(true, "Failed to create a socket for the handover!");
+
+    const struct sockaddr_un socket_address = _generate_socket_address(handover_state->socket_path);
+    if(connect(socket_fd, (const struct sockaddr *) &socket_address, sizeof(struct sockaddr_un)) < 0) {
+        // A socket left over by a translator which is no longer running refuses connections
+        if(errno == ENOENT || errno == ECONNREFUSED) {
+            close(socket_fd);
+            log__info("There is no running translator listening on the handover socket '%s' - the file descriptors will be opened normally.", handover_state->socket_path);
+            return false;
+        }
+
+        log__crash(true, "Failed to connect to the handover socket '%s'!", handover_state->socket_path);
+    }
+
+    if(!_set_socket_timeouts(socket_fd))
+        log__crash(true, "Failed to set the timeouts of the handover socket!");
+
+    for(size_t i = 0; i < instance_count; i++)
+        _receive_instance(handover_state, socket_fd, instances + i, i, (i == (instance_count - 1)));
+
+    tundra__handover_socket_message socket_message;
+    int listening_fd = -1;
+    size_t attached_fd_count = 0;
+    if(!_receive_message(socket_fd, &socket_message, sizeof(tundra__handover_socket_message), &listening_fd, 1, &attached_fd_count))
+        log__crash(true, "Failed to receive the listening handover socket!");
+
+    if(!_is_message_header_valid(socket_message.magic, socket_message.version) || attached_fd_count != 1)
+        log__crash(false, "The handover information about the listening handover socket is invalid!");
+
+    handover_state->listening_fd = listening_fd;
+    handover_state->connection_fd = socket_fd;
+    handover_state->has_taken_over = true;
+
+    log__info("The file descriptors of %zu translation instance(s) have been taken over from the translator listening on the handover socket '%s'.", instance_count, handover_state->socket_path);
+
+    return true;
+}
+
+static void _receive_instance(tundra__handover_state *handover_state, const int socket_fd, const tundra__xlat_instance *const instance, const size_t instance_index, const bool is_last_instance) {
+    const tundra__conf_file *const file_config = instance->file_config;
+    tundra__handover_instance_fds *const instance_fds = handover_state->instance_fds + instance_index;
+
+    tundra__handover_instance_message instance_message;
+    int attached_fds[_MAX_ATTACHED_FDS];
+    size_t attached_fd_count = 0;
+    if(!_receive_message(socket_fd, &instance_message, sizeof(tundra__handover_instance_message), attached_fds, 1, &attached_fd_count))
+        log__crash(true, "Failed to receive the handover information about the instance '%s'!", instance->name);
+
+    if(!_is_message_header_valid(instance_message.magic, instance_message.version))
+        log__crash(false, "The running translator uses an incompatible version of the handover protocol!");
+
+    instance_message.name[TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH] = '\0';
+    instance_message.tun_interface_name[IFNAMSIZ - 1] = '\0';
+    if(!UTILS__STR_EQ(instance_message.name, instance->name) || (instance_message.is_last_instance != 0) != is_last_instance)
+        log__crash(false, "The running translator's translation instances differ from this process's ones (instance #%zu is named '%s' there, and '%s' here)!", (instance_index + 1), instance_message.name, instance->name);
+
+    if(instance_message.io_mode != (uint8_t) file_config->io_mode || (size_t) instance_message.thread_count != file_config->program_translator_threads)
+        log__crash(false, "The I/O mode or the count of translator threads of the instance '%s' differs from the running translator's one!", instance->name);
+
+    if(file_config->io_mode == TUNDRA__IO_MODE_TUN && (!UTILS__STR_EQ(instance_message.tun_interface_name, file_config->io_tun_interface_name) || (instance_message.is_tun_multi_queue != 0) != file_config->io_tun_multi_queue))
+        log__crash(false, "The TUN interface of the instance '%s' differs from the running translator's one!", instance->name);
+
+    if((instance_message.is_external_addr_xlat_cache_file_fd_attached != 0) != (attached_fd_count == 1))
+        log__crash(false, "The handover information about the instance '%s' is invalid!", instance->name);
+    instance_fds->external_addr_xlat_cache_file_fd = ((attached_fd_count == 1) ? attached_fds[0] : -1);
+
+    // See tundra__handover_thread_message
+    int received_fds[2 * TUNDRA__MAX_XLAT_THREADS];
+    size_t received_fd_count = 0;
+    for(size_t i = 0; i < file_config->program_translator_threads; i++) {
+        tundra__handover_thread_message thread_message;
+        if(!_receive_message(socket_fd, &thread_message, sizeof(tundra__handover_thread_message), received_fds + received_fd_count, 2, &attached_fd_count))
+            log__crash(true, "Failed to receive the file descriptors of the instance '%s'!", instance->name);
+        received_fd_count += attached_fd_count;
+
+        if(!_is_message_header_valid(thread_message.magic, thread_message.version) || (size_t) thread_message.packet_read_fd_index >= received_fd_count || (size_t) thread_message.packet_write_fd_index >= received_fd_count)
+            log__crash(false, "The handover information about the file descriptors of the instance '%s' is invalid!", instance->name);
+
+        instance_fds->packet_fds[2 * i] = received_fds[thread_message.packet_read_fd_index];
+        instance_fds->packet_fds[(2 * i) + 1] = received_fds[thread_message.packet_write_fd_index];
+    }
+}
+
+// Binds the handover socket, so that the next translator can take the file descriptors over from this one; a socket
+//  left over by a translator which is no longer running is replaced. If the file descriptors have been taken over,
+//  the previous translator's listening socket has been taken over along with them, so the socket's path is never
+//  without a running translator behind it (even if this process dies before it completes the take-over). This function
+//  must be called before the program's working directory is changed and its privileges are dropped!
+void handover__listen(tundra__handover_state *handover_state) {
+    if(handover_state->listening_fd >= 0)
+        return;
+
+    const int socket_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(socket_fd < 0)
+        log__crash(true, "Failed to create a socket for the handover!");
+
+    if(unlink(handover_state->socket_path) < 0 && errno != ENOENT)
+        log__crash(true, "Failed to remove the old handover socket '%s'!", handover_state->socket_path);
+
+    const struct sockaddr_un socket_address = _generate_socket_address(handover_state->socket_path);
+    if(bind(socket_fd, (const struct sockaddr *) &socket_address, sizeof(struct sockaddr_un)) < 0)
+        log__crash(true, "Failed to bind the handover socket '%s'!", handover_state->socket_path);
+
+    // Whoever connects to the socket gets hold of the program's TUN interfaces
+    if(chmod(handover_state->socket_path, 0600) < 0)
+        log__crash(true, "Failed to change the permissions of the handover socket '%s'!", handover_state->socket_path);
+
+    if(listen(socket_fd, 1) < 0)
+        log__crash(true, "Failed to listen on the handover socket '%s'!", handover_state->socket_path);
+
+    handover_state->listening_fd = socket_fd;
+}
+
+// Tells the previous translator to drain its in-flight packets and terminate; if the caches are to be transferred,
+//  waits until it has done so and loads them. This function must be called after the instances have been fully
+//  initialized (nothing may fail after the previous translator has been told to terminate), but before the translator
+//  threads are started!
+void handover__complete_take_over(tundra__handover_state *handover_state, const tundra__xlat_instance *const instances, const size_t instance_count, const bool should_transfer_external_addr_xlat_caches) {
+    tundra__handover_ack_message ack_message;
+    UTILS__MEM_ZERO_OUT(&ack_message, sizeof(tundra__handover_ack_message));
+    _initialize_message_header(ack_message.magic, &ack_message.version);
+    ack_message.should_transfer_external_addr_xlat_caches = (should_transfer_external_addr_xlat_caches ? 1 : 0);
+
+    if(!_send_message(handover_state->connection_fd, &ack_message, sizeof(tundra__handover_ack_message), NULL, 0))
+        log__crash(true, "Failed to tell the previous translator that its file descriptors have been taken over!");
+
+    if(should_transfer_external_addr_xlat_caches) {
+        // The previous translator sends the caches once its translator threads have terminated; if it fails to do so,
+        //  this one just starts with the caches it has loaded by itself
+        tundra__handover_cache_message cache_message;
+        int attached_fds[_MAX_ATTACHED_FDS];
+        size_t attached_fd_count = 0;
+
+        if(!_receive_message(handover_state->connection_fd, &cache_message, sizeof(tundra__handover_cache_message), attached_fds, _MAX_ATTACHED_FDS, &attached_fd_count) || !_is_message_header_valid(cache_message.magic, cache_message.version)) {
+            log__info("Failed to receive the external address translation caches from the previous translator - they will not be taken over!");
+        } else {
+            size_t attached_fd_index = 0;
+            for(size_t i = 0; i < instance_count && attached_fd_index < attached_fd_count; i++) {
+                if(cache_message.is_external_addr_xlat_cache_attached[i] == 0)
+                    continue;
+
+                const int cache_fd = attached_fds[attached_fd_index++];
+                if(instances[i].file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL)
+                    xlat_addr_external_cache_file__load_from_fd(instances[i].file_config, instances[i].thread_contexts, cache_fd, _HANDED_OVER_CACHE_DESCRIPTION);
+
+                close(cache_fd);
+            }
+
+            for(; attached_fd_index < attached_fd_count; attached_fd_index++)
+                close(attached_fds[attached_fd_index]);
+        }
+    }
+
+    close(handover_state->connection_fd);
+    handover_state->connection_fd = -1;
+}
+
+// Called periodically from the main thread instead of sleeping; returns true if the file descriptors have been handed
+//  over to a new translator, which means that this one is to drain its in-flight packets and terminate (see
+//  handover__complete_hand_over()). Once the file descriptors have been sent, the new translator's ack is waited for
+//  in the following calls, so the main thread keeps handling signals and checking the translator threads in the
+//  meantime. If anything goes wrong, this translator keeps running as if nothing happened.
+bool handover__wait_for_successor(tundra__handover_state *handover_state, const tundra__xlat_instance *const instances, const size_t instance_count, const int timeout_milliseconds) {
+    if(handover_state->connection_fd >= 0)
+        return _wait_for_successor_ack(handover_state, timeout_milliseconds);
+
+    struct pollfd listening_poll_fd = {.fd = handover_state->listening_fd, .events = POLLIN, .revents = 0};
+    if(poll(&listening_poll_fd, 1, timeout_milliseconds) <= 0)
+        return false; // A signal (which is handled by the caller), a timeout, or an error (which is not worth a crash)
+
+    const int socket_fd = accept4(handover_state->listening_fd, NULL, NULL, SOCK_CLOEXEC);
+    if(socket_fd < 0)
+        return false;
+
+    if(!_is_peer_trusted(socket_fd)) {
+        log__info("A process which is not allowed to take the file descriptors over has connected to the handover socket!");
+        close(socket_fd);
+        return false;
+    }
+
+    if(!_set_socket_timeouts(socket_fd)) {
+        log__info("Failed to set the timeouts of the handover socket!");
+        close(socket_fd);
+        return false;
+    }
+
+    log__info("A new translator has connected to the handover socket - handing the file descriptors over to it...");
+    for(size_t i = 0; i < instance_count; i++) {
+        if(!_send_instance(socket_fd, instances + i, (i == (instance_count - 1)))) {
+            log__info("Failed to hand the file descriptors over to the new translator - this one will keep translating!");
+            close(socket_fd);
+            return false;
+        }
+    }
+
+    tundra__handover_socket_message socket_message;
+    UTILS__MEM_ZERO_OUT(&socket_message, sizeof(tundra__handover_socket_message));
+    _initialize_message_header(socket_message.magic, &socket_message.version);
+    if(!_send_message(socket_fd, &socket_message, sizeof(tundra__handover_socket_message), &handover_state->listening_fd, 1)) {
+        log__info("Failed to hand the file descriptors over to the new translator - this one will keep translating!");
+        close(socket_fd);
+        return false;
+    }
+
+    handover_state->connection_fd = socket_fd;
+    handover_state->successor_ack_deadline = (utils__get_coarse_monotonic_timestamp() + TUNDRA__HANDOVER_TIMEOUT_SECONDS);
+
+    return false;
+}
+
+// The new translator closes the connection if it does not like what it has received
+static bool _wait_for_successor_ack(tundra__handover_state *handover_state, const int timeout_milliseconds) {
+    struct pollfd connection_poll_fd = {.fd = handover_state->connection_fd, .events = POLLIN, .revents = 0};
+    if(poll(&connection_poll_fd, 1, timeout_milliseconds) <= 0) {
+        // A signal (which is handled by the caller), a timeout, or an error (which is not worth a crash)
+        if(utils__get_coarse_monotonic_timestamp() >= handover_state->successor_ack_deadline) {
+            log__info("The new translator has not taken the file descriptors over in time - this one will keep translating!");
+            close(handover_state->connection_fd);
+            handover_state->connection_fd = -1;
+        }
+
+        return false;
+    }
+
+    tundra__handover_ack_message ack_message;
+    size_t attached_fd_count = 0;
+    if(!_receive_message(handover_state->connection_fd, &ack_message, sizeof(tundra__handover_ack_message), NULL, 0, &attached_fd_count) || !_is_message_header_valid(ack_message.magic, ack_message.version)) {
+        log__info("The new translator has not taken the file descriptors over (see its log for details) - this one will keep translating!");
+        close(handover_state->connection_fd);
+        handover_state->connection_fd = -1;
+        return false;
+    }
+
+    handover_state->has_handed_over = true;
+    handover_state->should_transfer_external_addr_xlat_caches = (ack_message.should_transfer_external_addr_xlat_caches != 0);
+
+    log__info("The file descriptors have been taken over by the new translator - this one will now drain its in-flight packets and terminate.");
+
+    return true;
+}
+
+static bool _send_instance(const int socket_fd, const tundra__xlat_instance *const instance, const bool is_last_instance) {
+    const tundra__conf_file *const file_config = instance->file_config;
+
+    tundra__handover_instance_message instance_message;
+    UTILS__MEM_ZERO_OUT(&instance_message, sizeof(tundra__handover_instance_message));
+    _initialize_message_header(instance_message.magic, &instance_message.version);
+    instance_message.io_mode = (uint8_t) file_config->io_mode;
+    instance_message.is_tun_multi_queue = ((file_config->io_mode == TUNDRA__IO_MODE_TUN && file_config->io_tun_multi_queue) ? 1 : 0);
+    instance_message.is_external_addr_xlat_cache_file_fd_attached = ((instance->external_addr_xlat_cache_file_fd >= 0) ? 1 : 0);
+    instance_message.thread_count = (uint32_t) file_config->program_translator_threads;
+    instance_message.is_last_instance = (is_last_instance ? 1 : 0);
+    utils__secure_strncpy(instance_message.name, instance->name, TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH + 1);
+    if(file_config->io_mode == TUNDRA__IO_MODE_TUN)
+        utils__secure_strncpy(instance_message.tun_interface_name, file_config->io_tun_interface_name, IFNAMSIZ);
+
+    if(!_send_message(socket_fd, &instance_message, sizeof(tundra__handover_instance_message), &instance->external_addr_xlat_cache_file_fd, ((instance->external_addr_xlat_cache_file_fd >= 0) ? 1 : 0)))
+        return false;
+
+    // See tundra__handover_thread_message
+    int sent_fds[2 * TUNDRA__MAX_XLAT_THREADS];
+    size_t sent_fd_count = 0;
+    for(size_t i = 0; i < file_config->program_translator_threads; i++) {
+        int new_fds[2];
+        size_t new_fd_count = 0;
+
+        tundra__handover_thread_message thread_message;
+        UTILS__MEM_ZERO_OUT(&thread_message, sizeof(tundra__handover_thread_message));
+        _initialize_message_header(thread_message.magic, &thread_message.version);
+        thread_message.packet_read_fd_index = (uint32_t) _find_or_add_fd(sent_fds, &sent_fd_count, instance->thread_contexts[i].packet_read_fd, new_fds, &new_fd_count);
+        thread_message.packet_write_fd_index = (uint32_t) _find_or_add_fd(sent_fds, &sent_fd_count, instance->thread_contexts[i].packet_write_fd, new_fds, &new_fd_count);
+
+        if(!_send_message(socket_fd, &thread_message, sizeof(tundra__handover_thread_message), new_fds, new_fd_count))
+            return false;
+    }
+
+    return true;
+}
+
+static size_t _find_or_add_fd(int *fds, size_t *fd_count, const int fd, int *new_fds, size_t *new_fd_count) {
+    for(size_t i = 0; i < *fd_count; i++) {
+        if(fds[i] == fd)
+            return i;
+    }
+
+    fds[*fd_count] = fd;
+    new_fds[(*new_fd_count)++] = fd;
+    return (*fd_count)++;
+}
+
+// This function must be called after all the translator threads have been terminated, and before the instances are
+//  finalized!
+void handover__complete_hand_over(tundra__handover_state *handover_state, tundra__xlat_instance *const instances, const size_t instance_count) {
+    // The cache snapshot files now belong to the new translator, which will overwrite them when it terminates
+    for(size_t i = 0; i < instance_count; i++) {
+        if(instances[i].external_addr_xlat_cache_file_fd >= 0) {
+            close(instances[i].external_addr_xlat_cache_file_fd);
+            instances[i].external_addr_xlat_cache_file_fd = -1;
+        }
+    }
+
+    if(handover_state->should_transfer_external_addr_xlat_caches) {
+        tundra__handover_cache_message cache_message;
+        UTILS__MEM_ZERO_OUT(&cache_message, sizeof(tundra__handover_cache_message));
+        _initialize_message_header(cache_message.magic, &cache_message.version);
+
+        int cache_fds[_MAX_ATTACHED_FDS];
+        size_t cache_fd_count = 0;
+        for(size_t i = 0; i < instance_count; i++) {
+            if(instances[i].file_config->addressing_mode != TUNDRA__ADDRESSING_MODE_EXTERNAL)
+                continue;
+
+            // The caches are transferred in the format of the cache snapshot file, within a file which lives in memory
+            const int cache_fd = memfd_create("tundra-nat64-handover-cache", MFD_CLOEXEC);
+            if(cache_fd < 0) {
+                log__info("Failed to create a memory file for the external address translation cache of the instance '%s' - it will not be handed over!", instances[i].name);
+                continue;
+            }
+
+            const size_t entry_count = xlat_addr_external_cache_file__save_to_fd(instances[i].file_config, instances[i].thread_contexts, cache_fd);
+            log__info("%zu entries of the external address translation cache of the instance '%s' will be handed over to the new translator.", entry_count, instances[i].name);
+
+            cache_message.is_external_addr_xlat_cache_attached[i] = 1;
+            cache_fds[cache_fd_count++] = cache_fd;
+        }
+
+        if(!_send_message(handover_state->connection_fd, &cache_message, sizeof(tundra__handover_cache_message), cache_fds, cache_fd_count))
+            log__info("Failed to hand the external address translation caches over to the new translator!");
+
+        for(size_t i = 0; i < cache_fd_count; i++)
+            close(cache_fds[i]);
+    }
+
+    close(handover_state->connection_fd);
+    handover_state->connection_fd = -1;
+}
+
+// Only the superuser and the user the program is running as may take the file descriptors over (the socket's
+//  permissions should not let anyone else connect to it anyway)
+static bool _is_peer_trusted(const int socket_fd) {
+    struct ucred peer_credentials;
+    socklen_t peer_credentials_size = sizeof(struct ucred);
+    if(getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &peer_credentials, &peer_credentials_size) < 0 || peer_credentials_size != sizeof(struct ucred))
+        return false;
+
+    return (peer_credentials.uid == 0 || peer_credentials.uid == geteuid());
+}
+
+static bool _set_socket_timeouts(const int socket_fd) {
+    const struct timeval timeout = {.tv_sec = TUNDRA__HANDOVER_TIMEOUT_SECONDS, .tv_usec = 0};
+
+    return (
+        (setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(struct timeval)) >= 0) &&
+        (setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(struct timeval)) >= 0)
+    );
+}
+
+static struct sockaddr_un _generate_socket_address(const char *const socket_path) {
+    struct sockaddr_un socket_address;
+    UTILS__MEM_ZERO_OUT(&socket_address, sizeof(struct sockaddr_un));
+    socket_address.sun_family = AF_UNIX;
+    utils__secure_strncpy(socket_address.sun_path, socket_path, sizeof(socket_address.sun_path));
+
+    return socket_address;
+}
+
+static void _initialize_message_header(uint8_t *magic, uint8_t *version) {
+    memcpy(magic, _MESSAGE_MAGIC, 4);
+    *version = _MESSAGE_VERSION;
+}
+
+static bool _is_message_header_valid(const uint8_t *magic, const uint8_t version) {
+    return (UTILS__MEM_EQ(magic, _MESSAGE_MAGIC, 4) && version == _MESSAGE_VERSION);
+}
+
+static bool _send_message(const int socket_fd, const void *message, const size_t message_size, const int *fds, const size_t fd_count) {
+    if(fd_count > _MAX_ATTACHED_FDS)
+        log__crash_invalid_internal_state("Too many file descriptors are to be attached to a handover message");
+
+    // FALSE-POSITIVE: sendmsg() does not modify the message, but 'struct iovec' requires the pointer to be non-const
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wcast-qual"
+    struct iovec iov = {.iov_base = (void *) message, .iov_len = message_size};
+    #pragma GCC diagnostic pop
+
+    union {
+        struct cmsghdr header; // Ensures the buffer's alignment
+        uint8_t buffer[CMSG_SPACE(sizeof(int) * _MAX_ATTACHED_FDS)];
+    } control;
+    UTILS__MEM_ZERO_OUT(&control, sizeof(control));
+
+    struct msghdr message_header;
+    UTILS__MEM_ZERO_OUT(&message_header, sizeof(struct msghdr));
+    message_header.msg_iov = &iov;
+    message_header.msg_iovlen = 1;
+
+    if(fd_count > 0) {
+        message_header.msg_control = control.buffer;
+        message_header.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+
+        struct cmsghdr *control_message = CMSG_FIRSTHDR(&message_header);
+        control_message->cmsg_level = SOL_SOCKET;
+        control_message->cmsg_type = SCM_RIGHTS;
+        control_message->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+        memcpy(CMSG_DATA(control_message), fds, sizeof(int) * fd_count);
+    }
+
+    for(;;) {
+        const ssize_t ret_value = sendmsg(socket_fd, &message_header, MSG_NOSIGNAL);
+
+        if(ret_value < 0 && errno == EINTR)
+            continue;
+
+        return (ret_value == (ssize_t) message_size);
+    }
+}
+
+// The received file descriptors have the close-on-exec flag set
+static bool _receive_message(const int socket_fd, void *message, const size_t message_size, int *fds, const size_t max_fd_count, size_t *fd_count) {
+    if(max_fd_count > _MAX_ATTACHED_FDS)
+        log__crash_invalid_internal_state("Too many file descriptors are to be received with a handover message");
+
+    *fd_count = 0;
+
+    struct iovec iov = {.iov_base = message, .iov_len = message_size};
+
+    union {
+        struct cmsghdr header; // Ensures the buffer's alignment
+        uint8_t buffer[CMSG_SPACE(sizeof(int) * _MAX_ATTACHED_FDS)];
+    } control;
+    UTILS__MEM_ZERO_OUT(&control, sizeof(control));
+
+    struct msghdr message_header;
+    UTILS__MEM_ZERO_OUT(&message_header, sizeof(struct msghdr));
+    message_header.msg_iov = &iov;
+    message_header.msg_iovlen = 1;
+    message_header.msg_control = control.buffer;
+    message_header.msg_controllen = sizeof(control.buffer);
+
+    ssize_t ret_value;
+    do {
+        ret_value = recvmsg(socket_fd, &message_header, MSG_CMSG_CLOEXEC);
+    } while(ret_value < 0 && errno == EINTR);
+
+    if(ret_value < 0)
+        return false;
+
+    for(struct cmsghdr *control_message = CMSG_FIRSTHDR(&message_header); control_message != NULL; control_message = CMSG_NXTHDR(&message_header, control_message)) {
+        if(control_message->cmsg_level != SOL_SOCKET || control_message->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        const size_t received_fd_count = ((control_message->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        int received_fds[_MAX_ATTACHED_FDS];
+        memcpy(received_fds, CMSG_DATA(control_message), sizeof(int) * UTILS__MINIMUM_UNSAFE(received_fd_count, _MAX_ATTACHED_FDS));
+
+        // Surplus file descriptors must not be leaked
+        for(size_t i = 0; i < received_fd_count && i < _MAX_ATTACHED_FDS; i++) {
+            if(*fd_count < max_fd_count)
+                fds[(*fd_count)++] = received_fds[i];
+            else
+                close(received_fds[i]);
+        }
+    }
+
+    return ((message_header.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) == 0 && ret_value == (ssize_t) message_size);
+}
+
+
+#undef _MESSAGE_MAGIC
+#undef _MESSAGE_VERSION
+#undef _MAX_ATTACHED_FDS
+#undef _HANDED_OVER_CACHE_DESCRIPTION
@@ -0,0 +1,32 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+extern tundra__handover_state *handover__create_state(const char *const socket_path);
+extern void handover__free_state(tundra__handover_state *handover_state);
+extern bool handover__take_over(tundra__handover_state *handover_state, const tundra__xlat_instance *const instances, const size_t instance_count);
+extern void handover__listen(tundra__handover_state *handover_state);
+extern void handover__complete_take_over(tundra__handover_state *handover_state, const tundra__xlat_instance *const instances, const size_t instance_count, const bool should_transfer_external_addr_xlat_caches);
+extern bool handover__wait_for_successor(tundra__handover_state *handover_state, const tundra__xlat_instance *const instances, const size_t instance_count, const int timeout_milliseconds);
+extern void handover__complete_hand_over(tundra__handover_state *handover_state, tundra__xlat_instance *const instances, const size_t instance_count);
@@ -74,7 +74,10 @@ static void _check_compile_time_config(void) {
         (TUNDRA__MIN_GENERATED_PACKET_TTL > TUNDRA__MAX_GENERATED_PACKET_TTL) ||
         (TUNDRA__MIN_TIMEOUT_MILLISECONDS > TUNDRA__MAX_TIMEOUT_MILLISECONDS) ||
         (sizeof(struct iphdr) != 20) || (sizeof(struct ipv6hdr) != 40) ||
-        (sizeof(tundra__ipv6_frag_header) != 8) || (sizeof(tundra__external_addr_xlat_message) != 40) ||
+        (sizeof(tundra__ipv6_frag_header) != 8) || (sizeof(tundra__external_addr_xlat_message) != 40) || (sizeof(tundra__external_addr_xlat_message_v2) != 80) ||
+        (sizeof(tundra__external_addr_xlat_cache_file_header) != 24) || (sizeof(tundra__external_addr_xlat_cache_file_entry) != 48) ||
+        (sizeof(tundra__handover_instance_message) != 72) || (sizeof(tundra__handover_thread_message) != 16) ||
+        (sizeof(tundra__handover_ack_message) != 8) || (sizeof(tundra__handover_cache_message) != 24) ||
         (sizeof(size_t) < 4) || (sizeof(int) < 4) || (sizeof(unsigned int) < 4)
     ) exit(TUNDRA__EXIT_INVALID_COMPILE_TIME_CONFIG);
 }
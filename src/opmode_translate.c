@@ -26,73 +26,285 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"log.h"
 #include"init_io.h"
 #include"signals.h"
+#include"conf_file.h"
+#include"conf_reload.h"
+#include"conf_rfc7050.h"
+#include"handover.h"
 #include"xlat.h"
-
-
-static tundra__thread_ctx *_initialize_thread_contexts(const tundra__conf_cmdline *const cmdline_config, const tundra__conf_file *const file_config);
-static tundra__external_addr_xlat_state *_initialize_external_addr_xlat_state(const tundra__conf_file *const file_config, char **addressing_external_next_fds_string_ptr);
+#include"xlat_addr_external_cache_file.h"
+#include"xlat_addr_external_inflight.h"
+#include"xlat_addr_external_circuit_breaker.h"
+#include"xlat_addr_external_rate_limiter.h"
+#include"xlat_addr_external_prefix_cache.h"
+#include"xlat_addr_external_timer_wheel.h"
+#include"xlat_addr_plugin.h"
+#include"xlat_addr_bpf.h"
+#include"xlat_addr_nat64_stateful.h"
+#include"xlat_addr_map_t.h"
+#include"xlat_addr_siit_eam.h"
+#include"xlat_addr_clat_nat44.h"
+
+
+static void _prepare_instance(tundra__xlat_instance *const instance, const char *const name, const tundra__conf_file *const file_config, tundra__conf_file *const owned_file_config);
+static void _initialize_instance(tundra__xlat_instance *const instance, const char *const config_file_path, char *const io_inherited_fds, char *const addressing_external_inherited_fds, const tundra__handover_instance_fds *const handed_over_fds);
+static void _finalize_instance(tundra__xlat_instance *const instance);
+static tundra__thread_ctx *_initialize_thread_contexts(const tundra__xlat_instance *const instance, const char *const config_file_path, char *const io_inherited_fds, char *const addressing_external_inherited_fds, const tundra__handover_instance_fds *const handed_over_fds);
+static tundra__external_addr_xlat_state *_initialize_external_addr_xlat_state(const tundra__conf_file *const file_config, tundra__external_addr_xlat_inflight_table *inflight_table, tundra__external_addr_xlat_circuit_breaker *circuit_breaker, char **addressing_external_next_fds_string_ptr);
 static void _free_thread_contexts(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts);
-static void _free_external_addr_xlat_state(tundra__external_addr_xlat_state *external_addr_xlat_state);
+static void _free_external_addr_xlat_state(const tundra__conf_file *const file_config, tundra__external_addr_xlat_state *external_addr_xlat_state);
+static tundra__xlat_worker *_initialize_workers(const tundra__xlat_instance *const instances, const size_t instance_count, size_t *const worker_count);
+static void _check_packet_read_fds_are_not_shared(const tundra__xlat_instance *const instances, const size_t instance_count);
 static void _partially_daemonize(const tundra__conf_file *const file_config);
-static void _start_threads(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts);
-static void _print_info_about_xlat_start(const tundra__conf_file *const file_config);
-static void _monitor_threads(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts);
-static void _terminate_threads(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts);
+static void _start_threads(tundra__xlat_worker *const workers, const size_t worker_count);
+static void _print_info_about_xlat_start(const tundra__xlat_instance *const instance, const bool print_instance_name);
+static void _monitor_threads(const tundra__xlat_instance *const instances, const size_t instance_count, const tundra__xlat_worker *const workers, const size_t worker_count, tundra__handover_state *const handover_state);
+static void _reload_addr_xlat_plugins_and_bpf_programs(const tundra__xlat_instance *const instances, const size_t instance_count);
+static void _terminate_threads(tundra__xlat_worker *const workers, const size_t worker_count);
 
 
 void opmode_translate__run(const tundra__conf_cmdline *const cmdline_config, const tundra__conf_file *const file_config) {
+    log__info("%s", TUNDRA__PROGRAM_INFO_STRING);
+
+    // Each instance has its own thread contexts (and therefore its own addressing state), but their packets are
+    //  translated by a single pool of threads (see _initialize_workers())
+    const size_t instance_count = (cmdline_config->instance_count + 1);
+    tundra__xlat_instance *const instances = utils__alloc_zeroed_out_memory(instance_count, sizeof(tundra__xlat_instance));
+
+    _prepare_instance(instances, "main", file_config, NULL);
+    for(size_t i = 1; i < instance_count; i++) {
+        // Just as the main instance's configuration file, these files are read before the program's privileges are dropped
+        tundra__conf_file *const instance_file_config = conf_file__read_and_parse_config_file(cmdline_config->instance_config_file_paths[i - 1]);
+        _prepare_instance(instances + i, cmdline_config->instance_names[i - 1], instance_file_config, instance_file_config);
+    }
+
+    // If another translator is running, its file descriptors are taken over instead of being opened (see handover.c)
+    tundra__handover_state *const handover_state = (
+        (cmdline_config->handover_socket_path != NULL) ?
+        handover__create_state(cmdline_config->handover_socket_path) :
+        NULL
+    );
+    const bool has_taken_over = (handover_state != NULL && handover__take_over(handover_state, instances, instance_count));
+
+    _initialize_instance(instances, cmdline_config->config_file_path, cmdline_config->io_inherited_fds, cmdline_config->addressing_external_inherited_fds, (has_taken_over ? handover_state->instance_fds : NULL));
+    for(size_t i = 1; i < instance_count; i++)
+        _initialize_instance(instances + i, cmdline_config->instance_config_file_paths[i - 1], cmdline_config->instance_io_inherited_fds[i - 1], NULL, (has_taken_over ? (handover_state->instance_fds + i) : NULL));
+
+    size_t worker_count = 0;
+    tundra__xlat_worker *const workers = _initialize_workers(instances, instance_count, &worker_count);
+
+    if(handover_state != NULL)
+        handover__listen(handover_state);
+    _partially_daemonize(file_config); // The privileges are dropped according to the main instance's configuration
+    if(has_taken_over)
+        handover__complete_take_over(handover_state, instances, instance_count, cmdline_config->handover_external_cache);
+    _start_threads(workers, worker_count);
+    for(size_t i = 0; i < instance_count; i++) {
+        if(instances[i].rfc7050_rediscovery_state != NULL)
+            conf_rfc7050__start_rediscovery_thread(instances[i].rfc7050_rediscovery_state);
+
+        _print_info_about_xlat_start(instances + i, (instance_count > 1));
+    }
+
+    _monitor_threads(instances, instance_count, workers, worker_count, handover_state);
+
+    for(size_t i = 0; i < instance_count; i++) {
+        if(instances[i].rfc7050_rediscovery_state != NULL)
+            conf_rfc7050__stop_rediscovery_thread(instances[i].rfc7050_rediscovery_state);
+    }
+    _terminate_threads(workers, worker_count);
+    if(handover_state != NULL && handover_state->has_handed_over)
+        handover__complete_hand_over(handover_state, instances, instance_count);
+    for(size_t i = 0; i < instance_count; i++)
+        _finalize_instance(instances + i);
+
+    if(handover_state != NULL)
+        handover__free_state(handover_state);
+
+    utils__free_memory(workers);
+    utils__free_memory(instances);
+
+    log__info("Tundra will now terminate.");
+}
+
+static void _prepare_instance(tundra__xlat_instance *const instance, const char *const name, const tundra__conf_file *const file_config, tundra__conf_file *const owned_file_config) {
     if(file_config->program_translator_threads < 1 || file_config->program_translator_threads > TUNDRA__MAX_XLAT_THREADS)
         log__crash_invalid_internal_state("Invalid count of translator threads");
 
-    log__info("%s", TUNDRA__PROGRAM_INFO_STRING);
+    instance->name = name;
+    instance->owned_file_config = owned_file_config;
+    instance->file_config = file_config;
+    instance->thread_contexts = NULL;
+    instance->rfc7050_rediscovery_state = NULL;
+    instance->external_addr_xlat_cache_file_fd = -1;
+}
 
-    tundra__thread_ctx *thread_contexts = _initialize_thread_contexts(cmdline_config, file_config);
-    _partially_daemonize(file_config);
-    _start_threads(file_config, thread_contexts);
-    _print_info_about_xlat_start(file_config);
+// 'handed_over_fds' is NULL unless the file descriptors have been taken over from a previously running translator
+static void _initialize_instance(tundra__xlat_instance *const instance, const char *const config_file_path, char *const io_inherited_fds, char *const addressing_external_inherited_fds, const tundra__handover_instance_fds *const handed_over_fds) {
+    const tundra__conf_file *const file_config = instance->file_config;
+
+    instance->thread_contexts = _initialize_thread_contexts(instance, config_file_path, io_inherited_fds, addressing_external_inherited_fds, handed_over_fds);
+    instance->external_addr_xlat_cache_file_fd = xlat_addr_external_cache_file__open_and_load(file_config, instance->thread_contexts, ((handed_over_fds != NULL) ? handed_over_fds->external_addr_xlat_cache_file_fd : -1));
+    instance->rfc7050_rediscovery_state = (
+        (file_config->addressing_nat64_clat_siit_rfc7050_rediscovery) ?
+        conf_rfc7050__create_rediscovery_state(file_config, instance->thread_contexts[0].conf_reload_state) :
+        NULL
+    );
+}
 
-    _monitor_threads(file_config, thread_contexts);
+// The instance's threads must have been terminated before this function is called!
+static void _finalize_instance(tundra__xlat_instance *const instance) {
+    if(instance->rfc7050_rediscovery_state != NULL)
+        conf_rfc7050__free_rediscovery_state(instance->rfc7050_rediscovery_state);
 
-    _terminate_threads(file_config, thread_contexts);
-    _free_thread_contexts(file_config, thread_contexts);
+    xlat_addr_external_cache_file__save_and_close(instance->file_config, instance->thread_contexts, instance->external_addr_xlat_cache_file_fd);
+    _free_thread_contexts(instance->file_config, instance->thread_contexts);
 
-    log__info("Tundra will now terminate.");
+    if(instance->owned_file_config != NULL)
+        conf_file__free_parsed_config_file(instance->owned_file_config);
 }
 
-static tundra__thread_ctx *_initialize_thread_contexts(const tundra__conf_cmdline *const cmdline_config, const tundra__conf_file *const file_config) {
+static tundra__thread_ctx *_initialize_thread_contexts(const tundra__xlat_instance *const instance, const char *const config_file_path, char *const io_inherited_fds, char *const addressing_external_inherited_fds, const tundra__handover_instance_fds *const handed_over_fds) {
+    const tundra__conf_file *const file_config = instance->file_config;
+    const bool is_main_instance = (instance->owned_file_config == NULL);
     tundra__thread_ctx *thread_contexts = utils__alloc_zeroed_out_memory(file_config->program_translator_threads, sizeof(tundra__thread_ctx));
 
-    if(file_config->io_mode == TUNDRA__IO_MODE_INHERITED_FDS && cmdline_config->io_inherited_fds == NULL)
-        log__crash(false, "Even though the program is in the 'inherited-fds' I/O mode, the '-f' / '--io-inherited-fds' command-line option is missing!");
+    if(file_config->io_mode == TUNDRA__IO_MODE_INHERITED_FDS && io_inherited_fds == NULL && handed_over_fds == NULL) {
+        if(is_main_instance)
+            log__crash(false, "Even though the program is in the 'inherited-fds' I/O mode, the '-f' / '--io-inherited-fds' command-line option is missing!");
+        log__crash(false, "Even though the instance '%s' is in the 'inherited-fds' I/O mode, the '-I' / '--instance-io-inherited-fds' command-line option is missing for it!", instance->name);
+    }
 
-    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS && cmdline_config->addressing_external_inherited_fds == NULL)
-        log__crash(false, "Even though the program is configured to use the 'inherited-fds' transport of the 'external' addressing mode, the '-F' / '--addressing-external-inherited-fds' command-line option is missing!");
+    if(file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS && addressing_external_inherited_fds == NULL) {
+        if(is_main_instance)
+            log__crash(false, "Even though the program is configured to use the 'inherited-fds' transport of the 'external' addressing mode, the '-F' / '--addressing-external-inherited-fds' command-line option is missing!");
+        log__crash(false, "The instance '%s' is configured to use the 'inherited-fds' transport of the 'external' addressing mode, which is only supported by the main instance!", instance->name);
+    }
 
 
-    char *io_next_fds_string_ptr = cmdline_config->io_inherited_fds;
-    char *addressing_external_next_fds_string_ptr = cmdline_config->addressing_external_inherited_fds;
+    char *io_next_fds_string_ptr = io_inherited_fds;
+    char *addressing_external_next_fds_string_ptr = addressing_external_inherited_fds;
     int single_queue_tun_fd = -1;
 
+    // Concurrent identical queries can only occur if there is more than one translator thread
+    tundra__external_addr_xlat_inflight_table *inflight_table = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->program_translator_threads > 1) ?
+        xlat_addr_external_inflight__create_table() :
+        NULL
+    );
+
+    // The circuit breaker is shared by all the translator threads as well
+    tundra__external_addr_xlat_circuit_breaker *circuit_breaker = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL && file_config->addressing_external_unix_tcp_circuit_breaker_failure_threshold > 0) ?
+        xlat_addr_external_circuit_breaker__create() :
+        NULL
+    );
+
+    // The plugin is loaded (and initialized) here, i.e. before the program's privileges are dropped
+    tundra__addr_xlat_plugin *addr_xlat_plugin = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_PLUGIN) ?
+        xlat_addr_plugin__load(file_config) :
+        NULL
+    );
+
+    // The eBPF program and its maps are loaded here as well, i.e. before the program's privileges are dropped
+    tundra__bpf_addr_xlat_state *bpf_addr_xlat_state = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_BPF) ?
+        xlat_addr_bpf__create_state(file_config) :
+        NULL
+    );
+
+    // The session table is shared by all the translator threads (it is sharded to reduce lock contention)
+    tundra__nat64_stateful_state *nat64_stateful_state = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL) ?
+        xlat_addr_nat64_stateful__create_state(file_config) :
+        NULL
+    );
+
+    tundra__clat_nat44_state *clat_nat44_state = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_CLAT && file_config->addressing_clat_nat44) ?
+        xlat_addr_clat_nat44__create_state() :
+        NULL
+    );
+
+    // The MAP rules are loaded here as well, i.e. before the program's privileges are dropped
+    tundra__map_t_state *map_t_state = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_MAP_T) ?
+        xlat_addr_map_t__create_state(file_config) :
+        NULL
+    );
+
+    // ... and so are the explicit address mappings
+    tundra__siit_eam_state *siit_eam_state = (
+        (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_SIIT && file_config->addressing_siit_eam_file != NULL) ?
+        xlat_addr_siit_eam__create_state(file_config) :
+        NULL
+    );
+
+    // The configuration (and the data loaded according to it) can be replaced while the translator is running; the
+    //  initial version takes ownership of the explicit address mappings
+    tundra__conf_reload_state *conf_reload_state = conf_reload__create_state(config_file_path, file_config, siit_eam_state);
+
     for(size_t i = 0; i < file_config->program_translator_threads; i++) {
-        // thread_contexts[i].thread stays uninitialized (it is initialized in _start_threads())
         thread_contexts[i].thread_id = (i + 1); // Thread ID 0 is reserved for the main thread
+        thread_contexts[i].current_timestamp = utils__get_coarse_monotonic_timestamp();
         thread_contexts[i].in_packet_buffer = utils__alloc_aligned_zeroed_out_memory(TUNDRA__MAX_PACKET_SIZE + 1, sizeof(uint8_t), 64);
         thread_contexts[i].in_packet_size = 0;
-        thread_contexts[i].config = file_config;
-        thread_contexts[i].joined = false;
+        thread_contexts[i].conf_reload_state = conf_reload_state;
+        thread_contexts[i].conf_file_version = conf_reload__acquire_current_version(conf_reload_state, &thread_contexts[i].conf_file_version_generation);
+        thread_contexts[i].config = thread_contexts[i].conf_file_version->config;
 
         if(getrandom(&thread_contexts[i].frag_id_ipv6, 4, 0) != 4 || getrandom(&thread_contexts[i].frag_id_ipv4, 2, 0) != 2)
             log__crash(false, "Failed to generate fragment identifiers using the getrandom() system call!");
 
         thread_contexts[i].external_addr_xlat_state = (
             (file_config->addressing_mode == TUNDRA__ADDRESSING_MODE_EXTERNAL) ?
-            _initialize_external_addr_xlat_state(file_config, &addressing_external_next_fds_string_ptr) :
+            _initialize_external_addr_xlat_state(file_config, inflight_table, circuit_breaker, &addressing_external_next_fds_string_ptr) :
             NULL
         );
 
+        thread_contexts[i].addr_xlat_plugin = addr_xlat_plugin;
+        thread_contexts[i].addr_xlat_plugin_thread_data = (
+            (addr_xlat_plugin != NULL) ?
+            xlat_addr_plugin__initialize_thread_data(addr_xlat_plugin, thread_contexts[i].thread_id) :
+            NULL
+        );
+
+        thread_contexts[i].bpf_addr_xlat_state = bpf_addr_xlat_state;
+        thread_contexts[i].bpf_addr_xlat_image = (
+            (bpf_addr_xlat_state != NULL) ?
+            xlat_addr_bpf__acquire_current_image(bpf_addr_xlat_state, &thread_contexts[i].bpf_addr_xlat_image_generation) :
+            NULL
+        );
+
+        thread_contexts[i].nat64_stateful_state = nat64_stateful_state;
+        thread_contexts[i].clat_nat44_state = clat_nat44_state;
+        thread_contexts[i].map_t_state = map_t_state;
+        thread_contexts[i].siit_eam_state = thread_contexts[i].conf_file_version->siit_eam_state;
+
+        if(file_config->translator_hairpinning) {
+            thread_contexts[i].hairpin_packet = utils__alloc_zeroed_out_memory(1, sizeof(tundra__hairpin_packet));
+            thread_contexts[i].hairpin_packet->buffer = utils__alloc_aligned_zeroed_out_memory(TUNDRA__MAX_PACKET_SIZE + 1, sizeof(uint8_t), 64);
+            thread_contexts[i].hairpin_packet->size = 0;
+        } else {
+            thread_contexts[i].hairpin_packet = NULL;
+        }
+        thread_contexts[i].is_hairpinning = false;
+        thread_contexts[i].is_in_packet_hairpinned = false;
+        thread_contexts[i].is_siit_hairpin_destination = false;
+
+        if(handed_over_fds != NULL) {
+            thread_contexts[i].packet_read_fd = handed_over_fds->packet_fds[2 * i];
+            thread_contexts[i].packet_write_fd = handed_over_fds->packet_fds[(2 * i) + 1];
+            continue;
+        }
+
         switch(file_config->io_mode) {
             case TUNDRA__IO_MODE_INHERITED_FDS:
-                io_next_fds_string_ptr = init_io__get_fd_pair_from_inherited_fds_string(&thread_contexts[i].packet_read_fd, &thread_contexts[i].packet_write_fd, io_next_fds_string_ptr, 'f', "io-inherited-fds");
+                io_next_fds_string_ptr = (
+                    is_main_instance ?
+                    init_io__get_fd_pair_from_inherited_fds_string(&thread_contexts[i].packet_read_fd, &thread_contexts[i].packet_write_fd, io_next_fds_string_ptr, 'f', "io-inherited-fds") :
+                    init_io__get_fd_pair_from_inherited_fds_string(&thread_contexts[i].packet_read_fd, &thread_contexts[i].packet_write_fd, io_next_fds_string_ptr, 'I', "instance-io-inherited-fds")
+                );
                 break;
 
             case TUNDRA__IO_MODE_TUN:
@@ -116,33 +328,71 @@ static tundra__thread_ctx *_initialize_thread_contexts(const tundra__conf_cmdlin
     return thread_contexts;
 }
 
-static tundra__external_addr_xlat_state *_initialize_external_addr_xlat_state(const tundra__conf_file *const file_config, char **addressing_external_next_fds_string_ptr) {
+static tundra__external_addr_xlat_state *_initialize_external_addr_xlat_state(const tundra__conf_file *const file_config, tundra__external_addr_xlat_inflight_table *inflight_table, tundra__external_addr_xlat_circuit_breaker *circuit_breaker, char **addressing_external_next_fds_string_ptr) {
     tundra__external_addr_xlat_state *external_addr_xlat_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__external_addr_xlat_state));
 
+    external_addr_xlat_state->inflight_table = inflight_table;
+    external_addr_xlat_state->circuit_breaker = circuit_breaker;
+    external_addr_xlat_state->rate_limiter = (
+        (file_config->addressing_external_query_rate_limit_per_second > 0) ?
+        xlat_addr_external_rate_limiter__create() :
+        NULL
+    );
+
+    const time_t current_timestamp = utils__get_coarse_monotonic_timestamp();
+
     if(file_config->addressing_external_cache_size_main_addresses > 0) {
-        // It is absolutely crucial that the cache memory is zeroed out!
-        external_addr_xlat_state->cache_4to6_main_packet = utils__alloc_zeroed_out_memory(file_config->addressing_external_cache_size_main_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
-        external_addr_xlat_state->cache_6to4_main_packet = utils__alloc_zeroed_out_memory(file_config->addressing_external_cache_size_main_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+        // It is absolutely crucial that the cache memory is zeroed out! (the pages of the mapping are zeroed out lazily)
+        external_addr_xlat_state->cache_4to6_main_packet = utils__alloc_huge_page_backed_zeroed_out_memory(file_config->addressing_external_cache_size_main_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+        external_addr_xlat_state->cache_6to4_main_packet = utils__alloc_huge_page_backed_zeroed_out_memory(file_config->addressing_external_cache_size_main_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+        external_addr_xlat_state->timer_wheel_4to6_main_packet = xlat_addr_external_timer_wheel__create(file_config->addressing_external_cache_size_main_addresses, current_timestamp);
+        external_addr_xlat_state->timer_wheel_6to4_main_packet = xlat_addr_external_timer_wheel__create(file_config->addressing_external_cache_size_main_addresses, current_timestamp);
     } else {
         external_addr_xlat_state->cache_4to6_main_packet = NULL;
         external_addr_xlat_state->cache_6to4_main_packet = NULL;
+        external_addr_xlat_state->timer_wheel_4to6_main_packet = NULL;
+        external_addr_xlat_state->timer_wheel_6to4_main_packet = NULL;
     }
 
     if(file_config->addressing_external_cache_size_icmp_error_addresses > 0) {
-        // It is absolutely crucial that the cache memory is zeroed out!
-        external_addr_xlat_state->cache_4to6_icmp_error_packet = utils__alloc_zeroed_out_memory(file_config->addressing_external_cache_size_icmp_error_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
-        external_addr_xlat_state->cache_6to4_icmp_error_packet = utils__alloc_zeroed_out_memory(file_config->addressing_external_cache_size_icmp_error_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+        // It is absolutely crucial that the cache memory is zeroed out! (the pages of the mapping are zeroed out lazily)
+        external_addr_xlat_state->cache_4to6_icmp_error_packet = utils__alloc_huge_page_backed_zeroed_out_memory(file_config->addressing_external_cache_size_icmp_error_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+        external_addr_xlat_state->cache_6to4_icmp_error_packet = utils__alloc_huge_page_backed_zeroed_out_memory(file_config->addressing_external_cache_size_icmp_error_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+        external_addr_xlat_state->timer_wheel_4to6_icmp_error_packet = xlat_addr_external_timer_wheel__create(file_config->addressing_external_cache_size_icmp_error_addresses, current_timestamp);
+        external_addr_xlat_state->timer_wheel_6to4_icmp_error_packet = xlat_addr_external_timer_wheel__create(file_config->addressing_external_cache_size_icmp_error_addresses, current_timestamp);
     } else {
         external_addr_xlat_state->cache_4to6_icmp_error_packet = NULL;
         external_addr_xlat_state->cache_6to4_icmp_error_packet = NULL;
+        external_addr_xlat_state->timer_wheel_4to6_icmp_error_packet = NULL;
+        external_addr_xlat_state->timer_wheel_6to4_icmp_error_packet = NULL;
     }
 
-    if(file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS) {
-        *addressing_external_next_fds_string_ptr = init_io__get_fd_pair_from_inherited_fds_string(&external_addr_xlat_state->read_fd, &external_addr_xlat_state->write_fd, *addressing_external_next_fds_string_ptr, 'F', "addressing-external-inherited-fds");
+    if(file_config->addressing_external_cache_size_prefix_mappings > 0) {
+        external_addr_xlat_state->prefix_cache_4to6_main_packet = xlat_addr_external_prefix_cache__create(file_config->addressing_external_cache_size_prefix_mappings, current_timestamp);
+        external_addr_xlat_state->prefix_cache_4to6_icmp_error_packet = xlat_addr_external_prefix_cache__create(file_config->addressing_external_cache_size_prefix_mappings, current_timestamp);
+        external_addr_xlat_state->prefix_cache_6to4_main_packet = xlat_addr_external_prefix_cache__create(file_config->addressing_external_cache_size_prefix_mappings, current_timestamp);
+        external_addr_xlat_state->prefix_cache_6to4_icmp_error_packet = xlat_addr_external_prefix_cache__create(file_config->addressing_external_cache_size_prefix_mappings, current_timestamp);
     } else {
-        external_addr_xlat_state->read_fd = external_addr_xlat_state->write_fd = -1;
+        external_addr_xlat_state->prefix_cache_4to6_main_packet = NULL;
+        external_addr_xlat_state->prefix_cache_4to6_icmp_error_packet = NULL;
+        external_addr_xlat_state->prefix_cache_6to4_main_packet = NULL;
+        external_addr_xlat_state->prefix_cache_6to4_icmp_error_packet = NULL;
     }
 
+    external_addr_xlat_state->last_push_check_timestamp = 0;
+    external_addr_xlat_state->last_eviction_timestamp = 0;
+    external_addr_xlat_state->are_evictions_pending = false;
+
+    for(size_t i = 0; i < TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS; i++) {
+        external_addr_xlat_state->servers[i].read_fd = external_addr_xlat_state->servers[i].write_fd = -1;
+        external_addr_xlat_state->servers[i].has_recv_timed_out = false;
+    }
+    external_addr_xlat_state->current_server_index = 0;
+    external_addr_xlat_state->pending_refresh_count = 0;  // All the 'pending_refreshes' are zeroed out, i.e. not in use
+
+    if(file_config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS)
+        *addressing_external_next_fds_string_ptr = init_io__get_fd_pair_from_inherited_fds_string(&external_addr_xlat_state->servers[0].read_fd, &external_addr_xlat_state->servers[0].write_fd, *addressing_external_next_fds_string_ptr, 'F', "addressing-external-inherited-fds");
+
     if(getrandom(&external_addr_xlat_state->message_identifier, 4, 0) != 4)
         log__crash(false, "Failed to generate a message identifier for external address translation using the getrandom() system call!");
 
@@ -151,38 +401,160 @@ static tundra__external_addr_xlat_state *_initialize_external_addr_xlat_state(co
 
 // Closes 'packet_read_fd' and 'packet_write_fd', but not 'termination_pipe_read_fd'!
 static void _free_thread_contexts(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts) {
+    // The in-flight table and the circuit breaker are shared by all the threads
+    if(thread_contexts[0].external_addr_xlat_state != NULL && thread_contexts[0].external_addr_xlat_state->inflight_table != NULL)
+        xlat_addr_external_inflight__free_table(thread_contexts[0].external_addr_xlat_state->inflight_table);
+
+    if(thread_contexts[0].external_addr_xlat_state != NULL && thread_contexts[0].external_addr_xlat_state->circuit_breaker != NULL)
+        xlat_addr_external_circuit_breaker__free(thread_contexts[0].external_addr_xlat_state->circuit_breaker);
+
     for(size_t i = 0; i < file_config->program_translator_threads; i++) {
         utils__free_memory(thread_contexts[i].in_packet_buffer);
 
+        if(thread_contexts[i].hairpin_packet != NULL) {
+            utils__free_memory(thread_contexts[i].hairpin_packet->buffer);
+            utils__free_memory(thread_contexts[i].hairpin_packet);
+        }
+
         if(thread_contexts[i].external_addr_xlat_state != NULL)
-            _free_external_addr_xlat_state(thread_contexts[i].external_addr_xlat_state);
+            _free_external_addr_xlat_state(file_config, thread_contexts[i].external_addr_xlat_state);
+
+        if(thread_contexts[i].addr_xlat_plugin != NULL)
+            xlat_addr_plugin__finalize_thread_data(thread_contexts[i].addr_xlat_plugin, thread_contexts[i].addr_xlat_plugin_thread_data);
+
+        if(thread_contexts[i].bpf_addr_xlat_state != NULL)
+            xlat_addr_bpf__release_image(thread_contexts[i].bpf_addr_xlat_state, thread_contexts[i].bpf_addr_xlat_image);
+
+        conf_reload__release_version(thread_contexts[i].conf_reload_state, thread_contexts[i].conf_file_version);
 
         init_io__close_fd(thread_contexts[i].packet_read_fd, true);
         init_io__close_fd(thread_contexts[i].packet_write_fd, true);
     }
 
+    // The plugin must be unloaded after the data of all the threads have been finalized
+    if(thread_contexts[0].addr_xlat_plugin != NULL)
+        xlat_addr_plugin__unload(thread_contexts[0].addr_xlat_plugin);
+
+    if(thread_contexts[0].bpf_addr_xlat_state != NULL)
+        xlat_addr_bpf__free_state(thread_contexts[0].bpf_addr_xlat_state);
+
+    if(thread_contexts[0].nat64_stateful_state != NULL)
+        xlat_addr_nat64_stateful__free_state(thread_contexts[0].nat64_stateful_state);
+
+    if(thread_contexts[0].clat_nat44_state != NULL)
+        xlat_addr_clat_nat44__free_state(thread_contexts[0].clat_nat44_state);
+
+    if(thread_contexts[0].map_t_state != NULL)
+        xlat_addr_map_t__free_state(thread_contexts[0].map_t_state);
+
+    // The explicit address mappings are freed along with the last version of the configuration which uses them
+    conf_reload__free_state(thread_contexts[0].conf_reload_state);
+
     utils__free_memory(thread_contexts);
 }
 
-static void _free_external_addr_xlat_state(tundra__external_addr_xlat_state *external_addr_xlat_state) {
+static void _free_external_addr_xlat_state(const tundra__conf_file *const file_config, tundra__external_addr_xlat_state *external_addr_xlat_state) {
     if(external_addr_xlat_state->cache_4to6_main_packet != NULL)
-        utils__free_memory(external_addr_xlat_state->cache_4to6_main_packet);
+        utils__free_huge_page_backed_memory(external_addr_xlat_state->cache_4to6_main_packet, file_config->addressing_external_cache_size_main_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
 
     if(external_addr_xlat_state->cache_4to6_icmp_error_packet != NULL)
-        utils__free_memory(external_addr_xlat_state->cache_4to6_icmp_error_packet);
+        utils__free_huge_page_backed_memory(external_addr_xlat_state->cache_4to6_icmp_error_packet, file_config->addressing_external_cache_size_icmp_error_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
 
     if(external_addr_xlat_state->cache_6to4_main_packet != NULL)
-        utils__free_memory(external_addr_xlat_state->cache_6to4_main_packet);
+        utils__free_huge_page_backed_memory(external_addr_xlat_state->cache_6to4_main_packet, file_config->addressing_external_cache_size_main_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
 
     if(external_addr_xlat_state->cache_6to4_icmp_error_packet != NULL)
-        utils__free_memory(external_addr_xlat_state->cache_6to4_icmp_error_packet);
+        utils__free_huge_page_backed_memory(external_addr_xlat_state->cache_6to4_icmp_error_packet, file_config->addressing_external_cache_size_icmp_error_addresses, sizeof(tundra__external_addr_xlat_cache_entry));
+
+    if(external_addr_xlat_state->timer_wheel_4to6_main_packet != NULL)
+        xlat_addr_external_timer_wheel__free(external_addr_xlat_state->timer_wheel_4to6_main_packet);
+
+    if(external_addr_xlat_state->timer_wheel_4to6_icmp_error_packet != NULL)
+        xlat_addr_external_timer_wheel__free(external_addr_xlat_state->timer_wheel_4to6_icmp_error_packet);
+
+    if(external_addr_xlat_state->timer_wheel_6to4_main_packet != NULL)
+        xlat_addr_external_timer_wheel__free(external_addr_xlat_state->timer_wheel_6to4_main_packet);
+
+    if(external_addr_xlat_state->timer_wheel_6to4_icmp_error_packet != NULL)
+        xlat_addr_external_timer_wheel__free(external_addr_xlat_state->timer_wheel_6to4_icmp_error_packet);
+
+    if(external_addr_xlat_state->prefix_cache_4to6_main_packet != NULL)
+        xlat_addr_external_prefix_cache__free(external_addr_xlat_state->prefix_cache_4to6_main_packet);
+
+    if(external_addr_xlat_state->prefix_cache_4to6_icmp_error_packet != NULL)
+        xlat_addr_external_prefix_cache__free(external_addr_xlat_state->prefix_cache_4to6_icmp_error_packet);
+
+    if(external_addr_xlat_state->prefix_cache_6to4_main_packet != NULL)
+        xlat_addr_external_prefix_cache__free(external_addr_xlat_state->prefix_cache_6to4_main_packet);
 
-    init_io__close_fd(external_addr_xlat_state->read_fd, true);
-    init_io__close_fd(external_addr_xlat_state->write_fd, true);
+    if(external_addr_xlat_state->prefix_cache_6to4_icmp_error_packet != NULL)
+        xlat_addr_external_prefix_cache__free(external_addr_xlat_state->prefix_cache_6to4_icmp_error_packet);
+
+    if(external_addr_xlat_state->rate_limiter != NULL)
+        xlat_addr_external_rate_limiter__free(external_addr_xlat_state->rate_limiter);
+
+    for(size_t i = 0; i < TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS; i++) {
+        init_io__close_fd(external_addr_xlat_state->servers[i].read_fd, true);
+        init_io__close_fd(external_addr_xlat_state->servers[i].write_fd, true);
+    }
 
     utils__free_memory(external_addr_xlat_state);
 }
 
+// The n-th worker (translator thread) serves the n-th thread context of each instance which has more than n of them, so
+//  there are as many workers as the largest instance has translator threads configured
+static tundra__xlat_worker *_initialize_workers(const tundra__xlat_instance *const instances, const size_t instance_count, size_t *const worker_count) {
+    if(instance_count < 1 || instance_count > TUNDRA__MAX_XLAT_INSTANCES)
+        log__crash_invalid_internal_state("Invalid count of translation instances");
+
+    *worker_count = 0;
+    for(size_t i = 0; i < instance_count; i++)
+        *worker_count = UTILS__MAXIMUM_UNSAFE(*worker_count, instances[i].file_config->program_translator_threads);
+
+    tundra__xlat_worker *const workers = utils__alloc_zeroed_out_memory(*worker_count, sizeof(tundra__xlat_worker));
+
+    for(size_t w = 0; w < *worker_count; w++) {
+        // workers[w].thread stays uninitialized (it is initialized in _start_threads())
+        workers[w].thread_context_count = 0;
+        workers[w].joined = false;
+
+        for(size_t i = 0; i < instance_count; i++) {
+            if(instances[i].file_config->program_translator_threads <= w)
+                continue;
+
+            tundra__thread_ctx *const ctx = instances[i].thread_contexts + w;
+            workers[w].thread_contexts[workers[w].thread_context_count] = ctx;
+            workers[w].poll_fds[workers[w].thread_context_count].fd = ctx->packet_read_fd;
+            workers[w].poll_fds[workers[w].thread_context_count].events = POLLIN;
+            workers[w].poll_fds[workers[w].thread_context_count].revents = 0;
+            workers[w].thread_context_count++;
+        }
+    }
+
+    if(instance_count > 1)
+        _check_packet_read_fds_are_not_shared(instances, instance_count);
+
+    return workers;
+}
+
+// A thread which serves several file descriptors waits for packets using poll() and then reads them - if a file
+//  descriptor was read by another thread as well, the packet could be "stolen" in the meantime, and the thread would
+//  block in read(), holding up the packets of all the other instances it serves
+static void _check_packet_read_fds_are_not_shared(const tundra__xlat_instance *const instances, const size_t instance_count) {
+    for(size_t i = 0; i < instance_count; i++) {
+        for(size_t j = 0; j < instances[i].file_config->program_translator_threads; j++) {
+            const int packet_read_fd = instances[i].thread_contexts[j].packet_read_fd;
+
+            for(size_t k = i; k < instance_count; k++) {
+                for(size_t l = ((k == i) ? (j + 1) : 0); l < instances[k].file_config->program_translator_threads; l++) {
+                    if(instances[k].thread_contexts[l].packet_read_fd == packet_read_fd)
+                        log__crash(false, "When there are multiple translation instances, each translator thread must read packets from its own file descriptor, but the instances '%s' and '%s' share one (use 'io.tun.multi_queue = yes' with multiple translator threads, and do not pass the same inherited file descriptor twice)!", instances[i].name, instances[k].name);
+                }
+            }
+        }
+    }
+}
+
 static void _partially_daemonize(const tundra__conf_file *const file_config) {
     // --- chdir() ---
     if(chdir(TUNDRA__WORK_DIR) < 0)
@@ -202,9 +574,9 @@ static void _partially_daemonize(const tundra__conf_file *const file_config) {
         log__crash(true, "Fail to drop the program's user privileges to UID %"PRIdMAX" (the setuid() call failed)!", (intmax_t) file_config->program_privilege_drop_user_uid);
 }
 
-static void _start_threads(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts) {
-    for(size_t i = 0; i < file_config->program_translator_threads; i++) {
-        const int pthread_errno = pthread_create(&thread_contexts[i].thread, NULL, xlat__run_thread, thread_contexts + i);
+static void _start_threads(tundra__xlat_worker *const workers, const size_t worker_count) {
+    for(size_t w = 0; w < worker_count; w++) {
+        const int pthread_errno = pthread_create(&workers[w].thread, NULL, xlat__run_thread, workers + w);
         if(pthread_errno != 0) {
             errno = pthread_errno;
             log__crash(true, "Failed to create a new translator thread!");
@@ -212,23 +584,33 @@ static void _start_threads(const tundra__conf_file *const file_config, tundra__t
     }
 }
 
-static void _print_info_about_xlat_start(const tundra__conf_file *const file_config) {
+static void _print_info_about_xlat_start(const tundra__xlat_instance *const instance, const bool print_instance_name) {
+    const tundra__conf_file *const file_config = instance->file_config;
+
     const char *addressing_mode_string = NULL;
     switch(file_config->addressing_mode) {
         case TUNDRA__ADDRESSING_MODE_NAT64: addressing_mode_string = "NAT64"; break;
-        case TUNDRA__ADDRESSING_MODE_CLAT: addressing_mode_string = "CLAT"; break;
-        case TUNDRA__ADDRESSING_MODE_SIIT: addressing_mode_string = "SIIT"; break;
+        case TUNDRA__ADDRESSING_MODE_CLAT: addressing_mode_string = (file_config->addressing_clat_nat44 ? "CLAT (with NAT44)" : "CLAT"); break;
+        case TUNDRA__ADDRESSING_MODE_SIIT: addressing_mode_string = ((file_config->addressing_siit_eam_file != NULL) ? "SIIT (with EAM)" : "SIIT"); break;
         case TUNDRA__ADDRESSING_MODE_EXTERNAL: addressing_mode_string = "<external>"; break;
+        case TUNDRA__ADDRESSING_MODE_PLUGIN: addressing_mode_string = "<plugin>"; break;
+        case TUNDRA__ADDRESSING_MODE_BPF: addressing_mode_string = "<bpf>"; break;
+        case TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL: addressing_mode_string = "stateful NAT64"; break;
+        case TUNDRA__ADDRESSING_MODE_MAP_T: addressing_mode_string = "MAP-T (border relay)"; break;
         default: log__crash_invalid_internal_state("Invalid addressing mode");
     }
 
+    char instance_name_string[TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH + 16] = "";
+    if(print_instance_name)
+        snprintf(instance_name_string, sizeof(instance_name_string), "[instance '%s'] ", instance->name);
+
     switch(file_config->io_mode) {
         case TUNDRA__IO_MODE_INHERITED_FDS:
-            log__info("%zu threads are now performing %s translation on command-line-provided file descriptors...", file_config->program_translator_threads, addressing_mode_string);
+            log__info("%s%zu threads are now performing %s translation on command-line-provided file descriptors...", instance_name_string, file_config->program_translator_threads, addressing_mode_string);
             break;
 
         case TUNDRA__IO_MODE_TUN:
-            log__info("%zu threads are now performing %s translation on TUN interface '%s'...", file_config->program_translator_threads, addressing_mode_string, file_config->io_tun_interface_name);
+            log__info("%s%zu threads are now performing %s translation on TUN interface '%s'...", instance_name_string, file_config->program_translator_threads, addressing_mode_string, file_config->io_tun_interface_name);
             break;
 
         default:
@@ -236,32 +618,63 @@ static void _print_info_about_xlat_start(const tundra__conf_file *const file_con
     }
 }
 
-static void _monitor_threads(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts) {
+static void _monitor_threads(const tundra__xlat_instance *const instances, const size_t instance_count, const tundra__xlat_worker *const workers, const size_t worker_count, tundra__handover_state *const handover_state) {
     while(signals__should_this_thread_keep_running()) {
-        for(size_t i = 0; i < file_config->program_translator_threads; i++) {
-            if(pthread_tryjoin_np(thread_contexts[i].thread, NULL) != EBUSY)
+        for(size_t w = 0; w < worker_count; w++) {
+            if(pthread_tryjoin_np(workers[w].thread, NULL) != EBUSY)
                 log__crash(false, "A translator thread has terminated unexpectedly!");
         }
 
-        usleep(TUNDRA__XLAT_THREAD_MONITOR_INTERVAL_MICROSECONDS);
+        if(signals__was_reload_requested())
+            _reload_addr_xlat_plugins_and_bpf_programs(instances, instance_count);
+
+        if(signals__was_config_reload_requested()) {
+            for(size_t i = 0; i < instance_count; i++)
+                conf_reload__reload(instances[i].thread_contexts[0].conf_reload_state);
+        }
+
+        // Once the file descriptors have been handed over to another translator, this one terminates
+        if(handover_state != NULL) {
+            if(handover__wait_for_successor(handover_state, instances, instance_count, (int) (TUNDRA__XLAT_THREAD_MONITOR_INTERVAL_MICROSECONDS / 1000)))
+                break;
+        } else {
+            usleep(TUNDRA__XLAT_THREAD_MONITOR_INTERVAL_MICROSECONDS);
+        }
     }
 }
 
-static void _terminate_threads(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts) {
+static void _reload_addr_xlat_plugins_and_bpf_programs(const tundra__xlat_instance *const instances, const size_t instance_count) {
+    bool was_anything_reloaded = false;
+
+    for(size_t i = 0; i < instance_count; i++) {
+        if(instances[i].thread_contexts[0].addr_xlat_plugin != NULL) {
+            xlat_addr_plugin__reload(instances[i].thread_contexts[0].addr_xlat_plugin);
+            was_anything_reloaded = true;
+        } else if(instances[i].thread_contexts[0].bpf_addr_xlat_state != NULL) {
+            xlat_addr_bpf__reload(instances[i].file_config, instances[i].thread_contexts[0].bpf_addr_xlat_state);
+            was_anything_reloaded = true;
+        }
+    }
+
+    if(!was_anything_reloaded)
+        log__info("A reload signal was received, but there is nothing to reload in the current addressing mode.");
+}
+
+static void _terminate_threads(tundra__xlat_worker *const workers, const size_t worker_count) {
     // Even though it is extremely unlikely, threads may not terminate on first signal (due to a race condition - when
     //  the signal is delivered between signals__should_this_thread_keep_running() and a blocking system call);
     //  therefore, the termination is performed within an "infinite" loop.
     for(;;) {
         bool are_there_running_threads = false;
 
-        for(size_t i = 0; i < file_config->program_translator_threads; i++) {
-            if(thread_contexts[i].joined)
+        for(size_t w = 0; w < worker_count; w++) {
+            if(workers[w].joined)
                 continue;
 
-            switch(pthread_tryjoin_np(thread_contexts[i].thread, NULL)) {
+            switch(pthread_tryjoin_np(workers[w].thread, NULL)) {
                 case 0:
                     {
-                        thread_contexts[i].joined = true;
+                        workers[w].joined = true;
                     }
                     break;
 
@@ -273,7 +686,7 @@ static void _terminate_threads(const tundra__conf_file *const file_config, tundr
                         //  pthread_tryjoin_np() and pthread_kill()), but it is ignored, because the chance of it
                         //  occurring is extremely tiny, and there seems to be no easy and performance-friendly way
                         //  of implementing the termination process 100% atomically.
-                        if(pthread_kill(thread_contexts[i].thread, SIGNALS__XLAT_THREAD_TERM_SIGNAL) != 0)
+                        if(pthread_kill(workers[w].thread, SIGNALS__XLAT_THREAD_TERM_SIGNAL) != 0)
                             log__crash(false, "Failed to inform a translator thread that it should terminate (using a signal)!");
                     }
                     break;
@@ -30,9 +30,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 static __thread volatile sig_atomic_t _term_signal_caught_in_thread = 0;
+static volatile sig_atomic_t _reload_signal_caught = 0; // Unlike the above variable, it is shared by all threads
+static volatile sig_atomic_t _config_reload_signal_caught = 0; // Shared by all threads as well
 
 
 static void _term_signal_handler(__attribute__((unused)) int sig, siginfo_t *info, __attribute__((unused)) void *ucontext);
+static void _reload_signal_handler(__attribute__((unused)) int sig, __attribute__((unused)) siginfo_t *info, __attribute__((unused)) void *ucontext);
+static void _config_reload_signal_handler(__attribute__((unused)) int sig, __attribute__((unused)) siginfo_t *info, __attribute__((unused)) void *ucontext);
 static void _ignore_signal(const int signal_number);
 static void _set_signal_handler(const int signal_number, void (*signal_handler)(int, siginfo_t *, void *));
 static inline sigset_t _generate_empty_signal_mask(void);
@@ -51,13 +55,36 @@ void signals__initialize(void) {
     //  is configured to be handled! (as of now, the constant is an alias for 'SIGTERM')
     _set_signal_handler(SIGTERM, _term_signal_handler);
     _set_signal_handler(SIGINT, _term_signal_handler);
-    _set_signal_handler(SIGHUP, _term_signal_handler);
+
+    // 'SIGHUP' asks the translator to reload its configuration file
+    _set_signal_handler(SIGHUP, _config_reload_signal_handler);
+
+    // 'SIGUSR1' asks the translator to reload its address translation plugin (if it uses one)
+    _set_signal_handler(SIGUSR1, _reload_signal_handler);
 }
 
 bool signals__should_this_thread_keep_running(void) {
     return (bool) (!_term_signal_caught_in_thread);
 }
 
+// Returns true at most once per received reload signal; it is meant to be called from the main thread only.
+bool signals__was_reload_requested(void) {
+    if(!_reload_signal_caught)
+        return false;
+
+    _reload_signal_caught = 0;
+    return true;
+}
+
+// Returns true at most once per received configuration reload signal; it is meant to be called from the main thread only.
+bool signals__was_config_reload_requested(void) {
+    if(!_config_reload_signal_caught)
+        return false;
+
+    _config_reload_signal_caught = 0;
+    return true;
+}
+
 static void _term_signal_handler(__attribute__((unused)) int sig, siginfo_t *info, __attribute__((unused)) void *ucontext) {
     pid_t process_pid = getpid();
     pid_t this_thread_pid = (pid_t) syscall(SYS_gettid);  // The gettid() wrapper function is not available on some platforms, namely on older versions of OpenWRT
@@ -77,6 +104,15 @@ static void _term_signal_handler(__attribute__((unused)) int sig, siginfo_t *inf
     }
 }
 
+static void _reload_signal_handler(__attribute__((unused)) int sig, __attribute__((unused)) siginfo_t *info, __attribute__((unused)) void *ucontext) {
+    // The signal may be delivered to any thread, so the main thread just gets notified about it here
+    _reload_signal_caught = 1;
+}
+
+static void _config_reload_signal_handler(__attribute__((unused)) int sig, __attribute__((unused)) siginfo_t *info, __attribute__((unused)) void *ucontext) {
+    _config_reload_signal_caught = 1;
+}
+
 static void _ignore_signal(const int signal_number) {
     struct sigaction signal_action;
     UTILS__MEM_ZERO_OUT(&signal_action, sizeof(struct sigaction));
@@ -28,3 +28,5 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extern void signals__initialize(void);
 extern bool signals__should_this_thread_keep_running(void);
+extern bool signals__was_reload_requested(void);
+extern bool signals__was_config_reload_requested(void);
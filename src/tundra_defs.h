@@ -51,9 +51,44 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define TUNDRA__WORK_DIR "/"  // The program does not access the filesystem after changing the working directory!
 #define TUNDRA__MAX_XLAT_THREADS ((size_t) 256)  // Multi-queue TUN interfaces can have up to 256 queues (= file descriptors)
+#define TUNDRA__MAX_XLAT_INSTANCES ((size_t) 16)  // Including the main instance (the one configured by the '-c' command-line option)
+#define TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH ((size_t) 32)
 #define TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_SIZE ((size_t) 10000000)
+#define TUNDRA__HUGE_PAGE_SIZE ((size_t) 2097152)  // Large tables are aligned to (and sized in multiples of) this size
+#define TUNDRA__ADDRESSING_EXTERNAL_INFLIGHT_TABLE_SIZE ((size_t) 1024)
+#define TUNDRA__MAX_ADDRESSING_EXTERNAL_CACHE_GRACE_PERIOD_SECONDS ((uint64_t) 86400)
+#define TUNDRA__ADDRESSING_EXTERNAL_MAX_PENDING_REFRESHES ((size_t) 16)  // Per translator thread
+#define TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS ((size_t) 16)  // Must not be greater than 32 (a 32-bit mask of servers is used)
+#define TUNDRA__MAX_ADDRESSING_EXTERNAL_QUERY_RATE_LIMIT ((uint64_t) 1000000)  // Queries per second, and the burst size
+#define TUNDRA__ADDRESSING_EXTERNAL_QUERY_RATE_LIMIT_TABLE_SIZE ((size_t) 4096)  // Per translator thread
+#define TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_LEVELS ((size_t) 5)  // 64^5 seconds cover the maximum finite cache lifetime
+#define TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS ((size_t) 64)  // Per level; must be a power of 2
+#define TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_POOL_SIZE ((uint64_t) 65536)  // IPv4 addresses
+#define TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_SESSIONS ((uint64_t) 10000000)
+#define TUNDRA__MAX_ADDRESSING_NAT64_STATEFUL_TIMEOUT_SECONDS ((uint64_t) 604800)
+#define TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS ((size_t) 64)  // Must be a power of 2; the pool's ports are partitioned among the shards
+#define TUNDRA__ADDRESSING_NAT64_STATEFUL_MIN_POOL_PORT ((uint32_t) 1024)  // The well-known ports are never allocated
+#define TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS ((size_t) 64)  // The translated ports are partitioned among the shards
+#define TUNDRA__ADDRESSING_CLAT_NAT44_MIN_PORT ((uint32_t) 1024)  // Must be a multiple of TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS
+#define TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD ((size_t) 1008)  // (65536 - TUNDRA__ADDRESSING_CLAT_NAT44_MIN_PORT) / TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS
+#define TUNDRA__ADDRESSING_CLAT_NAT44_BUCKETS_PER_SHARD ((size_t) 1024)  // Must be a power of 2
+#define TUNDRA__ADDRESSING_CLAT_NAT44_UDP_TIMEOUT ((time_t) 300)  // The timeouts (in seconds) recommended by RFC 4787, RFC 5382 and RFC 5508
+#define TUNDRA__ADDRESSING_CLAT_NAT44_TCP_ESTABLISHED_TIMEOUT ((time_t) 7440)
+#define TUNDRA__ADDRESSING_CLAT_NAT44_TCP_TRANSITORY_TIMEOUT ((time_t) 240)
+#define TUNDRA__ADDRESSING_CLAT_NAT44_ICMP_TIMEOUT ((time_t) 60)
+#define TUNDRA__MAX_ADDRESSING_SIIT_EAM_ENTRIES ((size_t) 65536)
+#define TUNDRA__MAX_ADDRESSING_MAP_T_RULES ((size_t) 65536)
+#define TUNDRA__ADDRESSING_MAP_T_DEFAULT_PSID_OFFSET ((uint8_t) 6)  // RFC 7597, section 5.1 (excludes the ports 0-1023)
+#define TUNDRA__MAX_ADDRESSING_BPF_PROGRAM_INSTRUCTIONS ((size_t) 65536)
+#define TUNDRA__MAX_ADDRESSING_BPF_EXECUTED_INSTRUCTIONS ((uint64_t) 100000)  // Per program run; guarantees termination
+#define TUNDRA__ADDRESSING_BPF_STACK_SIZE ((size_t) 512)
+#define TUNDRA__MAX_ADDRESSING_BPF_MAPS ((size_t) 16)
+#define TUNDRA__MAX_ADDRESSING_BPF_MAP_KEY_SIZE ((uint32_t) 256)
+#define TUNDRA__MAX_ADDRESSING_BPF_MAP_VALUE_SIZE ((uint32_t) 4096)
+#define TUNDRA__MAX_ADDRESSING_BPF_MAP_ENTRIES ((uint32_t) 10000000)
 #define TUNDRA__XLAT_THREAD_MONITOR_INTERVAL_MICROSECONDS ((useconds_t) 900000)
 #define TUNDRA__XLAT_THREAD_TERM_INTERVAL_MICROSECONDS ((useconds_t) 100000)
+#define TUNDRA__HANDOVER_TIMEOUT_SECONDS ((time_t) 60)  // How long the two processes wait for each other during a handover
 
 #define TUNDRA__MAX_PACKET_SIZE ((size_t) 65535)  // (TUNDRA__MAX_PACKET_SIZE + 1) must be divisible by 64!
 #define TUNDRA__MIN_MTU_IPV4 ((size_t) 96)
@@ -65,6 +100,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define TUNDRA__MIN_TIMEOUT_MILLISECONDS ((uint64_t) 10)
 #define TUNDRA__MAX_TIMEOUT_MILLISECONDS ((uint64_t) 2000)
+#define TUNDRA__MAX_CIRCUIT_BREAKER_FAILURE_THRESHOLD ((uint64_t) 1000)
+#define TUNDRA__MAX_CIRCUIT_BREAKER_OPEN_INTERVAL_SECONDS ((uint64_t) 3600)
+#define TUNDRA__MAX_ADDRESSING_EXTERNAL_DGRAM_RETRANSMISSIONS ((uint64_t) 10)
 
 #define TUNDRA__EXIT_SUCCESS ((int) 0)
 #define TUNDRA__EXIT_CRASH ((int) 1)
@@ -38,15 +38,19 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include<errno.h>
 #include<locale.h>
 #include<time.h>
+#include<endian.h>
 #include<getopt.h>
 #include<signal.h>
 #include<pwd.h>
 #include<grp.h>
 #include<poll.h>
 #include<pthread.h>
+#include<dlfcn.h>
 #include<arpa/inet.h>
+#include<arpa/nameser.h>
 #include<netinet/in.h>
 #include<netdb.h>
+#include<resolv.h>
 #include<linux/if.h>
 #include<linux/if_tun.h>
 #include<linux/ip.h>
@@ -59,6 +63,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include<sys/types.h>
 #include<sys/file.h>
 #include<sys/time.h>
+#include<sys/stat.h>
+#include<sys/mman.h>
 #include<sys/socket.h>
 #include<sys/un.h>
 #include<sys/ioctl.h>
@@ -66,3 +72,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include<sys/sysinfo.h>
 #include<sys/random.h>
 #include<sys/syscall.h>
+#include<sys/wait.h>
+
+#include"../addr_xlat_plugin/tundra_addr_xlat_plugin.h"
@@ -43,40 +43,74 @@ typedef enum tundra__addressing_mode {
     TUNDRA__ADDRESSING_MODE_NAT64,
     TUNDRA__ADDRESSING_MODE_CLAT,
     TUNDRA__ADDRESSING_MODE_SIIT,
-    TUNDRA__ADDRESSING_MODE_EXTERNAL
+    TUNDRA__ADDRESSING_MODE_EXTERNAL,
+    TUNDRA__ADDRESSING_MODE_PLUGIN,
+    TUNDRA__ADDRESSING_MODE_BPF,
+    TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL,
+    TUNDRA__ADDRESSING_MODE_MAP_T
 } tundra__addressing_mode;
 
 typedef enum tundra__addressing_external_transport {
     TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_NONE,
     TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS,
     TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX,
-    TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP
+    TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP,
+    TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM,
+    TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP
 } tundra__addressing_external_transport;
 
 typedef struct tundra__conf_cmdline {
     char *config_file_path; // Cannot be NULL - contains either command-line-provided filepath, or TUNDRA__DEFAULT_CONFIG_FILE_PATH
     char *io_inherited_fds; // NULL if no 'io-inherited-fds' are specified via command-line options
     char *addressing_external_inherited_fds;  // NULL if no 'addressing-external-inherited-fds' are specified via command-line options
+    char *instance_names[TUNDRA__MAX_XLAT_INSTANCES]; // The first instance_count items are not NULL; the main instance is not included
+    char *instance_config_file_paths[TUNDRA__MAX_XLAT_INSTANCES]; // The first instance_count items are not NULL
+    char *instance_io_inherited_fds[TUNDRA__MAX_XLAT_INSTANCES]; // NULL if no 'instance-io-inherited-fds' are specified for the instance
+    size_t instance_count; // The count of the instances besides the main one; at most TUNDRA__MAX_XLAT_INSTANCES - 1
+    char *handover_socket_path; // NULL if no 'handover-socket' is specified via command-line options
+    bool handover_external_cache; // Whether the external address translation caches should be taken over as well
     tundra__operation_mode mode_of_operation;
 } tundra__conf_cmdline;
 
 typedef struct tundra__conf_file {
     // The items are ordered in a way to reduce struct padding as much as possible, which is the reason why they seem to be in a "somewhat random order".
-    struct sockaddr_un addressing_external_unix_socket_info;
+    struct sockaddr_un addressing_external_unix_socket_info[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS]; // The first addressing_external_server_count items are used if addressing_mode == EXTERNAL && addressing_external_transport is UNIX or UNIX_DGRAM
     uint8_t addressing_nat64_clat_siit_prefix[16];
     uint8_t addressing_nat64_clat_ipv6[16];
     uint8_t router_ipv6[16];
     struct timeval addressing_external_unix_tcp_timeout;
+    time_t addressing_external_unix_tcp_circuit_breaker_open_interval; // In seconds; 0 if the circuit breaker is disabled
+    time_t addressing_external_cache_grace_period; // In seconds; 0 if expired cache entries should not be used at all
+    time_t addressing_nat64_stateful_udp_timeout; // In seconds; 0 if addressing_mode != NAT64_STATEFUL
+    time_t addressing_nat64_stateful_tcp_established_timeout; // In seconds; 0 if addressing_mode != NAT64_STATEFUL
+    time_t addressing_nat64_stateful_tcp_transitory_timeout; // In seconds; 0 if addressing_mode != NAT64_STATEFUL
+    time_t addressing_nat64_stateful_icmp_timeout; // In seconds; 0 if addressing_mode != NAT64_STATEFUL
     char *io_tun_device_path; // NULL if io_mode != TUN; Cannot be empty - contains either the config-file-provided TUN device path, or TUNDRA__DEFAULT_TUN_DEVICE_PATH
     char *io_tun_interface_name; // NULL if io_mode != TUN; Cannot be empty
-    struct addrinfo *addressing_external_tcp_socket_info; // Not NULL if addressing_mode == EXTERNAL && addressing_external_transport == TCP
+    char *addressing_external_cache_file; // NULL if addressing_mode != EXTERNAL or if the cache should not be persisted
+    char *addressing_external_cache_preload_file; // NULL if addressing_mode != EXTERNAL or if no cache should be preloaded
+    char *addressing_plugin_path; // NULL if addressing_mode != PLUGIN
+    char *addressing_plugin_argument; // NULL if addressing_mode != PLUGIN; may be empty
+    char *addressing_bpf_program_file; // NULL if addressing_mode != BPF
+    char *addressing_map_t_rules_file; // NULL if addressing_mode != MAP_T
+    char *addressing_siit_eam_file; // NULL if addressing_mode != SIIT or if no explicit address mappings are used
+    char *addressing_nat64_clat_siit_rfc7050_cache_file; // NULL if addressing_nat64_clat_siit_rfc7050_rediscovery == false or if the auto-discovered prefix should not be cached
+    char *addressing_bpf_map_files[TUNDRA__MAX_ADDRESSING_BPF_MAPS]; // The first addressing_bpf_map_count items are not NULL if addressing_mode == BPF; the rest are NULL
+    struct addrinfo *addressing_external_tcp_socket_info[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS]; // The first addressing_external_server_count items are not NULL if addressing_mode == EXTERNAL && addressing_external_transport is TCP or UDP; the rest are NULL
+    uint32_t addressing_external_server_hash_seeds[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS]; // Derived from the servers' configured paths/hosts, so that they do not depend on the servers' order
+    size_t addressing_external_server_count; // Between 1 and TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS (including) if addressing_mode == EXTERNAL (1 for the 'inherited-fds' transport); 0 otherwise
+    size_t addressing_bpf_map_count; // Between 0 and TUNDRA__MAX_ADDRESSING_BPF_MAPS (including); 0 if addressing_mode != BPF
     size_t program_translator_threads; // Between 1 and TUNDRA__MAX_XLAT_THREADS (including)
     size_t addressing_external_cache_size_main_addresses;
     size_t addressing_external_cache_size_icmp_error_addresses;
+    size_t addressing_external_cache_size_prefix_mappings;
+    size_t addressing_nat64_stateful_max_sessions; // 0 if addressing_mode != NAT64_STATEFUL
     size_t translator_ipv4_outbound_mtu;
     size_t translator_ipv6_outbound_mtu;
     uint8_t addressing_nat64_clat_ipv4[4];
     uint8_t router_ipv4[4];
+    uint8_t addressing_nat64_stateful_pool_ipv4[4]; // The first address of the pool; zeroed out if addressing_mode != NAT64_STATEFUL
+    uint32_t addressing_nat64_stateful_pool_size; // The pool is a range of consecutive IPv4 addresses; 0 if addressing_mode != NAT64_STATEFUL
     uid_t program_privilege_drop_user_uid; // Must not be accessed if program_privilege_drop_user_perform == false
     uid_t io_tun_owner_user_uid; // Must not be accessed if io_mode != TUN or if io_tun_owner_user_set == false
     gid_t program_privilege_drop_group_gid; // Must not be accessed if program_privilege_drop_group_perform == false
@@ -85,14 +119,28 @@ typedef struct tundra__conf_file {
     tundra__addressing_mode addressing_mode;
     tundra__addressing_external_transport addressing_external_transport;
     uint8_t router_generated_packet_ttl;
+    uint32_t addressing_external_unix_tcp_circuit_breaker_failure_threshold; // 0 if the circuit breaker is disabled (or if the transport is 'inherited-fds')
+    uint32_t addressing_external_dgram_retransmissions; // 0 if the transport is neither 'unix-dgram' nor 'udp'
+    uint32_t addressing_external_query_rate_limit_per_second; // 0 if the queries are not rate-limited
+    uint32_t addressing_external_query_rate_limit_burst; // 0 if the queries are not rate-limited
+    uint8_t addressing_external_query_rate_limit_ipv4_prefix_length; // 0 if the queries are not rate-limited (or if the whole IPv4 address space shares a single bucket)
+    uint8_t addressing_external_query_rate_limit_ipv6_prefix_length; // 0 if the queries are not rate-limited (or if the whole IPv6 address space shares a single bucket)
+    uint8_t addressing_external_protocol_version; // 1 or 2; 0 if addressing_mode != EXTERNAL
+    uint8_t addressing_nat64_clat_siit_prefix_length; // 32, 40, 48, 56, 64 or 96 (RFC 6052); 0 if the addressing mode does not use the prefix
     bool program_privilege_drop_user_perform;
     bool program_privilege_drop_group_perform;
     bool io_tun_owner_user_set; // Must not be accessed if io_mode != TUN
     bool io_tun_owner_group_set; // Must not be accessed if io_mode != TUN
     bool io_tun_multi_queue; // Must not be accessed if io_mode != TUN
     bool addressing_nat64_clat_siit_allow_translation_of_private_ips;
+    bool addressing_nat64_clat_siit_prefix_autodiscovered; // false if the addressing mode does not use the prefix
+    bool addressing_nat64_clat_siit_rfc7050_rediscovery; // false if the prefix is not auto-discovered
+    bool addressing_clat_nat44; // false if addressing_mode != CLAT
     bool translator_6to4_copy_dscp_and_ecn;
     bool translator_4to6_copy_dscp_and_ecn;
+    bool translator_hairpinning;
+    bool addressing_external_unix_tcp_circuit_breaker_icmp; // false if the circuit breaker is disabled
+    bool addressing_external_query_rate_limit_icmp; // false if the queries are not rate-limited
 } tundra__conf_file;
 
 
@@ -101,21 +149,161 @@ typedef struct tundra__conf_file {
 // External address translation
 // ---------------------------------------------------------------------------------------------------------------------
 
+typedef enum tundra__external_addr_xlat_result {
+    TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE, // Cache miss, or a protocol/transmission error occurred
+    TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS,
+    TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR,
+    TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP
+} tundra__external_addr_xlat_result;
+
+// 48 bytes, as the caches may have millions of entries. Both the address pairs are needed in either direction - one of
+//  them is the key, the other one is the translation result -, so a layout specific to each direction would not be any
+//  smaller. The 6to4 caches could only be shrunk (to 32 bytes) by replacing the IPv6 key with a 16-byte hash of it, but
+//  then a lookup would no longer be an exact match - a colliding flow (possibly crafted by an IPv6 host) would get
+//  another flow's IPv4 addresses -, and the entries could no longer be saved to the cache file (or handed over).
 typedef struct tundra__external_addr_xlat_cache_entry {
     uint8_t src_ipv6[16];
     uint8_t dst_ipv6[16];
-    time_t expiration_timestamp;
     uint8_t src_ipv4[4];
     uint8_t dst_ipv4[4];
+    uint32_t expiration_timestamp; // A coarse monotonic timestamp (see utils__get_coarse_monotonic_timestamp()); 0 = unused
+    uint8_t flags; // XLAT_ADDR_EXTERNAL_CACHE__FLAG_*
 } tundra__external_addr_xlat_cache_entry;
 
+// A hierarchical timer wheel which schedules the eviction of cache entries, so that expired entries are cleared
+//  incrementally instead of sitting in their slots until they are overwritten. The slots of level 0 are 1 second wide,
+//  those of level 1 are 64 seconds wide etc.; each slot is a doubly-linked list of the indices of cache entries. The
+//  wheel adds 14 bytes per cache entry.
+typedef struct tundra__external_addr_xlat_timer_wheel {
+    uint32_t *next_entry_indices; // Indexed by cache entry indices; XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY terminates the lists
+    uint32_t *previous_entry_indices;
+    uint16_t *entry_slots; // (level * TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS + slot + 1), or XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_SLOT if the entry is not scheduled
+    uint32_t *eviction_timestamps; // Coarse monotonic timestamps (which fit into 32 bits); must not be accessed if the entry is not scheduled
+    size_t entry_count;
+    time_t current_tick; // Entries in the level 0 slot of this tick are due; all the preceding ticks have been processed
+    uint32_t slot_heads[TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_LEVELS * TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS];
+} tundra__external_addr_xlat_timer_wheel;
+
+// Prefix mappings are stored as pairs of prefixes; the inbound and outbound prefixes always have the same number of host
+//  bits (at most 32), which occupy the last 4 bytes of IPv6 addresses and the whole IPv4 addresses
+typedef struct tundra__external_addr_xlat_prefix_cache_entry {
+    uint8_t in_src_prefix[16]; // IPv4 prefixes occupy the first 4 bytes, the rest is zeroed out
+    uint8_t in_dst_prefix[16];
+    uint8_t out_src_prefix[16];
+    uint8_t out_dst_prefix[16];
+    time_t expiration_timestamp;
+    uint8_t src_host_bits; // Between 0 and 32 (including)
+    uint8_t dst_host_bits;
+    uint8_t flags; // XLAT_ADDR_EXTERNAL_CACHE__FLAG_*
+} tundra__external_addr_xlat_prefix_cache_entry;
+
+// A "tuple space" of direct-mapped hash tables - one (virtual) table per pair of source & destination host bit counts
+//  ("tuple"); lookups probe the tuples which have any entries, from the most specific to the least specific one
+typedef struct tundra__external_addr_xlat_prefix_cache {
+    tundra__external_addr_xlat_prefix_cache_entry *entries;
+    size_t entry_count;
+    size_t active_tuple_count;
+    uint32_t tuple_entry_counts[33 * 33]; // Indexed by (src_host_bits * 33 + dst_host_bits)
+    tundra__external_addr_xlat_timer_wheel *timer_wheel;
+    uint16_t active_tuples[33 * 33]; // Sorted from the most specific tuple
+} tundra__external_addr_xlat_prefix_cache;
+
+// Parameters of a response which are needed to cache it
+typedef struct tundra__external_addr_xlat_response_params {
+    uint32_t cache_lifetime; // As received, i.e. XLAT_ADDR_EXTERNAL_CACHE__WIRE_INDEFINITE_LIFETIME means "indefinite"
+    uint8_t src_prefix_length; // Inbound prefix lengths; must not be accessed if is_prefix_mapping == false
+    uint8_t dst_prefix_length;
+    bool is_prefix_mapping; // Protocol version 2 only
+    bool is_bidirectional; // Protocol version 2 only; the reverse mapping should be cached as well
+} tundra__external_addr_xlat_response_params;
+
+typedef struct tundra__external_addr_xlat_inflight_slot {
+    uint8_t in_src_ip[16]; // IPv4 addresses occupy the first 4 bytes, the rest is zeroed out
+    uint8_t in_dst_ip[16];
+    uint8_t out_src_ip[16];
+    uint8_t out_dst_ip[16];
+    size_t waiter_count;
+    tundra__external_addr_xlat_response_params response_params;
+    tundra__external_addr_xlat_result result;
+    uint8_t message_type;
+    uint8_t state; // XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_*
+} tundra__external_addr_xlat_inflight_slot;
+
+// Shared by all translator threads
+typedef struct tundra__external_addr_xlat_inflight_table {
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    tundra__external_addr_xlat_inflight_slot *slots;
+    size_t slot_count;
+} tundra__external_addr_xlat_inflight_table;
+
+typedef struct tundra__external_addr_xlat_server_state {
+    int read_fd;
+    int write_fd;
+    bool has_recv_timed_out; // Datagram transports only; whether the last attempt to receive a message has timed out
+} tundra__external_addr_xlat_server_state;
+
+// A query which has been sent to refresh a stale cache entry, and whose response has not been received yet
+typedef struct tundra__external_addr_xlat_pending_refresh {
+    uint8_t in_src_ip[16]; // IPv4 addresses occupy the first 4 bytes, the rest is zeroed out
+    uint8_t in_dst_ip[16];
+    size_t server_index;
+    uint32_t message_identifier; // In network byte order
+    uint8_t message_type;
+    bool is_in_use;
+} tundra__external_addr_xlat_pending_refresh;
+
+typedef struct tundra__external_addr_xlat_circuit_breaker_server {
+    time_t open_until_timestamp; // Must not be accessed if is_open == false
+    uint32_t consecutive_failures;
+    uint32_t failed_probe_count; // The open interval doubles with each failed probe
+    bool is_open;
+    bool is_probe_in_progress;
+} tundra__external_addr_xlat_circuit_breaker_server;
+
+typedef struct tundra__external_addr_xlat_rate_limiter_bucket {
+    uint8_t src_prefix[16]; // IPv4 prefixes occupy the first 4 bytes
+    time_t last_refill_timestamp;
+    uint32_t token_count;
+    bool is_ipv6;
+    bool is_in_use;
+} tundra__external_addr_xlat_rate_limiter_bucket;
+
+// Each translator thread has its own token buckets, so that the rate limiting does not need any locking; the buckets
+//  form a direct-mapped hash table, i.e. a source prefix whose bucket is taken over by another one starts afresh
+typedef struct tundra__external_addr_xlat_rate_limiter {
+    tundra__external_addr_xlat_rate_limiter_bucket buckets[TUNDRA__ADDRESSING_EXTERNAL_QUERY_RATE_LIMIT_TABLE_SIZE];
+} tundra__external_addr_xlat_rate_limiter;
+
+// Shared by all translator threads
+typedef struct tundra__external_addr_xlat_circuit_breaker {
+    pthread_mutex_t mutex;
+    tundra__external_addr_xlat_circuit_breaker_server servers[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS];
+} tundra__external_addr_xlat_circuit_breaker;
+
 typedef struct tundra__external_addr_xlat_state {
+    tundra__external_addr_xlat_inflight_table *inflight_table; // NULL if there is only one translator thread
+    tundra__external_addr_xlat_circuit_breaker *circuit_breaker; // NULL if the circuit breaker is disabled
+    tundra__external_addr_xlat_rate_limiter *rate_limiter; // NULL if the queries are not rate-limited
     tundra__external_addr_xlat_cache_entry *cache_4to6_main_packet;
     tundra__external_addr_xlat_cache_entry *cache_4to6_icmp_error_packet;
     tundra__external_addr_xlat_cache_entry *cache_6to4_main_packet;
     tundra__external_addr_xlat_cache_entry *cache_6to4_icmp_error_packet;
-    int read_fd;
-    int write_fd;
+    tundra__external_addr_xlat_prefix_cache *prefix_cache_4to6_main_packet; // NULL if prefix mappings are not cached
+    tundra__external_addr_xlat_prefix_cache *prefix_cache_4to6_icmp_error_packet;
+    tundra__external_addr_xlat_prefix_cache *prefix_cache_6to4_main_packet;
+    tundra__external_addr_xlat_prefix_cache *prefix_cache_6to4_icmp_error_packet;
+    tundra__external_addr_xlat_timer_wheel *timer_wheel_4to6_main_packet; // NULL if the corresponding cache is disabled
+    tundra__external_addr_xlat_timer_wheel *timer_wheel_4to6_icmp_error_packet;
+    tundra__external_addr_xlat_timer_wheel *timer_wheel_6to4_main_packet;
+    tundra__external_addr_xlat_timer_wheel *timer_wheel_6to4_icmp_error_packet;
+    time_t last_push_check_timestamp; // Protocol version 2 only
+    time_t last_eviction_timestamp;
+    bool are_evictions_pending; // Whether the last eviction pass has been cut short, leaving due entries behind
+    tundra__external_addr_xlat_server_state servers[TUNDRA__MAX_ADDRESSING_EXTERNAL_SERVERS]; // The first 'addressing_external_server_count' (see tundra__conf_file) items are used
+    size_t current_server_index; // The server which is being communicated with
+    tundra__external_addr_xlat_pending_refresh pending_refreshes[TUNDRA__ADDRESSING_EXTERNAL_MAX_PENDING_REFRESHES];
+    size_t pending_refresh_count; // The number of items in 'pending_refreshes' whose 'is_in_use' is true
     uint32_t message_identifier;
 } tundra__external_addr_xlat_state;
 
@@ -129,28 +317,467 @@ typedef struct __attribute__((__packed__)) tundra__external_addr_xlat_message {
     uint8_t dst_ip[16];
 } tundra__external_addr_xlat_message;  // SIZE: 40 bytes
 
+typedef struct __attribute__((__packed__)) tundra__external_addr_xlat_message_v2 {
+    uint8_t magic_byte;
+    uint8_t version;
+    uint8_t message_type;
+    uint8_t flags;
+    uint32_t message_identifier;
+    uint32_t cache_lifetime;
+    uint8_t src_prefix_length;
+    uint8_t dst_prefix_length;
+    uint8_t reserved[2];
+    uint8_t in_src_ip[16];
+    uint8_t in_dst_ip[16];
+    uint8_t out_src_ip[16];
+    uint8_t out_dst_ip[16];
+} tundra__external_addr_xlat_message_v2;  // SIZE: 80 bytes
+
+// All the multi-byte integers in the cache file are stored in network byte order
+typedef struct __attribute__((__packed__)) tundra__external_addr_xlat_cache_file_header {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t reserved1[3];
+    uint64_t creation_timestamp; // UNIX time; '0' means that the lifetimes of entries are relative to the time of loading
+    uint32_t entry_count;
+    uint8_t reserved2[4];
+} tundra__external_addr_xlat_cache_file_header;  // SIZE: 24 bytes
+
+typedef struct __attribute__((__packed__)) tundra__external_addr_xlat_cache_file_entry {
+    uint8_t message_type; // The same values as in tundra__external_addr_xlat_message are used
+    uint8_t flags; // XLAT_ADDR_EXTERNAL_CACHE__FLAG_*, or'ed with 0x04 if the entry is a prefix mapping
+    uint8_t src_prefix_length; // Inbound prefix lengths; must be zero unless the entry is a prefix mapping
+    uint8_t dst_prefix_length;
+    uint32_t remaining_lifetime; // In seconds
+    uint8_t src_ipv4[4];
+    uint8_t dst_ipv4[4];
+    uint8_t src_ipv6[16];
+    uint8_t dst_ipv6[16];
+} tundra__external_addr_xlat_cache_file_entry;  // SIZE: 48 bytes
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Stateful NAT64
+// ---------------------------------------------------------------------------------------------------------------------
+
+// A mapping between an IPv6 transport address and an IPv4 transport address of the pool (RFC 6146's BIB entry); since
+//  the mappings are endpoint-independent, they are not bound to any remote host
+typedef struct tundra__nat64_stateful_binding {
+    uint8_t ipv6[16];
+    uint8_t ipv4[4];
+    uint16_t ipv6_port; // In network byte order; the TCP/UDP port or ICMP Echo identifier
+    uint16_t ipv4_port; // In network byte order
+    uint8_t protocol; // 1 (ICMP), 6 (TCP) or 17 (UDP), i.e. the IPv4 protocol numbers
+} tundra__nat64_stateful_binding;
+
+typedef struct tundra__nat64_stateful_session {
+    tundra__nat64_stateful_binding binding;
+    time_t expiration_timestamp; // A coarse monotonic timestamp (see utils__get_coarse_monotonic_timestamp())
+    uint32_t next_ipv6_side_index; // The next session in the IPv6-side hash chain (or in the list of free sessions)
+    uint32_t next_ipv4_side_index; // The next session in the IPv4-side hash chain
+    uint8_t tcp_state; // XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_*; must not be accessed if the session is not a TCP one
+    bool is_in_use;
+} tundra__nat64_stateful_session;
+
+// Each shard owns the pool ports which are congruent to its index modulo TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS,
+//  so the shard of an IPv4-side packet is determined by its port, and that of an IPv6-side packet by a hash of its
+//  transport address; this way, any translator thread can translate any packet, while contending only for the
+//  packet's shard
+typedef struct __attribute__((aligned(64))) tundra__nat64_stateful_shard {
+    pthread_mutex_t mutex;
+    tundra__nat64_stateful_session *sessions;
+    uint32_t *ipv6_side_buckets; // Hash chain heads; XLAT_ADDR_NAT64_STATEFUL__NO_SESSION terminates the chains
+    uint32_t *ipv4_side_buckets;
+    tundra__external_addr_xlat_timer_wheel *timer_wheel; // Schedules the sessions' expiration checks
+    size_t session_count; // Including the reserved session (see XLAT_ADDR_NAT64_STATEFUL__NO_SESSION)
+    size_t bucket_count; // A power of 2
+    size_t unused_session_index; // The sessions from this index onwards have never been used
+    uint32_t free_session_index; // The head of the list of free sessions; XLAT_ADDR_NAT64_STATEFUL__NO_SESSION if there are none
+} tundra__nat64_stateful_shard;
+
+// Shared by all translator threads
+typedef struct tundra__nat64_stateful_state {
+    tundra__nat64_stateful_shard shards[TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS];
+} tundra__nat64_stateful_state;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NAT44 of the 'clat' addressing mode
+// ---------------------------------------------------------------------------------------------------------------------
+
+// Since there is only one outside address, a session is identified by its protocol and translated port alone, and
+//  is therefore stored at a position derived from them - packets from the IPv6 side are matched with their session
+//  using a single array access, whereas those from the IPv4 side need a lookup in a hash table
+typedef struct tundra__clat_nat44_session {
+    uint8_t host_ipv4[4]; // The address of the IPv4 host the session belongs to
+    uint32_t next_index; // The next session in the IPv4-side hash chain
+    uint32_t expiration_timestamp; // A coarse monotonic timestamp (see utils__get_coarse_monotonic_timestamp())
+    uint16_t host_port; // In network byte order; the IPv4 host's TCP/UDP port or ICMP Echo identifier
+    uint8_t tcp_state; // XLAT_ADDR_CLAT_NAT44__TCP_STATE_*; must not be accessed if the session is not a TCP one
+    bool is_in_use;
+} tundra__clat_nat44_session;  // SIZE: 16 bytes
+
+// Each shard owns the translated ports which are congruent to its index modulo TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS
+//  (like in the case of tundra__nat64_stateful_shard)
+typedef struct __attribute__((aligned(64))) tundra__clat_nat44_shard {
+    pthread_mutex_t mutex;
+    tundra__external_addr_xlat_timer_wheel *timer_wheel; // Schedules the sessions' expiration checks
+    uint32_t buckets[TUNDRA__ADDRESSING_CLAT_NAT44_BUCKETS_PER_SHARD]; // IPv4-side hash chain heads; XLAT_ADDR_CLAT_NAT44__NO_SESSION terminates the chains
+    tundra__clat_nat44_session sessions[3 * TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD]; // Indexed by the protocol (ICMP, TCP, UDP) and the translated port
+} tundra__clat_nat44_shard;
+
+// Shared by all translator threads
+typedef struct tundra__clat_nat44_state {
+    tundra__clat_nat44_shard shards[TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS];
+} tundra__clat_nat44_state;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Longest-prefix-match tables
+// ---------------------------------------------------------------------------------------------------------------------
+
+// A prefix waiting for utils_lpm__build() - the table is built from all its prefixes at once
+typedef struct tundra__lpm_prefix {
+    uint8_t prefix[16]; // The bits following the prefix length are zero
+    uint32_t value;
+    uint32_t insertion_order; // If the same prefix is inserted more than once, the last value wins
+    uint8_t prefix_length;
+} tundra__lpm_prefix;
+
+// Only needed for nodes which skip some bytes of the key (i.e. whose stride does not start right after their parent's)
+typedef struct tundra__lpm_node {
+    uint8_t path[16]; // The bytes of the key preceding the node's stride which all the node's prefixes share
+    uint32_t fallback_entry; // The parent entry's value - used if the key's skipped bytes differ from 'path'
+    uint8_t path_start; // The index of the first skipped byte, i.e. the one following the parent node's stride
+} tundra__lpm_node;
+
+// A multibit trie whose nodes are stored in a single array: the root node is indexed by the key's first
+//  'first_stride_bits' bits, and every other node by the next 8 or 16 bits of the key. Runs of bytes in which the prefixes
+//  below a node do not diverge are skipped (path compression), so a lookup needs one memory access per byte at which
+//  the prefixes diverge rather than per byte of their length. Prefixes are "pushed" to the nodes' leaves, so a lookup
+//  never has to backtrack.
+typedef struct tundra__lpm_table {
+    uint32_t *entries; // Each entry is either empty (0), a value (value + 1), or a child node reference (see utils_lpm.c)
+    tundra__lpm_node *nodes; // Indexed by node indices (the root node's one is unused, and so are the last 255 of each 16-bit node)
+    uint8_t *entry_prefix_lengths; // The length of the prefix each entry's value belongs to; only needed while building
+    size_t entry_count; // The root node's 2^first_stride_bits entries, followed by 256 or 65536 entries per each other node
+    tundra__lpm_prefix *prefixes; // Only used before the table is built
+    size_t prefix_count;
+    size_t key_size; // In bytes; 4 (IPv4 addresses) or 16 (IPv6 addresses)
+    size_t first_stride_bits; // 8 or 16
+    bool is_built;
+} tundra__lpm_table;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Explicit address mappings of the 'siit' addressing mode
+// ---------------------------------------------------------------------------------------------------------------------
+
+// An explicit address mapping (RFC 7757) - the IPv6 prefix is (96 + ipv4_prefix_length) bits long, so that both the
+//  prefixes' suffixes have the same length and the addresses within them can be mapped to each other one-to-one
+typedef struct tundra__siit_eam_entry {
+    uint8_t ipv6_prefix[16]; // The bits following the prefix length are zero
+    uint8_t ipv4_prefix[4]; // The bits following the prefix length are zero
+    uint8_t ipv4_prefix_length; // Between 0 and 32 (including)
+} tundra__siit_eam_entry;
+
+// Loaded from the EAM file before the translator threads are started; read-only afterwards (and therefore shared by
+//  all translator threads without any locking)
+typedef struct tundra__siit_eam_state {
+    tundra__siit_eam_entry *entries;
+    size_t entry_count;
+    tundra__lpm_table *ipv4_entry_table; // The entries' IPv4 prefixes -> the entries' indices
+    tundra__lpm_table *ipv6_entry_table; // The entries' IPv6 prefixes -> the entries' indices
+} tundra__siit_eam_state;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The 'map-t' addressing mode
+// ---------------------------------------------------------------------------------------------------------------------
+
+// A MAP rule (RFC 7597, section 5); the embedded address (EA) bits of a CE's IPv6 prefix consist of the suffix of
+//  the CE's IPv4 address (following the rule's IPv4 prefix) and of the CE's port-set identifier (PSID)
+typedef struct tundra__map_t_rule {
+    uint8_t ipv6_prefix[16]; // The bits following the prefix length are zero
+    uint8_t ipv4_prefix[4]; // The bits following the prefix length are zero
+    uint8_t ipv6_prefix_length; // Between 0 and 64 (including)
+    uint8_t ipv4_prefix_length; // Between 0 and 32 (including)
+    uint8_t ea_bits_length; // Between (32 - ipv4_prefix_length) and (64 - ipv6_prefix_length) (including)
+    uint8_t psid_offset; // The 'a' bits; (psid_offset + psid_length) is at most 16
+    uint8_t psid_length; // The 'k' bits; (ea_bits_length - (32 - ipv4_prefix_length)), at most 16
+} tundra__map_t_rule;
+
+// Loaded from the rules file before the translator threads are started; read-only afterwards (and therefore shared by
+//  all translator threads without any locking)
+typedef struct tundra__map_t_state {
+    tundra__map_t_rule *rules;
+    size_t rule_count;
+    tundra__lpm_table *ipv4_rule_table; // The rules' IPv4 prefixes -> the rules' indices
+    tundra__lpm_table *ipv6_rule_table; // The rules' IPv6 prefixes -> the rules' indices
+} tundra__map_t_state;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Address translation plugins
+// ---------------------------------------------------------------------------------------------------------------------
+
+// Shared by all translator threads
+typedef struct tundra__addr_xlat_plugin {
+    void *library_handle; // Returned by dlopen()
+    const tundra_addr_xlat_plugin *definition; // Points into the plugin's memory
+    void *plugin_data; // Returned by the plugin's 'init' hook
+} tundra__addr_xlat_plugin;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// eBPF address translation programs
+// ---------------------------------------------------------------------------------------------------------------------
+
+// The instructions are stored in the host's byte order (they are converted from little-endian when they are loaded)
+typedef struct tundra__bpf_instruction {
+    uint8_t opcode;
+    uint8_t registers; // The destination register is stored in the lower 4 bits, the source register in the upper 4 bits
+    int16_t offset;
+    int32_t immediate;
+} tundra__bpf_instruction;  // SIZE: 8 bytes
+
+typedef struct tundra__bpf_addr_xlat_map {
+    uint8_t *entries; // 'entry_count' pairs of a key and a value, sorted by the keys
+    size_t entry_count;
+    size_t key_size;
+    size_t value_size;
+} tundra__bpf_addr_xlat_map;
+
+// A program together with its maps; it is immutable once it is loaded, and it is replaced as a whole when the program
+//  is reloaded
+typedef struct tundra__bpf_addr_xlat_image {
+    tundra__bpf_instruction *instructions;
+    size_t instruction_count;
+    tundra__bpf_addr_xlat_map maps[TUNDRA__MAX_ADDRESSING_BPF_MAPS];
+    size_t map_count;
+    size_t reference_count; // Protected by the mutex of tundra__bpf_addr_xlat_state
+} tundra__bpf_addr_xlat_image;
+
+// Shared by all translator threads
+typedef struct tundra__bpf_addr_xlat_state {
+    pthread_mutex_t mutex;
+    tundra__bpf_addr_xlat_image *current_image; // Protected by 'mutex'
+    uint32_t generation; // Incremented each time 'current_image' is replaced; it may be read without locking 'mutex', but only atomically
+} tundra__bpf_addr_xlat_state;
+
+// The context which is passed to programs in the R1 register; it is a part of the program ABI, so it must not be
+//  changed in incompatible ways!
+typedef struct tundra__bpf_addr_xlat_program_ctx {
+    uint8_t in_src_ip[16]; // IPv4 addresses occupy the first 4 bytes, the rest is zeroed out
+    uint8_t in_dst_ip[16];
+    uint8_t out_src_ip[16]; // Zeroed out before the program is run
+    uint8_t out_dst_ip[16];
+    uint32_t message_type; // XLAT_ADDR_BPF__MESSAGE_TYPE_*
+    uint32_t thread_id;
+} tundra__bpf_addr_xlat_program_ctx;  // SIZE: 72 bytes
+
+// All the multi-byte integers in the map file header are stored in network byte order
+typedef struct __attribute__((__packed__)) tundra__bpf_addr_xlat_map_file_header {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t entry_count;
+} tundra__bpf_addr_xlat_map_file_header;  // SIZE: 16 bytes
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Configuration reloading
+// ---------------------------------------------------------------------------------------------------------------------
+
+// A configuration which has been published to the translator threads, together with the data loaded according to it;
+//  it is immutable once it is published, and it is replaced as a whole when the configuration file is reloaded
+typedef struct tundra__conf_file_version {
+    const tundra__conf_file *config;
+    tundra__conf_file *owned_config; // Freed along with the version; NULL for the initial version, whose configuration is owned by init.c
+    tundra__siit_eam_state *siit_eam_state; // NULL if config->addressing_mode != SIIT or if no explicit address mappings are used
+    struct tundra__conf_file_version *base_version; // If not NULL, 'owned_config' is a shallow copy of the base version's configuration (with a different translation prefix), and the data it points to (as well as 'siit_eam_state') belong to the base version, which is kept alive by this version holding a reference to it
+    size_t reference_count; // Protected by the mutex of tundra__conf_reload_state
+} tundra__conf_file_version;
+
+// Shared by all translator threads
+typedef struct tundra__conf_reload_state {
+    pthread_mutex_t mutex;
+    tundra__conf_file_version *current_version; // Protected by 'mutex'
+    char *config_file_path; // An absolute path, so that it is valid after the working directory is changed; NULL if the configuration cannot be reloaded (it has been read from the standard input)
+    uint32_t generation; // Incremented each time 'current_version' is replaced; it may be read without locking 'mutex', but only atomically
+} tundra__conf_reload_state;
+
+// Used by the background thread which periodically re-runs the RFC 7050 translation prefix discovery
+typedef struct tundra__rfc7050_rediscovery_state {
+    pthread_t thread;
+    tundra__conf_reload_state *conf_reload_state;
+    int cache_file_fd; // -1 if the auto-discovered prefix should not be cached
+} tundra__rfc7050_rediscovery_state;
+
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // Thread context
 // ---------------------------------------------------------------------------------------------------------------------
 
+// An IPv4 packet which has been translated from IPv6, but whose destination is represented by the translator itself -
+//  instead of being sent out (and routed back by the kernel), it is translated back to IPv6 right away (see xlat.c)
+typedef struct tundra__hairpin_packet {
+    uint8_t *buffer; // Always 64-byte aligned
+    size_t size; // 0 if there is no packet to be hairpinned
+} tundra__hairpin_packet;
+
 typedef struct tundra__thread_ctx {
     uint8_t *in_packet_buffer; // Always 64-byte aligned; not modified during the translation process.
-    const tundra__conf_file *config;
+    const tundra__conf_file *config; // Points into 'conf_file_version'
+    tundra__conf_reload_state *conf_reload_state;
+    tundra__conf_file_version *conf_file_version; // The version the thread is using (it holds a reference to it)
     tundra__external_addr_xlat_state *external_addr_xlat_state;
+    tundra__addr_xlat_plugin *addr_xlat_plugin; // NULL if addressing_mode != PLUGIN
+    void *addr_xlat_plugin_thread_data; // Returned by the plugin's 'thread_init' hook; NULL if addressing_mode != PLUGIN
+    tundra__bpf_addr_xlat_state *bpf_addr_xlat_state; // NULL if addressing_mode != BPF
+    tundra__bpf_addr_xlat_image *bpf_addr_xlat_image; // The image the thread is using (it holds a reference to it); NULL if addressing_mode != BPF
+    tundra__nat64_stateful_state *nat64_stateful_state; // NULL if addressing_mode != NAT64_STATEFUL
+    tundra__clat_nat44_state *clat_nat44_state; // NULL if addressing_mode != CLAT or if its NAT44 is disabled
+    tundra__map_t_state *map_t_state; // NULL if addressing_mode != MAP_T
+    tundra__siit_eam_state *siit_eam_state; // NULL if addressing_mode != SIIT or if no explicit address mappings are used; points into 'conf_file_version'
+    tundra__hairpin_packet *hairpin_packet; // NULL if translator_hairpinning == false
+    const uint8_t *in_transport_payload_ptr; // The transport-layer header & data of the packet being translated; set before its main addresses are translated; NULL if the packet is fragmented. Points to a part of 'in_packet_buffer'.
+    size_t in_transport_payload_size;
     size_t in_packet_size; // Not modified during the translation process.
     size_t thread_id;
-    pthread_t thread;
+    time_t current_timestamp; // A coarse monotonic clock (in seconds), updated once per received packet; 0 if unavailable
     int packet_read_fd;
     int packet_write_fd;
     uint32_t frag_id_ipv6;
+    uint32_t bpf_addr_xlat_image_generation; // The generation of 'bpf_addr_xlat_image'
+    uint32_t conf_file_version_generation; // The generation of 'conf_file_version'
     uint16_t frag_id_ipv4;
-    bool joined;
+    uint16_t out_transport_port; // In network byte order; must not be accessed if is_out_transport_port_set == false
+    uint8_t in_transport_protocol; // The IPv4 protocol number (i.e. 1 for both ICMPv4 and ICMPv6); set along with 'in_transport_payload_ptr'
+    bool is_out_transport_port_set; // Set by addressing modes which translate ports as well; the replaced port is the source (6to4) or destination (4to6) TCP/UDP port, the ICMP Echo identifier, or the corresponding field of an ICMP error message's packet in error
+    bool is_out_transport_port_of_ipv4_host; // If true, the replaced port is the destination (6to4) or source (4to6) TCP/UDP port instead (and the other way around in packets in error); must not be accessed if is_out_transport_port_set == false
+    bool is_hairpinning; // Whether the IPv4 packet being translated from IPv6 is to be stored into 'hairpin_packet' instead of being sent out; always false outside of the 6to4 translation
+    bool is_in_packet_hairpinned; // Whether the packet being translated is a hairpinned one, i.e. it has been translated from IPv6 by the translator itself
+    bool is_siit_hairpin_destination; // Whether the destination of the packet being translated from IPv6 is an explicit address mapping's IPv4 address embedded into the translation prefix; only set by the 'siit' addressing mode
+    tundra__nat64_stateful_binding nat64_stateful_binding; // The binding of the packet being translated; must not be accessed if is_out_transport_port_set == false
+    uint8_t clat_nat44_host_ipv4[4]; // The IPv4 host of the NAT44 session of the packet being translated; must not be accessed if is_out_transport_port_set == false
 } tundra__thread_ctx;
 
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// Translation instances
+// ---------------------------------------------------------------------------------------------------------------------
+
+// A TUN interface (or a set of inherited file descriptors) together with the configuration according to which the
+//  packets passing through it are translated; one process may serve several of them (see opmode_translate.c)
+typedef struct tundra__xlat_instance {
+    const char *name; // "main" for the instance configured by the '-c' command-line option; points into the command-line configuration otherwise
+    tundra__conf_file *owned_file_config; // NULL for the main instance (its configuration is owned by init.c)
+    const tundra__conf_file *file_config;
+    tundra__thread_ctx *thread_contexts; // There are file_config->program_translator_threads of them
+    tundra__rfc7050_rediscovery_state *rfc7050_rediscovery_state; // NULL if the translation prefix is not being rediscovered
+    int external_addr_xlat_cache_file_fd;
+} tundra__xlat_instance;
+
+// A translator thread; it translates the packets of one thread context of each instance which has enough translator
+//  threads configured, so that the threads are shared by all the instances instead of each of them having its own
+typedef struct tundra__xlat_worker {
+    tundra__thread_ctx *thread_contexts[TUNDRA__MAX_XLAT_INSTANCES]; // The first thread_context_count items are used
+    struct pollfd poll_fds[TUNDRA__MAX_XLAT_INSTANCES]; // Used only if thread_context_count > 1
+    size_t thread_context_count;
+    pthread_t thread;
+    bool joined;
+} tundra__xlat_worker;
+
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Handover of file descriptors to a new process
+// ---------------------------------------------------------------------------------------------------------------------
+
+// The file descriptors of an instance which have been handed over by the previously running process
+typedef struct tundra__handover_instance_fds {
+    int packet_fds[2 * TUNDRA__MAX_XLAT_THREADS]; // The read & write file descriptor of each translator thread
+    int external_addr_xlat_cache_file_fd; // -1 if the previous process has not persisted its cache
+} tundra__handover_instance_fds;
+
+typedef struct tundra__handover_state {
+    tundra__handover_instance_fds instance_fds[TUNDRA__MAX_XLAT_INSTANCES]; // Valid only if has_taken_over == true
+    char *socket_path;
+    int listening_fd; // -1 until it is taken over from the previous process, or until handover__listen() is called
+    int connection_fd; // The connection to the previous (or the next) process while a handover is in progress; -1 otherwise
+    time_t successor_ack_deadline; // While the next process's ack is being waited for (see handover__wait_for_successor())
+    bool has_taken_over; // Whether the file descriptors have been taken over from the previous process
+    bool has_handed_over; // Whether the file descriptors have been handed over to the next process
+    bool should_transfer_external_addr_xlat_caches; // Requested by the process which takes the file descriptors over
+} tundra__handover_state;
+
+// The messages exchanged over the handover socket; since both processes run on the same host, the multi-byte integers
+//  are stored in the host's byte order. The file descriptors are attached to them as SCM_RIGHTS control messages.
+typedef struct __attribute__((__packed__)) tundra__handover_instance_message {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t io_mode; // tundra__io_mode
+    uint8_t is_tun_multi_queue;
+    uint8_t is_external_addr_xlat_cache_file_fd_attached;
+    uint32_t thread_count;
+    uint8_t is_last_instance;
+    uint8_t reserved1[3];
+    char name[TUNDRA__MAX_XLAT_INSTANCE_NAME_LENGTH + 1];
+    char tun_interface_name[IFNAMSIZ]; // Empty if io_mode != TUN
+    uint8_t reserved2[7];
+} tundra__handover_instance_message;  // SIZE: 72 bytes
+
+// The file descriptors which have not been sent in any of the previous messages of the instance are attached, in the
+//  order read-write; the indices refer to the list of all the file descriptors received for the instance so far (a
+//  single-queue TUN interface, for example, has only one file descriptor shared by all the threads)
+typedef struct __attribute__((__packed__)) tundra__handover_thread_message {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t packet_read_fd_index;
+    uint32_t packet_write_fd_index;
+} tundra__handover_thread_message;  // SIZE: 16 bytes
+
+// Sent after the instances' messages; the listening handover socket is attached, so that the socket's path keeps
+//  leading to the running translator until the next one has taken over (and it never has to be bound again)
+typedef struct __attribute__((__packed__)) tundra__handover_socket_message {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+} tundra__handover_socket_message;  // SIZE: 8 bytes
+
+// Sent by the process which takes the file descriptors over once it is ready to start translating
+typedef struct __attribute__((__packed__)) tundra__handover_ack_message {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t should_transfer_external_addr_xlat_caches;
+    uint8_t reserved[2];
+} tundra__handover_ack_message;  // SIZE: 8 bytes
+
+// Sent by the process which hands the file descriptors over once its translator threads have terminated (only if the
+//  caches are to be transferred); a memory file with the contents of each marked instance's caches is attached
+typedef struct __attribute__((__packed__)) tundra__handover_cache_message {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+    uint8_t is_external_addr_xlat_cache_attached[TUNDRA__MAX_XLAT_INSTANCES];
+} tundra__handover_cache_message;  // SIZE: 24 bytes
+
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // Miscellaneous
 // ---------------------------------------------------------------------------------------------------------------------
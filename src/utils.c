@@ -28,6 +28,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _OOM_MESSAGE "Out of memory!"
 
 
+static size_t _get_huge_page_backed_mapping_size(const size_t n, const size_t item_size);
+
+
 void *utils__alloc_zeroed_out_memory(const size_t n, const size_t item_size) {
     void *memory = calloc(n, item_size);
     if(memory == NULL)
@@ -50,6 +53,43 @@ void *utils__alloc_aligned_zeroed_out_memory(const size_t n, const size_t item_s
     return memory;
 }
 
+/*
+ * Intended for large tables which are accessed randomly (e.g. hash tables with millions of entries), for which the
+ * TLB would otherwise become a bottleneck. The memory is an anonymous mapping, whose pages are zeroed out lazily by the
+ * kernel when they are touched for the first time, so the allocation itself is cheap even if the table is huge.
+ * Explicitly reserved huge pages (MAP_HUGETLB) are used if there are enough of them; otherwise, the mapping is aligned
+ * to the huge page size and transparent huge pages are requested for it (which is merely a hint to the kernel).
+ * The memory must be freed using utils__free_huge_page_backed_memory() with the same 'n' and 'item_size'!
+ */
+void *utils__alloc_huge_page_backed_zeroed_out_memory(const size_t n, const size_t item_size) {
+    const size_t mapping_size = _get_huge_page_backed_mapping_size(n, item_size);
+
+    if(mapping_size >= TUNDRA__HUGE_PAGE_SIZE) {
+        void *memory = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(memory != MAP_FAILED)
+            return memory;
+    }
+
+    // In order for the mapping to be aligned, a larger one is created, and the excess parts of it are unmapped
+    const size_t alignment = ((mapping_size >= TUNDRA__HUGE_PAGE_SIZE) ? TUNDRA__HUGE_PAGE_SIZE : 0);
+    uint8_t *unaligned_memory = mmap(NULL, mapping_size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(unaligned_memory == MAP_FAILED)
+        log__crash(false, "%s", _OOM_MESSAGE);
+
+    if(alignment == 0)
+        return unaligned_memory;
+
+    const size_t head_size = ((alignment - ((uintptr_t) unaligned_memory % alignment)) % alignment);
+    uint8_t *memory = (unaligned_memory + head_size);
+    if(head_size > 0)
+        munmap(unaligned_memory, head_size);
+    munmap(memory + mapping_size, alignment - head_size);
+
+    madvise(memory, mapping_size, MADV_HUGEPAGE);  // Fails if transparent huge pages are not supported, which is fine
+
+    return memory;
+}
+
 void *utils__realloc_memory(void *old_memory, const size_t n, const size_t item_size) {
     void *new_memory = realloc(old_memory, n * item_size);
     if(new_memory == NULL)
@@ -71,6 +111,10 @@ void utils__free_memory(void *memory) {
     free(memory);
 }
 
+void utils__free_huge_page_backed_memory(void *memory, const size_t n, const size_t item_size) {
+    munmap(memory, _get_huge_page_backed_mapping_size(n, item_size));
+}
+
 void utils__secure_strncpy(char *destination, const char *const source, const size_t buffer_size) {
     /* https://www.cplusplus.com/reference/cstring/strncpy/:
      *   No null-character is implicitly appended at the end of destination if source is longer than num.
@@ -81,5 +125,76 @@ void utils__secure_strncpy(char *destination, const char *const source, const si
     destination[buffer_size - 1] = '\0';
 }
 
+// Returns NULL (with 'errno' set) if the file cannot be read; otherwise, the returned memory has to be freed using
+//  utils__free_memory(). Unlike most of the other functions, this one does not crash on failure, since it is used to
+//  (re)load files at runtime as well.
+uint8_t *utils__read_whole_file(const char *const file_path, size_t *out_file_size) {
+    const int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return NULL;
+
+    struct stat file_info;
+    if(fstat(fd, &file_info) < 0 || file_info.st_size < 0 || (uint64_t) file_info.st_size >= (uint64_t) SIZE_MAX) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = (saved_errno != 0 ? saved_errno : EFBIG);
+        return NULL;
+    }
+
+    const size_t file_size = (size_t) file_info.st_size;
+    uint8_t *file_data = utils__alloc_zeroed_out_memory(file_size + 1, sizeof(uint8_t));  // Empty files are not a problem
+
+    size_t read_size = 0;
+    while(read_size < file_size) {
+        const ssize_t return_value = read(fd, file_data + read_size, file_size - read_size);
+        if(return_value < 0 && errno == EINTR)
+            continue;
+
+        if(return_value <= 0) {
+            const int saved_errno = (return_value == 0 ? EIO : errno);  // The file has been truncated in the meantime
+            utils__free_memory(file_data);
+            close(fd);
+            errno = saved_errno;
+            return NULL;
+        }
+
+        read_size += (size_t) return_value;
+    }
+
+    close(fd);
+
+    *out_file_size = file_size;
+    return file_data;
+}
+
+// CLOCK_MONOTONIC_COARSE is read without a system call (using the vDSO), and its resolution (usually a few milliseconds)
+//  is more than enough for second-granular timestamps. Returns 0 if the clock cannot be read.
+time_t utils__get_coarse_monotonic_timestamp(void) {
+    struct timespec time_specification;
+    UTILS__MEM_ZERO_OUT(&time_specification, sizeof(struct timespec));
+
+    if(clock_gettime(CLOCK_MONOTONIC_COARSE, &time_specification) < 0)
+        return 0;
+
+    return time_specification.tv_sec;
+}
+
+// Mappings which are at least as large as a huge page are rounded up to a multiple of it, the rest to a multiple of the
+//  base page size
+static size_t _get_huge_page_backed_mapping_size(const size_t n, const size_t item_size) {
+    if(n == 0 || item_size == 0 || n > ((SIZE_MAX - TUNDRA__HUGE_PAGE_SIZE) / item_size))
+        log__crash(false, "Could not allocate huge page-backed memory - the requested size is invalid!");
+
+    const size_t size_in_bytes = (n * item_size);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const size_t granularity = (
+        (size_in_bytes >= TUNDRA__HUGE_PAGE_SIZE || page_size <= 0) ?
+        TUNDRA__HUGE_PAGE_SIZE :
+        (size_t) page_size
+    );
+
+    return (((size_in_bytes + granularity - 1) / granularity) * granularity);
+}
+
 
 #undef _OOM_MESSAGE
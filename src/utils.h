@@ -41,7 +41,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extern void *utils__alloc_zeroed_out_memory(const size_t n, const size_t item_size);
 extern void *utils__alloc_aligned_zeroed_out_memory(const size_t n, const size_t item_size, const size_t alignment);
+extern void *utils__alloc_huge_page_backed_zeroed_out_memory(const size_t n, const size_t item_size);
 extern void *utils__realloc_memory(void *old_memory, const size_t n, const size_t item_size);
 extern char *utils__duplicate_string(const char *const string);
 extern void utils__free_memory(void *memory);
+extern void utils__free_huge_page_backed_memory(void *memory, const size_t n, const size_t item_size);
 extern void utils__secure_strncpy(char *destination, const char *const source, const size_t buffer_size);
+extern uint8_t *utils__read_whole_file(const char *const file_path, size_t *out_file_size);
+extern time_t utils__get_coarse_monotonic_timestamp(void);
@@ -23,6 +23,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"utils_ip.h"
 
 #include"utils.h"
+#include"log.h"
 
 
 // Unusable IPv4 address blocks:
@@ -88,6 +89,142 @@ bool utils_ip__is_ip_proto_forbidden(const uint8_t ip_protocol_number) {
     //  (ip_protocol_number == 50) || // Encapsulating Security Payload
 }
 
+// 'prefix_length' is in bits and must not exceed the length of the addresses; the host bits of 'prefix' are ignored
+bool utils_ip__is_addr_in_prefix(const uint8_t *address, const uint8_t *prefix, const size_t prefix_length) {
+    const size_t whole_bytes = (prefix_length / 8);
+    const size_t remaining_bits = (prefix_length % 8);
+
+    if(!UTILS__MEM_EQ(address, prefix, whole_bytes))
+        return false;
+
+    if(remaining_bits == 0)
+        return true;
+
+    const uint8_t mask = (uint8_t) (0xff << (8 - remaining_bits));
+    return ((address[whole_bytes] & mask) == (prefix[whole_bytes] & mask));
+}
+
+// Parses a prefix in the '<address>/<length>' format in-place (the string is modified). Returns false if the string is
+//  not a valid prefix of the specified address family (AF_INET or AF_INET6), or if any bit following its length is set.
+bool utils_ip__parse_prefix_string(char *prefix_string, const int address_family, uint8_t *out_prefix, uint8_t *out_prefix_length) {
+    char *slash = strchr(prefix_string, '/');
+    if(slash == NULL)
+        return false;
+
+    *(slash++) = '\0';
+
+    const size_t prefix_size = ((address_family == AF_INET6) ? 16 : 4);
+    const size_t length_string_length = strlen(slash);
+    if(length_string_length < 1 || length_string_length > 3 || strspn(slash, "0123456789") != length_string_length)
+        return false;
+
+    const unsigned long prefix_length = strtoul(slash, NULL, 10);
+    if(prefix_length > (prefix_size * 8) || inet_pton(address_family, prefix_string, out_prefix) != 1)
+        return false;
+
+    for(size_t i = (size_t) prefix_length; i < (prefix_size * 8); i++) {
+        if(out_prefix[i / 8] & (0x80 >> (i % 8)))
+            return false;
+    }
+
+    *out_prefix_length = (uint8_t) prefix_length;
+    return true;
+}
+
+bool utils_ip__is_rfc6052_prefix_length_valid(const size_t prefix_length) {
+    return (prefix_length == 32 || prefix_length == 40 || prefix_length == 48 || prefix_length == 56 || prefix_length == 64 || prefix_length == 96);
+}
+
+/*
+ * The IPv4 address is embedded into the prefix as per RFC 6052, section 2.2 - bits 64 to 71 of the IPv6 address (the
+ * "u" octet) are skipped, and the bits following the IPv4 address (the suffix) are zero. The prefix's bits following
+ * its length must be zero (see conf_file_load__find_ipv6_prefix()), so that it can be copied as a whole. There is
+ * a specialized routine for each prefix length; which one is used is determined only by the configured length, so
+ * the branch is perfectly predictable.
+ */
+void utils_ip__embed_ipv4_into_rfc6052_prefix(const uint8_t *prefix, const uint8_t prefix_length, const uint8_t *ipv4, uint8_t *out_ipv6) {
+    switch(prefix_length) {
+        case 96:
+            memcpy(out_ipv6, prefix, 12);
+            memcpy(out_ipv6 + 12, ipv4, 4);
+            return;
+
+        case 64:
+            memcpy(out_ipv6, prefix, 16);
+            memcpy(out_ipv6 + 9, ipv4, 4);
+            return;
+
+        case 56:
+            memcpy(out_ipv6, prefix, 16);
+            out_ipv6[7] = ipv4[0];
+            memcpy(out_ipv6 + 9, ipv4 + 1, 3);
+            return;
+
+        case 48:
+            memcpy(out_ipv6, prefix, 16);
+            memcpy(out_ipv6 + 6, ipv4, 2);
+            memcpy(out_ipv6 + 9, ipv4 + 2, 2);
+            return;
+
+        case 40:
+            memcpy(out_ipv6, prefix, 16);
+            memcpy(out_ipv6 + 5, ipv4, 3);
+            out_ipv6[9] = ipv4[3];
+            return;
+
+        case 32:
+            memcpy(out_ipv6, prefix, 16);
+            memcpy(out_ipv6 + 4, ipv4, 4);
+            return;
+
+        default:
+            log__crash_invalid_internal_state("Invalid RFC 6052 prefix length");
+    }
+}
+
+// Returns false if the IPv6 address does not lie within the prefix; apart from the /96 prefix (whose suffix is
+//  empty), the "u" octet and the suffix must be zero as well, so that each IPv4 address has exactly one IPv6 counterpart
+bool utils_ip__extract_ipv4_from_rfc6052_address(const uint8_t *ipv6, const uint8_t *prefix, const uint8_t prefix_length, uint8_t *out_ipv4) {
+    switch(prefix_length) {
+        case 96:
+            if(!UTILS__MEM_EQ(ipv6, prefix, 12))
+                return false;
+            memcpy(out_ipv4, ipv6 + 12, 4);
+            return true;
+
+        case 64:
+            memcpy(out_ipv4, ipv6 + 9, 4);
+            break;
+
+        case 56:
+            out_ipv4[0] = ipv6[7];
+            memcpy(out_ipv4 + 1, ipv6 + 9, 3);
+            break;
+
+        case 48:
+            memcpy(out_ipv4, ipv6 + 6, 2);
+            memcpy(out_ipv4 + 2, ipv6 + 9, 2);
+            break;
+
+        case 40:
+            memcpy(out_ipv4, ipv6 + 5, 3);
+            out_ipv4[3] = ipv6[9];
+            break;
+
+        case 32:
+            memcpy(out_ipv4, ipv6 + 4, 4);
+            break;
+
+        default:
+            log__crash_invalid_internal_state("Invalid RFC 6052 prefix length");
+    }
+
+    uint8_t expected_ipv6[16];
+    utils_ip__embed_ipv4_into_rfc6052_prefix(prefix, prefix_length, out_ipv4, expected_ipv6);
+
+    return UTILS_IP__IPV6_ADDR_EQ(ipv6, expected_ipv6);
+}
+
 void utils_ip__generate_ipv6_frag_id(tundra__thread_ctx *const ctx, uint8_t *destination) {
     const uint32_t fragment_id = htonl(ctx->frag_id_ipv6); // This prevents the program from leaking the information about its endianness
     ctx->frag_id_ipv6++; // htonl() may be a macro
@@ -32,7 +32,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define UTILS_IP__IPV4_ADDR_EQ(ipv4_address1, ipv4_address2) (UTILS__MEM_EQ((ipv4_address1), (ipv4_address2), 4))
 #define UTILS_IP__IPV6_ADDR_EQ(ipv6_address1, ipv6_address2) (UTILS__MEM_EQ((ipv6_address1), (ipv6_address2), 16))
-#define UTILS_IP__IPV6_PREFIX_EQ(ipv6_prefix1, ipv6_prefix2) (UTILS__MEM_EQ((ipv6_prefix1), (ipv6_prefix2), 12))
 
 #define UTILS_IP__GET_IPV4_FRAG_RESERVED_BIT(ipv4_header_ptr) (!!(ntohs((ipv4_header_ptr)->frag_off) & 0x8000))
 #define UTILS_IP__GET_IPV4_DONT_FRAG(ipv4_header_ptr) (!!(ntohs((ipv4_header_ptr)->frag_off) & 0x4000))
@@ -51,5 +50,10 @@ extern bool utils_ip__is_ipv4_addr_unusable(const uint8_t *ipv4_address);
 extern bool utils_ip__is_ipv6_addr_unusable(const uint8_t *ipv6_address);
 extern bool utils_ip__is_ipv4_addr_unusable_or_private(const uint8_t *ipv4_address);
 extern bool utils_ip__is_ip_proto_forbidden(const uint8_t ip_protocol_number);
+extern bool utils_ip__is_addr_in_prefix(const uint8_t *address, const uint8_t *prefix, const size_t prefix_length);
+extern bool utils_ip__parse_prefix_string(char *prefix_string, const int address_family, uint8_t *out_prefix, uint8_t *out_prefix_length);
+extern bool utils_ip__is_rfc6052_prefix_length_valid(const size_t prefix_length);
+extern void utils_ip__embed_ipv4_into_rfc6052_prefix(const uint8_t *prefix, const uint8_t prefix_length, const uint8_t *ipv4, uint8_t *out_ipv6);
+extern bool utils_ip__extract_ipv4_from_rfc6052_address(const uint8_t *ipv6, const uint8_t *prefix, const uint8_t prefix_length, uint8_t *out_ipv4);
 extern void utils_ip__generate_ipv6_frag_id(tundra__thread_ctx *const ctx, uint8_t *destination);
 extern void utils_ip__generate_ipv4_frag_id(tundra__thread_ctx *const ctx, uint8_t *destination);
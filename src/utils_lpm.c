@@ -0,0 +1,319 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"utils_lpm.h"
+
+#include"utils.h"
+#include"log.h"
+
+
+#define _EMPTY_ENTRY ((uint32_t) 0)
+#define _CHILD_NODE_FLAG ((uint32_t) 0x80000000)
+#define _PATH_CHECK_FLAG ((uint32_t) 0x40000000)  // The child node skips some bytes of the key, which have to be checked
+#define _STRIDE_BYTE_INDEX_SHIFT ((uint32_t) 26)  // The index of the key's byte the child node is indexed by (4 bits)
+#define _STRIDE_BYTE_INDEX_MASK ((uint32_t) 0xf)
+#define _WIDE_STRIDE_FLAG ((uint32_t) 0x02000000)  // The child node is indexed by 16 bits of the key instead of 8
+#define _NODE_INDEX_MASK ((uint32_t) 0x01ffffff)
+#define _NODE_ENTRY_COUNT ((size_t) 256)  // Nodes with a 16-bit stride take up 256 node indices
+#define _WIDE_NODE_MIN_PREFIX_COUNT ((size_t) 256)  // A 16-bit node (256 KiB) takes up at most 1 KiB per prefix below it
+
+
+static int _compare_prefixes(const void *prefix1, const void *prefix2);
+static void _zero_out_bits_following_prefix_length(uint8_t *prefix, const size_t key_size, const size_t prefix_length);
+static void _build_node(tundra__lpm_table *table, const size_t node_offset, const size_t stride_start, const size_t stride_bits, const tundra__lpm_prefix *prefixes, const size_t prefix_count);
+static void _build_child_node(tundra__lpm_table *table, const size_t parent_entry_offset, const size_t path_start, const tundra__lpm_prefix *prefixes, const size_t prefix_count);
+static inline size_t _get_entry_index(const uint8_t *key, const size_t stride_start, const size_t stride_bits);
+static inline size_t _get_node_offset(const tundra__lpm_table *table, const size_t node_index);
+
+
+tundra__lpm_table *utils_lpm__create_table(const size_t key_size, const size_t first_stride_bits) {
+    if((key_size != 4 && key_size != 16) || (first_stride_bits != 8 && first_stride_bits != 16))
+        log__crash_invalid_internal_state("Invalid longest-prefix-match table parameters");
+
+    tundra__lpm_table *table = utils__alloc_zeroed_out_memory(1, sizeof(tundra__lpm_table));
+    table->entry_count = ((size_t) 1 << first_stride_bits);
+    table->entries = utils__alloc_zeroed_out_memory(table->entry_count, sizeof(uint32_t));
+    table->nodes = utils__alloc_zeroed_out_memory(1, sizeof(tundra__lpm_node));
+    table->entry_prefix_lengths = utils__alloc_zeroed_out_memory(table->entry_count, sizeof(uint8_t));
+    table->prefixes = NULL;
+    table->prefix_count = 0;
+    table->key_size = key_size;
+    table->first_stride_bits = first_stride_bits;
+    table->is_built = false;
+
+    return table;
+}
+
+void utils_lpm__free_table(tundra__lpm_table *table) {
+    utils__free_memory(table->entries);
+    utils__free_memory(table->nodes);
+    utils__free_memory(table->entry_prefix_lengths);
+    utils__free_memory(table->prefixes);
+    utils__free_memory(table);
+}
+
+/*
+ * The prefixes may be inserted in any order; the table is built from all of them at once by utils_lpm__build(), which
+ * has to be called before the table is looked up. Inserting the same prefix twice replaces its value. The bits of
+ * 'prefix' following 'prefix_length' are ignored.
+ */
+void utils_lpm__insert(tundra__lpm_table *table, const uint8_t *prefix, const size_t prefix_length, const uint32_t value) {
+    if(table->is_built || prefix_length > (table->key_size * 8) || value > UTILS_LPM__MAX_VALUE)
+        log__crash_invalid_internal_state("Invalid longest-prefix-match table prefix");
+
+    // The array's capacity doubles whenever its size reaches a power of two
+    if((table->prefix_count & (table->prefix_count - 1)) == 0)
+        table->prefixes = utils__realloc_memory(table->prefixes, UTILS__MAXIMUM_UNSAFE(table->prefix_count * 2, (size_t) 1), sizeof(tundra__lpm_prefix));
+
+    tundra__lpm_prefix *new_prefix = table->prefixes + table->prefix_count;
+    UTILS__MEM_ZERO_OUT(new_prefix, sizeof(tundra__lpm_prefix));
+    memcpy(new_prefix->prefix, prefix, table->key_size);
+    _zero_out_bits_following_prefix_length(new_prefix->prefix, table->key_size, prefix_length);
+    new_prefix->value = value;
+    new_prefix->insertion_order = (uint32_t) table->prefix_count;
+    new_prefix->prefix_length = (uint8_t) prefix_length;
+
+    table->prefix_count++;
+}
+
+void utils_lpm__build(tundra__lpm_table *table) {
+    if(table->is_built)
+        log__crash_invalid_internal_state("The longest-prefix-match table has already been built");
+
+    // Once sorted, the prefixes below each node form a contiguous run, and duplicate prefixes are adjacent to each
+    //  other (the last inserted one being the last of them)
+    size_t unique_prefix_count = 0;
+    if(table->prefix_count > 0) {
+        qsort(table->prefixes, table->prefix_count, sizeof(tundra__lpm_prefix), _compare_prefixes);
+
+        for(size_t i = 0; i < table->prefix_count; i++) {
+            const tundra__lpm_prefix *current_prefix = table->prefixes + i;
+            const tundra__lpm_prefix *next_prefix = current_prefix + 1;
+            if(
+                (i + 1) < table->prefix_count &&
+                current_prefix->prefix_length == next_prefix->prefix_length &&
+                UTILS__MEM_EQ(current_prefix->prefix, next_prefix->prefix, 16)
+            ) continue;
+
+            table->prefixes[unique_prefix_count++] = *current_prefix;
+        }
+    }
+
+    _build_node(table, 0, 0, table->first_stride_bits, table->prefixes, unique_prefix_count);
+
+    utils__free_memory(table->prefixes);
+    table->prefixes = NULL;
+    table->prefix_count = 0;
+    utils__free_memory(table->entry_prefix_lengths);
+    table->entry_prefix_lengths = NULL;
+    table->is_built = true;
+}
+
+/*
+ * Returns false if none of the table's prefixes contains the key (which has to be 'table->key_size' bytes long). Every
+ * level of the trie costs one memory access: an IPv4 lookup needs at most 3 of them with a 16-bit first stride, and
+ * an IPv6 one needs at most one per stride (8 or 16 bits) in which the prefixes on the key's path diverge, plus one (15
+ * in theory, but usually 2 or 3 - e.g. the IPv6 prefixes of explicit address mappings tend to share their first 96
+ * bits, which are skipped as a whole). Checking the skipped bytes does not delay the descent, as it does not depend on it.
+ */
+bool utils_lpm__lookup(const tundra__lpm_table *table, const uint8_t *key, uint32_t *out_value) {
+    uint32_t entry = table->entries[_get_entry_index(key, 0, table->first_stride_bits)];
+
+    // Child nodes' strides never reach beyond the key's end
+    while(entry & _CHILD_NODE_FLAG) {
+        const size_t node_index = (size_t) (entry & _NODE_INDEX_MASK);
+        const size_t stride_byte_index = (size_t) ((entry >> _STRIDE_BYTE_INDEX_SHIFT) & _STRIDE_BYTE_INDEX_MASK);
+        const size_t entry_index = (
+            (entry & _WIDE_STRIDE_FLAG) ?
+            ((((size_t) key[stride_byte_index]) << 8) | ((size_t) key[stride_byte_index + 1])) :
+            ((size_t) key[stride_byte_index])
+        );
+
+        if(entry & _PATH_CHECK_FLAG) {
+            const tundra__lpm_node *node = table->nodes + node_index;
+            if(!UTILS__MEM_EQ(key + node->path_start, node->path + node->path_start, stride_byte_index - node->path_start)) {
+                entry = node->fallback_entry;
+                break;
+            }
+        }
+
+        entry = table->entries[_get_node_offset(table, node_index) + entry_index];
+    }
+
+    if(entry == _EMPTY_ENTRY)
+        return false;
+
+    *out_value = (entry - 1);
+    return true;
+}
+
+// Sorts the prefixes by their bits, then by their lengths, and then by the order they were inserted in
+static int _compare_prefixes(const void *prefix1, const void *prefix2) {
+    const tundra__lpm_prefix *p1 = (const tundra__lpm_prefix *) prefix1;
+    const tundra__lpm_prefix *p2 = (const tundra__lpm_prefix *) prefix2;
+
+    const int bits_comparison = memcmp(p1->prefix, p2->prefix, 16);
+    if(bits_comparison != 0)
+        return bits_comparison;
+
+    if(p1->prefix_length != p2->prefix_length)
+        return ((p1->prefix_length < p2->prefix_length) ? -1 : 1);
+
+    if(p1->insertion_order != p2->insertion_order)
+        return ((p1->insertion_order < p2->insertion_order) ? -1 : 1);
+
+    return 0;
+}
+
+static void _zero_out_bits_following_prefix_length(uint8_t *prefix, const size_t key_size, const size_t prefix_length) {
+    for(size_t i = 0; i < key_size; i++) {
+        const size_t byte_start = (i * 8);
+
+        if(prefix_length <= byte_start)
+            prefix[i] = 0;
+        else if(prefix_length < (byte_start + 8))
+            prefix[i] &= (uint8_t) (0xff << (8 - (prefix_length - byte_start)));
+    }
+}
+
+// The node's entries must already hold the value it inherits from its parent entry (if any); all the prefixes have to
+//  be longer than 'stride_start' and share the bits preceding it
+static void _build_node(tundra__lpm_table *table, const size_t node_offset, const size_t stride_start, const size_t stride_bits, const tundra__lpm_prefix *prefixes, const size_t prefix_count) {
+    const size_t stride_end = (stride_start + stride_bits);
+
+    // Prefixes which end within the node's stride cover blocks of consecutive entries, where the longest of them wins
+    for(size_t i = 0; i < prefix_count; i++) {
+        const tundra__lpm_prefix *current_prefix = prefixes + i;
+        if(current_prefix->prefix_length > stride_end)
+            continue;
+
+        const size_t covered_entry_count = ((size_t) 1 << (stride_end - current_prefix->prefix_length));
+        const size_t first_entry_index = (_get_entry_index(current_prefix->prefix, stride_start, stride_bits) & ~(covered_entry_count - 1));
+
+        for(size_t entry_offset = (node_offset + first_entry_index); entry_offset < (node_offset + first_entry_index + covered_entry_count); entry_offset++) {
+            if(table->entries[entry_offset] == _EMPTY_ENTRY || table->entry_prefix_lengths[entry_offset] <= current_prefix->prefix_length) {
+                table->entries[entry_offset] = (current_prefix->value + 1);
+                table->entry_prefix_lengths[entry_offset] = current_prefix->prefix_length;
+            }
+        }
+    }
+
+    // Longer prefixes are passed to child nodes - as the prefixes are sorted, those belonging to the same entry are
+    //  adjacent to each other
+    for(size_t i = 0; i < prefix_count;) {
+        if(prefixes[i].prefix_length <= stride_end) {
+            i++;
+            continue;
+        }
+
+        const size_t entry_index = _get_entry_index(prefixes[i].prefix, stride_start, stride_bits);
+        size_t group_end = (i + 1);
+        while(group_end < prefix_count && prefixes[group_end].prefix_length > stride_end && _get_entry_index(prefixes[group_end].prefix, stride_start, stride_bits) == entry_index)
+            group_end++;
+
+        if(table->entries[node_offset + entry_index] & _CHILD_NODE_FLAG)
+            log__crash_invalid_internal_state("A longest-prefix-match table entry has been assigned two child nodes");
+
+        _build_child_node(table, (node_offset + entry_index), stride_end, prefixes + i, (group_end - i));
+        i = group_end;
+    }
+}
+
+// The child node's stride starts at the first byte in which its prefixes diverge (or in which the shortest of them
+//  ends); the bytes between 'path_start' and it are skipped. Nodes with many prefixes below them are indexed by 16 bits
+//  of the key, so that large tables (e.g. thousands of explicit address mappings of single hosts) need fewer levels.
+static void _build_child_node(tundra__lpm_table *table, const size_t parent_entry_offset, const size_t path_start, const tundra__lpm_prefix *prefixes, const size_t prefix_count) {
+    // The prefixes are sorted, so the first and the last one share the fewest bytes
+    size_t common_byte_count = 0;
+    while(common_byte_count < table->key_size && prefixes[0].prefix[common_byte_count] == prefixes[prefix_count - 1].prefix[common_byte_count])
+        common_byte_count++;
+
+    size_t shortest_prefix_length = prefixes[0].prefix_length;
+    for(size_t i = 1; i < prefix_count; i++)
+        shortest_prefix_length = UTILS__MINIMUM_UNSAFE(shortest_prefix_length, (size_t) prefixes[i].prefix_length);
+
+    const size_t stride_start = (UTILS__MINIMUM_UNSAFE((common_byte_count * 8), (shortest_prefix_length - 1)) / 8 * 8);
+    const size_t stride_bits = ((prefix_count >= _WIDE_NODE_MIN_PREFIX_COUNT && (stride_start + 16) <= (table->key_size * 8)) ? 16 : 8);
+    const size_t child_node_size = ((size_t) 1 << stride_bits);
+
+    const size_t child_node_index = (((table->entry_count - ((size_t) 1 << table->first_stride_bits)) / _NODE_ENTRY_COUNT) + 1);
+    const size_t next_node_index = (child_node_index + (child_node_size / _NODE_ENTRY_COUNT));
+    if(next_node_index > ((size_t) _NODE_INDEX_MASK + 1))
+        log__crash(false, "The longest-prefix-match table is too large!");
+
+    const size_t child_node_offset = table->entry_count;
+    table->entry_count += child_node_size;
+    table->entries = utils__realloc_memory(table->entries, table->entry_count, sizeof(uint32_t));
+    table->entry_prefix_lengths = utils__realloc_memory(table->entry_prefix_lengths, table->entry_count, sizeof(uint8_t));
+    table->nodes = utils__realloc_memory(table->nodes, next_node_index, sizeof(tundra__lpm_node));
+
+    // The new node inherits the parent entry's value (if any), since the prefix it belongs to covers all the node's entries
+    for(size_t i = child_node_offset; i < table->entry_count; i++) {
+        table->entries[i] = table->entries[parent_entry_offset];
+        table->entry_prefix_lengths[i] = table->entry_prefix_lengths[parent_entry_offset];
+    }
+
+    tundra__lpm_node *child_node = table->nodes + child_node_index;
+    UTILS__MEM_ZERO_OUT(child_node, sizeof(tundra__lpm_node));
+    memcpy(child_node->path, prefixes[0].prefix, (stride_start / 8));
+    child_node->fallback_entry = table->entries[parent_entry_offset];
+    child_node->path_start = (uint8_t) (path_start / 8);
+
+    table->entries[parent_entry_offset] = (
+        _CHILD_NODE_FLAG |
+        ((stride_start > path_start) ? _PATH_CHECK_FLAG : 0) |
+        ((stride_bits == 16) ? _WIDE_STRIDE_FLAG : 0) |
+        (((uint32_t) (stride_start / 8)) << _STRIDE_BYTE_INDEX_SHIFT) |
+        ((uint32_t) child_node_index)
+    );
+    table->entry_prefix_lengths[parent_entry_offset] = 0;
+
+    _build_node(table, child_node_offset, stride_start, stride_bits, prefixes, prefix_count);
+}
+
+static inline size_t _get_entry_index(const uint8_t *key, const size_t stride_start, const size_t stride_bits) {
+    const size_t byte_index = (stride_start / 8);
+
+    if(stride_bits == 16)
+        return ((((size_t) key[byte_index]) << 8) | ((size_t) key[byte_index + 1]));
+
+    return (size_t) key[byte_index];
+}
+
+static inline size_t _get_node_offset(const tundra__lpm_table *table, const size_t node_index) {
+    // Node 0 is the root node
+    if(node_index == 0)
+        return 0;
+
+    return (((size_t) 1 << table->first_stride_bits) + ((node_index - 1) * _NODE_ENTRY_COUNT));
+}
+
+
+#undef _EMPTY_ENTRY
+#undef _CHILD_NODE_FLAG
+#undef _PATH_CHECK_FLAG
+#undef _STRIDE_BYTE_INDEX_SHIFT
+#undef _STRIDE_BYTE_INDEX_MASK
+#undef _WIDE_STRIDE_FLAG
+#undef _NODE_INDEX_MASK
+#undef _NODE_ENTRY_COUNT
+#undef _WIDE_NODE_MIN_PREFIX_COUNT
@@ -77,23 +77,17 @@ bool utils_xlat_addr__siit__translate_6to4_prefix_for_main_packet(const tundra__
     if(UTILS_IP__IPV6_ADDR_EQ(in_ipv6, ctx->config->router_ipv6))
         return false;
 
-    if(!UTILS_IP__IPV6_PREFIX_EQ(in_ipv6, ctx->config->addressing_nat64_clat_siit_prefix))
+    if(!utils_ip__extract_ipv4_from_rfc6052_address(in_ipv6, ctx->config->addressing_nat64_clat_siit_prefix, ctx->config->addressing_nat64_clat_siit_prefix_length, out_ipv4))
         return false;
 
-    if(!_nat64_clat_siit__is_ipv4_embeddable_into_prefix(ctx, in_ipv6 + 12))
-        return false;
-
-    memcpy(out_ipv4, in_ipv6 + 12, 4);
-
-    return true;
+    return _nat64_clat_siit__is_ipv4_embeddable_into_prefix(ctx, out_ipv4);
 }
 
 bool utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint8_t *out_ipv6) {
     if(!_nat64_clat_siit__is_ipv4_embeddable_into_prefix(ctx, in_ipv4))
         return false;
 
-    memcpy(out_ipv6, ctx->config->addressing_nat64_clat_siit_prefix, 12);
-    memcpy(out_ipv6 + 12, in_ipv4, 4);
+    utils_ip__embed_ipv4_into_rfc6052_prefix(ctx->config->addressing_nat64_clat_siit_prefix, ctx->config->addressing_nat64_clat_siit_prefix_length, in_ipv4, out_ipv6);
 
     if(UTILS_IP__IPV6_ADDR_EQ(out_ipv6, ctx->config->router_ipv6))
         return false;
@@ -102,19 +96,13 @@ bool utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(const tundra__
 }
 
 bool utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv6, uint8_t *out_ipv4) {
-    if(!UTILS_IP__IPV6_PREFIX_EQ(in_ipv6, ctx->config->addressing_nat64_clat_siit_prefix))
-        return false;
-
     // For debugging purposes, illegal addresses (such as 127.0.0.1) inside ICMP packets are translated normally.
-    memcpy(out_ipv4, in_ipv6 + 12, 4);
-
-    return true;
+    return utils_ip__extract_ipv4_from_rfc6052_address(in_ipv6, ctx->config->addressing_nat64_clat_siit_prefix, ctx->config->addressing_nat64_clat_siit_prefix_length, out_ipv4);
 }
 
 void utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint8_t *out_ipv6) {
     // For debugging purposes, illegal addresses (such as 127.0.0.1) inside ICMP packets are translated normally.
-    memcpy(out_ipv6, ctx->config->addressing_nat64_clat_siit_prefix, 12);
-    memcpy(out_ipv6 + 12, in_ipv4, 4);
+    utils_ip__embed_ipv4_into_rfc6052_prefix(ctx->config->addressing_nat64_clat_siit_prefix, ctx->config->addressing_nat64_clat_siit_prefix_length, in_ipv4, out_ipv6);
 }
 
 static bool _nat64_clat_siit__is_ipv4_embeddable_into_prefix(const tundra__thread_ctx *const ctx, const uint8_t *ipv4_address) {
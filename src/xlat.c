@@ -22,25 +22,70 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"tundra.h"
 #include"xlat.h"
 
+#include"utils.h"
+#include"log.h"
 #include"signals.h"
+#include"conf_reload.h"
+#include"xlat_interrupt.h"
 #include"xlat_io.h"
 #include"xlat_4to6.h"
 #include"xlat_6to4.h"
 
 
+static void _serve_one_thread_context(tundra__thread_ctx *const ctx);
+static void _serve_multiple_thread_contexts(tundra__xlat_worker *const worker);
+static void _handle_next_packet(tundra__thread_ctx *const ctx);
+static inline void _pick_up_reloaded_config(tundra__thread_ctx *const ctx);
 static void _translate_packet(tundra__thread_ctx *const ctx);
+static void _translate_hairpinned_packet(tundra__thread_ctx *const ctx);
 
 
 void *xlat__run_thread(void *arg) {
-    tundra__thread_ctx *const ctx = (tundra__thread_ctx *const) arg;
+    tundra__xlat_worker *const worker = (tundra__xlat_worker *const) arg;
 
+    if(worker->thread_context_count == 1)
+        _serve_one_thread_context(worker->thread_contexts[0]);
+    else
+        _serve_multiple_thread_contexts(worker);
+
+    return NULL;
+}
+
+// Unless there are several translation instances, each thread serves just one file descriptor, which it can block on
+static void _serve_one_thread_context(tundra__thread_ctx *const ctx) {
+    while(signals__should_this_thread_keep_running())
+        _handle_next_packet(ctx);
+}
+
+// Each of the file descriptors is read exclusively by this thread (see opmode_translate.c), so the read following the
+//  poll() call never blocks. At most one packet is handled per file descriptor and round, so that a busy instance
+//  cannot starve the others served by the same thread.
+static void _serve_multiple_thread_contexts(tundra__xlat_worker *const worker) {
     while(signals__should_this_thread_keep_running()) {
-        xlat_io__recv_packet_into_in_packet_buffer(ctx);
+        if(xlat_interrupt__poll(worker->poll_fds, (nfds_t) worker->thread_context_count, -1) < 0)
+            log__thread_crash(worker->thread_contexts[0]->thread_id, true, "An error occurred while waiting for packets!");
 
-        _translate_packet(ctx);
+        for(size_t i = 0; i < worker->thread_context_count; i++) {
+            // POLLERR & POLLHUP are handled by the read, which reports them
+            if(worker->poll_fds[i].revents != 0)
+                _handle_next_packet(worker->thread_contexts[i]);
+        }
     }
+}
 
-    return NULL;
+static void _handle_next_packet(tundra__thread_ctx *const ctx) {
+    xlat_io__recv_packet_into_in_packet_buffer(ctx);
+    ctx->current_timestamp = utils__get_coarse_monotonic_timestamp();
+
+    _pick_up_reloaded_config(ctx);
+    _translate_packet(ctx);
+}
+
+// The configuration is only switched between packets, so that a single packet is always translated according to a
+//  single configuration; in the common case (no reload has happened), this costs just a single atomic load.
+static inline void _pick_up_reloaded_config(tundra__thread_ctx *const ctx) {
+    if(__atomic_load_n(&ctx->conf_reload_state->generation, __ATOMIC_ACQUIRE) != ctx->conf_file_version_generation)
+        conf_reload__switch_thread_to_current_version(ctx);
 }
 
 static void _translate_packet(tundra__thread_ctx *const ctx) {
@@ -50,6 +95,35 @@ static void _translate_packet(tundra__thread_ctx *const ctx) {
     const uint8_t ip_version = (*ctx->in_packet_buffer) >> 4;
     if(ip_version == 4)
         xlat_4to6__handle_packet(ctx);
-    else if(ip_version == 6)
+    else if(ip_version == 6) {
         xlat_6to4__handle_packet(ctx);
+
+        if(ctx->is_hairpinning)
+            _translate_hairpinned_packet(ctx);
+    }
+}
+
+// The IPv4 packet produced by the 6to4 translation is translated back to IPv6 as if it has been received from the
+//  kernel - this saves two trips through the TUN interface and a routing lookup
+static void _translate_hairpinned_packet(tundra__thread_ctx *const ctx) {
+    ctx->is_hairpinning = false;
+
+    const size_t hairpin_packet_size = ctx->hairpin_packet->size;
+    if(hairpin_packet_size == 0)
+        return; // The packet has been dropped
+
+    ctx->hairpin_packet->size = 0;
+
+    uint8_t *const in_packet_buffer = ctx->in_packet_buffer;
+    const size_t in_packet_size = ctx->in_packet_size;
+
+    ctx->in_packet_buffer = ctx->hairpin_packet->buffer;
+    ctx->in_packet_size = hairpin_packet_size;
+    ctx->is_in_packet_hairpinned = true;
+
+    xlat_4to6__handle_packet(ctx);
+
+    ctx->in_packet_buffer = in_packet_buffer;
+    ctx->in_packet_size = in_packet_size;
+    ctx->is_in_packet_hairpinned = false;
 }
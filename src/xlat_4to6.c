@@ -48,6 +48,7 @@ static void _translate_icmpv4_payload_to_icmpv6_and_send(tundra__thread_ctx *con
 static void _translate_tcp_payload_and_send(tundra__thread_ctx *const ctx, _out_ipv6_packet_data *const out_packet_data);
 static void _translate_udp_payload_and_send(tundra__thread_ctx *const ctx, _out_ipv6_packet_data *const out_packet_data);
 static void _translate_generic_payload_and_send(tundra__thread_ctx *const ctx, _out_ipv6_packet_data *const out_packet_data);
+static void _replace_tcp_udp_port_if_translated(const tundra__thread_ctx *const ctx, uint16_t *source_port, uint16_t *dest_port, uint16_t *checksum);
 static void _appropriately_send_ipv6_packet(tundra__thread_ctx *const ctx, struct ipv6hdr *ipv6_header, const tundra__ipv6_frag_header *nullable_ipv6_fragment_header, const uint8_t *nullable_payload1_ptr, const size_t zeroable_payload1_size_m8, const uint8_t *payload2_ptr, const size_t payload2_size, const bool dont_fragment);
 static void _fragment_and_send_ipv6_packet(tundra__thread_ctx *const ctx, struct ipv6hdr *ipv6_header, const tundra__ipv6_frag_header *nullable_ipv6_fragment_header, const uint8_t *nullable_payload1_ptr, const size_t zeroable_payload1_size_m8, const uint8_t *payload2_ptr, const size_t payload2_size);
 static bool _fragment_and_send_ipv6_packet_part(const tundra__thread_ctx *const ctx, struct ipv6hdr *ready_ipv6_header, tundra__ipv6_frag_header *ready_ipv6_fragment_header, const uint8_t *payload_part_ptr, const size_t payload_part_size, size_t *fragment_offset_8byte_chunks, const bool more_fragments_after_this_part, const size_t max_fragment_payload_size);
@@ -211,6 +212,16 @@ static bool _validate_and_translate_ip_header(tundra__thread_ctx *const ctx, _ou
         out_packet_data->is_fragment = false;
     }
 
+    out_packet_data->payload_ptr = (const uint8_t *) (ctx->in_packet_buffer + in_ipv4_header_size);
+    out_packet_data->payload_size = (ctx->in_packet_size - in_ipv4_header_size);
+
+    // :: Transport-layer information (for addressing modes which translate ports as well)
+    ctx->in_transport_payload_ptr = (out_packet_data->is_fragment ? NULL : out_packet_data->payload_ptr);
+    ctx->in_transport_payload_size = (out_packet_data->is_fragment ? 0 : out_packet_data->payload_size);
+    ctx->in_transport_protocol = in_ipv4_header->protocol;
+    ctx->is_out_transport_port_set = false;
+    ctx->is_out_transport_port_of_ipv4_host = false;
+
     // :: Source & destination IP address
     // NOTE: All header fields of the input packet (including any IPv4 options) have been validated at this point,
     //  except the source & destination IP address; therefore, after validating these two fields, the address
@@ -223,9 +234,6 @@ static bool _validate_and_translate_ip_header(tundra__thread_ctx *const ctx, _ou
         (uint8_t *) (out_ipv6_header->daddr.s6_addr)
     )) return false;
 
-    out_packet_data->payload_ptr = (const uint8_t *) (ctx->in_packet_buffer + in_ipv4_header_size);
-    out_packet_data->payload_size = (ctx->in_packet_size - in_ipv4_header_size);
-
     // If there are more fragments after this one, this fragment's payload size must be a multiple of 8, as fragment
     //  offsets in IPv4/v6 headers are specified in 8-byte units.
     if(more_fragments && (out_packet_data->payload_size % 8) != 0)
@@ -274,6 +282,7 @@ static void _translate_tcp_payload_and_send(tundra__thread_ctx *const ctx, _out_
                 (const struct iphdr *) __builtin_assume_aligned(ctx->in_packet_buffer, 64),
                 &out_packet_data->ipv6_header
             );
+            _replace_tcp_udp_port_if_translated(ctx, &new_tcp_header->source, &new_tcp_header->dest, &new_tcp_header->check);
 
             _appropriately_send_ipv6_packet(
                 ctx, &out_packet_data->ipv6_header, (out_packet_data->is_fragment ? &out_packet_data->ipv6_fragment_header : NULL),
@@ -289,6 +298,7 @@ static void _translate_tcp_payload_and_send(tundra__thread_ctx *const ctx, _out_
                 (const struct iphdr *) __builtin_assume_aligned(ctx->in_packet_buffer, 64),
                 &out_packet_data->ipv6_header
             );
+            _replace_tcp_udp_port_if_translated(ctx, &new_tcp_header->source, &new_tcp_header->dest, &new_tcp_header->check);
 
             _appropriately_send_ipv6_packet(
                 ctx, &out_packet_data->ipv6_header, (out_packet_data->is_fragment ? &out_packet_data->ipv6_fragment_header : NULL),
@@ -315,12 +325,14 @@ static void _translate_udp_payload_and_send(tundra__thread_ctx *const ctx, _out_
         if(new_udp_header.check == 0)
             return;
 
-        const uint16_t new_checksum = checksum__recalculate_checksum_4to6(
+        new_udp_header.check = checksum__recalculate_checksum_4to6(
             new_udp_header.check,
             (const struct iphdr *) __builtin_assume_aligned(ctx->in_packet_buffer, 64),
             &out_packet_data->ipv6_header
         );
-        new_udp_header.check = (new_checksum == 0 ? 0xffff : new_checksum);
+        _replace_tcp_udp_port_if_translated(ctx, &new_udp_header.source, &new_udp_header.dest, &new_udp_header.check);
+        if(new_udp_header.check == 0)
+            new_udp_header.check = 0xffff;
 
         _appropriately_send_ipv6_packet(
             ctx, &out_packet_data->ipv6_header, (out_packet_data->is_fragment ? &out_packet_data->ipv6_fragment_header : NULL),
@@ -347,6 +359,17 @@ static void _translate_generic_payload_and_send(tundra__thread_ctx *const ctx, _
     );
 }
 
+// The destination port is replaced if the addressing mode has translated it (e.g. 'nat64-stateful'), or the source
+//  port if the translated port belongs to the IPv4 host (e.g. the 'clat' mode's NAT44)
+static void _replace_tcp_udp_port_if_translated(const tundra__thread_ctx *const ctx, uint16_t *source_port, uint16_t *dest_port, uint16_t *checksum) {
+    if(!ctx->is_out_transport_port_set)
+        return;
+
+    uint16_t *port = (ctx->is_out_transport_port_of_ipv4_host ? source_port : dest_port);
+    *checksum = checksum__recalculate_checksum_for_changed_16bit_word(*checksum, *port, ctx->out_transport_port);
+    *port = ctx->out_transport_port;
+}
+
 static void _appropriately_send_ipv6_packet(
     tundra__thread_ctx *const ctx,
     struct ipv6hdr *ipv6_header,
@@ -97,6 +97,10 @@ bool xlat_4to6_icmp__translate_icmpv4_to_icmpv6(tundra__thread_ctx *const ctx, c
 
     // :: Payload
     if(in_icmpv4_header->type == 0 || in_icmpv4_header->type == 8) { // Echo Reply, Echo Request
+        // The identifier is replaced if the addressing mode has translated it (e.g. 'nat64-stateful')
+        if(ctx->is_out_transport_port_set)
+            memcpy(out_message_data->message_start_64b + 4, &ctx->out_transport_port, 2);
+
         out_message_data->message_end_ptr = in_icmpv4_payload_ptr;
         out_message_data->message_end_size = in_icmpv4_payload_size;
 
@@ -142,6 +146,21 @@ bool xlat_4to6_icmp__translate_icmpv4_to_icmpv6(tundra__thread_ctx *const ctx, c
             else
                 return false;
 
+            // The packet in error was sent from the translated identifier
+            if(ctx->is_out_transport_port_set)
+                memcpy(((uint8_t *) new_icmpv6_packet_in_error_payload_ptr) + 4, &ctx->out_transport_port, 2);
+
+            out_message_data->message_end_ptr = (out_packet_in_error_data.payload_ptr + 8);
+            out_message_data->message_end_size = (out_packet_in_error_data.payload_size - 8);
+        } else if(ctx->is_out_transport_port_set && out_packet_in_error_data.payload_size >= 8) { // All other transport protocols - translated port
+            // The packet in error was sent from the translated TCP/UDP port - its source port is replaced, or its
+            //  destination port if the translated port belongs to the IPv4 host (the packet in error's own checksum
+            //  cannot be fixed, as the packet is usually truncated). Since the packet in error's header is 40 or 48
+            //  bytes in size, the start of its payload always fits into the buffer.
+            memcpy(out_message_data->message_start_64b + out_message_data->message_start_size_m8, out_packet_in_error_data.payload_ptr, 8);
+            memcpy(out_message_data->message_start_64b + out_message_data->message_start_size_m8 + (ctx->is_out_transport_port_of_ipv4_host ? 2 : 0), &ctx->out_transport_port, 2);
+            out_message_data->message_start_size_m8 += 8;
+
             out_message_data->message_end_ptr = (out_packet_in_error_data.payload_ptr + 8);
             out_message_data->message_end_size = (out_packet_in_error_data.payload_size - 8);
         } else { // All other transport protocols
@@ -45,6 +45,7 @@ static void _translate_icmpv6_payload_to_icmpv4_and_send(tundra__thread_ctx *con
 static void _translate_tcp_payload_and_send(const tundra__thread_ctx *const ctx, _out_ipv4_packet_data *const out_packet_data);
 static void _translate_udp_payload_and_send(const tundra__thread_ctx *const ctx, _out_ipv4_packet_data *const out_packet_data);
 static void _translate_generic_payload_and_send(const tundra__thread_ctx *const ctx, _out_ipv4_packet_data *const out_packet_data);
+static void _replace_tcp_udp_port_if_translated(const tundra__thread_ctx *const ctx, uint16_t *source_port, uint16_t *dest_port, uint16_t *checksum);
 static void _appropriately_send_ipv4_packet(const tundra__thread_ctx *const ctx, struct iphdr *ipv4_header, const uint8_t *nullable_payload1_ptr, const size_t zeroable_payload1_size_m8, const uint8_t *payload2_ptr, const size_t payload2_size);
 static void _fragment_and_send_ipv4_packet(const tundra__thread_ctx *const ctx, struct iphdr *ipv4_header, const uint8_t *nullable_payload1_ptr, const size_t zeroable_payload1_size_m8, const uint8_t *payload2_ptr, const size_t payload2_size);
 static bool _fragment_and_send_ipv4_packet_part(const tundra__thread_ctx *const ctx, struct iphdr *ready_ipv4_header, const uint8_t *current_payload_part_ptr, size_t remaining_payload_part_size, size_t *fragment_offset_8byte_chunks, const bool more_fragments_after_this_part, const bool dont_fragment, const size_t max_fragment_payload_size);
@@ -192,6 +193,18 @@ static bool _validate_and_translate_ip_header(tundra__thread_ctx *const ctx, _ou
         }
     }
 
+    // If the input IPv6 packet has a fragment header, it does not necessarily mean that the packet is fragmented -
+    //  it is possible for the fragment header to have both its offset and the more fragments bit set to zero, which
+    //  effectively means that the program has the whole, unfragmented packet on its hands.
+    out_packet_data->is_fragment = (bool) UTILS_IP__IS_IPV4_PACKET_FRAGMENTED_UNSAFE(out_ipv4_header);
+
+    // :: Transport-layer information (for addressing modes which translate ports as well)
+    ctx->in_transport_payload_ptr = (out_packet_data->is_fragment ? NULL : out_packet_data->payload_ptr);
+    ctx->in_transport_payload_size = (out_packet_data->is_fragment ? 0 : out_packet_data->payload_size);
+    ctx->in_transport_protocol = out_ipv4_header->protocol;
+    ctx->is_out_transport_port_set = false;
+    ctx->is_out_transport_port_of_ipv4_host = false;
+
     // :: Source & destination IP address
     // NOTE: All header fields of the input packet (including any IPv4 options) have been validated at this point,
     //  except the source & destination IP address; therefore, after validating these two fields, the address
@@ -204,10 +217,8 @@ static bool _validate_and_translate_ip_header(tundra__thread_ctx *const ctx, _ou
         (uint8_t *) &out_ipv4_header->daddr
     )) return false;
 
-    // If the input IPv6 packet has a fragment header, it does not necessarily mean that the packet is fragmented -
-    //  it is possible for the fragment header to have both its offset and the more fragments bit set to zero, which
-    //  effectively means that the program has the whole, unfragmented packet on its hands.
-    out_packet_data->is_fragment = (bool) UTILS_IP__IS_IPV4_PACKET_FRAGMENTED_UNSAFE(out_ipv4_header);
+    // :: Hairpinning (the flag is cleared once the packet has been handled, see xlat.c)
+    ctx->is_hairpinning = (ctx->hairpin_packet != NULL && xlat_addr__is_hairpin_destination(ctx, (const uint8_t *) &out_ipv4_header->daddr));
 
     return true;
 }
@@ -236,12 +247,12 @@ static void _translate_icmpv6_payload_to_icmpv4_and_send(tundra__thread_ctx *con
         _appropriately_send_ipv4_packet(
             ctx, &out_packet_data->ipv4_header,
             NULL, 0,
-            out_message_data.message_start_36b, out_message_data.message_start_size_m8u
+            out_message_data.message_start_40b, out_message_data.message_start_size_m8u
         );
     else
         _appropriately_send_ipv4_packet(
             ctx, &out_packet_data->ipv4_header,
-            out_message_data.message_start_36b, out_message_data.message_start_size_m8u,
+            out_message_data.message_start_40b, out_message_data.message_start_size_m8u,
             out_message_data.nullable_message_end_ptr, out_message_data.zeroable_message_end_size
         );
 }
@@ -259,6 +270,7 @@ static void _translate_tcp_payload_and_send(const tundra__thread_ctx *const ctx,
                 (const struct ipv6hdr *) __builtin_assume_aligned(ctx->in_packet_buffer, 64),
                 &out_packet_data->ipv4_header
             );
+            _replace_tcp_udp_port_if_translated(ctx, &new_tcp_header->source, &new_tcp_header->dest, &new_tcp_header->check);
 
             _appropriately_send_ipv4_packet(
                 ctx, &out_packet_data->ipv4_header,
@@ -273,6 +285,7 @@ static void _translate_tcp_payload_and_send(const tundra__thread_ctx *const ctx,
                 (const struct ipv6hdr *) __builtin_assume_aligned(ctx->in_packet_buffer, 64),
                 &out_packet_data->ipv4_header
             );
+            _replace_tcp_udp_port_if_translated(ctx, &new_tcp_header->source, &new_tcp_header->dest, &new_tcp_header->check);
 
             _appropriately_send_ipv4_packet(
                 ctx, &out_packet_data->ipv4_header,
@@ -297,12 +310,14 @@ static void _translate_udp_payload_and_send(const tundra__thread_ctx *const ctx,
         if(new_udp_header.check == 0)
             return;
 
-        const uint16_t new_checksum = checksum__recalculate_checksum_6to4(
+        new_udp_header.check = checksum__recalculate_checksum_6to4(
             new_udp_header.check,
             (const struct ipv6hdr *) __builtin_assume_aligned(ctx->in_packet_buffer, 64),
             &out_packet_data->ipv4_header
         );
-        new_udp_header.check = (new_checksum == 0 ? 0xffff : new_checksum);
+        _replace_tcp_udp_port_if_translated(ctx, &new_udp_header.source, &new_udp_header.dest, &new_udp_header.check);
+        if(new_udp_header.check == 0)
+            new_udp_header.check = 0xffff;
 
         _appropriately_send_ipv4_packet(
             ctx, &out_packet_data->ipv4_header,
@@ -326,6 +341,17 @@ static void _translate_generic_payload_and_send(const tundra__thread_ctx *const
     );
 }
 
+// The source port is replaced if the addressing mode has translated it (e.g. 'nat64-stateful'), or the destination
+//  port if the translated port belongs to the IPv4 host (e.g. the 'clat' mode's NAT44)
+static void _replace_tcp_udp_port_if_translated(const tundra__thread_ctx *const ctx, uint16_t *source_port, uint16_t *dest_port, uint16_t *checksum) {
+    if(!ctx->is_out_transport_port_set)
+        return;
+
+    uint16_t *port = (ctx->is_out_transport_port_of_ipv4_host ? dest_port : source_port);
+    *checksum = checksum__recalculate_checksum_for_changed_16bit_word(*checksum, *port, ctx->out_transport_port);
+    *port = ctx->out_transport_port;
+}
+
 static void _appropriately_send_ipv4_packet(
     const tundra__thread_ctx *const ctx,
     struct iphdr *ipv4_header,
@@ -338,6 +364,15 @@ static void _appropriately_send_ipv4_packet(
     const uint16_t more_fragments = UTILS_IP__GET_IPV4_MORE_FRAGS(ipv4_header);
     const uint16_t fragment_offset = UTILS_IP__GET_IPV4_FRAG_OFFSET(ipv4_header);
 
+    if(ctx->is_hairpinning) {
+        // A hairpinned packet does not cross any IPv4 link, so it is neither fragmented, nor checked against the IPv4
+        //  MTU - the IPv6 MTU is enforced once it is translated back to IPv6
+        ipv4_header->frag_off = UTILS_IP__CONSTRUCT_IPV4_FRAG_OFFSET_AND_FLAGS((uint16_t) (total_packet_size > 1260), more_fragments, fragment_offset);
+
+        xlat_io__send_ipv4_packet(ctx, ipv4_header, nullable_payload1_ptr, zeroable_payload1_size_m8, payload2_ptr, payload2_size);
+        return;
+    }
+
     if(total_packet_size <= 1260) {
         ipv4_header->frag_off = UTILS_IP__CONSTRUCT_IPV4_FRAG_OFFSET_AND_FLAGS(0, more_fragments, fragment_offset);
 
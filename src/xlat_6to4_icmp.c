@@ -58,7 +58,7 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
     const struct icmp6hdr *in_icmpv6_header = (const struct icmp6hdr *) in_packet_payload_ptr;
     #pragma GCC diagnostic pop
 
-    struct icmphdr *out_icmpv4_header = (struct icmphdr *) __builtin_assume_aligned(out_message_data->message_start_36b, 64);
+    struct icmphdr *out_icmpv4_header = (struct icmphdr *) __builtin_assume_aligned(out_message_data->message_start_40b, 64);
     out_message_data->message_start_size_m8u = 8;
 
 
@@ -77,7 +77,7 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
         in_icmpv6_header->icmp6_type,
         in_icmpv6_header->icmp6_code,
         (in_packet_payload_ptr + 4),
-        (out_message_data->message_start_36b + 4)
+        (out_message_data->message_start_40b + 4)
     )) return false;
 
 
@@ -86,6 +86,10 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
     const size_t in_icmpv6_payload_size = (in_packet_payload_size - 8);
 
     if(in_icmpv6_header->icmp6_type == 128 || in_icmpv6_header->icmp6_type == 129) { // Echo Request, Echo Reply
+        // The identifier is replaced if the addressing mode has translated it (e.g. 'nat64-stateful')
+        if(ctx->is_out_transport_port_set)
+            memcpy(out_message_data->message_start_40b + 4, &ctx->out_transport_port, 2);
+
         out_message_data->nullable_message_end_ptr = in_icmpv6_payload_ptr;
         out_message_data->zeroable_message_end_size = in_icmpv6_payload_size;
     } else { // ICMP Error message
@@ -94,7 +98,7 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
             ctx,
             in_icmpv6_payload_ptr,
             in_icmpv6_payload_size,
-            (out_message_data->message_start_36b + 8),
+            (out_message_data->message_start_40b + 8),
             &out_packet_in_error_data,
             (bool) (in_icmpv6_header->icmp6_type == 2) // "Packet too big" -> "Fragmentation Needed and DF was Set" (it literally says that DF must be set)
         )) return false;
@@ -107,9 +111,9 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
                 return false;
 
             // WARNING: Only the first 4 bytes (fields type, code, checksum) are set and therefore accessible!!!
-            // Since 'out_message_data->message_start_36b' is always 64-byte aligned, it can be assumed, that if the
+            // Since 'out_message_data->message_start_40b' is always 64-byte aligned, it can be assumed, that if the
             //  pointer is moved 28 bytes forward, the resulting pointer will always be (only) 4-byte aligned.
-            struct icmphdr *new_icmpv4_packet_in_error_payload_ptr = (struct icmphdr *) __builtin_assume_aligned(out_message_data->message_start_36b + 28, 4);
+            struct icmphdr *new_icmpv4_packet_in_error_payload_ptr = (struct icmphdr *) __builtin_assume_aligned(out_message_data->message_start_40b + 28, 4);
             memcpy(new_icmpv4_packet_in_error_payload_ptr, out_packet_in_error_data.payload_ptr, 4);
             out_message_data->message_start_size_m8u += 4; // Always 32 bytes -> aligned to 8
 
@@ -132,17 +136,43 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
             else
                 return false;
 
-            // The first 4 bytes of the payload are in the message start buffer (due to alignment).
-            out_message_data->nullable_message_end_ptr = (out_packet_in_error_data.payload_ptr + 4);
-            out_message_data->zeroable_message_end_size = (out_packet_in_error_data.payload_size - 4);
+            if(ctx->is_out_transport_port_set) {
+                // The packet in error was sent from the translated identifier (e.g. by the 'clat' mode's NAT44) - it
+                //  is replaced, so the first 12 bytes of the payload (or all of it) are put into the message start
+                //  buffer instead, which keeps its size a multiple of 8
+                if(out_packet_in_error_data.payload_size >= 12) {
+                    memcpy(out_message_data->message_start_40b + 28 + 4, out_packet_in_error_data.payload_ptr + 4, 8);
+                    out_message_data->message_start_size_m8u += 8; // Always 40 bytes -> aligned to 8
+
+                    out_message_data->nullable_message_end_ptr = (out_packet_in_error_data.payload_ptr + 12);
+                    out_message_data->zeroable_message_end_size = (out_packet_in_error_data.payload_size - 12);
+                } else {
+                    memcpy(out_message_data->message_start_40b + 28 + 4, out_packet_in_error_data.payload_ptr + 4, out_packet_in_error_data.payload_size - 4);
+                    out_message_data->message_start_size_m8u += (out_packet_in_error_data.payload_size - 4); // Not aligned to 8, but it does not matter since 'nullable_message_end_ptr' is NULL.
+
+                    out_message_data->nullable_message_end_ptr = NULL;
+                    out_message_data->zeroable_message_end_size = 0;
+                }
+                memcpy(out_message_data->message_start_40b + 28 + 4, &ctx->out_transport_port, 2);
+            } else {
+                // The first 4 bytes of the payload are in the message start buffer (due to alignment).
+                out_message_data->nullable_message_end_ptr = (out_packet_in_error_data.payload_ptr + 4);
+                out_message_data->zeroable_message_end_size = (out_packet_in_error_data.payload_size - 4);
+            }
         } else if(out_packet_in_error_data.payload_size >= 4) { // All other transport protocols - payload at least 4 bytes in size
-            memcpy(out_message_data->message_start_36b + 28, out_packet_in_error_data.payload_ptr, 4);
+            memcpy(out_message_data->message_start_40b + 28, out_packet_in_error_data.payload_ptr, 4);
             out_message_data->message_start_size_m8u += 4; // Always 32 bytes -> aligned to 8
 
+            // The packet in error was sent to the translated TCP/UDP port - its destination port is replaced, or its
+            //  source port if the translated port belongs to the IPv4 host (the packet in error's own checksum cannot
+            //  be fixed, as the packet is usually truncated)
+            if(ctx->is_out_transport_port_set)
+                memcpy(out_message_data->message_start_40b + 28 + (ctx->is_out_transport_port_of_ipv4_host ? 0 : 2), &ctx->out_transport_port, 2);
+
             out_message_data->nullable_message_end_ptr = (out_packet_in_error_data.payload_ptr + 4);
             out_message_data->zeroable_message_end_size = (out_packet_in_error_data.payload_size - 4);
         } else { // All other transport protocols - payload less than 4 bytes in size
-            memcpy(out_message_data->message_start_36b + 28, out_packet_in_error_data.payload_ptr, out_packet_in_error_data.payload_size);
+            memcpy(out_message_data->message_start_40b + 28, out_packet_in_error_data.payload_ptr, out_packet_in_error_data.payload_size);
             out_message_data->message_start_size_m8u += out_packet_in_error_data.payload_size; // Not always aligned to 8, but it does not matter since 'nullable_message_end_ptr' is NULL.
 
             out_message_data->nullable_message_end_ptr = NULL;
@@ -160,7 +190,7 @@ bool xlat_6to4_icmp__translate_icmpv6_to_icmpv4(tundra__thread_ctx *const ctx, c
     // :: Checksum
     out_icmpv4_header->checksum = 0;
     out_icmpv4_header->checksum = checksum__calculate_checksum_ipv4(
-        out_message_data->message_start_36b,
+        out_message_data->message_start_40b,
         out_message_data->message_start_size_m8u,
         out_message_data->nullable_message_end_ptr,
         out_message_data->zeroable_message_end_size,
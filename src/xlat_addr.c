@@ -27,6 +27,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"xlat_addr_clat.h"
 #include"xlat_addr_siit.h"
 #include"xlat_addr_external.h"
+#include"xlat_addr_plugin.h"
+#include"xlat_addr_bpf.h"
+#include"xlat_addr_nat64_stateful.h"
+#include"xlat_addr_map_t.h"
 
 
 bool xlat_addr__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
@@ -45,6 +49,18 @@ bool xlat_addr__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ct
         case TUNDRA__ADDRESSING_MODE_EXTERNAL:
             return xlat_addr_external__translate_4to6_addr_for_main_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
 
+        case TUNDRA__ADDRESSING_MODE_PLUGIN:
+            return xlat_addr_plugin__translate_4to6_addr_for_main_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+        case TUNDRA__ADDRESSING_MODE_BPF:
+            return xlat_addr_bpf__translate_4to6_addr_for_main_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+        case TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL:
+            return xlat_addr_nat64_stateful__translate_4to6_addr_for_main_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+        case TUNDRA__ADDRESSING_MODE_MAP_T:
+            return xlat_addr_map_t__translate_4to6_addr_for_main_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
         default:
             log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid addressing mode");
     }
@@ -66,6 +82,18 @@ bool xlat_addr__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *co
         case TUNDRA__ADDRESSING_MODE_EXTERNAL:
             return xlat_addr_external__translate_4to6_addr_for_icmp_error_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
 
+        case TUNDRA__ADDRESSING_MODE_PLUGIN:
+            return xlat_addr_plugin__translate_4to6_addr_for_icmp_error_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+        case TUNDRA__ADDRESSING_MODE_BPF:
+            return xlat_addr_bpf__translate_4to6_addr_for_icmp_error_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+        case TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL:
+            return xlat_addr_nat64_stateful__translate_4to6_addr_for_icmp_error_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+        case TUNDRA__ADDRESSING_MODE_MAP_T:
+            return xlat_addr_map_t__translate_4to6_addr_for_icmp_error_packet(ctx, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
         default:
             log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid addressing mode");
     }
@@ -87,6 +115,18 @@ bool xlat_addr__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ct
         case TUNDRA__ADDRESSING_MODE_EXTERNAL:
             return xlat_addr_external__translate_6to4_addr_for_main_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
 
+        case TUNDRA__ADDRESSING_MODE_PLUGIN:
+            return xlat_addr_plugin__translate_6to4_addr_for_main_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_BPF:
+            return xlat_addr_bpf__translate_6to4_addr_for_main_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL:
+            return xlat_addr_nat64_stateful__translate_6to4_addr_for_main_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_MAP_T:
+            return xlat_addr_map_t__translate_6to4_addr_for_main_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
         default:
             log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid addressing mode");
     }
@@ -108,6 +148,43 @@ bool xlat_addr__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *co
         case TUNDRA__ADDRESSING_MODE_EXTERNAL:
             return xlat_addr_external__translate_6to4_addr_for_icmp_error_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
 
+        case TUNDRA__ADDRESSING_MODE_PLUGIN:
+            return xlat_addr_plugin__translate_6to4_addr_for_icmp_error_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_BPF:
+            return xlat_addr_bpf__translate_6to4_addr_for_icmp_error_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL:
+            return xlat_addr_nat64_stateful__translate_6to4_addr_for_icmp_error_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_MAP_T:
+            return xlat_addr_map_t__translate_6to4_addr_for_icmp_error_packet(ctx, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+        default:
+            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid addressing mode");
+    }
+}
+
+// Whether an IPv4 address, to which a packet translated from IPv6 is destined, is represented by the translator itself,
+//  i.e. the packet would be routed back to it by the kernel
+bool xlat_addr__is_hairpin_destination(const tundra__thread_ctx *const ctx, const uint8_t *ipv4) {
+    switch(ctx->config->addressing_mode) {
+        case TUNDRA__ADDRESSING_MODE_SIIT:
+            return xlat_addr_siit__is_hairpin_destination(ctx, ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_NAT64_STATEFUL:
+            return xlat_addr_nat64_stateful__is_hairpin_destination(ctx, ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_MAP_T:
+            return xlat_addr_map_t__is_hairpin_destination(ctx, ipv4);
+
+        case TUNDRA__ADDRESSING_MODE_NAT64:
+        case TUNDRA__ADDRESSING_MODE_CLAT:
+        case TUNDRA__ADDRESSING_MODE_EXTERNAL:
+        case TUNDRA__ADDRESSING_MODE_PLUGIN:
+        case TUNDRA__ADDRESSING_MODE_BPF:
+            return false;
+
         default:
             log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid addressing mode");
     }
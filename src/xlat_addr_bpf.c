@@ -0,0 +1,266 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_bpf.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"log.h"
+#include"xlat_addr_bpf_vm.h"
+#include"xlat_addr_bpf_map.h"
+
+
+#define _ERROR_MESSAGE_SIZE ((size_t) 512)
+#define _VERIFIER_ERROR_MESSAGE_SIZE ((size_t) 256)
+
+
+static tundra__bpf_addr_xlat_image *_load_image(const tundra__conf_file *const file_config, char *error_message, const size_t error_message_size);
+static bool _load_program(tundra__bpf_addr_xlat_image *image, const char *const program_file_path, char *error_message, const size_t error_message_size);
+static void _free_image(tundra__bpf_addr_xlat_image *image);
+static inline tundra__bpf_addr_xlat_image *_get_up_to_date_image(tundra__thread_ctx *const ctx);
+static bool _run_program(tundra__thread_ctx *const ctx, const uint32_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const size_t in_ip_size, uint8_t *out_src_ip, uint8_t *out_dst_ip, const size_t out_ip_size);
+static bool _are_addrs_usable(tundra__thread_ctx *const ctx, const uint8_t *src_ip, const uint8_t *dst_ip, const size_t ip_size);
+
+
+// This function must be called before the program's working directory is changed and its privileges are dropped.
+tundra__bpf_addr_xlat_state *xlat_addr_bpf__create_state(const tundra__conf_file *const file_config) {
+    char error_message[_ERROR_MESSAGE_SIZE];
+    tundra__bpf_addr_xlat_image *image = _load_image(file_config, error_message, _ERROR_MESSAGE_SIZE);
+    if(image == NULL)
+        log__crash(false, "%s", error_message);
+
+    tundra__bpf_addr_xlat_state *bpf_addr_xlat_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__bpf_addr_xlat_state));
+    if(pthread_mutex_init(&bpf_addr_xlat_state->mutex, NULL) != 0)
+        exit(TUNDRA__EXIT_MUTEX_FAILURE);
+
+    bpf_addr_xlat_state->current_image = image;  // The state holds a reference to its current image
+    bpf_addr_xlat_state->generation = 0;
+
+    log__info("The eBPF address translation program '%s' (%zu instructions, %zu maps) has been loaded.", file_config->addressing_bpf_program_file, image->instruction_count, image->map_count);
+
+    return bpf_addr_xlat_state;
+}
+
+// This function must be called after all the translator threads have been terminated and have released their images!
+void xlat_addr_bpf__free_state(tundra__bpf_addr_xlat_state *bpf_addr_xlat_state) {
+    xlat_addr_bpf__release_image(bpf_addr_xlat_state, bpf_addr_xlat_state->current_image);
+
+    pthread_mutex_destroy(&bpf_addr_xlat_state->mutex);
+
+    utils__free_memory(bpf_addr_xlat_state);
+}
+
+/*
+ * Loads the program and its maps from the configured files again, and makes the translator threads switch to them
+ * without interrupting the translation (in an RCU-like manner): the new image is published by incrementing the
+ * generation counter, which each thread checks before running the program, and the old image is freed once the last
+ * thread has stopped using it. If the files cannot be loaded, the current image stays in use.
+ * Keep in mind that the files are re-read after the program's working directory has been changed and its privileges
+ * have been dropped.
+ */
+void xlat_addr_bpf__reload(const tundra__conf_file *const file_config, tundra__bpf_addr_xlat_state *bpf_addr_xlat_state) {
+    char error_message[_ERROR_MESSAGE_SIZE];
+    tundra__bpf_addr_xlat_image *new_image = _load_image(file_config, error_message, _ERROR_MESSAGE_SIZE);
+    if(new_image == NULL) {
+        log__info("Failed to reload the eBPF address translation program (the current one stays in use): %s", error_message);
+        return;
+    }
+
+    pthread_mutex_lock(&bpf_addr_xlat_state->mutex);
+    tundra__bpf_addr_xlat_image *old_image = bpf_addr_xlat_state->current_image;
+    bpf_addr_xlat_state->current_image = new_image;
+    __atomic_store_n(&bpf_addr_xlat_state->generation, bpf_addr_xlat_state->generation + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&bpf_addr_xlat_state->mutex);
+
+    xlat_addr_bpf__release_image(bpf_addr_xlat_state, old_image);
+
+    log__info("The eBPF address translation program '%s' (%zu instructions, %zu maps) has been reloaded.", file_config->addressing_bpf_program_file, new_image->instruction_count, new_image->map_count);
+}
+
+tundra__bpf_addr_xlat_image *xlat_addr_bpf__acquire_current_image(tundra__bpf_addr_xlat_state *bpf_addr_xlat_state, uint32_t *out_generation) {
+    pthread_mutex_lock(&bpf_addr_xlat_state->mutex);
+
+    tundra__bpf_addr_xlat_image *image = bpf_addr_xlat_state->current_image;
+    image->reference_count++;
+    *out_generation = bpf_addr_xlat_state->generation;
+
+    pthread_mutex_unlock(&bpf_addr_xlat_state->mutex);
+
+    return image;
+}
+
+void xlat_addr_bpf__release_image(tundra__bpf_addr_xlat_state *bpf_addr_xlat_state, tundra__bpf_addr_xlat_image *image) {
+    pthread_mutex_lock(&bpf_addr_xlat_state->mutex);
+    const bool is_image_unused = (--image->reference_count == 0);
+    pthread_mutex_unlock(&bpf_addr_xlat_state->mutex);
+
+    if(is_image_unused)
+        _free_image(image);
+}
+
+static tundra__bpf_addr_xlat_image *_load_image(const tundra__conf_file *const file_config, char *error_message, const size_t error_message_size) {
+    tundra__bpf_addr_xlat_image *image = utils__alloc_zeroed_out_memory(1, sizeof(tundra__bpf_addr_xlat_image));
+    image->reference_count = 1;
+
+    if(!_load_program(image, file_config->addressing_bpf_program_file, error_message, error_message_size)) {
+        _free_image(image);
+        return NULL;
+    }
+
+    for(size_t i = 0; i < file_config->addressing_bpf_map_count; i++) {
+        if(!xlat_addr_bpf_map__load(image->maps + i, file_config->addressing_bpf_map_files[i], error_message, error_message_size)) {
+            _free_image(image);
+            return NULL;
+        }
+
+        image->map_count++;
+    }
+
+    return image;
+}
+
+// The program file contains raw eBPF instructions in little-endian byte order (e.g. the '.text' section extracted from
+//  an object file compiled using 'clang -target bpf').
+static bool _load_program(tundra__bpf_addr_xlat_image *image, const char *const program_file_path, char *error_message, const size_t error_message_size) {
+    size_t file_size = 0;
+    uint8_t *file_data = utils__read_whole_file(program_file_path, &file_size);
+    if(file_data == NULL) {
+        snprintf(error_message, error_message_size, "Failed to read the eBPF program file '%s': %s", program_file_path, strerror(errno));
+        return false;
+    }
+
+    if(file_size == 0 || (file_size % sizeof(tundra__bpf_instruction)) != 0) {
+        snprintf(error_message, error_message_size, "The size of the eBPF program file '%s' is not a (non-zero) multiple of %zu bytes!", program_file_path, sizeof(tundra__bpf_instruction));
+        utils__free_memory(file_data);
+        return false;
+    }
+
+    image->instruction_count = (file_size / sizeof(tundra__bpf_instruction));
+    image->instructions = utils__alloc_zeroed_out_memory(image->instruction_count, sizeof(tundra__bpf_instruction));
+
+    for(size_t i = 0; i < image->instruction_count; i++) {
+        const uint8_t *raw_instruction = file_data + (i * sizeof(tundra__bpf_instruction));
+        uint16_t raw_offset;
+        uint32_t raw_immediate;
+        memcpy(&raw_offset, raw_instruction + 2, 2);
+        memcpy(&raw_immediate, raw_instruction + 4, 4);
+
+        // In the little-endian encoding, the destination register occupies the lower 4 bits of the second byte
+        image->instructions[i].opcode = raw_instruction[0];
+        image->instructions[i].registers = raw_instruction[1];
+        image->instructions[i].offset = (int16_t) le16toh(raw_offset);
+        image->instructions[i].immediate = (int32_t) le32toh(raw_immediate);
+    }
+
+    utils__free_memory(file_data);
+
+    char verifier_error_message[_VERIFIER_ERROR_MESSAGE_SIZE];
+    if(!xlat_addr_bpf_vm__verify_program(image->instructions, image->instruction_count, verifier_error_message, _VERIFIER_ERROR_MESSAGE_SIZE)) {
+        snprintf(error_message, error_message_size, "The eBPF program file '%s' has been rejected: %s", program_file_path, verifier_error_message);
+        return false;
+    }
+
+    return true;
+}
+
+static void _free_image(tundra__bpf_addr_xlat_image *image) {
+    if(image->instructions != NULL)
+        utils__free_memory(image->instructions);
+
+    for(size_t i = 0; i < image->map_count; i++)
+        xlat_addr_bpf_map__free(image->maps + i);
+
+    utils__free_memory(image);
+}
+
+bool xlat_addr_bpf__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    return (
+        _are_addrs_usable(ctx, in_src_ipv4, in_dst_ipv4, 4) &&
+        _run_program(ctx, XLAT_ADDR_BPF__MESSAGE_TYPE_4TO6_MAIN_PACKET, in_src_ipv4, in_dst_ipv4, 4, out_src_ipv6, out_dst_ipv6, 16) &&
+        _are_addrs_usable(ctx, out_src_ipv6, out_dst_ipv6, 16)
+    );
+}
+
+// The addresses of partial packets inside ICMP error messages' bodies are not checked, as they may be arbitrary
+bool xlat_addr_bpf__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    return _run_program(ctx, XLAT_ADDR_BPF__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET, in_src_ipv4, in_dst_ipv4, 4, out_src_ipv6, out_dst_ipv6, 16);
+}
+
+bool xlat_addr_bpf__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    return (
+        _are_addrs_usable(ctx, in_src_ipv6, in_dst_ipv6, 16) &&
+        _run_program(ctx, XLAT_ADDR_BPF__MESSAGE_TYPE_6TO4_MAIN_PACKET, in_src_ipv6, in_dst_ipv6, 16, out_src_ipv4, out_dst_ipv4, 4) &&
+        _are_addrs_usable(ctx, out_src_ipv4, out_dst_ipv4, 4)
+    );
+}
+
+// The addresses of partial packets inside ICMP error messages' bodies are not checked, as they may be arbitrary
+bool xlat_addr_bpf__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    return _run_program(ctx, XLAT_ADDR_BPF__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET, in_src_ipv6, in_dst_ipv6, 16, out_src_ipv4, out_dst_ipv4, 4);
+}
+
+// Switches the thread to the current image if a newer one has been published; the generation counter is read without
+//  locking the mutex, so in the common case (no reload has happened), this costs just a single atomic load.
+static inline tundra__bpf_addr_xlat_image *_get_up_to_date_image(tundra__thread_ctx *const ctx) {
+    if(__atomic_load_n(&ctx->bpf_addr_xlat_state->generation, __ATOMIC_ACQUIRE) != ctx->bpf_addr_xlat_image_generation) {
+        xlat_addr_bpf__release_image(ctx->bpf_addr_xlat_state, ctx->bpf_addr_xlat_image);
+        ctx->bpf_addr_xlat_image = xlat_addr_bpf__acquire_current_image(ctx->bpf_addr_xlat_state, &ctx->bpf_addr_xlat_image_generation);
+    }
+
+    return ctx->bpf_addr_xlat_image;
+}
+
+static bool _run_program(tundra__thread_ctx *const ctx, const uint32_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const size_t in_ip_size, uint8_t *out_src_ip, uint8_t *out_dst_ip, const size_t out_ip_size) {
+    tundra__bpf_addr_xlat_program_ctx program_ctx;
+    UTILS__MEM_ZERO_OUT(&program_ctx, sizeof(tundra__bpf_addr_xlat_program_ctx));
+    memcpy(program_ctx.in_src_ip, in_src_ip, in_ip_size);
+    memcpy(program_ctx.in_dst_ip, in_dst_ip, in_ip_size);
+    program_ctx.message_type = message_type;
+    program_ctx.thread_id = (uint32_t) ctx->thread_id;
+
+    uint64_t return_value = 0;
+    if(!xlat_addr_bpf_vm__run_program(_get_up_to_date_image(ctx), &program_ctx, &return_value) || return_value != XLAT_ADDR_BPF__PROGRAM_RESULT_TRANSLATE)
+        return false;
+
+    memcpy(out_src_ip, program_ctx.out_src_ip, out_ip_size);
+    memcpy(out_dst_ip, program_ctx.out_dst_ip, out_ip_size);
+
+    return true;
+}
+
+static bool _are_addrs_usable(tundra__thread_ctx *const ctx, const uint8_t *src_ip, const uint8_t *dst_ip, const size_t ip_size) {
+    if(ip_size == 4) {
+        return !(
+            utils_ip__is_ipv4_addr_unusable(src_ip) || UTILS_IP__IPV4_ADDR_EQ(src_ip, ctx->config->router_ipv4) ||
+            utils_ip__is_ipv4_addr_unusable(dst_ip) || UTILS_IP__IPV4_ADDR_EQ(dst_ip, ctx->config->router_ipv4)
+        );
+    }
+
+    return !(
+        utils_ip__is_ipv6_addr_unusable(src_ip) || UTILS_IP__IPV6_ADDR_EQ(src_ip, ctx->config->router_ipv6) ||
+        utils_ip__is_ipv6_addr_unusable(dst_ip) || UTILS_IP__IPV6_ADDR_EQ(dst_ip, ctx->config->router_ipv6)
+    );
+}
+
+
+#undef _ERROR_MESSAGE_SIZE
+#undef _VERIFIER_ERROR_MESSAGE_SIZE
@@ -0,0 +1,43 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+// The same values as in the external address translation protocol are used
+#define XLAT_ADDR_BPF__MESSAGE_TYPE_4TO6_MAIN_PACKET ((uint32_t) 1)
+#define XLAT_ADDR_BPF__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET ((uint32_t) 2)
+#define XLAT_ADDR_BPF__MESSAGE_TYPE_6TO4_MAIN_PACKET ((uint32_t) 3)
+#define XLAT_ADDR_BPF__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET ((uint32_t) 4)
+
+#define XLAT_ADDR_BPF__PROGRAM_RESULT_TRANSLATE ((uint64_t) 1)  // Any other value makes the packet be dropped
+
+
+extern tundra__bpf_addr_xlat_state *xlat_addr_bpf__create_state(const tundra__conf_file *const file_config);
+extern void xlat_addr_bpf__free_state(tundra__bpf_addr_xlat_state *bpf_addr_xlat_state);
+extern void xlat_addr_bpf__reload(const tundra__conf_file *const file_config, tundra__bpf_addr_xlat_state *bpf_addr_xlat_state);
+extern tundra__bpf_addr_xlat_image *xlat_addr_bpf__acquire_current_image(tundra__bpf_addr_xlat_state *bpf_addr_xlat_state, uint32_t *out_generation);
+extern void xlat_addr_bpf__release_image(tundra__bpf_addr_xlat_state *bpf_addr_xlat_state, tundra__bpf_addr_xlat_image *image);
+extern bool xlat_addr_bpf__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+extern bool xlat_addr_bpf__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+extern bool xlat_addr_bpf__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+extern bool xlat_addr_bpf__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
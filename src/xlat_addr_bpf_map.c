@@ -0,0 +1,138 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_bpf_map.h"
+
+#include"utils.h"
+
+
+#define _MAP_FILE_MAGIC ((const uint8_t *) "TBPM")
+#define _MAP_FILE_VERSION ((uint8_t) 1)
+
+
+static bool _parse_map_file(tundra__bpf_addr_xlat_map *map, const uint8_t *file_data, const size_t file_size, const char *const map_file_path, char *error_message, const size_t error_message_size);
+static int _compare_map_entries(const void *entry1, const void *entry2, void *key_size);
+
+
+// On failure, the map is left empty, and a description of the error is written to 'error_message'. Unlike most of the
+//  program's initialization functions, this one does not crash on failure, as maps are also (re)loaded at runtime.
+bool xlat_addr_bpf_map__load(tundra__bpf_addr_xlat_map *map, const char *const map_file_path, char *error_message, const size_t error_message_size) {
+    UTILS__MEM_ZERO_OUT(map, sizeof(tundra__bpf_addr_xlat_map));
+
+    size_t file_size = 0;
+    uint8_t *file_data = utils__read_whole_file(map_file_path, &file_size);
+    if(file_data == NULL) {
+        snprintf(error_message, error_message_size, "Failed to read the eBPF map file '%s': %s", map_file_path, strerror(errno));
+        return false;
+    }
+
+    const bool was_map_parsed = _parse_map_file(map, file_data, file_size, map_file_path, error_message, error_message_size);
+    utils__free_memory(file_data);
+
+    return was_map_parsed;
+}
+
+void xlat_addr_bpf_map__free(tundra__bpf_addr_xlat_map *map) {
+    if(map->entries != NULL)
+        utils__free_memory(map->entries);
+
+    UTILS__MEM_ZERO_OUT(map, sizeof(tundra__bpf_addr_xlat_map));
+}
+
+// Returns a pointer to the value associated with 'key' (which has to be 'map->key_size' bytes long), or NULL if the map
+//  does not contain the key.
+const uint8_t *xlat_addr_bpf_map__lookup(const tundra__bpf_addr_xlat_map *map, const uint8_t *key) {
+    const size_t entry_size = (map->key_size + map->value_size);
+    size_t low = 0;
+    size_t high = map->entry_count;
+
+    while(low < high) {
+        const size_t middle = low + ((high - low) / 2);
+        const uint8_t *entry = map->entries + (middle * entry_size);
+
+        const int comparison_result = memcmp(key, entry, map->key_size);
+        if(comparison_result == 0)
+            return (entry + map->key_size);
+
+        if(comparison_result < 0)
+            high = middle;
+        else
+            low = (middle + 1);
+    }
+
+    return NULL;
+}
+
+static bool _parse_map_file(tundra__bpf_addr_xlat_map *map, const uint8_t *file_data, const size_t file_size, const char *const map_file_path, char *error_message, const size_t error_message_size) {
+    const tundra__bpf_addr_xlat_map_file_header *header = (const tundra__bpf_addr_xlat_map_file_header *) file_data;
+    if(
+        file_size < sizeof(tundra__bpf_addr_xlat_map_file_header) ||
+        !UTILS__MEM_EQ(header->magic, _MAP_FILE_MAGIC, 4) || header->version != _MAP_FILE_VERSION
+    ) {
+        snprintf(error_message, error_message_size, "The eBPF map file '%s' is not a valid map file!", map_file_path);
+        return false;
+    }
+
+    const uint32_t key_size = ntohl(header->key_size);
+    const uint32_t value_size = ntohl(header->value_size);
+    const uint32_t entry_count = ntohl(header->entry_count);
+    if(key_size < 1 || key_size > TUNDRA__MAX_ADDRESSING_BPF_MAP_KEY_SIZE || value_size < 1 || value_size > TUNDRA__MAX_ADDRESSING_BPF_MAP_VALUE_SIZE || entry_count > TUNDRA__MAX_ADDRESSING_BPF_MAP_ENTRIES) {
+        snprintf(error_message, error_message_size, "The eBPF map file '%s' has an invalid key size, value size or entry count!", map_file_path);
+        return false;
+    }
+
+    // The sizes are limited, so this cannot overflow
+    const size_t entry_size = ((size_t) key_size + (size_t) value_size);
+    const size_t entries_size = (entry_size * (size_t) entry_count);
+    if((file_size - sizeof(tundra__bpf_addr_xlat_map_file_header)) != entries_size) {
+        snprintf(error_message, error_message_size, "The size of the eBPF map file '%s' does not match its entry count!", map_file_path);
+        return false;
+    }
+
+    map->key_size = (size_t) key_size;
+    map->value_size = (size_t) value_size;
+    map->entry_count = (size_t) entry_count;
+    map->entries = utils__alloc_zeroed_out_memory((entries_size > 0 ? entries_size : 1), sizeof(uint8_t));
+    memcpy(map->entries, file_data + sizeof(tundra__bpf_addr_xlat_map_file_header), entries_size);
+
+    // The entries are sorted, so that they can be looked up using binary search (the maps are read-only, so there is no
+    //  need for anything more sophisticated)
+    qsort_r(map->entries, map->entry_count, entry_size, _compare_map_entries, &map->key_size);
+
+    for(size_t i = 1; i < map->entry_count; i++) {
+        if(memcmp(map->entries + ((i - 1) * entry_size), map->entries + (i * entry_size), map->key_size) == 0) {
+            snprintf(error_message, error_message_size, "The eBPF map file '%s' contains duplicate keys!", map_file_path);
+            xlat_addr_bpf_map__free(map);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int _compare_map_entries(const void *entry1, const void *entry2, void *key_size) {
+    return memcmp(entry1, entry2, *((const size_t *) key_size));
+}
+
+
+#undef _MAP_FILE_MAGIC
+#undef _MAP_FILE_VERSION
@@ -0,0 +1,501 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_bpf_vm.h"
+
+#include"utils.h"
+#include"xlat_addr_bpf_map.h"
+
+
+/*
+ * An interpreter of the eBPF instruction set (as specified by RFC 9669), which is used to run address translation
+ * programs supplied by the user. Only the instructions which make sense for the programs are supported (e.g. the
+ * legacy packet access instructions, atomic operations and function calls within the program are not).
+ *
+ * Since the programs are not trusted, the interpreter is "sandboxed": the program is checked when it is loaded (the
+ * register numbers, opcodes and jump targets), and every memory access is checked at runtime, so that the program can
+ * only access the context, its stack, and the values stored in maps (read-only). The number of executed instructions
+ * is limited as well, so that the program always terminates. If any of the runtime checks fails, the program is
+ * aborted (and the packet which is being translated is dropped).
+ */
+
+
+#define _CLASS(opcode) ((opcode) & 0x07)
+#define _CLASS_LD ((uint8_t) 0x00)
+#define _CLASS_LDX ((uint8_t) 0x01)
+#define _CLASS_ST ((uint8_t) 0x02)
+#define _CLASS_STX ((uint8_t) 0x03)
+#define _CLASS_ALU ((uint8_t) 0x04)
+#define _CLASS_JMP ((uint8_t) 0x05)
+#define _CLASS_JMP32 ((uint8_t) 0x06)
+#define _CLASS_ALU64 ((uint8_t) 0x07)
+
+#define _OPERATION(opcode) ((opcode) & 0xf0)
+#define _SOURCE_REGISTER_FLAG ((uint8_t) 0x08)
+#define _LD_IMM64_OPCODE ((uint8_t) 0x18)
+#define _MEM_MODE_MASK ((uint8_t) 0xe0)
+#define _MEM_MODE_MEM ((uint8_t) 0x60)
+
+#define _DST_REGISTER(instruction) ((instruction)->registers & 0x0f)
+#define _SRC_REGISTER(instruction) ((instruction)->registers >> 4)
+#define _FRAME_POINTER_REGISTER ((uint8_t) 10)
+
+#define _DST registers[_DST_REGISTER(instruction)]
+#define _SRC registers[_SRC_REGISTER(instruction)]
+#define _IMM ((uint64_t) (int64_t) instruction->immediate)  // Sign-extended to 64 bits
+#define _IMM32 ((uint32_t) instruction->immediate)
+#define _JUMP_IF(condition) { if(condition) pc = (size_t) ((int64_t) pc + (int64_t) instruction->offset); } break
+
+
+typedef struct _memory_regions {
+    const tundra__bpf_addr_xlat_image *image;
+    uint8_t *ctx;
+    uint8_t *stack;
+} _memory_regions;
+
+
+static bool _verify_alu_instruction(const tundra__bpf_instruction *instruction);
+static bool _verify_jmp_instruction(const tundra__bpf_instruction *instruction);
+static bool _verify_memory_instruction(const tundra__bpf_instruction *instruction);
+static inline uint8_t *_get_accessible_memory(const _memory_regions *regions, const uint64_t address, const size_t size, const bool is_write);
+static inline bool _is_address_in_region(const uint64_t address, const size_t size, const uint8_t *region, const size_t region_size);
+static inline bool _load(const _memory_regions *regions, const uint64_t address, const size_t size, uint64_t *out_value);
+static inline bool _store(const _memory_regions *regions, const uint64_t address, const size_t size, const uint64_t value);
+static inline bool _call_helper(const _memory_regions *regions, const int32_t helper, uint64_t *registers);
+
+
+bool xlat_addr_bpf_vm__verify_program(const tundra__bpf_instruction *instructions, const size_t instruction_count, char *error_message, const size_t error_message_size) {
+    if(instruction_count < 1 || instruction_count > TUNDRA__MAX_ADDRESSING_BPF_PROGRAM_INSTRUCTIONS) {
+        snprintf(error_message, error_message_size, "The eBPF program must contain between 1 and %zu instructions!", TUNDRA__MAX_ADDRESSING_BPF_PROGRAM_INSTRUCTIONS);
+        return false;
+    }
+
+    // Jumps must not land in the middle of a 64-bit immediate load, which occupies two instruction slots
+    bool *is_second_slot = utils__alloc_zeroed_out_memory(instruction_count, sizeof(bool));
+    for(size_t pc = 0; pc < instruction_count; pc++) {
+        if(instructions[pc].opcode == _LD_IMM64_OPCODE && (pc + 1) < instruction_count)  // A truncated load is detected below
+            is_second_slot[++pc] = true;
+    }
+
+    for(size_t pc = 0; pc < instruction_count; pc++) {
+        const tundra__bpf_instruction *instruction = instructions + pc;
+        bool is_valid = false;
+
+        if(_DST_REGISTER(instruction) > _FRAME_POINTER_REGISTER || _SRC_REGISTER(instruction) > _FRAME_POINTER_REGISTER) {
+            snprintf(error_message, error_message_size, "The eBPF program's instruction #%zu uses an invalid register!", pc);
+            utils__free_memory(is_second_slot);
+            return false;
+        }
+
+        switch(_CLASS(instruction->opcode)) {
+            case _CLASS_ALU: case _CLASS_ALU64:
+                is_valid = _verify_alu_instruction(instruction);
+                break;
+
+            case _CLASS_JMP: case _CLASS_JMP32:
+                is_valid = _verify_jmp_instruction(instruction);
+                if(is_valid && _OPERATION(instruction->opcode) != 0x80 && _OPERATION(instruction->opcode) != 0x90) {  // Neither CALL nor EXIT
+                    const int64_t target = ((int64_t) pc + 1 + (int64_t) instruction->offset);
+                    is_valid = (target >= 0 && target < (int64_t) instruction_count && !is_second_slot[target]);
+                }
+                break;
+
+            case _CLASS_LD:
+                is_valid = (
+                    instruction->opcode == _LD_IMM64_OPCODE && _SRC_REGISTER(instruction) == 0 && instruction->offset == 0 &&
+                    _DST_REGISTER(instruction) != _FRAME_POINTER_REGISTER && (pc + 1) < instruction_count &&
+                    instructions[pc + 1].opcode == 0 && instructions[pc + 1].registers == 0 && instructions[pc + 1].offset == 0
+                );
+                pc++;
+                break;
+
+            case _CLASS_LDX: case _CLASS_ST: case _CLASS_STX:
+                is_valid = _verify_memory_instruction(instruction);
+                break;
+
+            default:
+                break;
+        }
+
+        if(!is_valid) {
+            snprintf(error_message, error_message_size, "The eBPF program's instruction #%zu (opcode 0x%02x) is invalid or unsupported!", pc, (unsigned int) instruction->opcode);
+            utils__free_memory(is_second_slot);
+            return false;
+        }
+    }
+
+    utils__free_memory(is_second_slot);
+
+    // The program must not be able to "fall off" its end
+    const uint8_t last_opcode = instructions[instruction_count - 1].opcode;
+    if(last_opcode != (_CLASS_JMP | 0x90) && last_opcode != (_CLASS_JMP | 0x00)) {
+        snprintf(error_message, error_message_size, "The eBPF program's last instruction must be either an exit or an unconditional jump!");
+        return false;
+    }
+
+    return true;
+}
+
+static bool _verify_alu_instruction(const tundra__bpf_instruction *instruction) {
+    if(instruction->offset != 0 || _DST_REGISTER(instruction) == _FRAME_POINTER_REGISTER)
+        return false;
+
+    const bool is_source_register = (instruction->opcode & _SOURCE_REGISTER_FLAG);
+
+    switch(_OPERATION(instruction->opcode)) {
+        case 0x00: case 0x10: case 0x20: case 0x40: case 0x50: case 0xa0: case 0xb0:  // ADD, SUB, MUL, OR, AND, XOR, MOV
+            return true;
+
+        case 0x30: case 0x90:  // DIV, MOD
+            return (is_source_register || instruction->immediate != 0);
+
+        case 0x60: case 0x70: case 0xc0:  // LSH, RSH, ARSH
+            return (is_source_register || (instruction->immediate >= 0 && instruction->immediate < (_CLASS(instruction->opcode) == _CLASS_ALU64 ? 64 : 32)));
+
+        case 0x80:  // NEG
+            return (!is_source_register && instruction->immediate == 0);
+
+        case 0xd0:  // END (byte swaps); the 64-bit class' unconditional byte swaps are not supported
+            return (_CLASS(instruction->opcode) == _CLASS_ALU && (instruction->immediate == 16 || instruction->immediate == 32 || instruction->immediate == 64));
+
+        default:
+            return false;
+    }
+}
+
+static bool _verify_jmp_instruction(const tundra__bpf_instruction *instruction) {
+    const bool is_source_register = (instruction->opcode & _SOURCE_REGISTER_FLAG);
+    const bool is_jmp32 = (_CLASS(instruction->opcode) == _CLASS_JMP32);
+
+    switch(_OPERATION(instruction->opcode)) {
+        case 0x00:  // JA
+            return (!is_jmp32 && !is_source_register && instruction->registers == 0 && instruction->immediate == 0);
+
+        case 0x80:  // CALL - only helper functions are supported
+            return (!is_jmp32 && !is_source_register && instruction->registers == 0 && instruction->offset == 0 && instruction->immediate == XLAT_ADDR_BPF_VM__HELPER_MAP_LOOKUP);
+
+        case 0x90:  // EXIT
+            return (!is_jmp32 && !is_source_register && instruction->registers == 0 && instruction->offset == 0 && instruction->immediate == 0);
+
+        case 0x10: case 0x20: case 0x30: case 0x40: case 0x50: case 0x60: case 0x70: case 0xa0: case 0xb0: case 0xc0: case 0xd0:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool _verify_memory_instruction(const tundra__bpf_instruction *instruction) {
+    if((instruction->opcode & _MEM_MODE_MASK) != _MEM_MODE_MEM)
+        return false;
+
+    switch(_CLASS(instruction->opcode)) {
+        case _CLASS_LDX:
+            return (instruction->immediate == 0 && _DST_REGISTER(instruction) != _FRAME_POINTER_REGISTER);
+
+        case _CLASS_ST:
+            return (_SRC_REGISTER(instruction) == 0);
+
+        case _CLASS_STX:
+            return (instruction->immediate == 0);
+
+        default:
+            return false;
+    }
+}
+
+// The program must have been verified using xlat_addr_bpf_vm__verify_program() before it is run! Returns false if the
+//  program has been aborted.
+bool xlat_addr_bpf_vm__run_program(const tundra__bpf_addr_xlat_image *image, tundra__bpf_addr_xlat_program_ctx *program_ctx, uint64_t *out_return_value) {
+    // The verifier does not track which stack slots have been written to, so the stack has to be zeroed out - otherwise,
+    //  a program could read (and return) whatever the host has left on its stack, including pointers
+    uint8_t stack[TUNDRA__ADDRESSING_BPF_STACK_SIZE] __attribute__((aligned(8))) = {0};
+    const _memory_regions regions = {.image = image, .ctx = (uint8_t *) program_ctx, .stack = stack};
+
+    uint64_t registers[11] = {0};
+    registers[1] = (uint64_t) (uintptr_t) program_ctx;
+    registers[_FRAME_POINTER_REGISTER] = (uint64_t) (uintptr_t) (stack + TUNDRA__ADDRESSING_BPF_STACK_SIZE);
+
+    const tundra__bpf_instruction *instructions = image->instructions;
+    size_t pc = 0;
+
+    for(uint64_t executed_instruction_count = 0; executed_instruction_count < TUNDRA__MAX_ADDRESSING_BPF_EXECUTED_INSTRUCTIONS; executed_instruction_count++) {
+        const tundra__bpf_instruction *instruction = instructions + (pc++);
+        uint64_t value = 0;
+
+        switch(instruction->opcode) {
+            // --- ALU64 ---
+            case 0x07: _DST += _IMM; break;
+            case 0x0f: _DST += _SRC; break;
+            case 0x17: _DST -= _IMM; break;
+            case 0x1f: _DST -= _SRC; break;
+            case 0x27: _DST *= _IMM; break;
+            case 0x2f: _DST *= _SRC; break;
+            case 0x37: _DST /= _IMM; break;  // Division by a zero immediate is rejected by the verifier
+            case 0x3f: _DST = (_SRC != 0) ? (_DST / _SRC) : 0; break;
+            case 0x47: _DST |= _IMM; break;
+            case 0x4f: _DST |= _SRC; break;
+            case 0x57: _DST &= _IMM; break;
+            case 0x5f: _DST &= _SRC; break;
+            case 0x67: _DST <<= (_IMM & 63); break;
+            case 0x6f: _DST <<= (_SRC & 63); break;
+            case 0x77: _DST >>= (_IMM & 63); break;
+            case 0x7f: _DST >>= (_SRC & 63); break;
+            case 0x87: _DST = -_DST; break;
+            case 0x97: _DST %= _IMM; break;
+            case 0x9f: _DST = (_SRC != 0) ? (_DST % _SRC) : _DST; break;
+            case 0xa7: _DST ^= _IMM; break;
+            case 0xaf: _DST ^= _SRC; break;
+            case 0xb7: _DST = _IMM; break;
+            case 0xbf: _DST = _SRC; break;
+            case 0xc7: _DST = (uint64_t) ((int64_t) _DST >> (_IMM & 63)); break;
+            case 0xcf: _DST = (uint64_t) ((int64_t) _DST >> (_SRC & 63)); break;
+
+            // --- ALU (32-bit; the results are zero-extended) ---
+            case 0x04: _DST = (uint32_t) ((uint32_t) _DST + _IMM32); break;
+            case 0x0c: _DST = (uint32_t) ((uint32_t) _DST + (uint32_t) _SRC); break;
+            case 0x14: _DST = (uint32_t) ((uint32_t) _DST - _IMM32); break;
+            case 0x1c: _DST = (uint32_t) ((uint32_t) _DST - (uint32_t) _SRC); break;
+            case 0x24: _DST = (uint32_t) ((uint32_t) _DST * _IMM32); break;
+            case 0x2c: _DST = (uint32_t) ((uint32_t) _DST * (uint32_t) _SRC); break;
+            case 0x34: _DST = (uint32_t) ((uint32_t) _DST / _IMM32); break;
+            case 0x3c: _DST = ((uint32_t) _SRC != 0) ? (uint32_t) ((uint32_t) _DST / (uint32_t) _SRC) : 0; break;
+            case 0x44: _DST = (uint32_t) ((uint32_t) _DST | _IMM32); break;
+            case 0x4c: _DST = (uint32_t) ((uint32_t) _DST | (uint32_t) _SRC); break;
+            case 0x54: _DST = (uint32_t) ((uint32_t) _DST & _IMM32); break;
+            case 0x5c: _DST = (uint32_t) ((uint32_t) _DST & (uint32_t) _SRC); break;
+            case 0x64: _DST = (uint32_t) ((uint32_t) _DST << (_IMM32 & 31)); break;
+            case 0x6c: _DST = (uint32_t) ((uint32_t) _DST << (_SRC & 31)); break;
+            case 0x74: _DST = (uint32_t) ((uint32_t) _DST >> (_IMM32 & 31)); break;
+            case 0x7c: _DST = (uint32_t) ((uint32_t) _DST >> (_SRC & 31)); break;
+            case 0x84: _DST = (uint32_t) -((uint32_t) _DST); break;
+            case 0x94: _DST = (uint32_t) ((uint32_t) _DST % _IMM32); break;
+            case 0x9c: _DST = ((uint32_t) _SRC != 0) ? (uint32_t) ((uint32_t) _DST % (uint32_t) _SRC) : (uint32_t) _DST; break;
+            case 0xa4: _DST = (uint32_t) ((uint32_t) _DST ^ _IMM32); break;
+            case 0xac: _DST = (uint32_t) ((uint32_t) _DST ^ (uint32_t) _SRC); break;
+            case 0xb4: _DST = _IMM32; break;
+            case 0xbc: _DST = (uint32_t) _SRC; break;
+            case 0xc4: _DST = (uint32_t) ((int32_t) (uint32_t) _DST >> (_IMM32 & 31)); break;
+            case 0xcc: _DST = (uint32_t) ((int32_t) (uint32_t) _DST >> (_SRC & 31)); break;
+            case 0xd4:  // Conversion to little-endian
+                switch(instruction->immediate) {
+                    case 16: _DST = htole16((uint16_t) _DST); break;
+                    case 32: _DST = htole32((uint32_t) _DST); break;
+                    default: _DST = htole64(_DST); break;
+                }
+                break;
+            case 0xdc:  // Conversion to big-endian
+                switch(instruction->immediate) {
+                    case 16: _DST = htobe16((uint16_t) _DST); break;
+                    case 32: _DST = htobe32((uint32_t) _DST); break;
+                    default: _DST = htobe64(_DST); break;
+                }
+                break;
+
+            // --- JMP ---
+            case 0x05: _JUMP_IF(true);
+            case 0x15: _JUMP_IF(_DST == _IMM);
+            case 0x1d: _JUMP_IF(_DST == _SRC);
+            case 0x25: _JUMP_IF(_DST > _IMM);
+            case 0x2d: _JUMP_IF(_DST > _SRC);
+            case 0x35: _JUMP_IF(_DST >= _IMM);
+            case 0x3d: _JUMP_IF(_DST >= _SRC);
+            case 0x45: _JUMP_IF(_DST & _IMM);
+            case 0x4d: _JUMP_IF(_DST & _SRC);
+            case 0x55: _JUMP_IF(_DST != _IMM);
+            case 0x5d: _JUMP_IF(_DST != _SRC);
+            case 0x65: _JUMP_IF((int64_t) _DST > (int64_t) _IMM);
+            case 0x6d: _JUMP_IF((int64_t) _DST > (int64_t) _SRC);
+            case 0x75: _JUMP_IF((int64_t) _DST >= (int64_t) _IMM);
+            case 0x7d: _JUMP_IF((int64_t) _DST >= (int64_t) _SRC);
+            case 0xa5: _JUMP_IF(_DST < _IMM);
+            case 0xad: _JUMP_IF(_DST < _SRC);
+            case 0xb5: _JUMP_IF(_DST <= _IMM);
+            case 0xbd: _JUMP_IF(_DST <= _SRC);
+            case 0xc5: _JUMP_IF((int64_t) _DST < (int64_t) _IMM);
+            case 0xcd: _JUMP_IF((int64_t) _DST < (int64_t) _SRC);
+            case 0xd5: _JUMP_IF((int64_t) _DST <= (int64_t) _IMM);
+            case 0xdd: _JUMP_IF((int64_t) _DST <= (int64_t) _SRC);
+            case 0x85:
+                if(!_call_helper(&regions, instruction->immediate, registers))
+                    return false;
+                break;
+            case 0x95:
+                *out_return_value = registers[0];
+                return true;
+
+            // --- JMP32 ---
+            case 0x16: _JUMP_IF((uint32_t) _DST == _IMM32);
+            case 0x1e: _JUMP_IF((uint32_t) _DST == (uint32_t) _SRC);
+            case 0x26: _JUMP_IF((uint32_t) _DST > _IMM32);
+            case 0x2e: _JUMP_IF((uint32_t) _DST > (uint32_t) _SRC);
+            case 0x36: _JUMP_IF((uint32_t) _DST >= _IMM32);
+            case 0x3e: _JUMP_IF((uint32_t) _DST >= (uint32_t) _SRC);
+            case 0x46: _JUMP_IF((uint32_t) _DST & _IMM32);
+            case 0x4e: _JUMP_IF((uint32_t) _DST & (uint32_t) _SRC);
+            case 0x56: _JUMP_IF((uint32_t) _DST != _IMM32);
+            case 0x5e: _JUMP_IF((uint32_t) _DST != (uint32_t) _SRC);
+            case 0x66: _JUMP_IF((int32_t) (uint32_t) _DST > instruction->immediate);
+            case 0x6e: _JUMP_IF((int32_t) (uint32_t) _DST > (int32_t) (uint32_t) _SRC);
+            case 0x76: _JUMP_IF((int32_t) (uint32_t) _DST >= instruction->immediate);
+            case 0x7e: _JUMP_IF((int32_t) (uint32_t) _DST >= (int32_t) (uint32_t) _SRC);
+            case 0xa6: _JUMP_IF((uint32_t) _DST < _IMM32);
+            case 0xae: _JUMP_IF((uint32_t) _DST < (uint32_t) _SRC);
+            case 0xb6: _JUMP_IF((uint32_t) _DST <= _IMM32);
+            case 0xbe: _JUMP_IF((uint32_t) _DST <= (uint32_t) _SRC);
+            case 0xc6: _JUMP_IF((int32_t) (uint32_t) _DST < instruction->immediate);
+            case 0xce: _JUMP_IF((int32_t) (uint32_t) _DST < (int32_t) (uint32_t) _SRC);
+            case 0xd6: _JUMP_IF((int32_t) (uint32_t) _DST <= instruction->immediate);
+            case 0xde: _JUMP_IF((int32_t) (uint32_t) _DST <= (int32_t) (uint32_t) _SRC);
+
+            // --- LD (64-bit immediate loads) ---
+            case 0x18:
+                _DST = ((uint64_t) (uint32_t) instruction->immediate) | (((uint64_t) (uint32_t) instructions[pc].immediate) << 32);
+                pc++;
+                break;
+
+            // --- LDX ---
+            case 0x61: if(!_load(&regions, _SRC + (uint64_t) (int64_t) instruction->offset, 4, &value)) return false; _DST = value; break;
+            case 0x69: if(!_load(&regions, _SRC + (uint64_t) (int64_t) instruction->offset, 2, &value)) return false; _DST = value; break;
+            case 0x71: if(!_load(&regions, _SRC + (uint64_t) (int64_t) instruction->offset, 1, &value)) return false; _DST = value; break;
+            case 0x79: if(!_load(&regions, _SRC + (uint64_t) (int64_t) instruction->offset, 8, &value)) return false; _DST = value; break;
+
+            // --- ST ---
+            case 0x62: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 4, _IMM)) return false; break;
+            case 0x6a: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 2, _IMM)) return false; break;
+            case 0x72: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 1, _IMM)) return false; break;
+            case 0x7a: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 8, _IMM)) return false; break;
+
+            // --- STX ---
+            case 0x63: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 4, _SRC)) return false; break;
+            case 0x6b: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 2, _SRC)) return false; break;
+            case 0x73: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 1, _SRC)) return false; break;
+            case 0x7b: if(!_store(&regions, _DST + (uint64_t) (int64_t) instruction->offset, 8, _SRC)) return false; break;
+
+            default:
+                return false;  // Cannot happen with a verified program
+        }
+    }
+
+    return false;  // The program has executed too many instructions
+}
+
+// Returns NULL if the program is not allowed to access the memory (which is the case if the memory is not entirely
+//  inside one of the regions)
+static inline uint8_t *_get_accessible_memory(const _memory_regions *regions, const uint64_t address, const size_t size, const bool is_write) {
+    if(_is_address_in_region(address, size, regions->stack, TUNDRA__ADDRESSING_BPF_STACK_SIZE) || _is_address_in_region(address, size, regions->ctx, sizeof(tundra__bpf_addr_xlat_program_ctx)))
+        return (uint8_t *) (uintptr_t) address;
+
+    // The maps are read-only
+    if(!is_write) {
+        for(size_t i = 0; i < regions->image->map_count; i++) {
+            const tundra__bpf_addr_xlat_map *map = regions->image->maps + i;
+
+            if(_is_address_in_region(address, size, map->entries, map->entry_count * (map->key_size + map->value_size)))
+                return (uint8_t *) (uintptr_t) address;
+        }
+    }
+
+    return NULL;
+}
+
+static inline bool _is_address_in_region(const uint64_t address, const size_t size, const uint8_t *region, const size_t region_size) {
+    const uint64_t region_address = (uint64_t) (uintptr_t) region;
+
+    return (address >= region_address && size <= region_size && (address - region_address) <= (uint64_t) (region_size - size));
+}
+
+static inline bool _load(const _memory_regions *regions, const uint64_t address, const size_t size, uint64_t *out_value) {
+    const uint8_t *memory = _get_accessible_memory(regions, address, size, false);
+    if(memory == NULL)
+        return false;
+
+    switch(size) {
+        case 1: *out_value = *memory; break;
+        case 2: { uint16_t value; memcpy(&value, memory, 2); *out_value = value; } break;
+        case 4: { uint32_t value; memcpy(&value, memory, 4); *out_value = value; } break;
+        default: memcpy(out_value, memory, 8); break;
+    }
+
+    return true;
+}
+
+static inline bool _store(const _memory_regions *regions, const uint64_t address, const size_t size, const uint64_t value) {
+    uint8_t *memory = _get_accessible_memory(regions, address, size, true);
+    if(memory == NULL)
+        return false;
+
+    switch(size) {
+        case 1: *memory = (uint8_t) value; break;
+        case 2: { const uint16_t truncated_value = (uint16_t) value; memcpy(memory, &truncated_value, 2); } break;
+        case 4: { const uint32_t truncated_value = (uint32_t) value; memcpy(memory, &truncated_value, 4); } break;
+        default: memcpy(memory, &value, 8); break;
+    }
+
+    return true;
+}
+
+static inline bool _call_helper(const _memory_regions *regions, const int32_t helper, uint64_t *registers) {
+    switch(helper) {
+        case XLAT_ADDR_BPF_VM__HELPER_MAP_LOOKUP:
+            {
+                // R1 = the map's index, R2 = a pointer to the key; R0 = a pointer to the value, or 0 if not found
+                if(registers[1] >= (uint64_t) regions->image->map_count)
+                    return false;
+
+                const tundra__bpf_addr_xlat_map *map = regions->image->maps + registers[1];
+                const uint8_t *key = _get_accessible_memory(regions, registers[2], map->key_size, false);
+                if(key == NULL)
+                    return false;
+
+                registers[0] = (uint64_t) (uintptr_t) xlat_addr_bpf_map__lookup(map, key);
+            }
+            return true;
+
+        default:
+            return false;  // Cannot happen with a verified program
+    }
+}
+
+
+#undef _CLASS
+#undef _CLASS_LD
+#undef _CLASS_LDX
+#undef _CLASS_ST
+#undef _CLASS_STX
+#undef _CLASS_ALU
+#undef _CLASS_JMP
+#undef _CLASS_JMP32
+#undef _CLASS_ALU64
+#undef _OPERATION
+#undef _SOURCE_REGISTER_FLAG
+#undef _LD_IMM64_OPCODE
+#undef _MEM_MODE_MASK
+#undef _MEM_MODE_MEM
+#undef _DST_REGISTER
+#undef _SRC_REGISTER
+#undef _FRAME_POINTER_REGISTER
+#undef _DST
+#undef _SRC
+#undef _IMM
+#undef _IMM32
+#undef _JUMP_IF
@@ -22,10 +22,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"tundra.h"
 #include"xlat_addr_clat.h"
 
+#include"utils_ip.h"
 #include"utils_xlat_addr.h"
+#include"xlat_addr_clat_nat44.h"
 
 
 bool xlat_addr_clat__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    if(ctx->config->addressing_clat_nat44) {
+        // The destination is checked first, so that no session is created for a packet which is going to be dropped
+        if(!utils_xlat_addr__nat64_clat__translate_4to6_prefix_for_main_packet(ctx, in_dst_ipv4, out_dst_ipv6))
+            return false;
+
+        // Any IPv4 host may use the translator - its transport address is translated into the CLAT's one
+        if(!xlat_addr_clat_nat44__translate_outbound_packet(ctx, in_src_ipv4))
+            return false;
+
+        memcpy(out_src_ipv6, ctx->config->addressing_nat64_clat_ipv6, 16);
+        return true;
+    }
+
     if(!utils_xlat_addr__nat64_clat__translate_4to6_translator_ip(ctx, in_src_ipv4, out_src_ipv6))
         return false;
 
@@ -35,6 +50,15 @@ bool xlat_addr_clat__translate_4to6_addr_for_main_packet(tundra__thread_ctx *con
 bool xlat_addr_clat__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
     utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_src_ipv4, out_src_ipv6);
 
+    if(ctx->config->addressing_clat_nat44) {
+        // The session has been looked up by the packet in error when the main packet's addresses were translated
+        if(!ctx->is_out_transport_port_set || !UTILS_IP__IPV4_ADDR_EQ(in_dst_ipv4, ctx->clat_nat44_host_ipv4))
+            return false;
+
+        memcpy(out_dst_ipv6, ctx->config->addressing_nat64_clat_ipv6, 16);
+        return true;
+    }
+
     return utils_xlat_addr__nat64_clat__translate_4to6_translator_ip(ctx, in_dst_ipv4, out_dst_ipv6);
 }
 
@@ -42,12 +66,27 @@ bool xlat_addr_clat__translate_6to4_addr_for_main_packet(tundra__thread_ctx *con
     if(!utils_xlat_addr__nat64_clat__translate_6to4_prefix_for_main_packet(ctx, in_src_ipv6, out_src_ipv4))
         return false;
 
-    return utils_xlat_addr__nat64_clat__translate_6to4_translator_ip(ctx, in_dst_ipv6, out_dst_ipv4);
+    if(!utils_xlat_addr__nat64_clat__translate_6to4_translator_ip(ctx, in_dst_ipv6, out_dst_ipv4))
+        return false;
+
+    // The CLAT's transport address is translated back into the IPv4 host's one
+    if(ctx->config->addressing_clat_nat44)
+        return xlat_addr_clat_nat44__translate_inbound_packet(ctx, out_dst_ipv4);
+
+    return true;
 }
 
 bool xlat_addr_clat__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
     if(!utils_xlat_addr__nat64_clat__translate_6to4_translator_ip(ctx, in_src_ipv6, out_src_ipv4))
         return false;
 
+    if(ctx->config->addressing_clat_nat44) {
+        // The session has been looked up by the packet in error when the main packet's addresses were translated
+        if(!ctx->is_out_transport_port_set)
+            return false;
+
+        memcpy(out_src_ipv4, ctx->clat_nat44_host_ipv4, 4);
+    }
+
     return utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_dst_ipv6, out_dst_ipv4);
 }
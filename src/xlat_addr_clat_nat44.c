@@ -0,0 +1,503 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_clat_nat44.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"xlat_addr_external_timer_wheel.h"
+
+
+#define _SHARD_INDEX_MASK ((uint32_t) (TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS - 1))
+#define _SESSIONS_PER_SHARD ((size_t) (3 * TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD))
+#define _MAX_EVICTIONS_PER_PACKET ((size_t) 8)
+
+#define _TCP_FLAG_FIN ((uint8_t) 0x01)
+#define _TCP_FLAG_SYN ((uint8_t) 0x02)
+#define _TCP_FLAG_RST ((uint8_t) 0x04)
+
+
+// The transport-layer information a session is looked up (and possibly created) by
+typedef struct _packet_transport_info {
+    const uint8_t *ip; // The IPv4 host's address (IPv4 side); NULL (IPv6 side)
+    uint16_t port; // In network byte order; the TCP/UDP port or ICMP Echo identifier of the IPv4 host (IPv4 side) or the translated one (IPv6 side)
+    uint8_t protocol; // 1 (ICMP), 6 (TCP) or 17 (UDP)
+    uint8_t tcp_flags; // 0 if the packet is not a TCP one
+    bool is_icmp_error; // The information has been gathered from the packet in error; such packets neither create nor refresh sessions
+} _packet_transport_info;
+
+
+static bool _get_ipv4_side_packet_transport_info(const tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, _packet_transport_info *const out_info);
+static bool _get_ipv6_side_packet_transport_info(const tundra__thread_ctx *const ctx, _packet_transport_info *const out_info);
+static uint32_t _find_session_by_ipv4_side(const tundra__clat_nat44_shard *const shard, const _packet_transport_info *const info, const uint32_t hash);
+static uint32_t _create_session(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard, const _packet_transport_info *const info, const uint32_t hash);
+static void _delete_session(tundra__clat_nat44_shard *const shard, const uint32_t session_index);
+static void _refresh_session(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard, const uint32_t session_index, const uint8_t tcp_flags, const bool is_from_ipv6_side);
+static void _evict_expired_sessions(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard);
+static uint32_t _discard_session_if_expired(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard, const uint32_t session_index);
+static uint32_t _hash_transport_address(const uint8_t protocol, const uint8_t *ipv4, const uint16_t port);
+static inline size_t _get_protocol_index(const uint8_t protocol);
+static inline uint8_t _get_session_protocol(const uint32_t session_index);
+static inline uint16_t _get_session_port(const uint32_t shard_index, const uint32_t session_index);
+static inline uint32_t _get_bucket_index(const uint32_t hash);
+static inline bool _is_session_expired(const tundra__thread_ctx *const ctx, const tundra__clat_nat44_session *const session);
+
+
+tundra__clat_nat44_state *xlat_addr_clat_nat44__create_state(void) {
+    // The sessions are used (i.e. the table's memory is touched) only as they are needed
+    tundra__clat_nat44_state *clat_nat44_state = utils__alloc_huge_page_backed_zeroed_out_memory(1, sizeof(tundra__clat_nat44_state));
+    const time_t current_timestamp = utils__get_coarse_monotonic_timestamp();
+
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS; i++) {
+        tundra__clat_nat44_shard *shard = clat_nat44_state->shards + i;
+
+        if(pthread_mutex_init(&shard->mutex, NULL) != 0)
+            exit(TUNDRA__EXIT_MUTEX_FAILURE);
+
+        shard->timer_wheel = xlat_addr_external_timer_wheel__create(_SESSIONS_PER_SHARD, current_timestamp);
+
+        for(size_t j = 0; j < TUNDRA__ADDRESSING_CLAT_NAT44_BUCKETS_PER_SHARD; j++)
+            shard->buckets[j] = XLAT_ADDR_CLAT_NAT44__NO_SESSION;
+    }
+
+    return clat_nat44_state;
+}
+
+void xlat_addr_clat_nat44__free_state(tundra__clat_nat44_state *clat_nat44_state) {
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS; i++) {
+        tundra__clat_nat44_shard *shard = clat_nat44_state->shards + i;
+
+        pthread_mutex_destroy(&shard->mutex);
+        xlat_addr_external_timer_wheel__free(shard->timer_wheel);
+    }
+
+    utils__free_huge_page_backed_memory(clat_nat44_state, 1, sizeof(tundra__clat_nat44_state));
+}
+
+// Translates the IPv4 host's transport address into the translated port (the address is then replaced by the CLAT's
+//  one by the caller); used for packets going from the IPv4 side to the IPv6 side
+bool xlat_addr_clat_nat44__translate_outbound_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4) {
+    if(utils_ip__is_ipv4_addr_unusable(in_src_ipv4))
+        return false;
+
+    _packet_transport_info info;
+    if(!_get_ipv4_side_packet_transport_info(ctx, in_src_ipv4, &info))
+        return false;
+
+    // The hash of the IPv4 host's transport address determines the shard (see tundra__clat_nat44_shard)
+    const uint32_t hash = _hash_transport_address(info.protocol, info.ip, info.port);
+    const uint32_t shard_index = (hash & _SHARD_INDEX_MASK);
+    tundra__clat_nat44_shard *shard = ctx->clat_nat44_state->shards + shard_index;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    _evict_expired_sessions(ctx, shard);
+
+    uint32_t session_index = _discard_session_if_expired(ctx, shard, _find_session_by_ipv4_side(shard, &info, hash));
+    if(session_index == XLAT_ADDR_CLAT_NAT44__NO_SESSION) {
+        // Only packets which may start a "connection" create sessions: TCP SYNs, UDP datagrams and ICMP Echo Requests
+        if(info.is_icmp_error || (info.protocol == 6 && (info.tcp_flags & (_TCP_FLAG_SYN | _TCP_FLAG_RST)) != _TCP_FLAG_SYN))
+            session_index = XLAT_ADDR_CLAT_NAT44__NO_SESSION;
+        else
+            session_index = _create_session(ctx, shard, &info, hash);
+
+        if(session_index == XLAT_ADDR_CLAT_NAT44__NO_SESSION) {
+            pthread_mutex_unlock(&shard->mutex);
+            return false;
+        }
+    } else if(!info.is_icmp_error) {
+        _refresh_session(ctx, shard, session_index, info.tcp_flags, false);
+    }
+
+    memcpy(ctx->clat_nat44_host_ipv4, shard->sessions[session_index].host_ipv4, 4);
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    ctx->out_transport_port = _get_session_port(shard_index, session_index);
+    ctx->is_out_transport_port_set = true;
+    ctx->is_out_transport_port_of_ipv4_host = true;
+
+    return true;
+}
+
+// Translates the translated port back into the IPv4 host's transport address, whose IP address is put into
+//  'out_dst_ipv4'; used for packets going from the IPv6 side to the IPv4 side
+bool xlat_addr_clat_nat44__translate_inbound_packet(tundra__thread_ctx *const ctx, uint8_t *out_dst_ipv4) {
+    _packet_transport_info info;
+    if(!_get_ipv6_side_packet_transport_info(ctx, &info))
+        return false;
+
+    // The translated port determines both the shard and the session's position within it (see tundra__clat_nat44_session)
+    const uint32_t port_host_order = (uint32_t) ntohs(info.port);
+    if(port_host_order < TUNDRA__ADDRESSING_CLAT_NAT44_MIN_PORT)
+        return false;
+
+    const uint32_t shard_index = (port_host_order & _SHARD_INDEX_MASK);
+    const uint32_t session_index = (uint32_t) (
+        (_get_protocol_index(info.protocol) * TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD) +
+        ((port_host_order - TUNDRA__ADDRESSING_CLAT_NAT44_MIN_PORT) / TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS)
+    );
+    tundra__clat_nat44_shard *shard = ctx->clat_nat44_state->shards + shard_index;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    _evict_expired_sessions(ctx, shard);
+
+    // Since the mappings are endpoint-independent, so is the filtering - any IPv6 host may reach a mapped IPv4 host
+    //  through its translated port (RFC 4787, section 5)
+    if(!shard->sessions[session_index].is_in_use || _discard_session_if_expired(ctx, shard, session_index) == XLAT_ADDR_CLAT_NAT44__NO_SESSION) {
+        pthread_mutex_unlock(&shard->mutex);
+        return false;
+    }
+
+    if(!info.is_icmp_error)
+        _refresh_session(ctx, shard, session_index, info.tcp_flags, true);
+
+    memcpy(ctx->clat_nat44_host_ipv4, shard->sessions[session_index].host_ipv4, 4);
+    ctx->out_transport_port = shard->sessions[session_index].host_port;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    memcpy(out_dst_ipv4, ctx->clat_nat44_host_ipv4, 4);
+    ctx->is_out_transport_port_set = true;
+    ctx->is_out_transport_port_of_ipv4_host = true;
+
+    return true;
+}
+
+// Fragmented packets cannot be translated, as only the first fragment carries the transport-layer header
+static bool _get_ipv4_side_packet_transport_info(const tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, _packet_transport_info *const out_info) {
+    const uint8_t *payload_ptr = ctx->in_transport_payload_ptr;
+    const size_t payload_size = ctx->in_transport_payload_size;
+    if(payload_ptr == NULL)
+        return false;
+
+    out_info->ip = in_src_ipv4;
+    out_info->protocol = ctx->in_transport_protocol;
+    out_info->tcp_flags = 0;
+    out_info->is_icmp_error = false;
+
+    switch(ctx->in_transport_protocol) {
+        case 6: // TCP
+            if(payload_size < 20)
+                return false;
+            memcpy(&out_info->port, payload_ptr, 2); // Source port
+            out_info->tcp_flags = payload_ptr[13];
+            return true;
+
+        case 17: // UDP
+            if(payload_size < 8)
+                return false;
+            memcpy(&out_info->port, payload_ptr, 2); // Source port
+            return true;
+
+        case 1: // ICMPv4
+            if(payload_size < 8)
+                return false;
+
+            if(payload_ptr[0] == 8) { // Echo Request
+                memcpy(&out_info->port, payload_ptr + 4, 2); // Identifier
+                return true;
+            }
+
+            if(payload_ptr[0] == 3 || payload_ptr[0] == 11 || payload_ptr[0] == 12) { // Destination Unreachable, Time Exceeded, Parameter Problem
+                const uint8_t *packet_in_error_ptr = (payload_ptr + 8);
+                if(payload_size < (8 + 20) || (packet_in_error_ptr[0] >> 4) != 4)
+                    return false;
+
+                const size_t packet_in_error_header_size = (((size_t) (packet_in_error_ptr[0] & 0x0f)) * 4);
+                if(packet_in_error_header_size < 20 || payload_size < (8 + packet_in_error_header_size + 8))
+                    return false;
+
+                // The packet in error must not be a non-first fragment (the fragment offset is in the lower 13 bits)
+                if(((packet_in_error_ptr[6] & 0x1f) | packet_in_error_ptr[7]) != 0)
+                    return false;
+
+                // The packet in error was sent to the IPv4 host (the error message itself may have been sent either by
+                //  the host, or by a router in between) - its destination is the host's transport address
+                const uint8_t *packet_in_error_payload_ptr = (packet_in_error_ptr + packet_in_error_header_size);
+                if(packet_in_error_ptr[9] == 6 || packet_in_error_ptr[9] == 17) { // TCP, UDP
+                    memcpy(&out_info->port, packet_in_error_payload_ptr + 2, 2); // Destination port
+                } else if(packet_in_error_ptr[9] == 1 && packet_in_error_payload_ptr[0] == 0) { // ICMPv4 Echo Reply
+                    memcpy(&out_info->port, packet_in_error_payload_ptr + 4, 2); // Identifier
+                } else {
+                    return false;
+                }
+                out_info->ip = (packet_in_error_ptr + 16);
+                out_info->protocol = packet_in_error_ptr[9];
+                out_info->is_icmp_error = true;
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+// The packet in error of an ICMPv6 error message must carry the TCP/UDP/ICMPv6 header right after its IPv6 header,
+//  i.e. it must not have any extension headers
+static bool _get_ipv6_side_packet_transport_info(const tundra__thread_ctx *const ctx, _packet_transport_info *const out_info) {
+    const uint8_t *payload_ptr = ctx->in_transport_payload_ptr;
+    const size_t payload_size = ctx->in_transport_payload_size;
+    if(payload_ptr == NULL)
+        return false;
+
+    out_info->ip = NULL;
+    out_info->protocol = ctx->in_transport_protocol;
+    out_info->tcp_flags = 0;
+    out_info->is_icmp_error = false;
+
+    switch(ctx->in_transport_protocol) {
+        case 6: // TCP
+            if(payload_size < 20)
+                return false;
+            memcpy(&out_info->port, payload_ptr + 2, 2); // Destination port
+            out_info->tcp_flags = payload_ptr[13];
+            return true;
+
+        case 17: // UDP
+            if(payload_size < 8)
+                return false;
+            memcpy(&out_info->port, payload_ptr + 2, 2); // Destination port
+            return true;
+
+        case 1: // ICMPv6
+            if(payload_size < 8)
+                return false;
+
+            if(payload_ptr[0] == 129) { // Echo Reply
+                memcpy(&out_info->port, payload_ptr + 4, 2); // Identifier
+                return true;
+            }
+
+            if(payload_ptr[0] >= 1 && payload_ptr[0] <= 4) { // Destination Unreachable, Packet Too Big, Time Exceeded, Parameter Problem
+                const uint8_t *packet_in_error_ptr = (payload_ptr + 8);
+                if(payload_size < (8 + 40 + 8) || (packet_in_error_ptr[0] >> 4) != 6)
+                    return false;
+
+                // The packet in error was sent from the CLAT's address - its source is the translated transport address
+                if(!UTILS_IP__IPV6_ADDR_EQ(packet_in_error_ptr + 8, ctx->config->addressing_nat64_clat_ipv6))
+                    return false;
+
+                if(packet_in_error_ptr[6] == 6 || packet_in_error_ptr[6] == 17) { // TCP, UDP
+                    memcpy(&out_info->port, packet_in_error_ptr + 40, 2); // Source port
+                    out_info->protocol = packet_in_error_ptr[6];
+                } else if(packet_in_error_ptr[6] == 58 && packet_in_error_ptr[40] == 128) { // ICMPv6 Echo Request
+                    memcpy(&out_info->port, packet_in_error_ptr + 40 + 4, 2); // Identifier
+                    out_info->protocol = 1;
+                } else {
+                    return false;
+                }
+                out_info->is_icmp_error = true;
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+static uint32_t _find_session_by_ipv4_side(const tundra__clat_nat44_shard *const shard, const _packet_transport_info *const info, const uint32_t hash) {
+    uint32_t session_index = shard->buckets[_get_bucket_index(hash)];
+
+    while(session_index != XLAT_ADDR_CLAT_NAT44__NO_SESSION) {
+        const tundra__clat_nat44_session *session = shard->sessions + session_index;
+        if(session->host_port == info->port && _get_session_protocol(session_index) == info->protocol && UTILS_IP__IPV4_ADDR_EQ(session->host_ipv4, info->ip))
+            return session_index;
+
+        session_index = session->next_index;
+    }
+
+    return XLAT_ADDR_CLAT_NAT44__NO_SESSION;
+}
+
+// The protocol's part of the shard's sessions (i.e. its translated ports) is searched for a free or expired session,
+//  starting at a position derived from the IPv4 host's transport address
+static uint32_t _create_session(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard, const _packet_transport_info *const info, const uint32_t hash) {
+    const size_t first_session_index = (_get_protocol_index(info->protocol) * TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD);
+    const size_t start_offset = ((hash / (uint32_t) TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS) % TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD);
+
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD; i++) {
+        const uint32_t session_index = (uint32_t) (first_session_index + ((start_offset + i) % TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD));
+        tundra__clat_nat44_session *session = shard->sessions + session_index;
+
+        if(session->is_in_use) {
+            if(!_is_session_expired(ctx, session))
+                continue;
+            _delete_session(shard, session_index);
+        }
+
+        memcpy(session->host_ipv4, info->ip, 4);
+        session->host_port = info->port;
+        session->expiration_timestamp = (uint32_t) ctx->current_timestamp;
+        session->tcp_state = XLAT_ADDR_CLAT_NAT44__TCP_STATE_OPENING;
+        session->is_in_use = true;
+
+        uint32_t *bucket = shard->buckets + _get_bucket_index(hash);
+        session->next_index = *bucket;
+        *bucket = session_index;
+
+        _refresh_session(ctx, shard, session_index, info->tcp_flags, false);
+
+        return session_index;
+    }
+
+    return XLAT_ADDR_CLAT_NAT44__NO_SESSION; // All the shard's ports are in use
+}
+
+static void _delete_session(tundra__clat_nat44_shard *const shard, const uint32_t session_index) {
+    tundra__clat_nat44_session *session = shard->sessions + session_index;
+
+    const uint32_t hash = _hash_transport_address(_get_session_protocol(session_index), session->host_ipv4, session->host_port);
+    uint32_t *link = shard->buckets + _get_bucket_index(hash);
+    while(*link != session_index)
+        link = &shard->sessions[*link].next_index;
+    *link = session->next_index;
+
+    xlat_addr_external_timer_wheel__unschedule(shard->timer_wheel, session_index);
+
+    session->is_in_use = false;
+}
+
+// The TCP state machine is the same as the one of the 'nat64-stateful' addressing mode, with the IPv4 host initiating
+//  the connections
+static void _refresh_session(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard, const uint32_t session_index, const uint8_t tcp_flags, const bool is_from_ipv6_side) {
+    tundra__clat_nat44_session *session = shard->sessions + session_index;
+
+    time_t timeout;
+    switch(_get_session_protocol(session_index)) {
+        case 6: // TCP
+            if(tcp_flags & (_TCP_FLAG_FIN | _TCP_FLAG_RST))
+                session->tcp_state = XLAT_ADDR_CLAT_NAT44__TCP_STATE_CLOSING;
+            else if(session->tcp_state == XLAT_ADDR_CLAT_NAT44__TCP_STATE_OPENING && is_from_ipv6_side)
+                session->tcp_state = XLAT_ADDR_CLAT_NAT44__TCP_STATE_ESTABLISHED;
+            else if(session->tcp_state == XLAT_ADDR_CLAT_NAT44__TCP_STATE_CLOSING && !is_from_ipv6_side && (tcp_flags & _TCP_FLAG_SYN))
+                session->tcp_state = XLAT_ADDR_CLAT_NAT44__TCP_STATE_OPENING;
+
+            timeout = (
+                (session->tcp_state == XLAT_ADDR_CLAT_NAT44__TCP_STATE_ESTABLISHED) ?
+                TUNDRA__ADDRESSING_CLAT_NAT44_TCP_ESTABLISHED_TIMEOUT :
+                TUNDRA__ADDRESSING_CLAT_NAT44_TCP_TRANSITORY_TIMEOUT
+            );
+            break;
+
+        case 17: // UDP
+            timeout = TUNDRA__ADDRESSING_CLAT_NAT44_UDP_TIMEOUT;
+            break;
+
+        default: // ICMP
+            timeout = TUNDRA__ADDRESSING_CLAT_NAT44_ICMP_TIMEOUT;
+            break;
+    }
+
+    // Extending the lifetime does not require the session to be rescheduled, as the expiration timestamp is checked
+    //  again once the session's eviction is due (see _evict_expired_sessions()); shortening it, however, does
+    const time_t new_expiration_timestamp = (ctx->current_timestamp + timeout);
+    const time_t old_expiration_timestamp = (time_t) session->expiration_timestamp;
+    session->expiration_timestamp = (uint32_t) new_expiration_timestamp;
+
+    if(new_expiration_timestamp < old_expiration_timestamp || old_expiration_timestamp <= ctx->current_timestamp)
+        xlat_addr_external_timer_wheel__schedule(shard->timer_wheel, session_index, new_expiration_timestamp);
+}
+
+// At most _MAX_EVICTIONS_PER_PACKET due sessions are processed per packet, so that the translation of a single packet
+//  never stalls for long; the rest are processed while the following packets are being translated
+static void _evict_expired_sessions(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard) {
+    size_t session_index;
+
+    for(size_t i = 0; i < _MAX_EVICTIONS_PER_PACKET && xlat_addr_external_timer_wheel__pop_due_entry(shard->timer_wheel, ctx->current_timestamp, &session_index); i++) {
+        const tundra__clat_nat44_session *session = shard->sessions + session_index;
+        if(!session->is_in_use)
+            continue;
+
+        if(!_is_session_expired(ctx, session))
+            xlat_addr_external_timer_wheel__schedule(shard->timer_wheel, session_index, (time_t) session->expiration_timestamp);
+        else
+            _delete_session(shard, (uint32_t) session_index);
+    }
+}
+
+// Expired sessions whose eviction has not been processed yet (see above) must not be used
+static uint32_t _discard_session_if_expired(const tundra__thread_ctx *const ctx, tundra__clat_nat44_shard *const shard, const uint32_t session_index) {
+    if(session_index == XLAT_ADDR_CLAT_NAT44__NO_SESSION || !_is_session_expired(ctx, shard->sessions + session_index))
+        return session_index;
+
+    _delete_session(shard, session_index);
+    return XLAT_ADDR_CLAT_NAT44__NO_SESSION;
+}
+
+static uint32_t _hash_transport_address(const uint8_t protocol, const uint8_t *ipv4, const uint16_t port) {
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261;
+
+    hash = (hash ^ protocol) * 16777619;
+    for(size_t i = 0; i < 4; i++)
+        hash = (hash ^ ipv4[i]) * 16777619;
+    hash = (hash ^ (uint32_t) (port & 0xff)) * 16777619;
+    hash = (hash ^ (uint32_t) (port >> 8)) * 16777619;
+
+    return hash;
+}
+
+// The protocol must be 1 (ICMP), 6 (TCP) or 17 (UDP)
+static inline size_t _get_protocol_index(const uint8_t protocol) {
+    return ((protocol == 1) ? 0 : ((protocol == 6) ? 1 : 2));
+}
+
+static inline uint8_t _get_session_protocol(const uint32_t session_index) {
+    const size_t protocol_index = (session_index / TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD);
+
+    return ((protocol_index == 0) ? 1 : ((protocol_index == 1) ? 6 : 17));
+}
+
+// Returns the translated port in network byte order
+static inline uint16_t _get_session_port(const uint32_t shard_index, const uint32_t session_index) {
+    const uint32_t port_host_order = (
+        TUNDRA__ADDRESSING_CLAT_NAT44_MIN_PORT +
+        ((uint32_t) (session_index % TUNDRA__ADDRESSING_CLAT_NAT44_PORTS_PER_SHARD) * (uint32_t) TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS) +
+        shard_index
+    );
+
+    return htons((uint16_t) port_host_order);
+}
+
+// The lowest bits of the hash have already been used to select the shard
+static inline uint32_t _get_bucket_index(const uint32_t hash) {
+    return ((hash / (uint32_t) TUNDRA__ADDRESSING_CLAT_NAT44_SHARDS) & (uint32_t) (TUNDRA__ADDRESSING_CLAT_NAT44_BUCKETS_PER_SHARD - 1));
+}
+
+static inline bool _is_session_expired(const tundra__thread_ctx *const ctx, const tundra__clat_nat44_session *const session) {
+    return (bool) (((time_t) session->expiration_timestamp) <= ctx->current_timestamp);
+}
+
+
+#undef _SHARD_INDEX_MASK
+#undef _SESSIONS_PER_SHARD
+#undef _MAX_EVICTIONS_PER_PACKET
+
+#undef _TCP_FLAG_FIN
+#undef _TCP_FLAG_SYN
+#undef _TCP_FLAG_RST
@@ -0,0 +1,36 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+#define XLAT_ADDR_CLAT_NAT44__NO_SESSION ((uint32_t) UINT32_MAX)
+
+#define XLAT_ADDR_CLAT_NAT44__TCP_STATE_OPENING ((uint8_t) 0)  // Only the IPv4 host's SYN has been seen so far
+#define XLAT_ADDR_CLAT_NAT44__TCP_STATE_ESTABLISHED ((uint8_t) 1)
+#define XLAT_ADDR_CLAT_NAT44__TCP_STATE_CLOSING ((uint8_t) 2)  // A FIN or RST has been seen
+
+
+extern tundra__clat_nat44_state *xlat_addr_clat_nat44__create_state(void);
+extern void xlat_addr_clat_nat44__free_state(tundra__clat_nat44_state *clat_nat44_state);
+extern bool xlat_addr_clat_nat44__translate_outbound_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4);
+extern bool xlat_addr_clat_nat44__translate_inbound_packet(tundra__thread_ctx *const ctx, uint8_t *out_dst_ipv4);
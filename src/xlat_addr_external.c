@@ -25,180 +25,412 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"utils.h"
 #include"utils_ip.h"
 #include"log.h"
+#include"xlat_addr_external_cache.h"
+#include"xlat_addr_external_prefix_cache.h"
+#include"xlat_addr_external_inflight.h"
+#include"xlat_addr_external_circuit_breaker.h"
+#include"xlat_addr_external_rate_limiter.h"
+#include"xlat_addr_external_timer_wheel.h"
 #include"router_ipv4.h"
 #include"router_ipv6.h"
 #include"xlat_interrupt.h"
 
 
 #define _MESSAGE_MAGIC_BYTE ((uint8_t) 0x54)
-#define _MESSAGE_VERSION ((uint8_t) 1)
-
-// These values could be put inside an enum, but since their main purpose is to be put as integers into messages, it
-//  seems to me that defining them this way is more appropriate.
-#define _MESSAGE_TYPE_4TO6_MAIN_PACKET ((uint8_t) 1)
-#define _MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET ((uint8_t) 2)
-#define _MESSAGE_TYPE_6TO4_MAIN_PACKET ((uint8_t) 3)
-#define _MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET ((uint8_t) 4)
-
-
-static bool _do_external_address_translation(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, uint8_t *out_cache_lifetime);
-static bool _construct_and_send_request_to_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
-static bool _recv_and_parse_response_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, uint8_t *out_src_ip, uint8_t *out_dst_ip, uint8_t *out_cache_lifetime);
+#define _MESSAGE_VERSION_1 ((uint8_t) 1)
+#define _MESSAGE_VERSION_2 ((uint8_t) 2)
+#define _MESSAGE_TYPE_MASK ((uint8_t) 0x1f)
+#define _MESSAGE_TYPE_BITS_RESPONSE ((uint8_t) 128)
+#define _MESSAGE_TYPE_BITS_RESPONSE_ERROR ((uint8_t) 192)
+#define _MESSAGE_TYPE_BITS_RESPONSE_ERROR_ICMP ((uint8_t) 224)
+#define _MESSAGE_FLAG_UNSOLICITED ((uint8_t) 0x80)
+#define _MESSAGE_FLAG_INVALIDATE ((uint8_t) 0x40)
+#define _MESSAGE_FLAG_PREFIX ((uint8_t) 0x20)
+#define _MESSAGE_FLAG_BIDIRECTIONAL ((uint8_t) 0x10)
+#define _MAX_UNSOLICITED_MESSAGES_PER_RESPONSE ((size_t) 1024)
+#define _MAX_UNSOLICITED_MESSAGES_PER_CHECK ((size_t) 1024)
+#define _MAX_DISCARDED_DATAGRAMS_PER_RECV ((size_t) 1024)
+#define _MAX_EVICTED_ENTRIES_PER_CACHE_PER_PASS ((size_t) 64)
+
+
+static bool _translate_4to6_addrs(tundra__thread_ctx *const ctx, const uint8_t message_type, tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+static bool _translate_6to4_addrs(tundra__thread_ctx *const ctx, const uint8_t message_type, tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+static tundra__external_addr_xlat_result _lookup_prefix_cache(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip);
+static void _save_addr_mapping_to_caches(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const tundra__external_addr_xlat_result result, const tundra__external_addr_xlat_response_params *response_params);
+static void _save_reverse_addr_mapping_to_caches(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const tundra__external_addr_xlat_response_params *response_params);
+static bool _act_upon_addr_xlat_result(tundra__thread_ctx *const ctx, const uint8_t message_type, const tundra__external_addr_xlat_result result);
+static tundra__external_addr_xlat_result _do_coalesced_external_address_translation(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params);
+static tundra__external_addr_xlat_result _do_external_address_translation(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params);
+static tundra__external_addr_xlat_result _query_current_server(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params);
+static uint32_t _get_next_message_identifier(tundra__thread_ctx *const ctx);
+static bool _send_request_to_fd(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static bool _construct_and_send_v1_request_to_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static tundra__external_addr_xlat_result _recv_and_parse_v1_response_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params);
+static bool _parse_v1_response(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params, tundra__external_addr_xlat_result *out_result);
+static bool _construct_and_send_v2_request_to_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message_v2 *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static tundra__external_addr_xlat_result _recv_and_parse_v2_response_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message_v2 *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params);
+static bool _parse_v2_response(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message_v2 *message_buf, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params, tundra__external_addr_xlat_result *out_result);
+static void _refresh_stale_cache_entry(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static bool _process_refresh_response(tundra__thread_ctx *const ctx, const void *message_buf, const uint32_t message_identifier);
+static void _process_incoming_messages_if_necessary(tundra__thread_ctx *const ctx);
+static void _evict_expired_cache_entries_if_necessary(tundra__thread_ctx *const ctx);
+static bool _process_unsolicited_v2_message(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message_v2 *message_buf);
+static bool _get_v2_response_params(tundra__thread_ctx *const ctx, const uint8_t message_type, const tundra__external_addr_xlat_message_v2 *message_buf, const tundra__external_addr_xlat_result result, tundra__external_addr_xlat_response_params *out_response_params);
+static bool _is_v2_message_header_valid(const tundra__external_addr_xlat_message_v2 *message_buf);
+static tundra__external_addr_xlat_cache_entry *_get_cache_for_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type, size_t *out_cache_size);
+static tundra__external_addr_xlat_prefix_cache *_get_prefix_cache_for_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type);
+static tundra__external_addr_xlat_timer_wheel *_get_timer_wheel_for_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type);
+static bool _is_4to6_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type);
+static uint8_t _get_reverse_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type);
+static bool _are_in_addrs_usable(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static bool _are_out_addrs_usable(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *out_src_ip, const uint8_t *out_dst_ip);
+static bool _is_ipv4_addr_field_padding_zeroed_out(const uint8_t *addr_field);
+static uint32_t _get_addr_pair_hash(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static bool _select_server(tundra__thread_ctx *const ctx, const uint32_t addr_pair_hash, uint32_t *considered_servers_mask, bool *out_is_probe);
+static size_t _get_preferred_server_index(tundra__thread_ctx *const ctx, const uint32_t addr_pair_hash, const uint32_t considered_servers_mask);
+static bool _is_query_allowed_by_rate_limiter(tundra__thread_ctx *const ctx, const uint8_t message_type);
+static tundra__external_addr_xlat_result _get_fail_fast_result(const uint8_t message_type, const bool send_icmp);
+static tundra__external_addr_xlat_server_state *_get_current_server(tundra__thread_ctx *const ctx);
 static bool _ensure_fds_are_open(tundra__thread_ctx *const ctx);
 static void _close_fds_if_necessary(tundra__thread_ctx *const ctx);
-static int _open_socket(const int family, const int protocol, const struct sockaddr *address, const socklen_t address_length, const struct timeval *timeout);
-static bool _recv_message_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf);
-static bool _send_message_to_fd(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message *message_buf);
-static bool _try_doing_4to6_addr_translation_using_cache(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
-static bool _try_doing_6to4_addr_translation_using_cache(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
-static void _save_4to6_addr_mapping_to_cache(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const uint8_t *out_src_ipv6, const uint8_t *out_dst_ipv6, const time_t cache_lifetime);
-static void _save_6to4_addr_mapping_to_cache(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const uint8_t *out_src_ipv4, const uint8_t *out_dst_ipv4, const time_t cache_lifetime);
-static inline void _save_addr_mapping_to_target_cache_entry(tundra__external_addr_xlat_cache_entry *target_entry, const uint8_t *src_ipv4, const uint8_t *dst_ipv4, const uint8_t *src_ipv6, const uint8_t *dst_ipv6, const time_t cache_lifetime);
-static inline size_t _get_hash_from_in_ipv4_addr_pair(const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const size_t cache_size);
-static inline size_t _get_hash_from_in_ipv6_addr_pair(const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const size_t cache_size);
-static inline time_t _get_current_timestamp(void);
+static int _open_socket(const int family, const int type, const int protocol, const struct sockaddr *address, const socklen_t address_length, const struct timeval *timeout);
+static bool _is_transport_datagram_based(tundra__thread_ctx *const ctx);
+static bool _recv_message_from_fd(tundra__thread_ctx *const ctx, void *message_buf, const size_t message_size);
+static bool _recv_datagram_from_fd(tundra__thread_ctx *const ctx, void *message_buf, const size_t message_size);
+static bool _send_message_to_fd(tundra__thread_ctx *const ctx, const void *message_buf, const size_t message_size);
 
 
 bool xlat_addr_external__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
-    if(_try_doing_4to6_addr_translation_using_cache(
+    return _translate_4to6_addrs(
+        ctx, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET,
         ctx->external_addr_xlat_state->cache_4to6_main_packet,
         ctx->config->addressing_external_cache_size_main_addresses,
         in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6
-    )) return true;
-
-    uint8_t cache_lifetime = 0;
-    if(!_do_external_address_translation(ctx, _MESSAGE_TYPE_4TO6_MAIN_PACKET, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, &cache_lifetime))
-        return false;
-
-    _save_4to6_addr_mapping_to_cache(
-        ctx->external_addr_xlat_state->cache_4to6_main_packet,
-        ctx->config->addressing_external_cache_size_main_addresses,
-        in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6,
-        (time_t) cache_lifetime
     );
-
-    return true;
 }
 
 bool xlat_addr_external__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
-    if(_try_doing_4to6_addr_translation_using_cache(
+    return _translate_4to6_addrs(
+        ctx, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET,
         ctx->external_addr_xlat_state->cache_4to6_icmp_error_packet,
         ctx->config->addressing_external_cache_size_icmp_error_addresses,
         in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6
-    )) return true;
-
-    uint8_t cache_lifetime = 0;
-    if(!_do_external_address_translation(ctx, _MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, &cache_lifetime))
-        return false;
-
-    _save_4to6_addr_mapping_to_cache(
-        ctx->external_addr_xlat_state->cache_4to6_icmp_error_packet,
-        ctx->config->addressing_external_cache_size_icmp_error_addresses,
-        in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6,
-        (time_t) cache_lifetime
     );
-
-    return true;
 }
 
 bool xlat_addr_external__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
-    if(_try_doing_6to4_addr_translation_using_cache(
+    return _translate_6to4_addrs(
+        ctx, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET,
         ctx->external_addr_xlat_state->cache_6to4_main_packet,
         ctx->config->addressing_external_cache_size_main_addresses,
         in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4
-    )) return true;
-
-    uint8_t cache_lifetime = 0;
-    if(!_do_external_address_translation(ctx, _MESSAGE_TYPE_6TO4_MAIN_PACKET, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4, &cache_lifetime))
-        return false;
-
-    _save_6to4_addr_mapping_to_cache(
-        ctx->external_addr_xlat_state->cache_6to4_main_packet,
-        ctx->config->addressing_external_cache_size_main_addresses,
-        in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4,
-        (time_t) cache_lifetime
     );
-
-    return true;
 }
 
 bool xlat_addr_external__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
-    if(_try_doing_6to4_addr_translation_using_cache(
+    return _translate_6to4_addrs(
+        ctx, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET,
         ctx->external_addr_xlat_state->cache_6to4_icmp_error_packet,
         ctx->config->addressing_external_cache_size_icmp_error_addresses,
         in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4
-    )) return true;
+    );
+}
 
-    uint8_t cache_lifetime = 0;
-    if(!_do_external_address_translation(ctx, _MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4, &cache_lifetime))
-        return false;
+static bool _translate_4to6_addrs(tundra__thread_ctx *const ctx, const uint8_t message_type, tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    _process_incoming_messages_if_necessary(ctx);  // Pushed updates and refreshes must be applied before the cache is looked up
+    _evict_expired_cache_entries_if_necessary(ctx);
 
-    _save_6to4_addr_mapping_to_cache(
-        ctx->external_addr_xlat_state->cache_6to4_icmp_error_packet,
-        ctx->config->addressing_external_cache_size_icmp_error_addresses,
-        in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4,
-        (time_t) cache_lifetime
+    // The exact address pair is the longest possible match, so the (cheaper) exact-pair cache is looked up first
+    bool is_stale = false;
+    tundra__external_addr_xlat_result result = xlat_addr_external_cache__lookup_4to6(cache, cache_size, ctx->config->addressing_external_cache_grace_period, ctx->current_timestamp, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, &is_stale);
+    if(is_stale)
+        _refresh_stale_cache_entry(ctx, message_type, in_src_ipv4, in_dst_ipv4);
+
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+        result = _lookup_prefix_cache(ctx, message_type, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE) {
+        tundra__external_addr_xlat_response_params response_params;
+        result = _do_coalesced_external_address_translation(ctx, message_type, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, &response_params);
+
+        if(result != TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+            _save_addr_mapping_to_caches(ctx, message_type, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, result, &response_params);
+    }
+
+    return _act_upon_addr_xlat_result(ctx, message_type, result);
+}
+
+static bool _translate_6to4_addrs(tundra__thread_ctx *const ctx, const uint8_t message_type, tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    _process_incoming_messages_if_necessary(ctx);  // Pushed updates and refreshes must be applied before the cache is looked up
+    _evict_expired_cache_entries_if_necessary(ctx);
+
+    // The exact address pair is the longest possible match, so the (cheaper) exact-pair cache is looked up first
+    bool is_stale = false;
+    tundra__external_addr_xlat_result result = xlat_addr_external_cache__lookup_6to4(cache, cache_size, ctx->config->addressing_external_cache_grace_period, ctx->current_timestamp, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4, &is_stale);
+    if(is_stale)
+        _refresh_stale_cache_entry(ctx, message_type, in_src_ipv6, in_dst_ipv6);
+
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+        result = _lookup_prefix_cache(ctx, message_type, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE) {
+        tundra__external_addr_xlat_response_params response_params;
+        result = _do_coalesced_external_address_translation(ctx, message_type, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4, &response_params);
+
+        if(result != TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+            _save_addr_mapping_to_caches(ctx, message_type, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4, result, &response_params);
+    }
+
+    return _act_upon_addr_xlat_result(ctx, message_type, result);
+}
+
+static tundra__external_addr_xlat_result _lookup_prefix_cache(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip) {
+    const tundra__external_addr_xlat_prefix_cache *prefix_cache = _get_prefix_cache_for_message_type(ctx, message_type);
+    if(prefix_cache == NULL)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    const tundra__external_addr_xlat_result result = (
+        _is_4to6_message_type(ctx, message_type) ?
+        xlat_addr_external_prefix_cache__lookup_4to6(prefix_cache, ctx->current_timestamp, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip) :
+        xlat_addr_external_prefix_cache__lookup_6to4(prefix_cache, ctx->current_timestamp, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip)
     );
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
 
-    return true;
+    // Unlike the entries of the exact-pair caches, which only ever contain addresses checked when they were queried, a
+    //  prefix mapping covers addresses which have never been checked - the packet is dropped if any of them is unusable
+    if(
+        !_are_in_addrs_usable(ctx, message_type, in_src_ip, in_dst_ip) ||
+        (result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS && !_are_out_addrs_usable(ctx, message_type, out_src_ip, out_dst_ip))
+    ) return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR;
+
+    return result;
+}
+
+static void _save_addr_mapping_to_caches(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const tundra__external_addr_xlat_result result, const tundra__external_addr_xlat_response_params *response_params) {
+    const bool is_4to6 = _is_4to6_message_type(ctx, message_type);
+    const time_t cache_lifetime = xlat_addr_external_cache__get_lifetime_from_wire_lifetime(response_params->cache_lifetime);
+
+    if(response_params->is_bidirectional)
+        _save_reverse_addr_mapping_to_caches(ctx, message_type, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, response_params);
+
+    tundra__external_addr_xlat_prefix_cache *prefix_cache = _get_prefix_cache_for_message_type(ctx, message_type);
+    if(response_params->is_prefix_mapping && prefix_cache != NULL) {
+        if(is_4to6)
+            xlat_addr_external_prefix_cache__save_4to6(prefix_cache, ctx->current_timestamp, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, response_params->src_prefix_length, response_params->dst_prefix_length, result, cache_lifetime);
+        else
+            xlat_addr_external_prefix_cache__save_6to4(prefix_cache, ctx->current_timestamp, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, response_params->src_prefix_length, response_params->dst_prefix_length, result, cache_lifetime);
+        return;
+    }
+
+    // If prefix mappings are not cached, the mapping is cached only for the address pair it was received for
+    size_t cache_size = 0;
+    tundra__external_addr_xlat_cache_entry *cache = _get_cache_for_message_type(ctx, message_type, &cache_size);
+    if(is_4to6)
+        xlat_addr_external_cache__save_4to6(cache, cache_size, _get_timer_wheel_for_message_type(ctx, message_type), ctx->current_timestamp, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, result, cache_lifetime);
+    else
+        xlat_addr_external_cache__save_6to4(cache, cache_size, _get_timer_wheel_for_message_type(ctx, message_type), ctx->current_timestamp, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, result, cache_lifetime);
 }
 
-static bool _do_external_address_translation(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, uint8_t *out_cache_lifetime) {
+// A bidirectional mapping also translates the return traffic, i.e. its outbound addresses (swapped) are translated to
+//  its inbound addresses (swapped) in the opposite "direction"; the reverse mapping is inserted into this thread's caches
+//  right away, so that the first packet flowing back does not have to be queried
+static void _save_reverse_addr_mapping_to_caches(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const tundra__external_addr_xlat_response_params *response_params) {
+    const uint8_t reverse_message_type = _get_reverse_message_type(ctx, message_type);
+    if(!_are_in_addrs_usable(ctx, reverse_message_type, out_dst_ip, out_src_ip) || !_are_out_addrs_usable(ctx, reverse_message_type, in_dst_ip, in_src_ip))
+        return;
+
+    tundra__external_addr_xlat_response_params reverse_response_params = *response_params;
+    reverse_response_params.is_bidirectional = false;
+
+    // The number of host bits stays the same, so the prefix lengths only need to be swapped and converted between IPv4
+    //  and IPv6 (see '_get_v2_response_params()')
+    if(response_params->is_prefix_mapping) {
+        if(_is_4to6_message_type(ctx, message_type)) {
+            reverse_response_params.src_prefix_length = (uint8_t) (response_params->dst_prefix_length + 96);
+            reverse_response_params.dst_prefix_length = (uint8_t) (response_params->src_prefix_length + 96);
+        } else {
+            reverse_response_params.src_prefix_length = (uint8_t) (response_params->dst_prefix_length - 96);
+            reverse_response_params.dst_prefix_length = (uint8_t) (response_params->src_prefix_length - 96);
+        }
+    }
+
+    _save_addr_mapping_to_caches(ctx, reverse_message_type, out_dst_ip, out_src_ip, in_dst_ip, in_src_ip, TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS, &reverse_response_params);
+}
+
+static bool _act_upon_addr_xlat_result(tundra__thread_ctx *const ctx, const uint8_t message_type, const tundra__external_addr_xlat_result result) {
+    switch(result) {
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS:
+            return true;
+
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP:
+            // For the ICMP error packet message types, the ICMP bit is not permitted - see '_recv_and_parse_v1_response_from_fd()'
+            if(message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET)
+                router_ipv4__send_dest_host_unreachable_to_in_ipv4_packet_src(ctx);
+            else if(message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET)
+                router_ipv6__send_address_unreachable_to_in_ipv6_packet_src(ctx);
+            return false;
+
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR:
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE:
+            return false;
+
+        default:
+            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid address translation result");
+    }
+}
+
+static tundra__external_addr_xlat_result _do_coalesced_external_address_translation(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params) {
+    // The result is never cached, as its cache lifetime is zero
+    if(!_is_query_allowed_by_rate_limiter(ctx, message_type)) {
+        UTILS__MEM_ZERO_OUT(out_response_params, sizeof(tundra__external_addr_xlat_response_params));
+        return _get_fail_fast_result(message_type, ctx->config->addressing_external_query_rate_limit_icmp);
+    }
+
+    if(ctx->external_addr_xlat_state->inflight_table == NULL)
+        return _do_external_address_translation(ctx, message_type, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, out_response_params);
+
+    tundra__external_addr_xlat_result result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+    size_t slot_index = 0;
+    if(!xlat_addr_external_inflight__join_or_lead(ctx, message_type, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, &result, out_response_params, &slot_index))
+        return result;  // Another thread has already performed the query
+
+    result = _do_external_address_translation(ctx, message_type, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, out_response_params);
+    xlat_addr_external_inflight__finish(ctx, slot_index, result, out_src_ip, out_dst_ip, out_response_params);
+
+    return result;
+}
+
+static tundra__external_addr_xlat_result _do_external_address_translation(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params) {
+    UTILS__MEM_ZERO_OUT(out_response_params, sizeof(tundra__external_addr_xlat_response_params));
+
+    if(!_are_in_addrs_usable(ctx, message_type, in_src_ip, in_dst_ip))
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    // If a protocol or transmission error occurs, the query is retried on the next server in the address pair's order
+    //  of preference (failover)
+    const uint32_t addr_pair_hash = _get_addr_pair_hash(ctx, message_type, in_src_ip, in_dst_ip);
+    uint32_t considered_servers_mask = 0;
+    bool is_probe = false;
+    bool has_queried_any_server = false;
+    tundra__external_addr_xlat_result result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    while(_select_server(ctx, addr_pair_hash, &considered_servers_mask, &is_probe)) {
+        has_queried_any_server = true;
+        result = _query_current_server(ctx, message_type, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, out_response_params);
+
+        // Since the file descriptors get closed whenever a protocol or transmission error occurs, their state tells
+        //  whether the exchange has succeeded
+        const tundra__external_addr_xlat_server_state *const server = _get_current_server(ctx);
+        const bool was_successful = (server->read_fd >= 0 && server->write_fd >= 0);
+
+        if(ctx->external_addr_xlat_state->circuit_breaker != NULL)
+            xlat_addr_external_circuit_breaker__report_exchange_outcome(ctx, ctx->external_addr_xlat_state->current_server_index, is_probe, was_successful);
+
+        if(was_successful)
+            return result;
+    }
+
+    // The circuit breakers of all the servers are open
+    if(!has_queried_any_server)
+        return _get_fail_fast_result(message_type, ctx->config->addressing_external_unix_tcp_circuit_breaker_icmp);
+
+    return result;
+}
+
+static tundra__external_addr_xlat_result _query_current_server(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params) {
     if(!_ensure_fds_are_open(ctx))
-        return false;
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    const uint32_t message_identifier = _get_next_message_identifier(ctx);
+    tundra__external_addr_xlat_server_state *const server = _get_current_server(ctx);
+
+    // Datagrams may get lost, so if the response does not arrive in time, the request is retransmitted (with the same
+    //  identifier, so that a late response to any of the copies is accepted); stream transports never retransmit, since
+    //  their receive timeouts close the file descriptors
+    for(uint32_t retransmission = 0; ; retransmission++) {
+        if(!_send_request_to_fd(ctx, message_type, message_identifier, in_src_ip, in_dst_ip))
+            return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+        tundra__external_addr_xlat_result result;
+        if(ctx->config->addressing_external_protocol_version == 2) {
+            tundra__external_addr_xlat_message_v2 message;
+            result = _recv_and_parse_v2_response_from_fd(ctx, &message, message_type, message_identifier, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, out_response_params);
+        } else {
+            tundra__external_addr_xlat_message message;
+            result = _recv_and_parse_v1_response_from_fd(ctx, &message, message_type, message_identifier, out_src_ip, out_dst_ip, out_response_params);
+        }
+
+        if(server->read_fd < 0 || !server->has_recv_timed_out)
+            return result;
 
+        // The file descriptors are closed so that the server is deemed unresponsive (see '_do_external_address_translation()')
+        if(retransmission >= ctx->config->addressing_external_dgram_retransmissions) {
+            _close_fds_if_necessary(ctx);
+            return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+        }
+    }
+}
+
+static uint32_t _get_next_message_identifier(tundra__thread_ctx *const ctx) {
     const uint32_t message_identifier = htonl(ctx->external_addr_xlat_state->message_identifier);
     ctx->external_addr_xlat_state->message_identifier++; // htonl() may be a macro
 
-    tundra__external_addr_xlat_message message;
+    return message_identifier;
+}
 
-    if(!_construct_and_send_request_to_fd(ctx, &message, message_type, message_identifier, in_src_ip, in_dst_ip))
-        return false;
+static bool _send_request_to_fd(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+    if(ctx->config->addressing_external_protocol_version == 2) {
+        tundra__external_addr_xlat_message_v2 message;
+        return _construct_and_send_v2_request_to_fd(ctx, &message, message_type, message_identifier, in_src_ip, in_dst_ip);
+    }
 
-    return _recv_and_parse_response_from_fd(ctx, &message, message_type, message_identifier, out_src_ip, out_dst_ip, out_cache_lifetime);
+    tundra__external_addr_xlat_message message;
+    return _construct_and_send_v1_request_to_fd(ctx, &message, message_type, message_identifier, in_src_ip, in_dst_ip);
 }
 
-static bool _construct_and_send_request_to_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+static bool _construct_and_send_v1_request_to_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
     UTILS__MEM_ZERO_OUT(message_buf, sizeof(tundra__external_addr_xlat_message));  // Fields which are not further modified will be set to 0
 
     message_buf->magic_byte = _MESSAGE_MAGIC_BYTE;
-    message_buf->version = _MESSAGE_VERSION;
+    message_buf->version = _MESSAGE_VERSION_1;
     message_buf->message_type = message_type;
     message_buf->message_identifier = message_identifier;
 
-    switch(message_type) {
-        case _MESSAGE_TYPE_4TO6_MAIN_PACKET:  // The fall-through is intentional!
-            if(
-                utils_ip__is_ipv4_addr_unusable(in_src_ip) || UTILS_IP__IPV4_ADDR_EQ(in_src_ip, ctx->config->router_ipv4) ||
-                utils_ip__is_ipv4_addr_unusable(in_dst_ip) || UTILS_IP__IPV4_ADDR_EQ(in_dst_ip, ctx->config->router_ipv4)
-            ) return false;
-            __attribute__((fallthrough));
+    const size_t in_addr_size = (_is_4to6_message_type(ctx, message_type) ? 4 : 16);
+    memcpy(message_buf->src_ip, in_src_ip, in_addr_size);
+    memcpy(message_buf->dst_ip, in_dst_ip, in_addr_size);
 
-        case _MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
-            memcpy(message_buf->src_ip, in_src_ip, 4);
-            memcpy(message_buf->dst_ip, in_dst_ip, 4);
-            break;
+    return _send_message_to_fd(ctx, message_buf, sizeof(tundra__external_addr_xlat_message));
+}
 
-        case _MESSAGE_TYPE_6TO4_MAIN_PACKET:  // The fall-through is intentional!
-            if(
-                utils_ip__is_ipv6_addr_unusable(in_src_ip) || UTILS_IP__IPV6_ADDR_EQ(in_src_ip, ctx->config->router_ipv6) ||
-                utils_ip__is_ipv6_addr_unusable(in_dst_ip) || UTILS_IP__IPV6_ADDR_EQ(in_dst_ip, ctx->config->router_ipv6)
-            ) return false;
-            __attribute__((fallthrough));
+static tundra__external_addr_xlat_result _recv_and_parse_v1_response_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params) {
+    // Responses to the queries refreshing stale cache entries may arrive before the awaited response, as may (when a
+    //  datagram transport is used) late duplicates of responses to retransmitted requests
+    for(size_t i = 0; i < _MAX_UNSOLICITED_MESSAGES_PER_RESPONSE; i++) {
+        if(!_recv_message_from_fd(ctx, message_buf, sizeof(tundra__external_addr_xlat_message)))
+            return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
 
-        case _MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
-            memcpy(message_buf->src_ip, in_src_ip, 16);
-            memcpy(message_buf->dst_ip, in_dst_ip, 16);
+        if(message_buf->magic_byte != _MESSAGE_MAGIC_BYTE || message_buf->version != _MESSAGE_VERSION_1)
             break;
 
-        default:
-            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+        if(message_buf->message_identifier == message_identifier) {
+            tundra__external_addr_xlat_result result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+            if(!_parse_v1_response(ctx, message_buf, message_type, out_src_ip, out_dst_ip, out_response_params, &result))
+                break;
+            return result;
+        }
+
+        if(!_process_refresh_response(ctx, message_buf, message_buf->message_identifier) && !_is_transport_datagram_based(ctx))
+            break;
     }
 
-    return _send_message_to_fd(ctx, message_buf);
+    _close_fds_if_necessary(ctx);
+    return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
 }
 
-static bool _recv_and_parse_response_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, const uint32_t message_identifier, uint8_t *out_src_ip, uint8_t *out_dst_ip, uint8_t *out_cache_lifetime) {
+// Returns false if the response violates the protocol (the caller is expected to close the file descriptors)
+static bool _parse_v1_response(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message *message_buf, const uint8_t message_type, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params, tundra__external_addr_xlat_result *out_result) {
     /*
      * The protocol specification states that if a value of a field in certain types of messages is not explicitly
      * defined in it (e.g. what addresses should the IP address fields contain in case of an erroneous 'response'
@@ -207,86 +439,664 @@ static bool _recv_and_parse_response_from_fd(tundra__thread_ctx *const ctx, tund
      * however, change in a future version of this program, so it is not a good idea to rely on it.
      */
 
-    if(!_recv_message_from_fd(ctx, message_buf))
-        return false;
+    if(message_buf->message_type == (message_type + _MESSAGE_TYPE_BITS_RESPONSE_ERROR_ICMP)) {
+        // For the ICMP error packet message types, the ICMP bit is not permitted, since these message types signify
+        //  that the addresses of a partial packet inside an ICMP error message's body are being translated, and since
+        //  ICMPv4 Destination Host Unreachable / ICMPv6 Address Unreachable signify that the main (outer) packet's
+        //  addresses are those in error, it would be a mistake to send them in this case
+        if(message_type != XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET && message_type != XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET)
+            return false;
 
-    if(message_buf->magic_byte != _MESSAGE_MAGIC_BYTE || message_buf->version != _MESSAGE_VERSION || message_buf->message_identifier != message_identifier) {
-        _close_fds_if_necessary(ctx);
-        return false;
+        out_response_params->cache_lifetime = message_buf->cache_lifetime;  // Negative cache lifetime
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP;
+        return true;
     }
 
-    if(message_buf->message_type == (message_type + 224)) {  // Bits set: response, error, ICMP
-        switch(message_type) {
-            case _MESSAGE_TYPE_4TO6_MAIN_PACKET:
-                router_ipv4__send_dest_host_unreachable_to_in_ipv4_packet_src(ctx);
-                return false;
+    if(message_buf->message_type == (message_type + _MESSAGE_TYPE_BITS_RESPONSE_ERROR)) {
+        out_response_params->cache_lifetime = message_buf->cache_lifetime;  // Negative cache lifetime
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR;
+        return true;
+    }
 
-            case _MESSAGE_TYPE_6TO4_MAIN_PACKET:
-                router_ipv6__send_address_unreachable_to_in_ipv6_packet_src(ctx);
-                return false;
+    if(message_buf->message_type == (message_type + _MESSAGE_TYPE_BITS_RESPONSE)) {
+        if(!_are_out_addrs_usable(ctx, message_type, message_buf->src_ip, message_buf->dst_ip)) {
+            *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+            return true;
+        }
 
-            case _MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
-            case _MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
-                // These message types signify that the addresses of a partial packet inside an ICMP error message's
-                //  body are being translated, and since ICMPv4 Destination Host Unreachable / ICMPv6 Address
-                //  Unreachable signify that the main (outer) packet's addresses are those in error, it would be a
-                //  mistake to send them in this case
-                _close_fds_if_necessary(ctx);
+        if(_is_4to6_message_type(ctx, message_type)) {
+            memcpy(out_src_ip, message_buf->src_ip, 16);
+            memcpy(out_dst_ip, message_buf->dst_ip, 16);
+        } else {
+            if(!_is_ipv4_addr_field_padding_zeroed_out(message_buf->src_ip) || !_is_ipv4_addr_field_padding_zeroed_out(message_buf->dst_ip))
                 return false;
+            memcpy(out_src_ip, message_buf->src_ip, 4);
+            memcpy(out_dst_ip, message_buf->dst_ip, 4);
+        }
+
+        out_response_params->cache_lifetime = message_buf->cache_lifetime;
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS;
+        return true;
+    }
+
+    return false;
+}
+
+static bool _construct_and_send_v2_request_to_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message_v2 *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+    UTILS__MEM_ZERO_OUT(message_buf, sizeof(tundra__external_addr_xlat_message_v2));  // Fields which are not further modified will be set to 0
 
-            default:
-                log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    message_buf->magic_byte = _MESSAGE_MAGIC_BYTE;
+    message_buf->version = _MESSAGE_VERSION_2;
+    message_buf->message_type = message_type;
+    message_buf->message_identifier = message_identifier;
+
+    const size_t in_addr_size = (_is_4to6_message_type(ctx, message_type) ? 4 : 16);
+    memcpy(message_buf->in_src_ip, in_src_ip, in_addr_size);
+    memcpy(message_buf->in_dst_ip, in_dst_ip, in_addr_size);
+
+    return _send_message_to_fd(ctx, message_buf, sizeof(tundra__external_addr_xlat_message_v2));
+}
+
+static tundra__external_addr_xlat_result _recv_and_parse_v2_response_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message_v2 *message_buf, const uint8_t message_type, const uint32_t message_identifier, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params) {
+    // The server may push unsolicited messages at any time, including while a response is being awaited; however, if
+    //  it keeps pushing them and does not send the response, the connection is deemed broken. Responses to the queries
+    //  refreshing stale cache entries may arrive in the meantime as well.
+    for(size_t i = 0; i < _MAX_UNSOLICITED_MESSAGES_PER_RESPONSE; i++) {
+        if(!_recv_message_from_fd(ctx, message_buf, sizeof(tundra__external_addr_xlat_message_v2)))
+            return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+        if(!_is_v2_message_header_valid(message_buf))
+            break;
+
+        if(message_buf->flags & _MESSAGE_FLAG_UNSOLICITED) {
+            if(!_process_unsolicited_v2_message(ctx, message_buf))
+                break;
+            continue;
+        }
+
+        if(message_buf->message_identifier == message_identifier) {
+            tundra__external_addr_xlat_result result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+            if(!_parse_v2_response(ctx, message_buf, message_type, in_src_ip, in_dst_ip, out_src_ip, out_dst_ip, out_response_params, &result))
+                break;
+            return result;
         }
+
+        if(!_process_refresh_response(ctx, message_buf, message_buf->message_identifier) && !_is_transport_datagram_based(ctx))
+            break;
     }
 
-    if(message_buf->message_type == (message_type + 192)) {  // Bits set: response, error
-        return false;
+    _close_fds_if_necessary(ctx);
+    return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+}
+
+// Returns false if the response violates the protocol (the caller is expected to close the file descriptors)
+static bool _parse_v2_response(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message_v2 *message_buf, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_response_params *out_response_params, tundra__external_addr_xlat_result *out_result) {
+    const size_t in_addr_size = (_is_4to6_message_type(ctx, message_type) ? 4 : 16);
+    if(
+        (message_buf->flags & ((uint8_t) ~(_MESSAGE_FLAG_PREFIX | _MESSAGE_FLAG_BIDIRECTIONAL))) != 0 ||
+        !UTILS__MEM_EQ(message_buf->in_src_ip, in_src_ip, in_addr_size) || !UTILS__MEM_EQ(message_buf->in_dst_ip, in_dst_ip, in_addr_size)
+    ) return false;
+
+    if(message_buf->message_type == (message_type + _MESSAGE_TYPE_BITS_RESPONSE_ERROR_ICMP)) {
+        // See '_parse_v1_response()'
+        if(message_type != XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET && message_type != XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET)
+            return false;
+
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP;
+        return _get_v2_response_params(ctx, message_type, message_buf, TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP, out_response_params);
     }
 
-    if(message_buf->message_type == (message_type + 128)) {  // Bits set: response
-        switch(message_type) {
-            case _MESSAGE_TYPE_4TO6_MAIN_PACKET:  // The fall-through is intentional!
-                if(
-                    utils_ip__is_ipv6_addr_unusable(message_buf->src_ip) || UTILS_IP__IPV6_ADDR_EQ(message_buf->src_ip, ctx->config->router_ipv6) ||
-                    utils_ip__is_ipv6_addr_unusable(message_buf->dst_ip) || UTILS_IP__IPV6_ADDR_EQ(message_buf->dst_ip, ctx->config->router_ipv6)
-                ) return false;
-                __attribute__((fallthrough));
+    if(message_buf->message_type == (message_type + _MESSAGE_TYPE_BITS_RESPONSE_ERROR)) {
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR;
+        return _get_v2_response_params(ctx, message_type, message_buf, TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR, out_response_params);
+    }
 
-            case _MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
-                memcpy(out_src_ip, message_buf->src_ip, 16);
-                memcpy(out_dst_ip, message_buf->dst_ip, 16);
+    if(message_buf->message_type == (message_type + _MESSAGE_TYPE_BITS_RESPONSE)) {
+        if(!_are_out_addrs_usable(ctx, message_type, message_buf->out_src_ip, message_buf->out_dst_ip)) {
+            *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+            return true;
+        }
+
+        if(!_get_v2_response_params(ctx, message_type, message_buf, TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS, out_response_params))
+            return false;
+
+        const size_t out_addr_size = (_is_4to6_message_type(ctx, message_type) ? 16 : 4);
+        memcpy(out_src_ip, message_buf->out_src_ip, out_addr_size);
+        memcpy(out_dst_ip, message_buf->out_dst_ip, out_addr_size);
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS;
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * When a stale cache entry (i.e. an entry which has expired, but is still within the grace period) is used, a query
+ * refreshing it is sent without waiting for its response; the response is processed whenever it arrives (see
+ * '_process_refresh_response()'), and meanwhile, the stale entry keeps being used for translation. At most one refresh
+ * of an address pair may be pending at a time.
+ */
+static void _refresh_stale_cache_entry(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+    tundra__external_addr_xlat_state *const state = ctx->external_addr_xlat_state;
+    const size_t in_addr_size = (_is_4to6_message_type(ctx, message_type) ? 4 : 16);
+
+    if(state->pending_refresh_count >= TUNDRA__ADDRESSING_EXTERNAL_MAX_PENDING_REFRESHES)
+        return;
+
+    tundra__external_addr_xlat_pending_refresh *free_pending_refresh = NULL;
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_EXTERNAL_MAX_PENDING_REFRESHES; i++) {
+        tundra__external_addr_xlat_pending_refresh *pending_refresh = state->pending_refreshes + i;
+
+        if(!pending_refresh->is_in_use) {
+            if(free_pending_refresh == NULL)
+                free_pending_refresh = pending_refresh;
+            continue;
+        }
+
+        if(
+            pending_refresh->message_type == message_type &&
+            UTILS__MEM_EQ(pending_refresh->in_src_ip, in_src_ip, in_addr_size) && UTILS__MEM_EQ(pending_refresh->in_dst_ip, in_dst_ip, in_addr_size)
+        ) return;
+    }
+
+    if(free_pending_refresh == NULL)
+        return;
+
+    // The refresh is sent only to the address pair's most preferred server, and only if its circuit breaker is closed,
+    //  as a refresh cannot be a probe (its outcome is not known immediately)
+    const size_t server_index = _get_preferred_server_index(ctx, _get_addr_pair_hash(ctx, message_type, in_src_ip, in_dst_ip), 0);
+    if(state->circuit_breaker != NULL && !xlat_addr_external_circuit_breaker__is_server_closed(ctx, server_index))
+        return;
+    state->current_server_index = server_index;
+
+    const uint32_t message_identifier = _get_next_message_identifier(ctx);
+    if(!_ensure_fds_are_open(ctx) || !_send_request_to_fd(ctx, message_type, message_identifier, in_src_ip, in_dst_ip)) {
+        if(state->circuit_breaker != NULL)
+            xlat_addr_external_circuit_breaker__report_exchange_outcome(ctx, server_index, false, false);
+        return;
+    }
+
+    UTILS__MEM_ZERO_OUT(free_pending_refresh, sizeof(tundra__external_addr_xlat_pending_refresh));
+    memcpy(free_pending_refresh->in_src_ip, in_src_ip, in_addr_size);
+    memcpy(free_pending_refresh->in_dst_ip, in_dst_ip, in_addr_size);
+    free_pending_refresh->server_index = server_index;
+    free_pending_refresh->message_identifier = message_identifier;
+    free_pending_refresh->message_type = message_type;
+    free_pending_refresh->is_in_use = true;
+    state->pending_refresh_count++;
+}
+
+// 'message_buf' must point to a message of the configured protocol version, whose header has already been validated.
+// Returns false if the message is not a response to a pending refresh sent to the current server, or if it violates
+//  the protocol (the caller is expected to close the file descriptors).
+static bool _process_refresh_response(tundra__thread_ctx *const ctx, const void *message_buf, const uint32_t message_identifier) {
+    tundra__external_addr_xlat_state *const state = ctx->external_addr_xlat_state;
+
+    tundra__external_addr_xlat_pending_refresh *pending_refresh = NULL;
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_EXTERNAL_MAX_PENDING_REFRESHES && pending_refresh == NULL; i++) {
+        tundra__external_addr_xlat_pending_refresh *current_pending_refresh = state->pending_refreshes + i;
+
+        if(current_pending_refresh->is_in_use && current_pending_refresh->message_identifier == message_identifier && current_pending_refresh->server_index == state->current_server_index)
+            pending_refresh = current_pending_refresh;
+    }
+
+    if(pending_refresh == NULL)
+        return false;
+
+    pending_refresh->is_in_use = false;
+    state->pending_refresh_count--;
+
+    uint8_t out_src_ip[16];
+    uint8_t out_dst_ip[16];
+    tundra__external_addr_xlat_response_params response_params;
+    UTILS__MEM_ZERO_OUT(&response_params, sizeof(tundra__external_addr_xlat_response_params));
+    tundra__external_addr_xlat_result result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    const bool is_response_valid = (
+        (ctx->config->addressing_external_protocol_version == 2) ?
+        _parse_v2_response(ctx, (const tundra__external_addr_xlat_message_v2 *) message_buf, pending_refresh->message_type, pending_refresh->in_src_ip, pending_refresh->in_dst_ip, out_src_ip, out_dst_ip, &response_params, &result) :
+        _parse_v1_response(ctx, (const tundra__external_addr_xlat_message *) message_buf, pending_refresh->message_type, out_src_ip, out_dst_ip, &response_params, &result)
+    );
+    if(!is_response_valid)
+        return false;
+
+    if(result != TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+        _save_addr_mapping_to_caches(ctx, pending_refresh->message_type, pending_refresh->in_src_ip, pending_refresh->in_dst_ip, out_src_ip, out_dst_ip, result, &response_params);
+
+    return true;
+}
+
+static void _process_incoming_messages_if_necessary(tundra__thread_ctx *const ctx) {
+    tundra__external_addr_xlat_state *const state = ctx->external_addr_xlat_state;
+    const bool is_protocol_version_2 = (ctx->config->addressing_external_protocol_version == 2);
+
+    // Protocol version 1 servers only send responses, so there is nothing to process unless a refresh is pending
+    if(!is_protocol_version_2 && state->pending_refresh_count == 0)
+        return;
+
+    // To keep the overhead on the fast path low, the file descriptors are checked for pushed messages at most once per
+    //  second (in addition to the messages being processed while a response is awaited); if refreshes are pending, they
+    //  are checked every time, so that their responses are applied as soon as possible
+    if(state->pending_refresh_count == 0 && ctx->current_timestamp == state->last_push_check_timestamp)
+        return;
+    state->last_push_check_timestamp = ctx->current_timestamp;
+
+    for(size_t server_index = 0; server_index < ctx->config->addressing_external_server_count; server_index++) {
+        state->current_server_index = server_index;
+        tundra__external_addr_xlat_server_state *const server = _get_current_server(ctx);
+
+        for(size_t i = 0; i < _MAX_UNSOLICITED_MESSAGES_PER_CHECK && server->read_fd >= 0 && server->write_fd >= 0; i++) {
+            struct pollfd poll_fd = {.fd = server->read_fd, .events = POLLIN, .revents = 0};
+            if(poll(&poll_fd, 1, 0) < 1)  // Does not block
                 break;
 
-            case _MESSAGE_TYPE_6TO4_MAIN_PACKET:  // The fall-through is intentional!
-                if(
-                    utils_ip__is_ipv4_addr_unusable(message_buf->src_ip) || UTILS_IP__IPV4_ADDR_EQ(message_buf->src_ip, ctx->config->router_ipv4) ||
-                    utils_ip__is_ipv4_addr_unusable(message_buf->dst_ip) || UTILS_IP__IPV4_ADDR_EQ(message_buf->dst_ip, ctx->config->router_ipv4)
-                ) return false;
-                __attribute__((fallthrough));
-
-            case _MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
-                if(!UTILS__MEM_EQ(((uint8_t *) message_buf->src_ip) + 4, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", 12) || !UTILS__MEM_EQ(((uint8_t *) message_buf->dst_ip) + 4, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", 12)) {
-                    _close_fds_if_necessary(ctx);
-                    return false;
-                }
-                memcpy(out_src_ip, message_buf->src_ip, 4);
-                memcpy(out_dst_ip, message_buf->dst_ip, 4);
+            // If the peer has closed the connection, the following read() fails and the file descriptors get closed.
+            // No response is awaited at this moment, so only unsolicited messages and responses to refreshes are
+            //  permitted (plus, when a datagram transport is used, late duplicates of responses, which are ignored).
+            bool is_message_valid;
+            if(is_protocol_version_2) {
+                tundra__external_addr_xlat_message_v2 message;
+                if(!_recv_message_from_fd(ctx, &message, sizeof(tundra__external_addr_xlat_message_v2)))
+                    break;
+
+                if(!_is_v2_message_header_valid(&message))
+                    is_message_valid = false;
+                else if(message.flags & _MESSAGE_FLAG_UNSOLICITED)
+                    is_message_valid = _process_unsolicited_v2_message(ctx, &message);
+                else
+                    is_message_valid = (_process_refresh_response(ctx, &message, message.message_identifier) || _is_transport_datagram_based(ctx));
+            } else {
+                tundra__external_addr_xlat_message message;
+                if(!_recv_message_from_fd(ctx, &message, sizeof(tundra__external_addr_xlat_message)))
+                    break;
+
+                is_message_valid = (
+                    message.magic_byte == _MESSAGE_MAGIC_BYTE && message.version == _MESSAGE_VERSION_1 &&
+                    (_process_refresh_response(ctx, &message, message.message_identifier) || _is_transport_datagram_based(ctx))
+                );
+            }
+
+            if(!is_message_valid) {
+                _close_fds_if_necessary(ctx);
                 break;
+            }
+        }
+    }
+}
+
+// The due entries are evicted at most once per second (when the coarse clock ticks), unless the previous pass has been
+//  cut short; the number of entries evicted per pass is limited, so that a mass expiration does not cause a latency spike
+static void _evict_expired_cache_entries_if_necessary(tundra__thread_ctx *const ctx) {
+    tundra__external_addr_xlat_state *const state = ctx->external_addr_xlat_state;
+    if(!state->are_evictions_pending && ctx->current_timestamp == state->last_eviction_timestamp)
+        return;
+    state->last_eviction_timestamp = ctx->current_timestamp;
+
+    static const uint8_t message_types[4] = {
+        XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET,
+        XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET
+    };
+
+    bool are_evictions_complete = true;
+    for(size_t i = 0; i < 4; i++) {
+        size_t cache_size = 0;
+        tundra__external_addr_xlat_cache_entry *cache = _get_cache_for_message_type(ctx, message_types[i], &cache_size);
+        tundra__external_addr_xlat_timer_wheel *timer_wheel = _get_timer_wheel_for_message_type(ctx, message_types[i]);
+        if(timer_wheel != NULL)
+            are_evictions_complete &= xlat_addr_external_cache__evict_expired_entries(cache, timer_wheel, ctx->config->addressing_external_cache_grace_period, ctx->current_timestamp, _MAX_EVICTED_ENTRIES_PER_CACHE_PER_PASS);
+
+        are_evictions_complete &= xlat_addr_external_prefix_cache__evict_expired_entries(_get_prefix_cache_for_message_type(ctx, message_types[i]), ctx->current_timestamp, _MAX_EVICTED_ENTRIES_PER_CACHE_PER_PASS);
+    }
+
+    state->are_evictions_pending = !are_evictions_complete;
+}
+
+// Returns false if the message violates the protocol (the caller is expected to close the file descriptors)
+static bool _process_unsolicited_v2_message(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message_v2 *message_buf) {
+    const uint8_t message_type = (message_buf->message_type & _MESSAGE_TYPE_MASK);
+    const uint8_t message_type_bits = (message_buf->message_type & ((uint8_t) ~_MESSAGE_TYPE_MASK));
 
-            default:
-                log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    size_t cache_size = 0;
+    tundra__external_addr_xlat_cache_entry *cache = _get_cache_for_message_type(ctx, message_type, &cache_size);
+    if(cache == NULL && cache_size == SIZE_MAX)
+        return false;  // Invalid message type
+
+    const bool is_4to6 = _is_4to6_message_type(ctx, message_type);
+
+    if(message_buf->flags == (_MESSAGE_FLAG_UNSOLICITED | _MESSAGE_FLAG_INVALIDATE)) {
+        const uint8_t max_prefix_length = (is_4to6 ? 32 : 128);
+        if(message_type_bits != 0 || message_buf->src_prefix_length > max_prefix_length || message_buf->dst_prefix_length > max_prefix_length)
+            return false;
+
+        tundra__external_addr_xlat_prefix_cache *prefix_cache = _get_prefix_cache_for_message_type(ctx, message_type);
+        if(is_4to6) {
+            xlat_addr_external_cache__invalidate_4to6(cache, cache_size, message_buf->in_src_ip, message_buf->src_prefix_length, message_buf->in_dst_ip, message_buf->dst_prefix_length);
+            xlat_addr_external_prefix_cache__invalidate_4to6(prefix_cache, message_buf->in_src_ip, message_buf->src_prefix_length, message_buf->in_dst_ip, message_buf->dst_prefix_length);
+        } else {
+            xlat_addr_external_cache__invalidate_6to4(cache, cache_size, message_buf->in_src_ip, message_buf->src_prefix_length, message_buf->in_dst_ip, message_buf->dst_prefix_length);
+            xlat_addr_external_prefix_cache__invalidate_6to4(prefix_cache, message_buf->in_src_ip, message_buf->src_prefix_length, message_buf->in_dst_ip, message_buf->dst_prefix_length);
         }
 
-        *out_cache_lifetime = message_buf->cache_lifetime;
         return true;
     }
 
-    _close_fds_if_necessary(ctx);
-    return false;
+    if((message_buf->flags & ((uint8_t) ~(_MESSAGE_FLAG_PREFIX | _MESSAGE_FLAG_BIDIRECTIONAL))) != _MESSAGE_FLAG_UNSOLICITED)
+        return false;
+
+    tundra__external_addr_xlat_result result;
+    switch(message_type_bits) {
+        case _MESSAGE_TYPE_BITS_RESPONSE:
+            result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS;
+            break;
+
+        case _MESSAGE_TYPE_BITS_RESPONSE_ERROR:
+            result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR;
+            break;
+
+        case _MESSAGE_TYPE_BITS_RESPONSE_ERROR_ICMP:
+            // See '_parse_v1_response()'
+            if(message_type != XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET && message_type != XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET)
+                return false;
+            result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP;
+            break;
+
+        default:
+            return false;
+    }
+
+    tundra__external_addr_xlat_response_params response_params;
+    if(!_get_v2_response_params(ctx, message_type, message_buf, result, &response_params))
+        return false;
+
+    // Mappings which could never be used by the translator (e.g. those for unusable addresses) are silently ignored
+    if(
+        !_are_in_addrs_usable(ctx, message_type, message_buf->in_src_ip, message_buf->in_dst_ip) ||
+        (result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS && !_are_out_addrs_usable(ctx, message_type, message_buf->out_src_ip, message_buf->out_dst_ip))
+    ) return true;
+
+    _save_addr_mapping_to_caches(ctx, message_type, message_buf->in_src_ip, message_buf->in_dst_ip, message_buf->out_src_ip, message_buf->out_dst_ip, result, &response_params);
+
+    return true;
+}
+
+// Returns false if the message violates the protocol; the other fields of the message must have already been validated
+static bool _get_v2_response_params(tundra__thread_ctx *const ctx, const uint8_t message_type, const tundra__external_addr_xlat_message_v2 *message_buf, const tundra__external_addr_xlat_result result, tundra__external_addr_xlat_response_params *out_response_params) {
+    UTILS__MEM_ZERO_OUT(out_response_params, sizeof(tundra__external_addr_xlat_response_params));
+    out_response_params->cache_lifetime = ntohl(message_buf->cache_lifetime);
+
+    // Only successful mappings can be bidirectional - an erroneous answer says nothing about the return traffic
+    if(message_buf->flags & _MESSAGE_FLAG_BIDIRECTIONAL) {
+        if(result != TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS)
+            return false;
+        out_response_params->is_bidirectional = true;
+    }
+
+    if(!(message_buf->flags & _MESSAGE_FLAG_PREFIX))
+        return (message_buf->src_prefix_length == 0 && message_buf->dst_prefix_length == 0);
+
+    // The inbound & outbound prefixes of a prefix mapping must have the same number of host bits, which must not exceed
+    //  32 (the size of an IPv4 address)
+    const bool is_4to6 = _is_4to6_message_type(ctx, message_type);
+    const uint8_t min_prefix_length = (is_4to6 ? 0 : 96);
+    const uint8_t max_prefix_length = (is_4to6 ? 32 : 128);
+    if(
+        message_buf->src_prefix_length < min_prefix_length || message_buf->src_prefix_length > max_prefix_length ||
+        message_buf->dst_prefix_length < min_prefix_length || message_buf->dst_prefix_length > max_prefix_length
+    ) return false;
+
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+        const size_t in_addr_size = (is_4to6 ? 4 : 16);
+        const size_t out_addr_size = (is_4to6 ? 16 : 4);
+        if(
+            !xlat_addr_external_prefix_cache__is_mapping_consistent(message_buf->in_src_ip, in_addr_size, message_buf->out_src_ip, out_addr_size, (uint8_t) (max_prefix_length - message_buf->src_prefix_length)) ||
+            !xlat_addr_external_prefix_cache__is_mapping_consistent(message_buf->in_dst_ip, in_addr_size, message_buf->out_dst_ip, out_addr_size, (uint8_t) (max_prefix_length - message_buf->dst_prefix_length))
+        ) return false;
+    }
+
+    out_response_params->src_prefix_length = message_buf->src_prefix_length;
+    out_response_params->dst_prefix_length = message_buf->dst_prefix_length;
+    out_response_params->is_prefix_mapping = true;
+
+    return true;
+}
+
+// Checks the fields which have to be valid in every version 2 message, including the zero padding of IPv4 addresses
+static bool _is_v2_message_header_valid(const tundra__external_addr_xlat_message_v2 *message_buf) {
+    if(message_buf->magic_byte != _MESSAGE_MAGIC_BYTE || message_buf->version != _MESSAGE_VERSION_2 || !UTILS__MEM_EQ(message_buf->reserved, "\x00\x00", 2))
+        return false;
+
+    switch(message_buf->message_type & _MESSAGE_TYPE_MASK) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+            return (_is_ipv4_addr_field_padding_zeroed_out(message_buf->in_src_ip) && _is_ipv4_addr_field_padding_zeroed_out(message_buf->in_dst_ip));
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            return (_is_ipv4_addr_field_padding_zeroed_out(message_buf->out_src_ip) && _is_ipv4_addr_field_padding_zeroed_out(message_buf->out_dst_ip));
+
+        default:
+            return false;
+    }
+}
+
+// If the message type is invalid, NULL is returned and 'out_cache_size' is set to SIZE_MAX; if the cache for the
+//  message type is disabled, NULL is returned and 'out_cache_size' is set to 0
+static tundra__external_addr_xlat_cache_entry *_get_cache_for_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type, size_t *out_cache_size) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+            *out_cache_size = ctx->config->addressing_external_cache_size_main_addresses;
+            return ctx->external_addr_xlat_state->cache_4to6_main_packet;
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+            *out_cache_size = ctx->config->addressing_external_cache_size_icmp_error_addresses;
+            return ctx->external_addr_xlat_state->cache_4to6_icmp_error_packet;
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            *out_cache_size = ctx->config->addressing_external_cache_size_main_addresses;
+            return ctx->external_addr_xlat_state->cache_6to4_main_packet;
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            *out_cache_size = ctx->config->addressing_external_cache_size_icmp_error_addresses;
+            return ctx->external_addr_xlat_state->cache_6to4_icmp_error_packet;
+
+        default:
+            *out_cache_size = SIZE_MAX;
+            return NULL;
+    }
+}
+
+static tundra__external_addr_xlat_prefix_cache *_get_prefix_cache_for_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET: return ctx->external_addr_xlat_state->prefix_cache_4to6_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET: return ctx->external_addr_xlat_state->prefix_cache_4to6_icmp_error_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET: return ctx->external_addr_xlat_state->prefix_cache_6to4_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET: return ctx->external_addr_xlat_state->prefix_cache_6to4_icmp_error_packet;
+        default: log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    }
+}
+
+static tundra__external_addr_xlat_timer_wheel *_get_timer_wheel_for_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET: return ctx->external_addr_xlat_state->timer_wheel_4to6_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET: return ctx->external_addr_xlat_state->timer_wheel_4to6_icmp_error_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET: return ctx->external_addr_xlat_state->timer_wheel_6to4_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET: return ctx->external_addr_xlat_state->timer_wheel_6to4_icmp_error_packet;
+        default: log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    }
+}
+
+static uint8_t _get_reverse_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET: return XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET: return XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET: return XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET: return XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET;
+        default: log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    }
+}
+
+static bool _is_4to6_message_type(tundra__thread_ctx *const ctx, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+            return true;
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            return false;
+
+        default:
+            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    }
+}
+
+// The addresses of partial packets inside ICMP error messages' bodies are not checked, as they may be arbitrary
+static bool _are_in_addrs_usable(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+            return !(
+                utils_ip__is_ipv4_addr_unusable(in_src_ip) || UTILS_IP__IPV4_ADDR_EQ(in_src_ip, ctx->config->router_ipv4) ||
+                utils_ip__is_ipv4_addr_unusable(in_dst_ip) || UTILS_IP__IPV4_ADDR_EQ(in_dst_ip, ctx->config->router_ipv4)
+            );
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            return !(
+                utils_ip__is_ipv6_addr_unusable(in_src_ip) || UTILS_IP__IPV6_ADDR_EQ(in_src_ip, ctx->config->router_ipv6) ||
+                utils_ip__is_ipv6_addr_unusable(in_dst_ip) || UTILS_IP__IPV6_ADDR_EQ(in_dst_ip, ctx->config->router_ipv6)
+            );
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            return true;
+
+        default:
+            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    }
+}
+
+// The addresses of partial packets inside ICMP error messages' bodies are not checked, as they may be arbitrary
+static bool _are_out_addrs_usable(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *out_src_ip, const uint8_t *out_dst_ip) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+            return !(
+                utils_ip__is_ipv6_addr_unusable(out_src_ip) || UTILS_IP__IPV6_ADDR_EQ(out_src_ip, ctx->config->router_ipv6) ||
+                utils_ip__is_ipv6_addr_unusable(out_dst_ip) || UTILS_IP__IPV6_ADDR_EQ(out_dst_ip, ctx->config->router_ipv6)
+            );
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            return !(
+                utils_ip__is_ipv4_addr_unusable(out_src_ip) || UTILS_IP__IPV4_ADDR_EQ(out_src_ip, ctx->config->router_ipv4) ||
+                utils_ip__is_ipv4_addr_unusable(out_dst_ip) || UTILS_IP__IPV4_ADDR_EQ(out_dst_ip, ctx->config->router_ipv4)
+            );
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            return true;
+
+        default:
+            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid message type");
+    }
+}
+
+// IPv4 addresses occupy the first 4 bytes of the 16-byte address fields; the rest of the field must be zeroed out
+static bool _is_ipv4_addr_field_padding_zeroed_out(const uint8_t *addr_field) {
+    return UTILS__MEM_EQ(addr_field + 4, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", 12);
+}
+
+static uint32_t _get_addr_pair_hash(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+    // 32-bit FNV-1a
+    const size_t in_addr_size = (_is_4to6_message_type(ctx, message_type) ? 4 : 16);
+    uint32_t hash = 2166136261;
+
+    hash = (hash ^ message_type) * 16777619;
+    for(size_t i = 0; i < in_addr_size; i++)
+        hash = (hash ^ in_src_ip[i]) * 16777619;
+    for(size_t i = 0; i < in_addr_size; i++)
+        hash = (hash ^ in_dst_ip[i]) * 16777619;
+
+    return hash;
+}
+
+// Rendezvous (highest random weight) hashing is used to distribute the queries among the servers: each server is given
+//  a pseudo-random score for the address pair, and the server with the highest score which has not been considered yet
+//  is selected. This way, adding or removing a server only redistributes the address pairs which map to it. Servers
+//  whose circuit breaker is open are skipped.
+// Returns false if there is no server left to query.
+static bool _select_server(tundra__thread_ctx *const ctx, const uint32_t addr_pair_hash, uint32_t *considered_servers_mask, bool *out_is_probe) {
+    for(;;) {
+        const size_t selected_server_index = _get_preferred_server_index(ctx, addr_pair_hash, *considered_servers_mask);
+        if(selected_server_index == SIZE_MAX)
+            return false;
+
+        *considered_servers_mask |= (((uint32_t) 1) << selected_server_index);
+
+        *out_is_probe = false;
+        if(ctx->external_addr_xlat_state->circuit_breaker == NULL || xlat_addr_external_circuit_breaker__try_acquire_server(ctx, selected_server_index, out_is_probe)) {
+            ctx->external_addr_xlat_state->current_server_index = selected_server_index;
+            return true;
+        }
+    }
+}
+
+// Returns the index of the server with the highest score among those not present in 'considered_servers_mask', or
+//  SIZE_MAX if there is no such server
+static size_t _get_preferred_server_index(tundra__thread_ctx *const ctx, const uint32_t addr_pair_hash, const uint32_t considered_servers_mask) {
+    size_t selected_server_index = SIZE_MAX;
+    uint32_t selected_server_score = 0;
+
+    for(size_t i = 0; i < ctx->config->addressing_external_server_count; i++) {
+        if(considered_servers_mask & (((uint32_t) 1) << i))
+            continue;
+
+        // The murmur3 finalizer
+        uint32_t score = addr_pair_hash ^ ctx->config->addressing_external_server_hash_seeds[i];
+        score ^= score >> 16;
+        score *= 0x85ebca6b;
+        score ^= score >> 13;
+        score *= 0xc2b2ae35;
+        score ^= score >> 16;
+
+        if(selected_server_index == SIZE_MAX || score > selected_server_score) {
+            selected_server_index = i;
+            selected_server_score = score;
+        }
+    }
+
+    return selected_server_index;
+}
+
+// The source of the packet being translated is the one who makes Tundra send the query - for the ICMP error packet
+//  message types, this is not the source address within the packet "in error"
+static bool _is_query_allowed_by_rate_limiter(tundra__thread_ctx *const ctx, const uint8_t message_type) {
+    if(ctx->external_addr_xlat_state->rate_limiter == NULL)
+        return true;
+
+    if(_is_4to6_message_type(ctx, message_type))
+        return xlat_addr_external_rate_limiter__try_consume_token(ctx, ctx->in_packet_buffer + 12, false);
+
+    return xlat_addr_external_rate_limiter__try_consume_token(ctx, ctx->in_packet_buffer + 8, true);
+}
+
+// Used when no query is sent at all (the circuit breakers of all the servers are open, or the query is rate-limited)
+static tundra__external_addr_xlat_result _get_fail_fast_result(const uint8_t message_type, const bool send_icmp) {
+    // See '_parse_v1_response()' for why the ICMP bit is not permitted for the ICMP error packet
+    //  message types; the result is never cached, as its cache lifetime is zero
+    if(
+        send_icmp &&
+        (message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET || message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET)
+    ) return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP;
+
+    return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+}
+
+static tundra__external_addr_xlat_server_state *_get_current_server(tundra__thread_ctx *const ctx) {
+    return &ctx->external_addr_xlat_state->servers[ctx->external_addr_xlat_state->current_server_index];
 }
 
 static bool _ensure_fds_are_open(tundra__thread_ctx *const ctx) {
-    if(ctx->external_addr_xlat_state->read_fd >= 0 && ctx->external_addr_xlat_state->write_fd >= 0)
+    tundra__external_addr_xlat_server_state *const server = _get_current_server(ctx);
+
+    if(server->read_fd >= 0 && server->write_fd >= 0)
         return true;
 
     // Since at least one of the file descriptors is not open, it is necessary to acquire a pair of new ones (after any
@@ -300,20 +1110,24 @@ static bool _ensure_fds_are_open(tundra__thread_ctx *const ctx) {
             log__thread_crash(ctx->thread_id, false, "At least one of the inherited file descriptors for the 'inherited-fds' transport of the 'external' addressing mode failed!");
 
         case TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX:
+        case TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM:
             {
-                const int socket_fd = _open_socket(AF_UNIX, 0, (const struct sockaddr *) &ctx->config->addressing_external_unix_socket_info, (const socklen_t) sizeof(struct sockaddr_un), (const struct timeval *) &ctx->config->addressing_external_unix_tcp_timeout);
+                const int socket_type = (ctx->config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM ? SOCK_DGRAM : SOCK_STREAM);
+                const int socket_fd = _open_socket(AF_UNIX, socket_type, 0, (const struct sockaddr *) &ctx->config->addressing_external_unix_socket_info[ctx->external_addr_xlat_state->current_server_index], (const socklen_t) sizeof(struct sockaddr_un), (const struct timeval *) &ctx->config->addressing_external_unix_tcp_timeout);
                 if(socket_fd >= 0) {
-                    ctx->external_addr_xlat_state->read_fd = ctx->external_addr_xlat_state->write_fd = socket_fd;
+                    server->read_fd = server->write_fd = socket_fd;
                     return true;
                 }
             }
             break;
 
         case TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_TCP:
-            for(struct addrinfo *current_addrinfo = ctx->config->addressing_external_tcp_socket_info; current_addrinfo != NULL; current_addrinfo = current_addrinfo->ai_next) {
-                const int socket_fd = _open_socket(current_addrinfo->ai_family, IPPROTO_TCP, (const struct sockaddr *) current_addrinfo->ai_addr, (const socklen_t) current_addrinfo->ai_addrlen, (const struct timeval *) &ctx->config->addressing_external_unix_tcp_timeout);
+        case TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP:
+            // The socket type & protocol (TCP or UDP) were already specified when the host was being resolved
+            for(struct addrinfo *current_addrinfo = ctx->config->addressing_external_tcp_socket_info[ctx->external_addr_xlat_state->current_server_index]; current_addrinfo != NULL; current_addrinfo = current_addrinfo->ai_next) {
+                const int socket_fd = _open_socket(current_addrinfo->ai_family, current_addrinfo->ai_socktype, current_addrinfo->ai_protocol, (const struct sockaddr *) current_addrinfo->ai_addr, (const socklen_t) current_addrinfo->ai_addrlen, (const struct timeval *) &ctx->config->addressing_external_unix_tcp_timeout);
                 if(socket_fd >= 0) {
-                    ctx->external_addr_xlat_state->read_fd = ctx->external_addr_xlat_state->write_fd = socket_fd;
+                    server->read_fd = server->write_fd = socket_fd;
                     return true;
                 }
             }
@@ -328,20 +1142,50 @@ static bool _ensure_fds_are_open(tundra__thread_ctx *const ctx) {
 }
 
 static void _close_fds_if_necessary(tundra__thread_ctx *const ctx) {
-    if(ctx->external_addr_xlat_state->read_fd >= 0)
-        xlat_interrupt__close(ctx->external_addr_xlat_state->read_fd);
+    tundra__external_addr_xlat_server_state *const server = _get_current_server(ctx);
+
+    if(server->read_fd >= 0)
+        xlat_interrupt__close(server->read_fd);
+
+    if(server->write_fd >= 0 && server->write_fd != server->read_fd)
+        xlat_interrupt__close(server->write_fd);
 
-    if(ctx->external_addr_xlat_state->write_fd >= 0 && ctx->external_addr_xlat_state->write_fd != ctx->external_addr_xlat_state->read_fd)
-        xlat_interrupt__close(ctx->external_addr_xlat_state->write_fd);
+    server->read_fd = server->write_fd = -1;
 
-    ctx->external_addr_xlat_state->read_fd = ctx->external_addr_xlat_state->write_fd = -1;
+    // The responses to the refreshes sent to the server will never arrive
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_EXTERNAL_MAX_PENDING_REFRESHES; i++) {
+        tundra__external_addr_xlat_pending_refresh *pending_refresh = ctx->external_addr_xlat_state->pending_refreshes + i;
+
+        if(pending_refresh->is_in_use && pending_refresh->server_index == ctx->external_addr_xlat_state->current_server_index) {
+            pending_refresh->is_in_use = false;
+            ctx->external_addr_xlat_state->pending_refresh_count--;
+        }
+    }
 }
 
-static int _open_socket(const int family, const int protocol, const struct sockaddr *address, const socklen_t address_length, const struct timeval *timeout) {
-    const int socket_fd = socket(family, SOCK_STREAM, protocol);
+static int _open_socket(const int family, const int type, const int protocol, const struct sockaddr *address, const socklen_t address_length, const struct timeval *timeout) {
+    const int socket_fd = socket(family, type, protocol);
     if(socket_fd < 0)
         return -1;
 
+    // A datagram Unix socket has to be bound to an address for the server to be able to reply to it; binding it to an
+    //  empty path makes the kernel assign it a unique abstract address ("autobind")
+    struct sockaddr_un autobind_address;
+    UTILS__MEM_ZERO_OUT(&autobind_address, sizeof(struct sockaddr_un));
+    autobind_address.sun_family = AF_UNIX;
+    if(family == AF_UNIX && type == SOCK_DGRAM && bind(socket_fd, (const struct sockaddr *) &autobind_address, (socklen_t) sizeof(sa_family_t)) < 0) {
+        xlat_interrupt__close(socket_fd);
+        return -1;
+    }
+
+    // The messages are small and each of them is awaited, so Nagle's algorithm would only delay them
+    const int tcp_nodelay = 1;
+    if(protocol == IPPROTO_TCP && setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &tcp_nodelay, sizeof(int)) < 0) {
+        xlat_interrupt__close(socket_fd);
+        return -1;
+    }
+
+    // A connected datagram socket only receives datagrams from the address it is connected to
     if(
         (xlat_interrupt__connect(socket_fd, address, address_length, true) < 0) ||
         (setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, timeout, sizeof(struct timeval)) < 0) ||
@@ -354,12 +1198,19 @@ static int _open_socket(const int family, const int protocol, const struct socka
     return socket_fd;
 }
 
-static bool _recv_message_from_fd(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_message *message_buf) {
+static bool _is_transport_datagram_based(tundra__thread_ctx *const ctx) {
+    return (ctx->config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UNIX_DGRAM || ctx->config->addressing_external_transport == TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_UDP);
+}
+
+static bool _recv_message_from_fd(tundra__thread_ctx *const ctx, void *message_buf, const size_t message_size) {
+    if(_is_transport_datagram_based(ctx))
+        return _recv_datagram_from_fd(ctx, message_buf, message_size);
+
     uint8_t *current_ptr = (uint8_t *) message_buf;
-    ssize_t remaining_bytes = sizeof(tundra__external_addr_xlat_message);
+    ssize_t remaining_bytes = (ssize_t) message_size;
 
     while(remaining_bytes > 0) {
-        const ssize_t return_value = xlat_interrupt__read(ctx->external_addr_xlat_state->read_fd, current_ptr, (size_t) remaining_bytes);
+        const ssize_t return_value = xlat_interrupt__read(_get_current_server(ctx)->read_fd, current_ptr, (size_t) remaining_bytes);
 
         if(return_value < 1) {
             _close_fds_if_necessary(ctx);
@@ -373,12 +1224,40 @@ static bool _recv_message_from_fd(tundra__thread_ctx *const ctx, tundra__externa
     return true;
 }
 
-static bool _send_message_to_fd(tundra__thread_ctx *const ctx, const tundra__external_addr_xlat_message *message_buf) {
+// Each datagram carries exactly one message. Unlike with the stream transports, a receive timeout does not close the
+//  file descriptors (it is up to the caller to decide whether to retransmit the request - see 'has_recv_timed_out').
+static bool _recv_datagram_from_fd(tundra__thread_ctx *const ctx, void *message_buf, const size_t message_size) {
+    tundra__external_addr_xlat_server_state *const server = _get_current_server(ctx);
+    server->has_recv_timed_out = false;
+
+    for(size_t i = 0; i < _MAX_DISCARDED_DATAGRAMS_PER_RECV; i++) {
+        // Thanks to MSG_TRUNC, the real size of the datagram is returned even if it does not fit into the buffer
+        const ssize_t return_value = xlat_interrupt__recv(server->read_fd, message_buf, message_size, MSG_TRUNC);
+
+        if(return_value == (ssize_t) message_size)
+            return true;
+
+        if(return_value < 0) {
+            if(errno == EAGAIN) {  // EWOULDBLOCK is the same as EAGAIN on Linux
+                server->has_recv_timed_out = true;
+                return false;
+            }
+            break;
+        }
+
+        // A datagram of a different size cannot be a message of the configured protocol version, so it is discarded
+    }
+
+    _close_fds_if_necessary(ctx);
+    return false;
+}
+
+static bool _send_message_to_fd(tundra__thread_ctx *const ctx, const void *message_buf, const size_t message_size) {
     const uint8_t *current_ptr = (const uint8_t *) message_buf;
-    ssize_t remaining_bytes = sizeof(tundra__external_addr_xlat_message);
+    ssize_t remaining_bytes = (ssize_t) message_size;
 
     while(remaining_bytes > 0) {
-        const ssize_t return_value = xlat_interrupt__write(ctx->external_addr_xlat_state->write_fd, current_ptr, (size_t) remaining_bytes);
+        const ssize_t return_value = xlat_interrupt__write(_get_current_server(ctx)->write_fd, current_ptr, (size_t) remaining_bytes);
 
         if(return_value < 1) {
             _close_fds_if_necessary(ctx);
@@ -392,135 +1271,19 @@ static bool _send_message_to_fd(tundra__thread_ctx *const ctx, const tundra__ext
     return true;
 }
 
-static bool _try_doing_4to6_addr_translation_using_cache(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
-    if(cache_size <= 0)
-        return false;
-
-    // The cache is a simple hash table...
-    const size_t cache_hash = _get_hash_from_in_ipv4_addr_pair(in_src_ipv4, in_dst_ipv4, cache_size);
-    const tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
-
-    if(
-        !UTILS_IP__IPV4_ADDR_EQ(in_src_ipv4, target_entry->src_ipv4) ||
-        !UTILS_IP__IPV4_ADDR_EQ(in_dst_ipv4, target_entry->dst_ipv4) ||
-        (target_entry->expiration_timestamp <= 0)  // '0' signifies that the cache entry is unused
-    ) return false;
-
-    const time_t current_timestamp = _get_current_timestamp();
-    if(current_timestamp <= 0 || current_timestamp >= target_entry->expiration_timestamp)
-        return false;
-
-    memcpy(out_src_ipv6, target_entry->src_ipv6, 16);
-    memcpy(out_dst_ipv6, target_entry->dst_ipv6, 16);
-
-    return true;
-}
-
-static bool _try_doing_6to4_addr_translation_using_cache(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
-    if(cache_size <= 0)
-        return false;
-
-    // The cache is a simple hash table...
-    const size_t cache_hash = _get_hash_from_in_ipv6_addr_pair(in_src_ipv6, in_dst_ipv6, cache_size);
-    const tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
-
-    if(
-        !UTILS_IP__IPV6_ADDR_EQ(in_src_ipv6, target_entry->src_ipv6) ||
-        !UTILS_IP__IPV6_ADDR_EQ(in_dst_ipv6, target_entry->dst_ipv6) ||
-        (target_entry->expiration_timestamp <= 0)  // '0' signifies that the cache entry is unused
-    ) return false;
-
-    const time_t current_timestamp = _get_current_timestamp();
-    if(current_timestamp <= 0 || current_timestamp >= target_entry->expiration_timestamp)
-        return false;
-
-    memcpy(out_src_ipv4, target_entry->src_ipv4, 4);
-    memcpy(out_dst_ipv4, target_entry->dst_ipv4, 4);
-
-    return true;
-}
-
-static void _save_4to6_addr_mapping_to_cache(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const uint8_t *out_src_ipv6, const uint8_t *out_dst_ipv6, const time_t cache_lifetime) {
-    if(cache_size <= 0)
-        return;
-
-    // The cache is a simple hash table...
-    const size_t cache_hash = _get_hash_from_in_ipv4_addr_pair(in_src_ipv4, in_dst_ipv4, cache_size);
-    tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
-
-    _save_addr_mapping_to_target_cache_entry(target_entry, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, cache_lifetime);
-}
-
-static void _save_6to4_addr_mapping_to_cache(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const uint8_t *out_src_ipv4, const uint8_t *out_dst_ipv4, const time_t cache_lifetime) {
-    if(cache_size <= 0)
-        return;
-
-    // The cache is a simple hash table...
-    const size_t cache_hash = _get_hash_from_in_ipv6_addr_pair(in_src_ipv6, in_dst_ipv6, cache_size);
-    tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
-
-    _save_addr_mapping_to_target_cache_entry(target_entry, out_src_ipv4, out_dst_ipv4, in_src_ipv6, in_dst_ipv6, cache_lifetime);
-}
-
-static inline void _save_addr_mapping_to_target_cache_entry(tundra__external_addr_xlat_cache_entry *target_entry, const uint8_t *src_ipv4, const uint8_t *dst_ipv4, const uint8_t *src_ipv6, const uint8_t *dst_ipv6, const time_t cache_lifetime) {
-    if(cache_lifetime == 0)  // '0' means "do not cache"
-        return;
-
-    const time_t current_timestamp = _get_current_timestamp();
-    if(current_timestamp <= 0)
-        return;
-
-    // This may overwrite an existing cache entry
-    target_entry->expiration_timestamp = (current_timestamp + cache_lifetime);
-    memcpy(target_entry->src_ipv4, src_ipv4, 4);
-    memcpy(target_entry->dst_ipv4, dst_ipv4, 4);
-    memcpy(target_entry->src_ipv6, src_ipv6, 16);
-    memcpy(target_entry->dst_ipv6, dst_ipv6, 16);
-}
-
-// WARNING: 'cache_size' must not be zero!
-static inline size_t _get_hash_from_in_ipv4_addr_pair(const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const size_t cache_size) {
-    // Memory alignment
-    uint32_t in_src_ipv4_32bit, in_dst_ipv4_32bit;
-    memcpy(&in_src_ipv4_32bit, in_src_ipv4, 4);
-    memcpy(&in_dst_ipv4_32bit, in_dst_ipv4, 4);
-
-    // 3 and 5 have been chosen because they are small prime numbers...
-    const size_t hash = (size_t) (in_src_ipv4_32bit * 3 + in_dst_ipv4_32bit * 5);
-    return hash % cache_size;
-}
-
-// WARNING: 'cache_size' must not be zero!
-static inline size_t _get_hash_from_in_ipv6_addr_pair(const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const size_t cache_size) {
-    // Memory alignment
-    uint32_t in_ipv6_addrs_32bit[8];
-    memcpy(in_ipv6_addrs_32bit, in_src_ipv6, 16);
-    memcpy(in_ipv6_addrs_32bit + 4, in_dst_ipv6, 16);
-
-    static const uint32_t small_primes[8] = {2, 3, 5, 7, 7, 5, 3, 2};
-
-    size_t hash = 0;
-    for(size_t i = 0; i < 8; i++) {
-        hash += (size_t) (in_ipv6_addrs_32bit[i] * small_primes[i]);
-    }
-    return hash % cache_size;
-}
-
-static inline time_t _get_current_timestamp(void) {
-    struct timespec time_specification;
-    UTILS__MEM_ZERO_OUT(&time_specification, sizeof(struct timespec));
-
-    if(clock_gettime(CLOCK_MONOTONIC_RAW, &time_specification) < 0)
-        return 0;
-
-    return time_specification.tv_sec;
-}
-
 
 #undef _MESSAGE_MAGIC_BYTE
-#undef _MESSAGE_VERSION
-
-#undef _MESSAGE_TYPE_4TO6_MAIN_PACKET
-#undef _MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET
-#undef _MESSAGE_TYPE_6TO4_MAIN_PACKET
-#undef _MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET
+#undef _MESSAGE_VERSION_1
+#undef _MESSAGE_VERSION_2
+#undef _MESSAGE_TYPE_MASK
+#undef _MESSAGE_TYPE_BITS_RESPONSE
+#undef _MESSAGE_TYPE_BITS_RESPONSE_ERROR
+#undef _MESSAGE_TYPE_BITS_RESPONSE_ERROR_ICMP
+#undef _MESSAGE_FLAG_UNSOLICITED
+#undef _MESSAGE_FLAG_INVALIDATE
+#undef _MESSAGE_FLAG_PREFIX
+#undef _MESSAGE_FLAG_BIDIRECTIONAL
+#undef _MAX_UNSOLICITED_MESSAGES_PER_RESPONSE
+#undef _MAX_UNSOLICITED_MESSAGES_PER_CHECK
+#undef _MAX_DISCARDED_DATAGRAMS_PER_RECV
+#undef _MAX_EVICTED_ENTRIES_PER_CACHE_PER_PASS
@@ -23,6 +23,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"tundra.h"
 
 
+// These values could be put inside an enum, but since their main purpose is to be put as integers into messages (and
+//  cache files), it seems to me that defining them this way is more appropriate.
+#define XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET ((uint8_t) 1)
+#define XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET ((uint8_t) 2)
+#define XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET ((uint8_t) 3)
+#define XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET ((uint8_t) 4)
+
+
 extern bool xlat_addr_external__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
 extern bool xlat_addr_external__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
 extern bool xlat_addr_external__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
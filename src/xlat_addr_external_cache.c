@@ -0,0 +1,303 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_cache.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"xlat_addr_external_timer_wheel.h"
+
+
+static inline tundra__external_addr_xlat_result _get_result_from_cache_entry(const tundra__external_addr_xlat_cache_entry *target_entry, const time_t grace_period, const time_t current_timestamp, bool *out_is_stale);
+static inline void _save_addr_mapping_to_target_cache_entry(tundra__external_addr_xlat_cache_entry *cache, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, const size_t cache_hash, const uint8_t *src_ipv4, const uint8_t *dst_ipv4, const uint8_t *src_ipv6, const uint8_t *dst_ipv6, const tundra__external_addr_xlat_result result, const time_t cache_lifetime);
+static inline size_t _get_hash_from_in_ipv4_addr_pair(const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const size_t cache_size);
+static inline size_t _get_hash_from_in_ipv6_addr_pair(const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const size_t cache_size);
+
+
+tundra__external_addr_xlat_result xlat_addr_external_cache__lookup_4to6(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const time_t grace_period, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6, bool *out_is_stale) {
+    *out_is_stale = false;
+
+    if(cache_size <= 0)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    // The cache is a simple hash table...
+    const size_t cache_hash = _get_hash_from_in_ipv4_addr_pair(in_src_ipv4, in_dst_ipv4, cache_size);
+    const tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
+
+    if(
+        !UTILS_IP__IPV4_ADDR_EQ(in_src_ipv4, target_entry->src_ipv4) ||
+        !UTILS_IP__IPV4_ADDR_EQ(in_dst_ipv4, target_entry->dst_ipv4) ||
+        (target_entry->expiration_timestamp == 0)  // '0' signifies that the cache entry is unused
+    ) return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    const tundra__external_addr_xlat_result result = _get_result_from_cache_entry(target_entry, grace_period, current_timestamp, out_is_stale);
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+        memcpy(out_src_ipv6, target_entry->src_ipv6, 16);
+        memcpy(out_dst_ipv6, target_entry->dst_ipv6, 16);
+    }
+
+    return result;
+}
+
+tundra__external_addr_xlat_result xlat_addr_external_cache__lookup_6to4(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const time_t grace_period, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4, bool *out_is_stale) {
+    *out_is_stale = false;
+
+    if(cache_size <= 0)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    // The cache is a simple hash table...
+    const size_t cache_hash = _get_hash_from_in_ipv6_addr_pair(in_src_ipv6, in_dst_ipv6, cache_size);
+    const tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
+
+    if(
+        !UTILS_IP__IPV6_ADDR_EQ(in_src_ipv6, target_entry->src_ipv6) ||
+        !UTILS_IP__IPV6_ADDR_EQ(in_dst_ipv6, target_entry->dst_ipv6) ||
+        (target_entry->expiration_timestamp == 0)  // '0' signifies that the cache entry is unused
+    ) return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    const tundra__external_addr_xlat_result result = _get_result_from_cache_entry(target_entry, grace_period, current_timestamp, out_is_stale);
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+        memcpy(out_src_ipv4, target_entry->src_ipv4, 4);
+        memcpy(out_dst_ipv4, target_entry->dst_ipv4, 4);
+    }
+
+    return result;
+}
+
+// The caller is responsible for checking whether the entry's key matches the addresses being translated!
+// During the grace period after its expiration, the entry is still returned, but it is marked as stale.
+static inline tundra__external_addr_xlat_result _get_result_from_cache_entry(const tundra__external_addr_xlat_cache_entry *target_entry, const time_t grace_period, const time_t current_timestamp, bool *out_is_stale) {
+    // Indefinite entries never expire, so there is no grace period to add (which might overflow a 32-bit time_t)
+    const time_t expiration_timestamp = (time_t) target_entry->expiration_timestamp;
+    if(grace_period <= 0 || expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP)
+        return xlat_addr_external_cache__get_result_from_flags(expiration_timestamp, target_entry->flags, current_timestamp);
+
+    const tundra__external_addr_xlat_result result = xlat_addr_external_cache__get_result_from_flags(expiration_timestamp + grace_period, target_entry->flags, current_timestamp);
+    *out_is_stale = (result != TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE && current_timestamp >= expiration_timestamp);
+
+    return result;
+}
+
+tundra__external_addr_xlat_result xlat_addr_external_cache__get_result_from_flags(const time_t expiration_timestamp, const uint8_t flags, const time_t current_timestamp) {
+    if(current_timestamp <= 0 || current_timestamp >= expiration_timestamp)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    if(flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP;
+
+    if(flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR;
+
+    return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS;
+}
+
+void xlat_addr_external_cache__save_4to6(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const uint8_t *out_src_ipv6, const uint8_t *out_dst_ipv6, const tundra__external_addr_xlat_result result, const time_t cache_lifetime) {
+    if(cache_size <= 0)
+        return;
+
+    // The cache is a simple hash table...
+    const size_t cache_hash = _get_hash_from_in_ipv4_addr_pair(in_src_ipv4, in_dst_ipv4, cache_size);
+    _save_addr_mapping_to_target_cache_entry(cache, timer_wheel, current_timestamp, cache_hash, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, result, cache_lifetime);
+}
+
+void xlat_addr_external_cache__save_6to4(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const uint8_t *out_src_ipv4, const uint8_t *out_dst_ipv4, const tundra__external_addr_xlat_result result, const time_t cache_lifetime) {
+    if(cache_size <= 0)
+        return;
+
+    // The cache is a simple hash table...
+    const size_t cache_hash = _get_hash_from_in_ipv6_addr_pair(in_src_ipv6, in_dst_ipv6, cache_size);
+    _save_addr_mapping_to_target_cache_entry(cache, timer_wheel, current_timestamp, cache_hash, out_src_ipv4, out_dst_ipv4, in_src_ipv6, in_dst_ipv6, result, cache_lifetime);
+}
+
+static inline void _save_addr_mapping_to_target_cache_entry(tundra__external_addr_xlat_cache_entry *cache, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, const size_t cache_hash, const uint8_t *src_ipv4, const uint8_t *dst_ipv4, const uint8_t *src_ipv6, const uint8_t *dst_ipv6, const tundra__external_addr_xlat_result result, const time_t cache_lifetime) {
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)  // Failures are never cached
+        return;
+
+    const time_t expiration_timestamp = xlat_addr_external_cache__get_expiration_timestamp(cache_lifetime, current_timestamp);
+    if(expiration_timestamp <= 0)
+        return;
+
+    // This may overwrite an existing cache entry
+    tundra__external_addr_xlat_cache_entry *target_entry = cache + cache_hash;
+    target_entry->expiration_timestamp = (uint32_t) expiration_timestamp;  // Cannot overflow (see xlat_addr_external_cache__get_expiration_timestamp())
+    memcpy(target_entry->src_ipv4, src_ipv4, 4);
+    memcpy(target_entry->dst_ipv4, dst_ipv4, 4);
+    memcpy(target_entry->src_ipv6, src_ipv6, 16);
+    memcpy(target_entry->dst_ipv6, dst_ipv6, 16);
+    target_entry->flags = xlat_addr_external_cache__get_flags_from_result(result);
+
+    // The grace period is added when the entry becomes due (see xlat_addr_external_cache__evict_expired_entries())
+    if(expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP)
+        xlat_addr_external_timer_wheel__unschedule(timer_wheel, cache_hash);
+    else
+        xlat_addr_external_timer_wheel__schedule(timer_wheel, cache_hash, expiration_timestamp);
+}
+
+// Returns 0 if an entry with the specified lifetime is not supposed to be cached
+time_t xlat_addr_external_cache__get_expiration_timestamp(const time_t cache_lifetime, const time_t current_timestamp) {
+    if(cache_lifetime == 0)  // '0' means "do not cache"
+        return 0;
+
+    if(cache_lifetime == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_LIFETIME)
+        return XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP;
+
+    // The timestamp must fit into the 32-bit 'expiration_timestamp' fields of cache entries, which is always the case
+    //  unless the system has been running for decades
+    if(current_timestamp <= 0 || cache_lifetime < 0 || current_timestamp >= (XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP - XLAT_ADDR_EXTERNAL_CACHE__MAX_FINITE_LIFETIME))
+        return 0;
+
+    return (current_timestamp + UTILS__MINIMUM_UNSAFE(cache_lifetime, XLAT_ADDR_EXTERNAL_CACHE__MAX_FINITE_LIFETIME));
+}
+
+uint8_t xlat_addr_external_cache__get_flags_from_result(const tundra__external_addr_xlat_result result) {
+    switch(result) {
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR: return XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE;
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP: return (XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE | XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP);
+        case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS: case TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE: default: return 0;
+    }
+}
+
+// Returns the number of invalidated entries; if both the prefix lengths are 32, only the entry for the exact address
+//  pair is looked up, otherwise, the whole cache is scanned
+size_t xlat_addr_external_cache__invalidate_4to6(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *src_ipv4_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv4_prefix, const size_t dst_prefix_length) {
+    if(cache_size <= 0)
+        return 0;
+
+    size_t first_index = 0, last_index = (cache_size - 1);
+    if(src_prefix_length == 32 && dst_prefix_length == 32)
+        first_index = last_index = _get_hash_from_in_ipv4_addr_pair(src_ipv4_prefix, dst_ipv4_prefix, cache_size);
+
+    size_t invalidated_entry_count = 0;
+    for(size_t i = first_index; i <= last_index; i++) {
+        tundra__external_addr_xlat_cache_entry *current_entry = cache + i;
+        if(
+            (current_entry->expiration_timestamp != 0) &&
+            utils_ip__is_addr_in_prefix(current_entry->src_ipv4, src_ipv4_prefix, src_prefix_length) &&
+            utils_ip__is_addr_in_prefix(current_entry->dst_ipv4, dst_ipv4_prefix, dst_prefix_length)
+        ) {
+            current_entry->expiration_timestamp = 0;
+            invalidated_entry_count++;
+        }
+    }
+
+    return invalidated_entry_count;
+}
+
+// Returns the number of invalidated entries; if both the prefix lengths are 128, only the entry for the exact address
+//  pair is looked up, otherwise, the whole cache is scanned
+size_t xlat_addr_external_cache__invalidate_6to4(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *src_ipv6_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv6_prefix, const size_t dst_prefix_length) {
+    if(cache_size <= 0)
+        return 0;
+
+    size_t first_index = 0, last_index = (cache_size - 1);
+    if(src_prefix_length == 128 && dst_prefix_length == 128)
+        first_index = last_index = _get_hash_from_in_ipv6_addr_pair(src_ipv6_prefix, dst_ipv6_prefix, cache_size);
+
+    size_t invalidated_entry_count = 0;
+    for(size_t i = first_index; i <= last_index; i++) {
+        tundra__external_addr_xlat_cache_entry *current_entry = cache + i;
+        if(
+            (current_entry->expiration_timestamp != 0) &&
+            utils_ip__is_addr_in_prefix(current_entry->src_ipv6, src_ipv6_prefix, src_prefix_length) &&
+            utils_ip__is_addr_in_prefix(current_entry->dst_ipv6, dst_ipv6_prefix, dst_prefix_length)
+        ) {
+            current_entry->expiration_timestamp = 0;
+            invalidated_entry_count++;
+        }
+    }
+
+    return invalidated_entry_count;
+}
+
+/*
+ * Clears the entries whose expiration (including the grace period) is due, so that they do not sit in the cache until
+ * they are overwritten. At most 'max_evicted_entries' due entries are processed; returns false if there may be more of
+ * them left, in which case the function should be called again later.
+ */
+bool xlat_addr_external_cache__evict_expired_entries(tundra__external_addr_xlat_cache_entry *cache, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t grace_period, const time_t current_timestamp, const size_t max_evicted_entries) {
+    if(current_timestamp <= 0)
+        return true;
+
+    size_t entry_index = 0;
+    for(size_t i = 0; i < max_evicted_entries; i++) {
+        if(!xlat_addr_external_timer_wheel__pop_due_entry(timer_wheel, current_timestamp, &entry_index))
+            return true;
+
+        // The entry might have been invalidated or replaced by an indefinite one after it had been scheduled
+        tundra__external_addr_xlat_cache_entry *current_entry = cache + entry_index;
+        const time_t expiration_timestamp = (time_t) current_entry->expiration_timestamp;
+        if(expiration_timestamp == 0 || expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP)
+            continue;
+
+        const time_t eviction_timestamp = expiration_timestamp + grace_period;
+        if(current_timestamp >= eviction_timestamp)
+            current_entry->expiration_timestamp = 0;  // The slot is now free
+        else
+            xlat_addr_external_timer_wheel__schedule(timer_wheel, entry_index, eviction_timestamp);  // Within the grace period
+    }
+
+    return false;
+}
+
+time_t xlat_addr_external_cache__get_lifetime_from_wire_lifetime(const uint32_t wire_lifetime) {
+    if(wire_lifetime == XLAT_ADDR_EXTERNAL_CACHE__WIRE_INDEFINITE_LIFETIME)
+        return XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_LIFETIME;
+
+    // The lifetime is capped so that the expiration timestamp cannot overflow even if time_t is 32 bits wide
+    return (time_t) UTILS__MINIMUM_UNSAFE((uint64_t) wire_lifetime, (uint64_t) XLAT_ADDR_EXTERNAL_CACHE__MAX_FINITE_LIFETIME);
+}
+
+// The entry must not be expired!
+uint32_t xlat_addr_external_cache__get_wire_remaining_lifetime(const tundra__external_addr_xlat_cache_entry *entry, const time_t current_timestamp) {
+    if((time_t) entry->expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP)
+        return XLAT_ADDR_EXTERNAL_CACHE__WIRE_INDEFINITE_LIFETIME;
+
+    return (uint32_t) ((time_t) entry->expiration_timestamp - current_timestamp);
+}
+
+// WARNING: 'cache_size' must not be zero!
+static inline size_t _get_hash_from_in_ipv4_addr_pair(const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const size_t cache_size) {
+    // Memory alignment
+    uint32_t in_src_ipv4_32bit, in_dst_ipv4_32bit;
+    memcpy(&in_src_ipv4_32bit, in_src_ipv4, 4);
+    memcpy(&in_dst_ipv4_32bit, in_dst_ipv4, 4);
+
+    // 3 and 5 have been chosen because they are small prime numbers...
+    const size_t hash = (size_t) (in_src_ipv4_32bit * 3 + in_dst_ipv4_32bit * 5);
+    return hash % cache_size;
+}
+
+// WARNING: 'cache_size' must not be zero!
+static inline size_t _get_hash_from_in_ipv6_addr_pair(const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const size_t cache_size) {
+    // Memory alignment
+    uint32_t in_ipv6_addrs_32bit[8];
+    memcpy(in_ipv6_addrs_32bit, in_src_ipv6, 16);
+    memcpy(in_ipv6_addrs_32bit + 4, in_dst_ipv6, 16);
+
+    static const uint32_t small_primes[8] = {2, 3, 5, 7, 7, 5, 3, 2};
+
+    size_t hash = 0;
+    for(size_t i = 0; i < 8; i++) {
+        hash += (size_t) (in_ipv6_addrs_32bit[i] * small_primes[i]);
+    }
+    return hash % cache_size;
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+// Erroneous responses are cached as well ("negative caching"), so that packets for which the external address
+//  translator does not have a mapping do not cause a query to be sent over and over again. Such cache entries contain
+//  no translated addresses - only the flags below, telling what to do with the packet.
+#define XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE ((uint8_t) 0x01)
+#define XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP ((uint8_t) 0x02)
+
+// Entries with an indefinite lifetime stay cached until they are invalidated or replaced (protocol version 2 only)
+#define XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_LIFETIME ((time_t) -1)
+#define XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP ((time_t) INT32_MAX)  // Works with 32-bit time_t as well
+#define XLAT_ADDR_EXTERNAL_CACHE__MAX_FINITE_LIFETIME ((time_t) 0x3fffffff)
+#define XLAT_ADDR_EXTERNAL_CACHE__WIRE_INDEFINITE_LIFETIME ((uint32_t) 0xffffffff)
+
+
+extern tundra__external_addr_xlat_result xlat_addr_external_cache__lookup_4to6(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const time_t grace_period, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6, bool *out_is_stale);
+extern tundra__external_addr_xlat_result xlat_addr_external_cache__lookup_6to4(const tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const time_t grace_period, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4, bool *out_is_stale);
+extern void xlat_addr_external_cache__save_4to6(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const uint8_t *out_src_ipv6, const uint8_t *out_dst_ipv6, const tundra__external_addr_xlat_result result, const time_t cache_lifetime);
+extern void xlat_addr_external_cache__save_6to4(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const uint8_t *out_src_ipv4, const uint8_t *out_dst_ipv4, const tundra__external_addr_xlat_result result, const time_t cache_lifetime);
+extern size_t xlat_addr_external_cache__invalidate_4to6(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *src_ipv4_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv4_prefix, const size_t dst_prefix_length);
+extern size_t xlat_addr_external_cache__invalidate_6to4(tundra__external_addr_xlat_cache_entry *cache, const size_t cache_size, const uint8_t *src_ipv6_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv6_prefix, const size_t dst_prefix_length);
+extern bool xlat_addr_external_cache__evict_expired_entries(tundra__external_addr_xlat_cache_entry *cache, tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t grace_period, const time_t current_timestamp, const size_t max_evicted_entries);
+extern tundra__external_addr_xlat_result xlat_addr_external_cache__get_result_from_flags(const time_t expiration_timestamp, const uint8_t flags, const time_t current_timestamp);
+extern time_t xlat_addr_external_cache__get_expiration_timestamp(const time_t cache_lifetime, const time_t current_timestamp);
+extern uint8_t xlat_addr_external_cache__get_flags_from_result(const tundra__external_addr_xlat_result result);
+extern time_t xlat_addr_external_cache__get_lifetime_from_wire_lifetime(const uint32_t wire_lifetime);
+extern uint32_t xlat_addr_external_cache__get_wire_remaining_lifetime(const tundra__external_addr_xlat_cache_entry *entry, const time_t current_timestamp);
@@ -0,0 +1,574 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_cache_file.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"log.h"
+#include"xlat_addr_external.h"
+#include"xlat_addr_external_cache.h"
+#include"xlat_addr_external_prefix_cache.h"
+
+
+#define _CACHE_FILE_MAGIC ((const uint8_t *) "TXAC")
+#define _CACHE_FILE_VERSION ((uint8_t) 1)
+#define _CACHE_FILE_WRITE_BUFFER_ENTRIES ((size_t) 1024)
+#define _CACHE_FILE_ENTRY_FLAG_PREFIX_MAPPING ((uint8_t) 0x04)  // Only used in the file, never in the caches themselves
+
+
+static void _load_cache_file(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int cache_file_fd, const char *const cache_file_path, const bool crash_if_invalid);
+static bool _is_cache_file_header_valid(const tundra__external_addr_xlat_cache_file_header *header, const size_t file_size);
+static bool _is_cache_file_entry_valid(const tundra__conf_file *const file_config, const tundra__external_addr_xlat_cache_file_entry *entry);
+static bool _is_cache_file_prefix_mapping_entry_valid(const tundra__external_addr_xlat_cache_file_entry *entry);
+static bool _are_ipv4_addrs_usable(const tundra__conf_file *const file_config, const uint8_t *src_ipv4, const uint8_t *dst_ipv4);
+static bool _are_ipv6_addrs_usable(const tundra__conf_file *const file_config, const uint8_t *src_ipv6, const uint8_t *dst_ipv6);
+static void _save_cache_file_entry_to_thread_caches(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const tundra__external_addr_xlat_cache_file_entry *entry, const time_t cache_lifetime, const time_t monotonic_timestamp);
+static void _save_cache_file_prefix_mapping_entry_to_thread_caches(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const tundra__external_addr_xlat_cache_file_entry *entry, const tundra__external_addr_xlat_result result, const time_t cache_lifetime, const time_t monotonic_timestamp);
+static size_t _save_thread_caches_to_cache_file(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int snapshot_fd, const uint8_t message_type, tundra__external_addr_xlat_cache_file_entry *write_buffer);
+static size_t _save_thread_prefix_caches_to_cache_file(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int snapshot_fd, const uint8_t message_type, tundra__external_addr_xlat_cache_file_entry *write_buffer);
+static void _write_to_cache_file(const int cache_file_fd, const void *data, const size_t data_size);
+static tundra__external_addr_xlat_cache_entry *_get_cache_by_message_type(const tundra__external_addr_xlat_state *external_addr_xlat_state, const uint8_t message_type);
+static tundra__external_addr_xlat_timer_wheel *_get_timer_wheel_by_message_type(const tundra__external_addr_xlat_state *external_addr_xlat_state, const uint8_t message_type);
+static tundra__external_addr_xlat_prefix_cache *_get_prefix_cache_by_message_type(const tundra__external_addr_xlat_state *external_addr_xlat_state, const uint8_t message_type);
+static bool _is_4to6_message_type(const uint8_t message_type);
+static size_t _get_cache_size_by_message_type(const tundra__conf_file *const file_config, const uint8_t message_type);
+
+
+// Returns a file descriptor of the opened snapshot file (which is to be passed to
+//  xlat_addr_external_cache_file__save_and_close() when the program is terminating), or -1 if the cache is not to be
+//  persisted. This function must be called before the program's working directory is changed and its privileges are
+//  dropped, and before the translator threads are started! 'handed_over_snapshot_fd' is the snapshot file which has
+//  been handed over by the previously running process (see handover.c), or -1; this function takes ownership of it.
+int xlat_addr_external_cache_file__open_and_load(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int handed_over_snapshot_fd) {
+    if(file_config->addressing_mode != TUNDRA__ADDRESSING_MODE_EXTERNAL || file_config->addressing_external_cache_file == NULL) {
+        if(handed_over_snapshot_fd >= 0)
+            close(handed_over_snapshot_fd);  // This process does not persist its cache
+    }
+
+    if(file_config->addressing_mode != TUNDRA__ADDRESSING_MODE_EXTERNAL)
+        return -1;
+
+    int snapshot_fd = -1;
+    if(file_config->addressing_external_cache_file != NULL && handed_over_snapshot_fd >= 0) {
+        // The file has been opened (and locked) by the process which has handed its file descriptors over to this one;
+        //  the lock belongs to the open file description, so it is now held by this process as well
+        snapshot_fd = handed_over_snapshot_fd;
+        _load_cache_file(file_config, thread_contexts, snapshot_fd, file_config->addressing_external_cache_file, false);
+    } else if(file_config->addressing_external_cache_file != NULL) {
+        snapshot_fd = open(file_config->addressing_external_cache_file, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if(snapshot_fd < 0)
+            log__crash(true, "Failed to open the external address translation cache file '%s'!", file_config->addressing_external_cache_file);
+
+        // Two instances of the program sharing one snapshot file would overwrite each other's entries
+        if(flock(snapshot_fd, LOCK_EX | LOCK_NB) < 0)
+            log__crash(true, "Failed to lock the external address translation cache file '%s' - is it being used by another instance of the program?", file_config->addressing_external_cache_file);
+
+        // The snapshot is overwritten when the program terminates, so an invalid one need not make the program crash
+        _load_cache_file(file_config, thread_contexts, snapshot_fd, file_config->addressing_external_cache_file, false);
+    }
+
+    // The preload file is loaded after the snapshot file, as it is expected to contain newer entries (e.g. if it has
+    //  been generated by the external address translator just before the program was started)
+    if(file_config->addressing_external_cache_preload_file != NULL) {
+        const int preload_fd = open(file_config->addressing_external_cache_preload_file, O_RDONLY | O_CLOEXEC);
+        if(preload_fd < 0)
+            log__crash(true, "Failed to open the external address translation cache preload file '%s'!", file_config->addressing_external_cache_preload_file);
+
+        _load_cache_file(file_config, thread_contexts, preload_fd, file_config->addressing_external_cache_preload_file, true);
+
+        close(preload_fd);
+    }
+
+    return snapshot_fd;
+}
+
+static void _load_cache_file(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int cache_file_fd, const char *const cache_file_path, const bool crash_if_invalid) {
+    struct stat file_info;
+    if(fstat(cache_file_fd, &file_info) < 0)
+        log__crash(true, "Failed to get information about the external address translation cache file '%s'!", cache_file_path);
+
+    if(file_info.st_size == 0)  // A newly created snapshot file
+        return;
+
+    if(file_info.st_size < 0 || (uint64_t) file_info.st_size > (uint64_t) SIZE_MAX)
+        log__crash(false, "The external address translation cache file '%s' has an invalid size!", cache_file_path);
+
+    const size_t file_size = (size_t) file_info.st_size;
+    uint8_t *file_data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, cache_file_fd, 0);
+    if(file_data == MAP_FAILED)
+        log__crash(true, "Failed to map the external address translation cache file '%s' into memory!", cache_file_path);
+
+    // The file is read sequentially, and each of its pages is read only once
+    madvise(file_data, file_size, MADV_SEQUENTIAL);
+
+    const tundra__external_addr_xlat_cache_file_header *header = (const tundra__external_addr_xlat_cache_file_header *) file_data;
+    if(!_is_cache_file_header_valid(header, file_size)) {
+        if(crash_if_invalid)
+            log__crash(false, "The external address translation cache file '%s' is invalid!", cache_file_path);
+
+        log__info("The external address translation cache file '%s' is invalid, and will therefore be ignored!", cache_file_path);
+        munmap(file_data, file_size);
+        return;
+    }
+
+    // The lifetimes of the entries are decreased by the time which has passed since the file was created
+    const uint64_t creation_timestamp = be64toh(header->creation_timestamp);
+    const time_t current_timestamp = time(NULL);
+    const time_t elapsed_time = (
+        (creation_timestamp > 0 && current_timestamp > 0 && (uint64_t) current_timestamp > creation_timestamp) ?
+        (time_t) ((uint64_t) current_timestamp - creation_timestamp) :
+        0
+    );
+    const time_t monotonic_timestamp = utils__get_coarse_monotonic_timestamp();  // The caches' expiration timestamps are monotonic
+
+    const size_t entry_count = (size_t) ntohl(header->entry_count);
+    const tundra__external_addr_xlat_cache_file_entry *entries = (const tundra__external_addr_xlat_cache_file_entry *) (file_data + sizeof(tundra__external_addr_xlat_cache_file_header));
+    size_t loaded_entry_count = 0;
+
+    for(size_t i = 0; i < entry_count; i++) {
+        const tundra__external_addr_xlat_cache_file_entry *entry = entries + i;
+
+        if(!_is_cache_file_entry_valid(file_config, entry))
+            continue;
+
+        // Indefinite lifetimes are not decreased
+        const time_t remaining_lifetime = xlat_addr_external_cache__get_lifetime_from_wire_lifetime(ntohl(entry->remaining_lifetime));
+        if(remaining_lifetime == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_LIFETIME) {
+            _save_cache_file_entry_to_thread_caches(file_config, thread_contexts, entry, remaining_lifetime, monotonic_timestamp);
+        } else {
+            if(remaining_lifetime <= elapsed_time)
+                continue;
+
+            _save_cache_file_entry_to_thread_caches(file_config, thread_contexts, entry, remaining_lifetime - elapsed_time, monotonic_timestamp);
+        }
+        loaded_entry_count++;
+    }
+
+    munmap(file_data, file_size);
+
+    log__info("%zu (out of %zu) entries have been loaded from the external address translation cache file '%s'.", loaded_entry_count, entry_count, cache_file_path);
+}
+
+// Used to load the caches handed over by another process (see handover.c); the file descriptor is not closed. This
+//  function must be called before the translator threads are started!
+void xlat_addr_external_cache_file__load_from_fd(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int fd, const char *const description) {
+    _load_cache_file(file_config, thread_contexts, fd, description, false);
+}
+
+static bool _is_cache_file_header_valid(const tundra__external_addr_xlat_cache_file_header *header, const size_t file_size) {
+    if(file_size < sizeof(tundra__external_addr_xlat_cache_file_header))
+        return false;
+
+    if(!UTILS__MEM_EQ(header->magic, _CACHE_FILE_MAGIC, 4) || header->version != _CACHE_FILE_VERSION)
+        return false;
+
+    // This also detects snapshot files which have not been completely written (e.g. due to a power outage)
+    const size_t entries_size = (file_size - sizeof(tundra__external_addr_xlat_cache_file_header));
+    return (
+        (entries_size % sizeof(tundra__external_addr_xlat_cache_file_entry)) == 0 &&
+        (entries_size / sizeof(tundra__external_addr_xlat_cache_file_entry)) == (size_t) ntohl(header->entry_count)
+    );
+}
+
+static bool _is_cache_file_entry_valid(const tundra__conf_file *const file_config, const tundra__external_addr_xlat_cache_file_entry *entry) {
+    // The entries are validated in the same way responses from the external address translator are - the preload file
+    //  may have been generated by a program other than Tundra
+    if(entry->flags & ~(XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE | XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP | _CACHE_FILE_ENTRY_FLAG_PREFIX_MAPPING))
+        return false;
+
+    if((entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP) && !(entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE))
+        return false;
+
+    if(entry->flags & _CACHE_FILE_ENTRY_FLAG_PREFIX_MAPPING)
+        return _is_cache_file_prefix_mapping_entry_valid(entry);
+
+    if(entry->src_prefix_length != 0 || entry->dst_prefix_length != 0)
+        return false;
+
+    const bool is_negative = (entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE);
+
+    switch(entry->message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+            return (
+                _are_ipv4_addrs_usable(file_config, entry->src_ipv4, entry->dst_ipv4) &&
+                (is_negative || _are_ipv6_addrs_usable(file_config, entry->src_ipv6, entry->dst_ipv6))
+            );
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            return (
+                _are_ipv6_addrs_usable(file_config, entry->src_ipv6, entry->dst_ipv6) &&
+                (is_negative || _are_ipv4_addrs_usable(file_config, entry->src_ipv4, entry->dst_ipv4))
+            );
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            return !(entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP);
+
+        default:
+            return false;
+    }
+}
+
+// A prefix mapping covers addresses which have never been checked, so their usability is only checked when the mapping
+//  is looked up (see xlat_addr_external.c); the prefix lengths are validated in the same way as in responses
+static bool _is_cache_file_prefix_mapping_entry_valid(const tundra__external_addr_xlat_cache_file_entry *entry) {
+    switch(entry->message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            break;
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            if(entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP)
+                return false;
+            break;
+
+        default:
+            return false;
+    }
+
+    const bool is_4to6 = _is_4to6_message_type(entry->message_type);
+    const uint8_t min_prefix_length = (is_4to6 ? 0 : 96);
+    const uint8_t max_prefix_length = (is_4to6 ? 32 : 128);
+    if(
+        entry->src_prefix_length < min_prefix_length || entry->src_prefix_length > max_prefix_length ||
+        entry->dst_prefix_length < min_prefix_length || entry->dst_prefix_length > max_prefix_length
+    ) return false;
+
+    if(entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE)
+        return true;
+
+    return (
+        is_4to6 ?
+        (
+            xlat_addr_external_prefix_cache__is_mapping_consistent(entry->src_ipv4, 4, entry->src_ipv6, 16, (uint8_t) (max_prefix_length - entry->src_prefix_length)) &&
+            xlat_addr_external_prefix_cache__is_mapping_consistent(entry->dst_ipv4, 4, entry->dst_ipv6, 16, (uint8_t) (max_prefix_length - entry->dst_prefix_length))
+        ) :
+        (
+            xlat_addr_external_prefix_cache__is_mapping_consistent(entry->src_ipv6, 16, entry->src_ipv4, 4, (uint8_t) (max_prefix_length - entry->src_prefix_length)) &&
+            xlat_addr_external_prefix_cache__is_mapping_consistent(entry->dst_ipv6, 16, entry->dst_ipv4, 4, (uint8_t) (max_prefix_length - entry->dst_prefix_length))
+        )
+    );
+}
+
+static bool _are_ipv4_addrs_usable(const tundra__conf_file *const file_config, const uint8_t *src_ipv4, const uint8_t *dst_ipv4) {
+    return !(
+        utils_ip__is_ipv4_addr_unusable(src_ipv4) || UTILS_IP__IPV4_ADDR_EQ(src_ipv4, file_config->router_ipv4) ||
+        utils_ip__is_ipv4_addr_unusable(dst_ipv4) || UTILS_IP__IPV4_ADDR_EQ(dst_ipv4, file_config->router_ipv4)
+    );
+}
+
+static bool _are_ipv6_addrs_usable(const tundra__conf_file *const file_config, const uint8_t *src_ipv6, const uint8_t *dst_ipv6) {
+    return !(
+        utils_ip__is_ipv6_addr_unusable(src_ipv6) || UTILS_IP__IPV6_ADDR_EQ(src_ipv6, file_config->router_ipv6) ||
+        utils_ip__is_ipv6_addr_unusable(dst_ipv6) || UTILS_IP__IPV6_ADDR_EQ(dst_ipv6, file_config->router_ipv6)
+    );
+}
+
+static void _save_cache_file_entry_to_thread_caches(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const tundra__external_addr_xlat_cache_file_entry *entry, const time_t cache_lifetime, const time_t monotonic_timestamp) {
+    tundra__external_addr_xlat_result result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS;
+    if(entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE_ICMP)
+        result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR_ICMP;
+    else if(entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE)
+        result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_ERROR;
+
+    if(entry->flags & _CACHE_FILE_ENTRY_FLAG_PREFIX_MAPPING) {
+        _save_cache_file_prefix_mapping_entry_to_thread_caches(file_config, thread_contexts, entry, result, cache_lifetime, monotonic_timestamp);
+        return;
+    }
+
+    const size_t cache_size = _get_cache_size_by_message_type(file_config, entry->message_type);
+    if(cache_size <= 0)
+        return;
+
+    // Each translator thread has its own caches, and any of the threads may receive a packet with the addresses
+    for(size_t i = 0; i < file_config->program_translator_threads; i++) {
+        tundra__external_addr_xlat_cache_entry *cache = _get_cache_by_message_type(thread_contexts[i].external_addr_xlat_state, entry->message_type);
+        tundra__external_addr_xlat_timer_wheel *timer_wheel = _get_timer_wheel_by_message_type(thread_contexts[i].external_addr_xlat_state, entry->message_type);
+
+        switch(entry->message_type) {
+            case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+            case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+                xlat_addr_external_cache__save_4to6(cache, cache_size, timer_wheel, monotonic_timestamp, entry->src_ipv4, entry->dst_ipv4, entry->src_ipv6, entry->dst_ipv6, result, cache_lifetime);
+                break;
+
+            case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+                xlat_addr_external_cache__save_6to4(cache, cache_size, timer_wheel, monotonic_timestamp, entry->src_ipv6, entry->dst_ipv6, entry->src_ipv4, entry->dst_ipv4, result, cache_lifetime);
+                break;
+
+            default:
+                log__crash_invalid_internal_state("Invalid message type");
+        }
+    }
+}
+
+// If the prefix mapping caches are disabled, prefix mapping entries are skipped - unlike responses, they are not cached
+//  for any particular address pair
+static void _save_cache_file_prefix_mapping_entry_to_thread_caches(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const tundra__external_addr_xlat_cache_file_entry *entry, const tundra__external_addr_xlat_result result, const time_t cache_lifetime, const time_t monotonic_timestamp) {
+    for(size_t i = 0; i < file_config->program_translator_threads; i++) {
+        tundra__external_addr_xlat_prefix_cache *prefix_cache = _get_prefix_cache_by_message_type(thread_contexts[i].external_addr_xlat_state, entry->message_type);
+        if(prefix_cache == NULL)
+            return;
+
+        if(_is_4to6_message_type(entry->message_type))
+            xlat_addr_external_prefix_cache__save_4to6(prefix_cache, monotonic_timestamp, entry->src_ipv4, entry->dst_ipv4, entry->src_ipv6, entry->dst_ipv6, entry->src_prefix_length, entry->dst_prefix_length, result, cache_lifetime);
+        else
+            xlat_addr_external_prefix_cache__save_6to4(prefix_cache, monotonic_timestamp, entry->src_ipv6, entry->dst_ipv6, entry->src_ipv4, entry->dst_ipv4, entry->src_prefix_length, entry->dst_prefix_length, result, cache_lifetime);
+    }
+}
+
+// This function must be called after all the translator threads have been terminated!
+void xlat_addr_external_cache_file__save_and_close(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int snapshot_fd) {
+    if(snapshot_fd < 0)
+        return;
+
+    const size_t entry_count = xlat_addr_external_cache_file__save_to_fd(file_config, thread_contexts, snapshot_fd);
+
+    if(fsync(snapshot_fd) < 0)
+        log__crash(true, "Failed to synchronize the external address translation cache file!");
+
+    close(snapshot_fd);  // This also releases the lock
+
+    log__info("%zu entries have been saved to the external address translation cache file.", entry_count);
+}
+
+// Overwrites the file with the contents of the threads' caches and returns the count of saved entries; the file
+//  descriptor is left open. This function must be called after all the translator threads have been terminated!
+size_t xlat_addr_external_cache_file__save_to_fd(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int fd) {
+    if(ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0)
+        log__crash(true, "Failed to truncate the external address translation cache file!");
+
+    tundra__external_addr_xlat_cache_file_header header;
+    UTILS__MEM_ZERO_OUT(&header, sizeof(tundra__external_addr_xlat_cache_file_header));
+    memcpy(header.magic, _CACHE_FILE_MAGIC, 4);
+    header.version = _CACHE_FILE_VERSION;
+    header.creation_timestamp = htobe64((uint64_t) time(NULL));
+    header.entry_count = 0;  // The header is rewritten after all the entries have been written
+    _write_to_cache_file(fd, &header, sizeof(tundra__external_addr_xlat_cache_file_header));
+
+    tundra__external_addr_xlat_cache_file_entry *write_buffer = utils__alloc_zeroed_out_memory(_CACHE_FILE_WRITE_BUFFER_ENTRIES, sizeof(tundra__external_addr_xlat_cache_file_entry));
+    size_t entry_count = 0;
+    entry_count += _save_thread_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET, write_buffer);
+    entry_count += _save_thread_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET, write_buffer);
+    entry_count += _save_thread_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET, write_buffer);
+    entry_count += _save_thread_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET, write_buffer);
+    entry_count += _save_thread_prefix_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET, write_buffer);
+    entry_count += _save_thread_prefix_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET, write_buffer);
+    entry_count += _save_thread_prefix_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET, write_buffer);
+    entry_count += _save_thread_prefix_caches_to_cache_file(file_config, thread_contexts, fd, XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET, write_buffer);
+    utils__free_memory(write_buffer);
+
+    header.entry_count = htonl((uint32_t) entry_count);
+    if(lseek(fd, 0, SEEK_SET) < 0)
+        log__crash(true, "Failed to seek in the external address translation cache file!");
+    _write_to_cache_file(fd, &header, sizeof(tundra__external_addr_xlat_cache_file_header));
+
+    return entry_count;
+}
+
+static size_t _save_thread_caches_to_cache_file(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int snapshot_fd, const uint8_t message_type, tundra__external_addr_xlat_cache_file_entry *write_buffer) {
+    const size_t cache_size = _get_cache_size_by_message_type(file_config, message_type);
+    const time_t current_timestamp = utils__get_coarse_monotonic_timestamp();
+    if(cache_size <= 0 || current_timestamp <= 0)
+        return 0;
+
+    size_t entry_count = 0;
+    size_t buffered_entry_count = 0;
+
+    for(size_t slot = 0; slot < cache_size; slot++) {
+        // Since all the threads' caches are of the same size and use the same hash function, an entry would end up in
+        //  the same slot of each of them when loaded - therefore, only the most recently saved entry is worth saving
+        const tundra__external_addr_xlat_cache_entry *newest_entry = NULL;
+        for(size_t i = 0; i < file_config->program_translator_threads; i++) {
+            const tundra__external_addr_xlat_cache_entry *current_entry = _get_cache_by_message_type(thread_contexts[i].external_addr_xlat_state, message_type) + slot;
+            if(current_entry->expiration_timestamp > current_timestamp && (newest_entry == NULL || current_entry->expiration_timestamp > newest_entry->expiration_timestamp))
+                newest_entry = current_entry;
+        }
+
+        if(newest_entry == NULL)
+            continue;
+
+        tundra__external_addr_xlat_cache_file_entry *file_entry = write_buffer + buffered_entry_count;
+        UTILS__MEM_ZERO_OUT(file_entry, sizeof(tundra__external_addr_xlat_cache_file_entry));
+        file_entry->message_type = message_type;
+        file_entry->flags = newest_entry->flags;
+        file_entry->remaining_lifetime = htonl(xlat_addr_external_cache__get_wire_remaining_lifetime(newest_entry, current_timestamp));
+
+        // Negative entries contain no translated addresses, so only the inbound ones are saved
+        const bool is_negative = (newest_entry->flags & XLAT_ADDR_EXTERNAL_CACHE__FLAG_NEGATIVE);
+        const bool is_4to6 = _is_4to6_message_type(message_type);
+        if(is_4to6 || !is_negative) {
+            memcpy(file_entry->src_ipv4, newest_entry->src_ipv4, 4);
+            memcpy(file_entry->dst_ipv4, newest_entry->dst_ipv4, 4);
+        }
+        if(!is_4to6 || !is_negative) {
+            memcpy(file_entry->src_ipv6, newest_entry->src_ipv6, 16);
+            memcpy(file_entry->dst_ipv6, newest_entry->dst_ipv6, 16);
+        }
+
+        entry_count++;
+        if(++buffered_entry_count >= _CACHE_FILE_WRITE_BUFFER_ENTRIES) {
+            _write_to_cache_file(snapshot_fd, write_buffer, buffered_entry_count * sizeof(tundra__external_addr_xlat_cache_file_entry));
+            buffered_entry_count = 0;
+        }
+    }
+
+    if(buffered_entry_count > 0)
+        _write_to_cache_file(snapshot_fd, write_buffer, buffered_entry_count * sizeof(tundra__external_addr_xlat_cache_file_entry));
+
+    return entry_count;
+}
+
+static size_t _save_thread_prefix_caches_to_cache_file(const tundra__conf_file *const file_config, tundra__thread_ctx *thread_contexts, const int snapshot_fd, const uint8_t message_type, tundra__external_addr_xlat_cache_file_entry *write_buffer) {
+    const tundra__external_addr_xlat_prefix_cache *first_prefix_cache = _get_prefix_cache_by_message_type(thread_contexts[0].external_addr_xlat_state, message_type);
+    const time_t current_timestamp = utils__get_coarse_monotonic_timestamp();
+    if(first_prefix_cache == NULL || current_timestamp <= 0)
+        return 0;
+
+    const bool is_4to6 = _is_4to6_message_type(message_type);
+    const size_t in_addr_bits = (is_4to6 ? 32 : 128);
+    size_t entry_count = 0;
+    size_t buffered_entry_count = 0;
+
+    for(size_t slot = 0; slot < first_prefix_cache->entry_count; slot++) {
+        // The same applies as for the exact-pair caches (see above) - the slot of a prefix mapping does not depend on
+        //  the thread either
+        const tundra__external_addr_xlat_prefix_cache_entry *newest_entry = NULL;
+        for(size_t i = 0; i < file_config->program_translator_threads; i++) {
+            const tundra__external_addr_xlat_prefix_cache_entry *current_entry = _get_prefix_cache_by_message_type(thread_contexts[i].external_addr_xlat_state, message_type)->entries + slot;
+            if(current_entry->expiration_timestamp > current_timestamp && (newest_entry == NULL || current_entry->expiration_timestamp > newest_entry->expiration_timestamp))
+                newest_entry = current_entry;
+        }
+
+        if(newest_entry == NULL)
+            continue;
+
+        tundra__external_addr_xlat_cache_file_entry *file_entry = write_buffer + buffered_entry_count;
+        UTILS__MEM_ZERO_OUT(file_entry, sizeof(tundra__external_addr_xlat_cache_file_entry));
+        file_entry->message_type = message_type;
+        file_entry->flags = (uint8_t) (newest_entry->flags | _CACHE_FILE_ENTRY_FLAG_PREFIX_MAPPING);
+        file_entry->src_prefix_length = (uint8_t) (in_addr_bits - newest_entry->src_host_bits);
+        file_entry->dst_prefix_length = (uint8_t) (in_addr_bits - newest_entry->dst_host_bits);
+        file_entry->remaining_lifetime = htonl(
+            (newest_entry->expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP) ?
+            XLAT_ADDR_EXTERNAL_CACHE__WIRE_INDEFINITE_LIFETIME :
+            (uint32_t) (newest_entry->expiration_timestamp - current_timestamp)
+        );
+
+        // The outbound prefixes of negative entries are already zeroed out in the caches
+        if(is_4to6) {
+            memcpy(file_entry->src_ipv4, newest_entry->in_src_prefix, 4);
+            memcpy(file_entry->dst_ipv4, newest_entry->in_dst_prefix, 4);
+            memcpy(file_entry->src_ipv6, newest_entry->out_src_prefix, 16);
+            memcpy(file_entry->dst_ipv6, newest_entry->out_dst_prefix, 16);
+        } else {
+            memcpy(file_entry->src_ipv6, newest_entry->in_src_prefix, 16);
+            memcpy(file_entry->dst_ipv6, newest_entry->in_dst_prefix, 16);
+            memcpy(file_entry->src_ipv4, newest_entry->out_src_prefix, 4);
+            memcpy(file_entry->dst_ipv4, newest_entry->out_dst_prefix, 4);
+        }
+
+        entry_count++;
+        if(++buffered_entry_count >= _CACHE_FILE_WRITE_BUFFER_ENTRIES) {
+            _write_to_cache_file(snapshot_fd, write_buffer, buffered_entry_count * sizeof(tundra__external_addr_xlat_cache_file_entry));
+            buffered_entry_count = 0;
+        }
+    }
+
+    if(buffered_entry_count > 0)
+        _write_to_cache_file(snapshot_fd, write_buffer, buffered_entry_count * sizeof(tundra__external_addr_xlat_cache_file_entry));
+
+    return entry_count;
+}
+
+static void _write_to_cache_file(const int cache_file_fd, const void *data, const size_t data_size) {
+    const uint8_t *current_ptr = (const uint8_t *) data;
+    size_t remaining_bytes = data_size;
+
+    while(remaining_bytes > 0) {
+        const ssize_t return_value = write(cache_file_fd, current_ptr, remaining_bytes);
+        if(return_value < 0 && errno == EINTR)
+            continue;
+        if(return_value < 1)
+            log__crash(true, "Failed to write to the external address translation cache file!");
+
+        current_ptr += return_value;
+        remaining_bytes -= (size_t) return_value;
+    }
+}
+
+static tundra__external_addr_xlat_cache_entry *_get_cache_by_message_type(const tundra__external_addr_xlat_state *external_addr_xlat_state, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET: return external_addr_xlat_state->cache_4to6_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET: return external_addr_xlat_state->cache_4to6_icmp_error_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET: return external_addr_xlat_state->cache_6to4_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET: return external_addr_xlat_state->cache_6to4_icmp_error_packet;
+        default: log__crash_invalid_internal_state("Invalid message type");
+    }
+}
+
+static tundra__external_addr_xlat_timer_wheel *_get_timer_wheel_by_message_type(const tundra__external_addr_xlat_state *external_addr_xlat_state, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET: return external_addr_xlat_state->timer_wheel_4to6_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET: return external_addr_xlat_state->timer_wheel_4to6_icmp_error_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET: return external_addr_xlat_state->timer_wheel_6to4_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET: return external_addr_xlat_state->timer_wheel_6to4_icmp_error_packet;
+        default: log__crash_invalid_internal_state("Invalid message type");
+    }
+}
+
+static tundra__external_addr_xlat_prefix_cache *_get_prefix_cache_by_message_type(const tundra__external_addr_xlat_state *external_addr_xlat_state, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET: return external_addr_xlat_state->prefix_cache_4to6_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET: return external_addr_xlat_state->prefix_cache_4to6_icmp_error_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET: return external_addr_xlat_state->prefix_cache_6to4_main_packet;
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET: return external_addr_xlat_state->prefix_cache_6to4_icmp_error_packet;
+        default: log__crash_invalid_internal_state("Invalid message type");
+    }
+}
+
+static bool _is_4to6_message_type(const uint8_t message_type) {
+    return (message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET || message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET);
+}
+
+static size_t _get_cache_size_by_message_type(const tundra__conf_file *const file_config, const uint8_t message_type) {
+    switch(message_type) {
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_MAIN_PACKET:
+            return file_config->addressing_external_cache_size_main_addresses;
+
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET:
+        case XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_6TO4_ICMP_ERROR_PACKET:
+            return file_config->addressing_external_cache_size_icmp_error_addresses;
+
+        default:
+            log__crash_invalid_internal_state("Invalid message type");
+    }
+}
+
+
+#undef _CACHE_FILE_MAGIC
+#undef _CACHE_FILE_VERSION
+#undef _CACHE_FILE_WRITE_BUFFER_ENTRIES
+#undef _CACHE_FILE_ENTRY_FLAG_PREFIX_MAPPING
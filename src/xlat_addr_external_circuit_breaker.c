@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_circuit_breaker.h"
+
+#include"utils.h"
+#include"log.h"
+
+
+#define _MAX_OPEN_INTERVAL_DOUBLINGS ((uint32_t) 5)
+
+
+static time_t _get_open_interval(const tundra__conf_file *const file_config, const tundra__external_addr_xlat_circuit_breaker_server *breaker_server);
+
+
+tundra__external_addr_xlat_circuit_breaker *xlat_addr_external_circuit_breaker__create(void) {
+    // All the servers' circuit breakers are initially closed
+    tundra__external_addr_xlat_circuit_breaker *circuit_breaker = utils__alloc_zeroed_out_memory(1, sizeof(tundra__external_addr_xlat_circuit_breaker));
+
+    if(pthread_mutex_init(&circuit_breaker->mutex, NULL) != 0)
+        exit(TUNDRA__EXIT_MUTEX_FAILURE);
+
+    return circuit_breaker;
+}
+
+// This function must be called after all the translator threads have been terminated!
+void xlat_addr_external_circuit_breaker__free(tundra__external_addr_xlat_circuit_breaker *circuit_breaker) {
+    pthread_mutex_destroy(&circuit_breaker->mutex);
+
+    utils__free_memory(circuit_breaker);
+}
+
+/*
+ * Each server has its own circuit breaker, which is shared by all the translator threads. Once the configured number
+ * of consecutive exchanges with a server fails, its breaker opens, and the server is not queried at all until the open
+ * interval elapses. After that, exactly one thread is let through to probe the server (the others keep treating the
+ * breaker as open): if the probe succeeds, the breaker closes; otherwise, it is reopened for twice the previous interval
+ * (up to 32 times the configured one).
+ * If true is returned, the caller is obligated to query the server and call
+ * xlat_addr_external_circuit_breaker__report_exchange_outcome() afterwards, passing it the 'out_is_probe' value.
+ */
+bool xlat_addr_external_circuit_breaker__try_acquire_server(tundra__thread_ctx *const ctx, const size_t server_index, bool *out_is_probe) {
+    tundra__external_addr_xlat_circuit_breaker *circuit_breaker = ctx->external_addr_xlat_state->circuit_breaker;
+    tundra__external_addr_xlat_circuit_breaker_server *breaker_server = circuit_breaker->servers + server_index;
+    bool is_acquired = true;
+    *out_is_probe = false;
+
+    pthread_mutex_lock(&circuit_breaker->mutex);
+
+    if(breaker_server->is_open) {
+        if(breaker_server->is_probe_in_progress || ctx->current_timestamp < breaker_server->open_until_timestamp)
+            is_acquired = false;
+        else
+            breaker_server->is_probe_in_progress = *out_is_probe = true;
+    }
+
+    pthread_mutex_unlock(&circuit_breaker->mutex);
+
+    return is_acquired;
+}
+
+// Unlike xlat_addr_external_circuit_breaker__try_acquire_server(), this function never lets a probe through; it is
+//  meant for exchanges whose outcome is not known immediately.
+bool xlat_addr_external_circuit_breaker__is_server_closed(tundra__thread_ctx *const ctx, const size_t server_index) {
+    tundra__external_addr_xlat_circuit_breaker *circuit_breaker = ctx->external_addr_xlat_state->circuit_breaker;
+
+    pthread_mutex_lock(&circuit_breaker->mutex);
+    const bool is_closed = !circuit_breaker->servers[server_index].is_open;
+    pthread_mutex_unlock(&circuit_breaker->mutex);
+
+    return is_closed;
+}
+
+void xlat_addr_external_circuit_breaker__report_exchange_outcome(tundra__thread_ctx *const ctx, const size_t server_index, const bool is_probe, const bool was_successful) {
+    tundra__external_addr_xlat_circuit_breaker *circuit_breaker = ctx->external_addr_xlat_state->circuit_breaker;
+    tundra__external_addr_xlat_circuit_breaker_server *breaker_server = circuit_breaker->servers + server_index;
+
+    pthread_mutex_lock(&circuit_breaker->mutex);
+
+    const bool was_open = breaker_server->is_open;
+    bool has_opened = false;
+
+    if(was_successful) {
+        breaker_server->is_open = false;
+        breaker_server->is_probe_in_progress = false;
+        breaker_server->consecutive_failures = 0;
+        breaker_server->failed_probe_count = 0;
+
+    } else if(was_open) {
+        // Failures of exchanges which had begun before the breaker opened are ignored
+        if(!is_probe) {
+            pthread_mutex_unlock(&circuit_breaker->mutex);
+            return;
+        }
+
+        breaker_server->is_probe_in_progress = false;
+        if(breaker_server->failed_probe_count < UINT32_MAX)
+            breaker_server->failed_probe_count++;
+        breaker_server->open_until_timestamp = ctx->current_timestamp + _get_open_interval(ctx->config, breaker_server);
+
+    } else {
+        if(breaker_server->consecutive_failures < UINT32_MAX)
+            breaker_server->consecutive_failures++;
+
+        if(breaker_server->consecutive_failures >= ctx->config->addressing_external_unix_tcp_circuit_breaker_failure_threshold) {
+            breaker_server->is_open = true;
+            breaker_server->open_until_timestamp = ctx->current_timestamp + _get_open_interval(ctx->config, breaker_server);
+            has_opened = true;
+        }
+    }
+
+    pthread_mutex_unlock(&circuit_breaker->mutex);
+
+    // The state changes are rare, so they are worth logging (outside the critical section)
+    if(has_opened)
+        log__thread_info(ctx->thread_id, "The circuit breaker of external address translation server #%zu has opened.", server_index + 1);
+    else if(was_open && was_successful)
+        log__thread_info(ctx->thread_id, "The circuit breaker of external address translation server #%zu has closed.", server_index + 1);
+}
+
+static time_t _get_open_interval(const tundra__conf_file *const file_config, const tundra__external_addr_xlat_circuit_breaker_server *breaker_server) {
+    const uint32_t doublings = UTILS__MINIMUM_UNSAFE(breaker_server->failed_probe_count, _MAX_OPEN_INTERVAL_DOUBLINGS);
+
+    return (file_config->addressing_external_unix_tcp_circuit_breaker_open_interval << doublings);
+}
+
+
+#undef _MAX_OPEN_INTERVAL_DOUBLINGS
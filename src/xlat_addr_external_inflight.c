@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_inflight.h"
+
+#include"utils.h"
+#include"log.h"
+#include"signals.h"
+#include"xlat_addr_external.h"
+
+
+#define _WAIT_SLICE_MILLISECONDS ((uint64_t) 100)
+
+
+static inline bool _is_message_type_4to6(const uint8_t message_type);
+static inline size_t _get_slot_index(const tundra__external_addr_xlat_inflight_table *inflight_table, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip);
+static bool _wait_until_slot_is_done(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_inflight_slot *slot);
+static uint64_t _get_max_wait_milliseconds(const tundra__conf_file *const file_config);
+static uint64_t _get_current_monotonic_milliseconds(void);
+static void _get_absolute_monotonic_timespec(struct timespec *out_timespec, const uint64_t milliseconds);
+
+
+tundra__external_addr_xlat_inflight_table *xlat_addr_external_inflight__create_table(void) {
+    tundra__external_addr_xlat_inflight_table *inflight_table = utils__alloc_zeroed_out_memory(1, sizeof(tundra__external_addr_xlat_inflight_table));
+
+    // All the slots are initially in the XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_FREE state
+    inflight_table->slots = utils__alloc_zeroed_out_memory(TUNDRA__ADDRESSING_EXTERNAL_INFLIGHT_TABLE_SIZE, sizeof(tundra__external_addr_xlat_inflight_slot));
+    inflight_table->slot_count = TUNDRA__ADDRESSING_EXTERNAL_INFLIGHT_TABLE_SIZE;
+
+    if(pthread_mutex_init(&inflight_table->mutex, NULL) != 0)
+        exit(TUNDRA__EXIT_MUTEX_FAILURE);
+
+    // The waiting threads use timeouts based on CLOCK_MONOTONIC, which must therefore be set for the condition
+    pthread_condattr_t condition_attributes;
+    if(
+        (pthread_condattr_init(&condition_attributes) != 0) ||
+        (pthread_condattr_setclock(&condition_attributes, CLOCK_MONOTONIC) != 0) ||
+        (pthread_cond_init(&inflight_table->condition, &condition_attributes) != 0) ||
+        (pthread_condattr_destroy(&condition_attributes) != 0)
+    ) log__crash(false, "Failed to initialize a condition variable for the external address translation in-flight table!");
+
+    return inflight_table;
+}
+
+// This function must be called after all the translator threads have been terminated!
+void xlat_addr_external_inflight__free_table(tundra__external_addr_xlat_inflight_table *inflight_table) {
+    // The mutex & condition variable may be locked/waited on by a thread which has been terminated in the middle of a
+    //  query; since all the threads are gone at this point, it is safe to simply release the memory
+    pthread_cond_destroy(&inflight_table->condition);
+    pthread_mutex_destroy(&inflight_table->mutex);
+
+    utils__free_memory(inflight_table->slots);
+    utils__free_memory(inflight_table);
+}
+
+/*
+ * When a popular address pair appears, multiple translator threads may miss their caches on it at once. To prevent
+ * each of them from querying the external address translator separately, the first thread which misses on the pair
+ * becomes the "leader" of the query (true is returned, and the caller is then obligated to perform the query and call
+ * xlat_addr_external_inflight__finish() afterwards), whereas the others wait until it is finished and then reuse its
+ * result (false is returned, and the result is saved into the 'out_*' parameters).
+ */
+bool xlat_addr_external_inflight__join_or_lead(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_result *out_result, tundra__external_addr_xlat_response_params *out_response_params, size_t *out_slot_index) {
+    tundra__external_addr_xlat_inflight_table *inflight_table = ctx->external_addr_xlat_state->inflight_table;
+
+    const bool is_4to6 = _is_message_type_4to6(message_type);
+    const size_t in_addr_size = (is_4to6 ? 4 : 16);
+    const size_t out_addr_size = (is_4to6 ? 16 : 4);
+
+    uint8_t key_src_ip[16] = {0};
+    uint8_t key_dst_ip[16] = {0};
+    memcpy(key_src_ip, in_src_ip, in_addr_size);
+    memcpy(key_dst_ip, in_dst_ip, in_addr_size);
+
+    const size_t slot_index = _get_slot_index(inflight_table, message_type, key_src_ip, key_dst_ip);
+    tundra__external_addr_xlat_inflight_slot *slot = inflight_table->slots + slot_index;
+    *out_slot_index = slot_index;
+
+    pthread_mutex_lock(&inflight_table->mutex);
+
+    if(slot->state == XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_FREE) {
+        slot->state = XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_IN_FLIGHT;
+        slot->message_type = message_type;
+        slot->waiter_count = 0;
+        memcpy(slot->in_src_ip, key_src_ip, 16);
+        memcpy(slot->in_dst_ip, key_dst_ip, 16);
+
+        pthread_mutex_unlock(&inflight_table->mutex);
+        return true;
+    }
+
+    if(slot->message_type != message_type || !UTILS__MEM_EQ(slot->in_src_ip, key_src_ip, 16) || !UTILS__MEM_EQ(slot->in_dst_ip, key_dst_ip, 16)) {
+        // The slot is occupied by a query for a different address pair - the query is performed without coalescing.
+        //  The slot is not touched, so 'out_slot_index' must not be passed to xlat_addr_external_inflight__finish()!
+        pthread_mutex_unlock(&inflight_table->mutex);
+        *out_slot_index = SIZE_MAX;
+        return true;
+    }
+
+    bool result_available = true;
+    if(slot->state == XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_IN_FLIGHT) {
+        slot->waiter_count++;
+        result_available = _wait_until_slot_is_done(ctx, slot);
+        slot->waiter_count--;
+    }
+
+    if(result_available) {
+        *out_result = slot->result;
+        memcpy(out_response_params, &slot->response_params, sizeof(tundra__external_addr_xlat_response_params));
+        if(slot->result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+            memcpy(out_src_ip, slot->out_src_ip, out_addr_size);
+            memcpy(out_dst_ip, slot->out_dst_ip, out_addr_size);
+        }
+    } else {
+        // The leader did not finish the query in time - the packet is dropped, the same way it would be if this
+        //  thread performed the query itself and it timed out
+        *out_result = TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+        UTILS__MEM_ZERO_OUT(out_response_params, sizeof(tundra__external_addr_xlat_response_params));
+    }
+
+    // The last waiter releases the slot
+    if(slot->state == XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_DONE && slot->waiter_count == 0)
+        slot->state = XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_FREE;
+
+    pthread_mutex_unlock(&inflight_table->mutex);
+    return false;
+}
+
+void xlat_addr_external_inflight__finish(tundra__thread_ctx *const ctx, const size_t slot_index, const tundra__external_addr_xlat_result result, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const tundra__external_addr_xlat_response_params *response_params) {
+    if(slot_index == SIZE_MAX)  // The query was not coalesced
+        return;
+
+    tundra__external_addr_xlat_inflight_table *inflight_table = ctx->external_addr_xlat_state->inflight_table;
+    tundra__external_addr_xlat_inflight_slot *slot = inflight_table->slots + slot_index;
+
+    pthread_mutex_lock(&inflight_table->mutex);
+
+    if(slot->state != XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_IN_FLIGHT)
+        log__thread_crash_invalid_internal_state(ctx->thread_id, "An in-flight external address translation slot is in an invalid state");
+
+    slot->result = result;
+    memcpy(&slot->response_params, response_params, sizeof(tundra__external_addr_xlat_response_params));
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+        const size_t out_addr_size = (_is_message_type_4to6(slot->message_type) ? 16 : 4);
+        memcpy(slot->out_src_ip, out_src_ip, out_addr_size);
+        memcpy(slot->out_dst_ip, out_dst_ip, out_addr_size);
+    }
+
+    if(slot->waiter_count > 0) {
+        slot->state = XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_DONE;
+        pthread_cond_broadcast(&inflight_table->condition);
+    } else {
+        slot->state = XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_FREE;
+    }
+
+    pthread_mutex_unlock(&inflight_table->mutex);
+}
+
+static inline bool _is_message_type_4to6(const uint8_t message_type) {
+    return (message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_MAIN_PACKET || message_type == XLAT_ADDR_EXTERNAL__MESSAGE_TYPE_4TO6_ICMP_ERROR_PACKET);
+}
+
+static inline size_t _get_slot_index(const tundra__external_addr_xlat_inflight_table *inflight_table, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip) {
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+
+    hash = (hash ^ message_type) * 16777619U;
+    for(size_t i = 0; i < 16; i++)
+        hash = (hash ^ in_src_ip[i]) * 16777619U;
+    for(size_t i = 0; i < 16; i++)
+        hash = (hash ^ in_dst_ip[i]) * 16777619U;
+
+    return ((size_t) hash) % inflight_table->slot_count;
+}
+
+// The table's mutex must be locked when this function is called! Returns false if the leader did not finish the query
+//  in time.
+static bool _wait_until_slot_is_done(tundra__thread_ctx *const ctx, tundra__external_addr_xlat_inflight_slot *slot) {
+    tundra__external_addr_xlat_inflight_table *inflight_table = ctx->external_addr_xlat_state->inflight_table;
+    const uint64_t deadline = _get_current_monotonic_milliseconds() + _get_max_wait_milliseconds(ctx->config);
+
+    while(slot->state == XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_IN_FLIGHT) {
+        const uint64_t current_time = _get_current_monotonic_milliseconds();
+        if(current_time >= deadline)
+            return false;
+
+        // The waiting is done in short slices, so that a termination signal does not go unnoticed for long
+        const uint64_t remaining_time = (deadline - current_time);
+        struct timespec wake_up_time;
+        _get_absolute_monotonic_timespec(&wake_up_time, current_time + ((remaining_time < _WAIT_SLICE_MILLISECONDS) ? remaining_time : _WAIT_SLICE_MILLISECONDS));
+        pthread_cond_timedwait(&inflight_table->condition, &inflight_table->mutex, &wake_up_time);
+
+        if(!signals__should_this_thread_keep_running()) {
+            slot->waiter_count--;
+            if(slot->state == XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_DONE && slot->waiter_count == 0)
+                slot->state = XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_FREE;
+
+            pthread_mutex_unlock(&inflight_table->mutex);
+            pthread_exit(NULL);
+        }
+    }
+
+    return true;
+}
+
+static uint64_t _get_max_wait_milliseconds(const tundra__conf_file *const file_config) {
+    // The leader may need to both send the request and receive the response, each of which can take up to the
+    //  configured timeout, it may retransmit the request (datagram transports only), and it may fail over to each of
+    //  the configured servers; the 'inherited-fds' transport has no configurable timeout
+    if(file_config->addressing_external_transport != TUNDRA__ADDRESSING_EXTERNAL_TRANSPORT_INHERITED_FDS) {
+        const uint64_t timeout_milliseconds = (
+            ((uint64_t) file_config->addressing_external_unix_tcp_timeout.tv_sec * 1000) +
+            ((uint64_t) file_config->addressing_external_unix_tcp_timeout.tv_usec / 1000)
+        );
+        return 2 * timeout_milliseconds * (1 + (uint64_t) file_config->addressing_external_dgram_retransmissions) * (uint64_t) file_config->addressing_external_server_count;
+    }
+
+    return TUNDRA__MAX_TIMEOUT_MILLISECONDS;
+}
+
+static uint64_t _get_current_monotonic_milliseconds(void) {
+    struct timespec time_specification;
+    UTILS__MEM_ZERO_OUT(&time_specification, sizeof(struct timespec));
+
+    if(clock_gettime(CLOCK_MONOTONIC, &time_specification) < 0)
+        return 0;
+
+    return ((uint64_t) time_specification.tv_sec * 1000) + ((uint64_t) time_specification.tv_nsec / 1000000);
+}
+
+static void _get_absolute_monotonic_timespec(struct timespec *out_timespec, const uint64_t milliseconds) {
+    out_timespec->tv_sec = (time_t) (milliseconds / 1000);
+    out_timespec->tv_nsec = (long) ((milliseconds % 1000) * 1000000);
+}
+
+
+#undef _WAIT_SLICE_MILLISECONDS
@@ -0,0 +1,34 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+#define XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_FREE ((uint8_t) 0)
+#define XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_IN_FLIGHT ((uint8_t) 1)
+#define XLAT_ADDR_EXTERNAL_INFLIGHT__SLOT_STATE_DONE ((uint8_t) 2)
+
+
+extern tundra__external_addr_xlat_inflight_table *xlat_addr_external_inflight__create_table(void);
+extern void xlat_addr_external_inflight__free_table(tundra__external_addr_xlat_inflight_table *inflight_table);
+extern bool xlat_addr_external_inflight__join_or_lead(tundra__thread_ctx *const ctx, const uint8_t message_type, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip, tundra__external_addr_xlat_result *out_result, tundra__external_addr_xlat_response_params *out_response_params, size_t *out_slot_index);
+extern void xlat_addr_external_inflight__finish(tundra__thread_ctx *const ctx, const size_t slot_index, const tundra__external_addr_xlat_result result, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const tundra__external_addr_xlat_response_params *response_params);
@@ -0,0 +1,323 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_prefix_cache.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"xlat_addr_external_cache.h"
+#include"xlat_addr_external_timer_wheel.h"
+
+
+#define _TUPLE_DIMENSION ((size_t) 33)  // The number of possible host bit counts (0 to 32)
+
+
+static tundra__external_addr_xlat_result _lookup(const tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const size_t in_addr_size, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip);
+static void _save(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const size_t in_addr_size, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const uint8_t src_prefix_length, const uint8_t dst_prefix_length, const tundra__external_addr_xlat_result result, const time_t cache_lifetime);
+static size_t _invalidate(tundra__external_addr_xlat_prefix_cache *prefix_cache, const size_t in_addr_size, const uint8_t *src_prefix, const size_t src_prefix_length, const uint8_t *dst_prefix, const size_t dst_prefix_length);
+static void _increment_tuple_entry_count(tundra__external_addr_xlat_prefix_cache *prefix_cache, const size_t tuple);
+static void _decrement_tuple_entry_count(tundra__external_addr_xlat_prefix_cache *prefix_cache, const size_t tuple);
+static inline size_t _get_tuple_specificity(const size_t tuple);
+static inline size_t _get_hash_from_masked_in_addr_pair(const uint8_t *masked_in_src_ip, const uint8_t *masked_in_dst_ip, const size_t tuple, const size_t entry_count);
+static inline void _mask_addr(uint8_t *destination, const uint8_t *address, const size_t addr_size, const uint8_t host_bits);
+static inline void _apply_mapping(uint8_t *destination, const uint8_t *out_prefix, const size_t out_addr_size, const uint8_t *in_ip, const size_t in_addr_size, const uint8_t host_bits);
+static inline uint32_t _get_host_mask(const uint8_t host_bits);
+
+
+tundra__external_addr_xlat_prefix_cache *xlat_addr_external_prefix_cache__create(const size_t entry_count, const time_t current_timestamp) {
+    // It is absolutely crucial that the cache memory is zeroed out!
+    tundra__external_addr_xlat_prefix_cache *prefix_cache = utils__alloc_zeroed_out_memory(1, sizeof(tundra__external_addr_xlat_prefix_cache));
+    prefix_cache->entries = utils__alloc_zeroed_out_memory(entry_count, sizeof(tundra__external_addr_xlat_prefix_cache_entry));
+    prefix_cache->entry_count = entry_count;
+    prefix_cache->active_tuple_count = 0;
+    prefix_cache->timer_wheel = xlat_addr_external_timer_wheel__create(entry_count, current_timestamp);
+
+    return prefix_cache;
+}
+
+void xlat_addr_external_prefix_cache__free(tundra__external_addr_xlat_prefix_cache *prefix_cache) {
+    xlat_addr_external_timer_wheel__free(prefix_cache->timer_wheel);
+    utils__free_memory(prefix_cache->entries);
+    utils__free_memory(prefix_cache);
+}
+
+tundra__external_addr_xlat_result xlat_addr_external_prefix_cache__lookup_4to6(const tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    return _lookup(prefix_cache, current_timestamp, 4, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+}
+
+tundra__external_addr_xlat_result xlat_addr_external_prefix_cache__lookup_6to4(const tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    return _lookup(prefix_cache, current_timestamp, 16, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+}
+
+static tundra__external_addr_xlat_result _lookup(const tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const size_t in_addr_size, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, uint8_t *out_src_ip, uint8_t *out_dst_ip) {
+    if(prefix_cache == NULL)
+        return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+
+    // In the common case, there are only a few tuples in use (e.g. a single one for a SIIT-DC-style deployment), so
+    //  only a few hash table probes are performed
+    for(size_t i = 0; i < prefix_cache->active_tuple_count; i++) {
+        const size_t tuple = prefix_cache->active_tuples[i];
+        const uint8_t src_host_bits = (uint8_t) (tuple / _TUPLE_DIMENSION);
+        const uint8_t dst_host_bits = (uint8_t) (tuple % _TUPLE_DIMENSION);
+
+        uint8_t masked_in_src_ip[16], masked_in_dst_ip[16];
+        _mask_addr(masked_in_src_ip, in_src_ip, in_addr_size, src_host_bits);
+        _mask_addr(masked_in_dst_ip, in_dst_ip, in_addr_size, dst_host_bits);
+
+        const tundra__external_addr_xlat_prefix_cache_entry *target_entry = prefix_cache->entries + _get_hash_from_masked_in_addr_pair(masked_in_src_ip, masked_in_dst_ip, tuple, prefix_cache->entry_count);
+        if(
+            (target_entry->expiration_timestamp <= 0) ||  // '0' signifies that the cache entry is unused
+            (target_entry->src_host_bits != src_host_bits) || (target_entry->dst_host_bits != dst_host_bits) ||
+            !UTILS__MEM_EQ(target_entry->in_src_prefix, masked_in_src_ip, 16) ||
+            !UTILS__MEM_EQ(target_entry->in_dst_prefix, masked_in_dst_ip, 16)
+        ) continue;
+
+        const tundra__external_addr_xlat_result result = xlat_addr_external_cache__get_result_from_flags(target_entry->expiration_timestamp, target_entry->flags, current_timestamp);
+        if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)
+            continue;  // Expired - a less specific entry might still match
+
+        if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+            const size_t out_addr_size = (in_addr_size == 4 ? 16 : 4);
+            _apply_mapping(out_src_ip, target_entry->out_src_prefix, out_addr_size, in_src_ip, in_addr_size, src_host_bits);
+            _apply_mapping(out_dst_ip, target_entry->out_dst_prefix, out_addr_size, in_dst_ip, in_addr_size, dst_host_bits);
+        }
+
+        return result;
+    }
+
+    return TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE;
+}
+
+// The inbound & outbound addresses are those of the queried pair; the prefix lengths are the inbound ones, and they
+//  must have been validated by the caller (4to6: 0 to 32; 6to4: 96 to 128)
+void xlat_addr_external_prefix_cache__save_4to6(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const uint8_t *out_src_ipv6, const uint8_t *out_dst_ipv6, const uint8_t src_prefix_length, const uint8_t dst_prefix_length, const tundra__external_addr_xlat_result result, const time_t cache_lifetime) {
+    _save(prefix_cache, current_timestamp, 4, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6, src_prefix_length, dst_prefix_length, result, cache_lifetime);
+}
+
+void xlat_addr_external_prefix_cache__save_6to4(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const uint8_t *out_src_ipv4, const uint8_t *out_dst_ipv4, const uint8_t src_prefix_length, const uint8_t dst_prefix_length, const tundra__external_addr_xlat_result result, const time_t cache_lifetime) {
+    _save(prefix_cache, current_timestamp, 16, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4, src_prefix_length, dst_prefix_length, result, cache_lifetime);
+}
+
+static void _save(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const size_t in_addr_size, const uint8_t *in_src_ip, const uint8_t *in_dst_ip, const uint8_t *out_src_ip, const uint8_t *out_dst_ip, const uint8_t src_prefix_length, const uint8_t dst_prefix_length, const tundra__external_addr_xlat_result result, const time_t cache_lifetime) {
+    if(prefix_cache == NULL || result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_FAILURE)  // Failures are never cached
+        return;
+
+    const time_t expiration_timestamp = xlat_addr_external_cache__get_expiration_timestamp(cache_lifetime, current_timestamp);
+    if(expiration_timestamp <= 0)
+        return;
+
+    const uint8_t src_host_bits = (uint8_t) ((in_addr_size * 8) - src_prefix_length);
+    const uint8_t dst_host_bits = (uint8_t) ((in_addr_size * 8) - dst_prefix_length);
+    const size_t tuple = ((src_host_bits * _TUPLE_DIMENSION) + dst_host_bits);
+
+    uint8_t masked_in_src_ip[16], masked_in_dst_ip[16];
+    _mask_addr(masked_in_src_ip, in_src_ip, in_addr_size, src_host_bits);
+    _mask_addr(masked_in_dst_ip, in_dst_ip, in_addr_size, dst_host_bits);
+
+    // The cache is a direct-mapped hash table, so this may overwrite an existing cache entry (even one from another tuple)
+    const size_t entry_index = _get_hash_from_masked_in_addr_pair(masked_in_src_ip, masked_in_dst_ip, tuple, prefix_cache->entry_count);
+    tundra__external_addr_xlat_prefix_cache_entry *target_entry = prefix_cache->entries + entry_index;
+    if(target_entry->expiration_timestamp > 0)
+        _decrement_tuple_entry_count(prefix_cache, ((target_entry->src_host_bits * _TUPLE_DIMENSION) + target_entry->dst_host_bits));
+
+    memcpy(target_entry->in_src_prefix, masked_in_src_ip, 16);
+    memcpy(target_entry->in_dst_prefix, masked_in_dst_ip, 16);
+    UTILS__MEM_ZERO_OUT(target_entry->out_src_prefix, 16);
+    UTILS__MEM_ZERO_OUT(target_entry->out_dst_prefix, 16);
+    if(result == TUNDRA__EXTERNAL_ADDR_XLAT_RESULT_SUCCESS) {
+        const size_t out_addr_size = (in_addr_size == 4 ? 16 : 4);
+        _mask_addr(target_entry->out_src_prefix, out_src_ip, out_addr_size, src_host_bits);
+        _mask_addr(target_entry->out_dst_prefix, out_dst_ip, out_addr_size, dst_host_bits);
+    }
+    target_entry->expiration_timestamp = expiration_timestamp;
+    target_entry->src_host_bits = src_host_bits;
+    target_entry->dst_host_bits = dst_host_bits;
+    target_entry->flags = xlat_addr_external_cache__get_flags_from_result(result);
+
+    _increment_tuple_entry_count(prefix_cache, tuple);
+
+    if(expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP)
+        xlat_addr_external_timer_wheel__unschedule(prefix_cache->timer_wheel, entry_index);
+    else
+        xlat_addr_external_timer_wheel__schedule(prefix_cache->timer_wheel, entry_index, expiration_timestamp);
+}
+
+// Expired prefix mappings are not served during the grace period, so they are evicted right away; apart from freeing
+//  their slots, this makes tuples which only contain expired entries inactive, so lookups stop probing them. At most
+//  'max_evicted_entries' due entries are processed; returns false if there may be more of them left.
+bool xlat_addr_external_prefix_cache__evict_expired_entries(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const size_t max_evicted_entries) {
+    if(prefix_cache == NULL || current_timestamp <= 0)
+        return true;
+
+    size_t entry_index = 0;
+    for(size_t i = 0; i < max_evicted_entries; i++) {
+        if(!xlat_addr_external_timer_wheel__pop_due_entry(prefix_cache->timer_wheel, current_timestamp, &entry_index))
+            return true;
+
+        // The entry might have been invalidated or replaced by another one after it had been scheduled
+        tundra__external_addr_xlat_prefix_cache_entry *current_entry = prefix_cache->entries + entry_index;
+        if(current_entry->expiration_timestamp <= 0 || current_entry->expiration_timestamp == XLAT_ADDR_EXTERNAL_CACHE__INDEFINITE_EXPIRATION_TIMESTAMP)
+            continue;
+
+        if(current_timestamp >= current_entry->expiration_timestamp) {
+            _decrement_tuple_entry_count(prefix_cache, ((current_entry->src_host_bits * _TUPLE_DIMENSION) + current_entry->dst_host_bits));
+            current_entry->expiration_timestamp = 0;
+        } else {
+            xlat_addr_external_timer_wheel__schedule(prefix_cache->timer_wheel, entry_index, current_entry->expiration_timestamp);
+        }
+    }
+
+    return false;
+}
+
+size_t xlat_addr_external_prefix_cache__invalidate_4to6(tundra__external_addr_xlat_prefix_cache *prefix_cache, const uint8_t *src_ipv4_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv4_prefix, const size_t dst_prefix_length) {
+    return _invalidate(prefix_cache, 4, src_ipv4_prefix, src_prefix_length, dst_ipv4_prefix, dst_prefix_length);
+}
+
+size_t xlat_addr_external_prefix_cache__invalidate_6to4(tundra__external_addr_xlat_prefix_cache *prefix_cache, const uint8_t *src_ipv6_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv6_prefix, const size_t dst_prefix_length) {
+    return _invalidate(prefix_cache, 16, src_ipv6_prefix, src_prefix_length, dst_ipv6_prefix, dst_prefix_length);
+}
+
+// Invalidates all the entries which overlap with the specified pair of prefixes, i.e. both those which are inside it and
+//  those which contain it (otherwise, a less specific mapping would keep covering the invalidated addresses)
+static size_t _invalidate(tundra__external_addr_xlat_prefix_cache *prefix_cache, const size_t in_addr_size, const uint8_t *src_prefix, const size_t src_prefix_length, const uint8_t *dst_prefix, const size_t dst_prefix_length) {
+    if(prefix_cache == NULL || prefix_cache->active_tuple_count == 0)
+        return 0;
+
+    size_t invalidated_entry_count = 0;
+    for(size_t i = 0; i < prefix_cache->entry_count; i++) {
+        tundra__external_addr_xlat_prefix_cache_entry *current_entry = prefix_cache->entries + i;
+        if(current_entry->expiration_timestamp <= 0)
+            continue;
+
+        const size_t entry_src_prefix_length = ((in_addr_size * 8) - current_entry->src_host_bits);
+        const size_t entry_dst_prefix_length = ((in_addr_size * 8) - current_entry->dst_host_bits);
+        if(
+            utils_ip__is_addr_in_prefix(current_entry->in_src_prefix, src_prefix, UTILS__MINIMUM_UNSAFE(src_prefix_length, entry_src_prefix_length)) &&
+            utils_ip__is_addr_in_prefix(current_entry->in_dst_prefix, dst_prefix, UTILS__MINIMUM_UNSAFE(dst_prefix_length, entry_dst_prefix_length))
+        ) {
+            _decrement_tuple_entry_count(prefix_cache, ((current_entry->src_host_bits * _TUPLE_DIMENSION) + current_entry->dst_host_bits));
+            current_entry->expiration_timestamp = 0;
+            invalidated_entry_count++;
+        }
+    }
+
+    return invalidated_entry_count;
+}
+
+// Checks whether the host bits of the inbound and outbound addresses of a prefix mapping are equal - if they are not,
+//  the mapping cannot be expressed as a pair of prefixes
+bool xlat_addr_external_prefix_cache__is_mapping_consistent(const uint8_t *in_ip, const size_t in_addr_size, const uint8_t *out_ip, const size_t out_addr_size, const uint8_t host_bits) {
+    uint32_t in_suffix, out_suffix;
+    memcpy(&in_suffix, in_ip + (in_addr_size - 4), 4);
+    memcpy(&out_suffix, out_ip + (out_addr_size - 4), 4);
+
+    const uint32_t host_mask = _get_host_mask(host_bits);
+    return ((ntohl(in_suffix) & host_mask) == (ntohl(out_suffix) & host_mask));
+}
+
+static void _increment_tuple_entry_count(tundra__external_addr_xlat_prefix_cache *prefix_cache, const size_t tuple) {
+    if(prefix_cache->tuple_entry_counts[tuple]++ > 0)
+        return;
+
+    // The tuple has become active - it is inserted into the list so that the list stays sorted by specificity
+    const size_t specificity = _get_tuple_specificity(tuple);
+    size_t position = 0;
+    while(position < prefix_cache->active_tuple_count && _get_tuple_specificity(prefix_cache->active_tuples[position]) <= specificity)
+        position++;
+
+    memmove(prefix_cache->active_tuples + position + 1, prefix_cache->active_tuples + position, (prefix_cache->active_tuple_count - position) * sizeof(uint16_t));
+    prefix_cache->active_tuples[position] = (uint16_t) tuple;
+    prefix_cache->active_tuple_count++;
+}
+
+static void _decrement_tuple_entry_count(tundra__external_addr_xlat_prefix_cache *prefix_cache, const size_t tuple) {
+    if(--prefix_cache->tuple_entry_counts[tuple] > 0)
+        return;
+
+    // The tuple has become inactive
+    for(size_t i = 0; i < prefix_cache->active_tuple_count; i++) {
+        if(prefix_cache->active_tuples[i] != tuple)
+            continue;
+
+        memmove(prefix_cache->active_tuples + i, prefix_cache->active_tuples + i + 1, (prefix_cache->active_tuple_count - i - 1) * sizeof(uint16_t));
+        prefix_cache->active_tuple_count--;
+        return;
+    }
+}
+
+// Lower values signify more specific tuples, i.e. those with fewer host bits; ties are broken by the source host bits
+static inline size_t _get_tuple_specificity(const size_t tuple) {
+    const size_t src_host_bits = (tuple / _TUPLE_DIMENSION);
+    const size_t dst_host_bits = (tuple % _TUPLE_DIMENSION);
+
+    return (((src_host_bits + dst_host_bits) * _TUPLE_DIMENSION) + src_host_bits);
+}
+
+// WARNING: 'entry_count' must not be zero!
+static inline size_t _get_hash_from_masked_in_addr_pair(const uint8_t *masked_in_src_ip, const uint8_t *masked_in_dst_ip, const size_t tuple, const size_t entry_count) {
+    // Memory alignment
+    uint32_t in_ip_addrs_32bit[8];
+    memcpy(in_ip_addrs_32bit, masked_in_src_ip, 16);
+    memcpy(in_ip_addrs_32bit + 4, masked_in_dst_ip, 16);
+
+    static const uint32_t small_primes[8] = {2, 3, 5, 7, 7, 5, 3, 2};
+
+    size_t hash = (tuple * 11);
+    for(size_t i = 0; i < 8; i++) {
+        hash += (size_t) (in_ip_addrs_32bit[i] * small_primes[i]);
+    }
+    return hash % entry_count;
+}
+
+// The destination is always 16 bytes long; IPv4 addresses occupy the first 4 bytes, the rest is zeroed out
+static inline void _mask_addr(uint8_t *destination, const uint8_t *address, const size_t addr_size, const uint8_t host_bits) {
+    UTILS__MEM_ZERO_OUT(destination, 16);
+    memcpy(destination, address, addr_size);
+
+    uint32_t suffix;
+    memcpy(&suffix, destination + (addr_size - 4), 4);
+    suffix = htonl(ntohl(suffix) & ~_get_host_mask(host_bits));
+    memcpy(destination + (addr_size - 4), &suffix, 4);
+}
+
+static inline void _apply_mapping(uint8_t *destination, const uint8_t *out_prefix, const size_t out_addr_size, const uint8_t *in_ip, const size_t in_addr_size, const uint8_t host_bits) {
+    memcpy(destination, out_prefix, out_addr_size);
+
+    uint32_t prefix_suffix, in_suffix;
+    memcpy(&prefix_suffix, out_prefix + (out_addr_size - 4), 4);
+    memcpy(&in_suffix, in_ip + (in_addr_size - 4), 4);
+
+    const uint32_t host_mask = _get_host_mask(host_bits);
+    const uint32_t out_suffix = htonl((ntohl(prefix_suffix) & ~host_mask) | (ntohl(in_suffix) & host_mask));
+    memcpy(destination + (out_addr_size - 4), &out_suffix, 4);
+}
+
+static inline uint32_t _get_host_mask(const uint8_t host_bits) {
+    if(host_bits >= 32)
+        return UINT32_MAX;
+
+    return (((uint32_t) 1 << host_bits) - 1);
+}
+
+
+#undef _TUPLE_DIMENSION
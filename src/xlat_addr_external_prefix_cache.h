@@ -0,0 +1,35 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+extern tundra__external_addr_xlat_prefix_cache *xlat_addr_external_prefix_cache__create(const size_t entry_count, const time_t current_timestamp);
+extern void xlat_addr_external_prefix_cache__free(tundra__external_addr_xlat_prefix_cache *prefix_cache);
+extern tundra__external_addr_xlat_result xlat_addr_external_prefix_cache__lookup_4to6(const tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
+extern tundra__external_addr_xlat_result xlat_addr_external_prefix_cache__lookup_6to4(const tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+extern void xlat_addr_external_prefix_cache__save_4to6(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, const uint8_t *out_src_ipv6, const uint8_t *out_dst_ipv6, const uint8_t src_prefix_length, const uint8_t dst_prefix_length, const tundra__external_addr_xlat_result result, const time_t cache_lifetime);
+extern void xlat_addr_external_prefix_cache__save_6to4(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, const uint8_t *out_src_ipv4, const uint8_t *out_dst_ipv4, const uint8_t src_prefix_length, const uint8_t dst_prefix_length, const tundra__external_addr_xlat_result result, const time_t cache_lifetime);
+extern bool xlat_addr_external_prefix_cache__evict_expired_entries(tundra__external_addr_xlat_prefix_cache *prefix_cache, const time_t current_timestamp, const size_t max_evicted_entries);
+extern size_t xlat_addr_external_prefix_cache__invalidate_4to6(tundra__external_addr_xlat_prefix_cache *prefix_cache, const uint8_t *src_ipv4_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv4_prefix, const size_t dst_prefix_length);
+extern size_t xlat_addr_external_prefix_cache__invalidate_6to4(tundra__external_addr_xlat_prefix_cache *prefix_cache, const uint8_t *src_ipv6_prefix, const size_t src_prefix_length, const uint8_t *dst_ipv6_prefix, const size_t dst_prefix_length);
+extern bool xlat_addr_external_prefix_cache__is_mapping_consistent(const uint8_t *in_ip, const size_t in_addr_size, const uint8_t *out_ip, const size_t out_addr_size, const uint8_t host_bits);
@@ -0,0 +1,99 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_rate_limiter.h"
+
+#include"utils.h"
+
+
+static tundra__external_addr_xlat_rate_limiter_bucket *_get_bucket(tundra__external_addr_xlat_rate_limiter *rate_limiter, const uint8_t *src_prefix, const bool is_ipv6);
+static void _get_src_prefix(const uint8_t *src_ip, const size_t prefix_length, uint8_t *out_src_prefix);
+
+
+tundra__external_addr_xlat_rate_limiter *xlat_addr_external_rate_limiter__create(void) {
+    // All the buckets are initially unused
+    return utils__alloc_zeroed_out_memory(1, sizeof(tundra__external_addr_xlat_rate_limiter));
+}
+
+void xlat_addr_external_rate_limiter__free(tundra__external_addr_xlat_rate_limiter *rate_limiter) {
+    utils__free_memory(rate_limiter);
+}
+
+/*
+ * Each source prefix (of the configured length) has a token bucket which holds up to 'burst' tokens and is refilled
+ * with 'per_second' tokens every second; a query may only be sent if a token can be taken from the bucket of the prefix
+ * which the packet being translated came from. This way, a single client sweeping through many destinations cannot
+ * flood the "backend" with queries and stall the translation of unrelated traffic on the same thread.
+ * Returns false if the bucket is empty, i.e. if the query must not be sent.
+ */
+bool xlat_addr_external_rate_limiter__try_consume_token(tundra__thread_ctx *const ctx, const uint8_t *src_ip, const bool is_ipv6) {
+    const tundra__conf_file *const config = ctx->config;
+
+    uint8_t src_prefix[16];
+    if(is_ipv6)
+        _get_src_prefix(src_ip, config->addressing_external_query_rate_limit_ipv6_prefix_length, src_prefix);
+    else
+        _get_src_prefix(src_ip, config->addressing_external_query_rate_limit_ipv4_prefix_length, src_prefix);
+
+    tundra__external_addr_xlat_rate_limiter_bucket *bucket = _get_bucket(ctx->external_addr_xlat_state->rate_limiter, src_prefix, is_ipv6);
+
+    if(!bucket->is_in_use || bucket->is_ipv6 != is_ipv6 || !UTILS__MEM_EQ(bucket->src_prefix, src_prefix, 16)) {
+        // The bucket is (re)initialized for the source prefix; since this may only happen on a hash collision, it makes
+        //  the limiting more lenient at worst
+        memcpy(bucket->src_prefix, src_prefix, 16);
+        bucket->last_refill_timestamp = ctx->current_timestamp;
+        bucket->token_count = config->addressing_external_query_rate_limit_burst;
+        bucket->is_ipv6 = is_ipv6;
+        bucket->is_in_use = true;
+
+    } else if(ctx->current_timestamp > bucket->last_refill_timestamp) {
+        const uint64_t refilled_token_count = ((uint64_t) (ctx->current_timestamp - bucket->last_refill_timestamp) * config->addressing_external_query_rate_limit_per_second);
+        bucket->token_count = (uint32_t) UTILS__MINIMUM_UNSAFE((uint64_t) bucket->token_count + refilled_token_count, (uint64_t) config->addressing_external_query_rate_limit_burst);
+        bucket->last_refill_timestamp = ctx->current_timestamp;
+    }
+
+    if(bucket->token_count == 0)
+        return false;
+
+    bucket->token_count--;
+    return true;
+}
+
+static tundra__external_addr_xlat_rate_limiter_bucket *_get_bucket(tundra__external_addr_xlat_rate_limiter *rate_limiter, const uint8_t *src_prefix, const bool is_ipv6) {
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261;
+
+    hash = (hash ^ (uint32_t) is_ipv6) * 16777619;
+    for(size_t i = 0; i < 16; i++)
+        hash = (hash ^ src_prefix[i]) * 16777619;
+
+    return rate_limiter->buckets + (hash % TUNDRA__ADDRESSING_EXTERNAL_QUERY_RATE_LIMIT_TABLE_SIZE);
+}
+
+// The host bits (and the unused bytes of IPv4 prefixes) are zeroed out; 'prefix_length' must not exceed the address' size
+static void _get_src_prefix(const uint8_t *src_ip, const size_t prefix_length, uint8_t *out_src_prefix) {
+    UTILS__MEM_ZERO_OUT(out_src_prefix, 16);
+    memcpy(out_src_prefix, src_ip, prefix_length / 8);
+
+    if(prefix_length % 8 != 0)
+        out_src_prefix[prefix_length / 8] = (uint8_t) (src_ip[prefix_length / 8] & (0xff << (8 - (prefix_length % 8))));
+}
@@ -0,0 +1,176 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_external_timer_wheel.h"
+
+#include"utils.h"
+
+
+#define _SLOT_BITS ((size_t) 6)  // log2(TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS)
+#define _SLOT_MASK ((time_t) (TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS - 1))
+
+
+static void _link_entry(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index, const time_t eviction_timestamp);
+static void _unlink_entry(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index);
+static void _cascade_slot(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t level);
+static inline size_t _get_slot_index(const size_t level, const time_t timestamp);
+
+
+// The per-entry arrays are as large as the caches they belong to, so they are not touched here - zeroed-out entries are
+//  not scheduled (see XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_SLOT), and their pages are faulted in only once they are used
+tundra__external_addr_xlat_timer_wheel *xlat_addr_external_timer_wheel__create(const size_t entry_count, const time_t current_timestamp) {
+    tundra__external_addr_xlat_timer_wheel *timer_wheel = utils__alloc_zeroed_out_memory(1, sizeof(tundra__external_addr_xlat_timer_wheel));
+    timer_wheel->next_entry_indices = utils__alloc_huge_page_backed_zeroed_out_memory(entry_count, sizeof(uint32_t));
+    timer_wheel->previous_entry_indices = utils__alloc_huge_page_backed_zeroed_out_memory(entry_count, sizeof(uint32_t));
+    timer_wheel->entry_slots = utils__alloc_huge_page_backed_zeroed_out_memory(entry_count, sizeof(uint16_t));
+    timer_wheel->eviction_timestamps = utils__alloc_huge_page_backed_zeroed_out_memory(entry_count, sizeof(uint32_t));
+    timer_wheel->entry_count = entry_count;
+    timer_wheel->current_tick = current_timestamp;
+
+    for(size_t i = 0; i < (TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_LEVELS * TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS); i++)
+        timer_wheel->slot_heads[i] = XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY;
+
+    return timer_wheel;
+}
+
+void xlat_addr_external_timer_wheel__free(tundra__external_addr_xlat_timer_wheel *timer_wheel) {
+    utils__free_huge_page_backed_memory(timer_wheel->next_entry_indices, timer_wheel->entry_count, sizeof(uint32_t));
+    utils__free_huge_page_backed_memory(timer_wheel->previous_entry_indices, timer_wheel->entry_count, sizeof(uint32_t));
+    utils__free_huge_page_backed_memory(timer_wheel->entry_slots, timer_wheel->entry_count, sizeof(uint16_t));
+    utils__free_huge_page_backed_memory(timer_wheel->eviction_timestamps, timer_wheel->entry_count, sizeof(uint32_t));
+    utils__free_memory(timer_wheel);
+}
+
+// If the entry has already been scheduled, it is rescheduled. The eviction may happen later than the timestamp
+//  specified (e.g. if it lies in the past, or if no packet is received for a while), but never earlier.
+void xlat_addr_external_timer_wheel__schedule(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index, const time_t eviction_timestamp) {
+    if(entry_index >= timer_wheel->entry_count)
+        return;
+
+    _unlink_entry(timer_wheel, entry_index);
+    _link_entry(timer_wheel, entry_index, eviction_timestamp);
+}
+
+void xlat_addr_external_timer_wheel__unschedule(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index) {
+    if(entry_index >= timer_wheel->entry_count)
+        return;
+
+    _unlink_entry(timer_wheel, entry_index);
+}
+
+/*
+ * Returns the index of an entry whose eviction is due (and unschedules it), or false if there are no such entries. The
+ * wheel is advanced one tick (second) at a time, so the work is proportional to the number of elapsed ticks and due
+ * entries; the caller may stop calling this function at any time and continue later, i.e. evict entries incrementally.
+ * Keep in mind that entries may also have been invalidated or overwritten in the meantime - the caller is responsible
+ * for checking whether the entry is really supposed to be evicted.
+ */
+bool xlat_addr_external_timer_wheel__pop_due_entry(tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, size_t *out_entry_index) {
+    for(;;) {
+        const uint32_t head_entry_index = timer_wheel->slot_heads[_get_slot_index(0, timer_wheel->current_tick)];
+        if(head_entry_index != XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY) {
+            _unlink_entry(timer_wheel, head_entry_index);
+            *out_entry_index = head_entry_index;
+            return true;
+        }
+
+        if(timer_wheel->current_tick >= current_timestamp)
+            return false;
+
+        timer_wheel->current_tick++;
+
+        // When a higher level's slot boundary is crossed, the slot's entries are redistributed to the lower levels; the
+        //  higher levels must be processed first, as their entries may end up in the lower levels' current slots
+        for(size_t level = (TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_LEVELS - 1); level > 0; level--) {
+            const time_t level_granularity_mask = (((time_t) 1 << (level * _SLOT_BITS)) - 1);
+            if((timer_wheel->current_tick & level_granularity_mask) == 0)
+                _cascade_slot(timer_wheel, level);
+        }
+    }
+}
+
+static void _link_entry(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index, const time_t eviction_timestamp) {
+    // Entries whose eviction is already due are put into the current slot of level 0
+    const time_t timestamp = UTILS__MAXIMUM_UNSAFE(eviction_timestamp, timer_wheel->current_tick);
+
+    // The lowest level on which the timestamp lies less than a full rotation ahead of the current tick is used; if even
+    //  the highest level is not enough, the entry is put into the highest level's furthest slot and redistributed later
+    size_t level = 0;
+    time_t slot_timestamp = timestamp;
+    while(((timestamp >> (level * _SLOT_BITS)) - (timer_wheel->current_tick >> (level * _SLOT_BITS))) >= (time_t) TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS) {
+        if(++level >= TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_LEVELS) {
+            level = (TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_LEVELS - 1);
+            slot_timestamp = (timer_wheel->current_tick + (_SLOT_MASK << (level * _SLOT_BITS)));
+            break;
+        }
+    }
+
+    const size_t slot = ((level * TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS) + _get_slot_index(level, slot_timestamp));
+    const uint32_t old_head_entry_index = timer_wheel->slot_heads[slot];
+
+    timer_wheel->next_entry_indices[entry_index] = old_head_entry_index;
+    timer_wheel->previous_entry_indices[entry_index] = XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY;
+    timer_wheel->entry_slots[entry_index] = (uint16_t) (slot + 1);
+    timer_wheel->eviction_timestamps[entry_index] = (uint32_t) UTILS__MINIMUM_UNSAFE(timestamp, (time_t) UINT32_MAX);  // Monotonic timestamps do not get anywhere near this
+    if(old_head_entry_index != XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY)
+        timer_wheel->previous_entry_indices[old_head_entry_index] = (uint32_t) entry_index;
+    timer_wheel->slot_heads[slot] = (uint32_t) entry_index;
+}
+
+static void _unlink_entry(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index) {
+    if(timer_wheel->entry_slots[entry_index] == XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_SLOT)
+        return;
+
+    const size_t slot = (size_t) (timer_wheel->entry_slots[entry_index] - 1);
+
+    const uint32_t next_entry_index = timer_wheel->next_entry_indices[entry_index];
+    const uint32_t previous_entry_index = timer_wheel->previous_entry_indices[entry_index];
+
+    if(previous_entry_index == XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY)
+        timer_wheel->slot_heads[slot] = next_entry_index;
+    else
+        timer_wheel->next_entry_indices[previous_entry_index] = next_entry_index;
+
+    if(next_entry_index != XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY)
+        timer_wheel->previous_entry_indices[next_entry_index] = previous_entry_index;
+
+    timer_wheel->entry_slots[entry_index] = XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_SLOT;
+}
+
+// The slot's entries are redistributed according to their eviction timestamps - since the slot covers the interval
+//  starting at the current tick, they all end up on lower levels
+static void _cascade_slot(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t level) {
+    const size_t slot = ((level * TUNDRA__ADDRESSING_EXTERNAL_TIMER_WHEEL_SLOTS) + _get_slot_index(level, timer_wheel->current_tick));
+
+    for(uint32_t entry_index = timer_wheel->slot_heads[slot]; entry_index != XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY; entry_index = timer_wheel->slot_heads[slot]) {
+        _unlink_entry(timer_wheel, entry_index);
+        _link_entry(timer_wheel, entry_index, (time_t) timer_wheel->eviction_timestamps[entry_index]);
+    }
+}
+
+static inline size_t _get_slot_index(const size_t level, const time_t timestamp) {
+    return (size_t) ((timestamp >> (level * _SLOT_BITS)) & _SLOT_MASK);
+}
+
+
+#undef _SLOT_BITS
+#undef _SLOT_MASK
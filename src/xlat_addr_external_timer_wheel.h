@@ -0,0 +1,34 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include"tundra.h"
+
+
+#define XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_ENTRY ((uint32_t) UINT32_MAX)
+#define XLAT_ADDR_EXTERNAL_TIMER_WHEEL__NO_SLOT ((uint16_t) 0)  // Zero, so that the zeroed-out entries are not scheduled
+
+
+extern tundra__external_addr_xlat_timer_wheel *xlat_addr_external_timer_wheel__create(const size_t entry_count, const time_t current_timestamp);
+extern void xlat_addr_external_timer_wheel__free(tundra__external_addr_xlat_timer_wheel *timer_wheel);
+extern void xlat_addr_external_timer_wheel__schedule(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index, const time_t eviction_timestamp);
+extern void xlat_addr_external_timer_wheel__unschedule(tundra__external_addr_xlat_timer_wheel *timer_wheel, const size_t entry_index);
+extern bool xlat_addr_external_timer_wheel__pop_due_entry(tundra__external_addr_xlat_timer_wheel *timer_wheel, const time_t current_timestamp, size_t *out_entry_index);
@@ -0,0 +1,532 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_map_t.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"log.h"
+#include"utils_lpm.h"
+#include"utils_xlat_addr.h"
+
+
+#define _ERROR_MESSAGE_SIZE ((size_t) 512)
+#define _LPM_TABLE_FIRST_STRIDE_BITS ((size_t) 16)
+
+
+static bool _load_rules(tundra__map_t_state *map_t_state, const char *const rules_file_path, char *error_message, const size_t error_message_size);
+static bool _parse_rule_line(tundra__map_t_rule *rule, char *line, bool *out_is_empty);
+static bool _parse_small_number(const char *number_string, const unsigned long max_value, uint8_t *out_number);
+static int _compare_rules_by_ipv6_prefix(const void *rule1, const void *rule2);
+static int _compare_rules_by_ipv4_prefix(const void *rule1, const void *rule2);
+static bool _construct_map_ipv6_address_for_ipv4_side_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint8_t *out_ipv6);
+static bool _extract_ipv4_address_from_map_ipv6_address(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv6, uint8_t *out_ipv4, const tundra__map_t_rule **out_rule, uint16_t *out_psid);
+static void _construct_map_ipv6_address(const tundra__map_t_rule *const rule, const uint8_t *ipv4, const uint16_t psid, uint8_t *out_ipv6);
+static bool _get_psid_of_port(const tundra__map_t_rule *const rule, const uint16_t port, uint16_t *out_psid);
+static bool _get_ipv4_side_port(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint16_t *out_port);
+static bool _get_ipv6_side_port(const tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, uint16_t *out_port);
+static inline uint64_t _get_low_bits_mask(const size_t bit_count);
+
+
+// This function must be called before the program's working directory is changed and its privileges are dropped.
+tundra__map_t_state *xlat_addr_map_t__create_state(const tundra__conf_file *const file_config) {
+    tundra__map_t_state *map_t_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__map_t_state));
+
+    char error_message[_ERROR_MESSAGE_SIZE];
+    if(!_load_rules(map_t_state, file_config->addressing_map_t_rules_file, error_message, _ERROR_MESSAGE_SIZE))
+        log__crash(false, "%s", error_message);
+
+    map_t_state->ipv4_rule_table = utils_lpm__create_table(4, _LPM_TABLE_FIRST_STRIDE_BITS);
+    map_t_state->ipv6_rule_table = utils_lpm__create_table(16, _LPM_TABLE_FIRST_STRIDE_BITS);
+    for(size_t i = 0; i < map_t_state->rule_count; i++) {
+        const tundra__map_t_rule *rule = map_t_state->rules + i;
+        utils_lpm__insert(map_t_state->ipv4_rule_table, rule->ipv4_prefix, rule->ipv4_prefix_length, (uint32_t) i);
+        utils_lpm__insert(map_t_state->ipv6_rule_table, rule->ipv6_prefix, rule->ipv6_prefix_length, (uint32_t) i);
+    }
+    utils_lpm__build(map_t_state->ipv4_rule_table);
+    utils_lpm__build(map_t_state->ipv6_rule_table);
+
+    log__info("%zu MAP-T rules have been loaded from the file '%s'.", map_t_state->rule_count, file_config->addressing_map_t_rules_file);
+
+    return map_t_state;
+}
+
+void xlat_addr_map_t__free_state(tundra__map_t_state *map_t_state) {
+    utils_lpm__free_table(map_t_state->ipv4_rule_table);
+    utils_lpm__free_table(map_t_state->ipv6_rule_table);
+    utils__free_memory(map_t_state->rules);
+    utils__free_memory(map_t_state);
+}
+
+/*
+ * Tundra acts as a MAP-T border relay (RFC 7599): packets from the IPv4 internet are sent to the CE which owns the
+ * packet's destination address and port (as determined by the MAP rules), and their source addresses are embedded into
+ * the default mapping rule's (DMR) prefix, which is the 'addressing.nat64_clat_siit.prefix'.
+ */
+bool xlat_addr_map_t__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    return (
+        utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(ctx, in_src_ipv4, out_src_ipv6) &&
+        _construct_map_ipv6_address_for_ipv4_side_packet(ctx, in_dst_ipv4, out_dst_ipv6)
+    );
+}
+
+bool xlat_addr_map_t__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    // The packet in error has been sent by the CE, so its port set is determined by the packet's source port, which is
+    //  the one _get_ipv4_side_port() returns for ICMP error messages
+    if(!_construct_map_ipv6_address_for_ipv4_side_packet(ctx, in_src_ipv4, out_src_ipv6))
+        return false;
+
+    utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_dst_ipv4, out_dst_ipv6);
+
+    return true;
+}
+
+bool xlat_addr_map_t__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    if(!utils_xlat_addr__siit__translate_6to4_prefix_for_main_packet(ctx, in_dst_ipv6, out_dst_ipv4))
+        return false;
+
+    const tundra__map_t_rule *rule = NULL;
+    uint16_t psid = 0;
+    if(!_extract_ipv4_address_from_map_ipv6_address(ctx, in_src_ipv6, out_src_ipv4, &rule, &psid))
+        return false;
+
+    // The BR must check that the packet's source port belongs to the CE's port set (RFC 7597, section 8.1); this cannot
+    //  be done for fragmented packets, as only the first fragment carries the transport-layer header
+    if(rule->psid_length > 0 && ctx->in_transport_payload_ptr != NULL) {
+        uint16_t port = 0;
+        uint16_t port_psid = 0;
+        if(!_get_ipv6_side_port(ctx, in_src_ipv6, &port) || !_get_psid_of_port(rule, port, &port_psid) || port_psid != psid)
+            return false;
+    }
+
+    return true;
+}
+
+bool xlat_addr_map_t__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    if(!utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_src_ipv6, out_src_ipv4))
+        return false;
+
+    // The port set has already been checked when the main packet's addresses were translated
+    const tundra__map_t_rule *rule = NULL;
+    uint16_t psid = 0;
+    return _extract_ipv4_address_from_map_ipv6_address(ctx, in_dst_ipv6, out_dst_ipv4, &rule, &psid);
+}
+
+// Packets from one CE to another one are hairpinned by the BR (RFC 7597, section 8.3)
+bool xlat_addr_map_t__is_hairpin_destination(const tundra__thread_ctx *const ctx, const uint8_t *ipv4) {
+    uint32_t rule_index = 0;
+    return utils_lpm__lookup(ctx->map_t_state->ipv4_rule_table, ipv4, &rule_index);
+}
+
+/*
+ * The rules file contains one rule per line, in the following format (the PSID offset is optional and defaults to 6):
+ *   <rule IPv6 prefix>/<length> <rule IPv4 prefix>/<length> <EA-bits length> [<PSID offset>]
+ * Empty lines are ignored, and '#' starts a comment which extends to the end of the line.
+ */
+static bool _load_rules(tundra__map_t_state *map_t_state, const char *const rules_file_path, char *error_message, const size_t error_message_size) {
+    size_t file_size = 0;
+    char *file_data = (char *) utils__read_whole_file(rules_file_path, &file_size);
+    if(file_data == NULL) {
+        snprintf(error_message, error_message_size, "Failed to read the MAP-T rules file '%s': %s", rules_file_path, strerror(errno));
+        return false;
+    }
+
+    if(strlen(file_data) != file_size) {
+        snprintf(error_message, error_message_size, "The MAP-T rules file '%s' is not a text file!", rules_file_path);
+        utils__free_memory(file_data);
+        return false;
+    }
+
+    size_t allocated_rule_count = 16;
+    map_t_state->rules = utils__alloc_zeroed_out_memory(allocated_rule_count, sizeof(tundra__map_t_rule));
+    map_t_state->rule_count = 0;
+
+    size_t line_number = 0;
+    for(char *line = file_data; line != NULL; ) {
+        line_number++;
+
+        char *next_line = strchr(line, '\n');
+        if(next_line != NULL)
+            *(next_line++) = '\0';
+
+        if(map_t_state->rule_count >= allocated_rule_count) {
+            allocated_rule_count *= 2;
+            map_t_state->rules = utils__realloc_memory(map_t_state->rules, allocated_rule_count, sizeof(tundra__map_t_rule));
+        }
+
+        bool is_empty = false;
+        if(!_parse_rule_line(map_t_state->rules + map_t_state->rule_count, line, &is_empty)) {
+            snprintf(error_message, error_message_size, "The MAP-T rules file '%s' contains an invalid rule on line %zu!", rules_file_path, line_number);
+            utils__free_memory(file_data);
+            return false;
+        }
+
+        if(!is_empty && ++map_t_state->rule_count > TUNDRA__MAX_ADDRESSING_MAP_T_RULES) {
+            snprintf(error_message, error_message_size, "The MAP-T rules file '%s' must not contain more than %zu rules!", rules_file_path, TUNDRA__MAX_ADDRESSING_MAP_T_RULES);
+            utils__free_memory(file_data);
+            return false;
+        }
+
+        line = next_line;
+    }
+
+    utils__free_memory(file_data);
+
+    if(map_t_state->rule_count == 0) {
+        snprintf(error_message, error_message_size, "The MAP-T rules file '%s' does not contain any rules!", rules_file_path);
+        return false;
+    }
+
+    // Rules with the same prefix would be ambiguous (overlapping prefixes of different lengths are fine though - the
+    //  longest matching one is used)
+    qsort(map_t_state->rules, map_t_state->rule_count, sizeof(tundra__map_t_rule), _compare_rules_by_ipv6_prefix);
+    for(size_t i = 1; i < map_t_state->rule_count; i++) {
+        if(_compare_rules_by_ipv6_prefix(map_t_state->rules + (i - 1), map_t_state->rules + i) == 0) {
+            snprintf(error_message, error_message_size, "The MAP-T rules file '%s' contains multiple rules with the same IPv6 prefix!", rules_file_path);
+            return false;
+        }
+    }
+
+    qsort(map_t_state->rules, map_t_state->rule_count, sizeof(tundra__map_t_rule), _compare_rules_by_ipv4_prefix);
+    for(size_t i = 1; i < map_t_state->rule_count; i++) {
+        if(_compare_rules_by_ipv4_prefix(map_t_state->rules + (i - 1), map_t_state->rules + i) == 0) {
+            snprintf(error_message, error_message_size, "The MAP-T rules file '%s' contains multiple rules with the same IPv4 prefix!", rules_file_path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool _parse_rule_line(tundra__map_t_rule *rule, char *line, bool *out_is_empty) {
+    char *comment_start = strchr(line, '#');
+    if(comment_start != NULL)
+        *comment_start = '\0';
+
+    char *fields[5];
+    size_t field_count = 0;
+    char *save_ptr = NULL;
+    for(char *field = strtok_r(line, " \t\r", &save_ptr); field != NULL; field = strtok_r(NULL, " \t\r", &save_ptr)) {
+        if(field_count >= 5)
+            return false;
+
+        fields[field_count++] = field;
+    }
+
+    *out_is_empty = (field_count == 0);
+    if(*out_is_empty)
+        return true;
+
+    if(field_count < 3 || field_count > 4)
+        return false;
+
+    UTILS__MEM_ZERO_OUT(rule, sizeof(tundra__map_t_rule));
+    rule->psid_offset = TUNDRA__ADDRESSING_MAP_T_DEFAULT_PSID_OFFSET;
+    if(
+        !utils_ip__parse_prefix_string(fields[0], AF_INET6, rule->ipv6_prefix, &rule->ipv6_prefix_length) ||
+        !utils_ip__parse_prefix_string(fields[1], AF_INET, rule->ipv4_prefix, &rule->ipv4_prefix_length) ||
+        !_parse_small_number(fields[2], 48, &rule->ea_bits_length) ||
+        (field_count == 4 && !_parse_small_number(fields[3], 16, &rule->psid_offset))
+    ) return false;
+
+    // The EA bits must contain the whole IPv4 address suffix (i.e. CEs cannot be delegated IPv4 prefixes, which MAP-T
+    //  does not support anyway), and must fit into the first 64 bits of the IPv6 address
+    const size_t ipv4_suffix_length = (32 - (size_t) rule->ipv4_prefix_length);
+    if(
+        rule->ipv6_prefix_length > 64 ||
+        (size_t) rule->ea_bits_length < ipv4_suffix_length ||
+        ((size_t) rule->ipv6_prefix_length + (size_t) rule->ea_bits_length) > 64
+    ) return false;
+
+    const size_t psid_length = ((size_t) rule->ea_bits_length - ipv4_suffix_length);
+    if((psid_length + (size_t) rule->psid_offset) > 16)
+        return false;
+
+    rule->psid_length = (uint8_t) psid_length;
+    if(rule->psid_length == 0)
+        rule->psid_offset = 0; // Not used
+
+    return true;
+}
+
+static bool _parse_small_number(const char *number_string, const unsigned long max_value, uint8_t *out_number) {
+    const size_t length = strlen(number_string);
+    if(length < 1 || length > 3 || strspn(number_string, "0123456789") != length)
+        return false;
+
+    const unsigned long number = strtoul(number_string, NULL, 10);
+    if(number > max_value)
+        return false;
+
+    *out_number = (uint8_t) number;
+    return true;
+}
+
+static int _compare_rules_by_ipv6_prefix(const void *rule1, const void *rule2) {
+    const tundra__map_t_rule *r1 = (const tundra__map_t_rule *) rule1;
+    const tundra__map_t_rule *r2 = (const tundra__map_t_rule *) rule2;
+
+    if(r1->ipv6_prefix_length != r2->ipv6_prefix_length)
+        return ((r1->ipv6_prefix_length < r2->ipv6_prefix_length) ? -1 : 1);
+
+    return memcmp(r1->ipv6_prefix, r2->ipv6_prefix, 16);
+}
+
+static int _compare_rules_by_ipv4_prefix(const void *rule1, const void *rule2) {
+    const tundra__map_t_rule *r1 = (const tundra__map_t_rule *) rule1;
+    const tundra__map_t_rule *r2 = (const tundra__map_t_rule *) rule2;
+
+    if(r1->ipv4_prefix_length != r2->ipv4_prefix_length)
+        return ((r1->ipv4_prefix_length < r2->ipv4_prefix_length) ? -1 : 1);
+
+    return memcmp(r1->ipv4_prefix, r2->ipv4_prefix, 4);
+}
+
+// Returns false if no rule matches the IPv4 address, or if the CE's port set cannot be determined from the packet
+static bool _construct_map_ipv6_address_for_ipv4_side_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint8_t *out_ipv6) {
+    uint32_t rule_index = 0;
+    if(!utils_lpm__lookup(ctx->map_t_state->ipv4_rule_table, in_ipv4, &rule_index))
+        return false;
+
+    const tundra__map_t_rule *rule = ctx->map_t_state->rules + rule_index;
+
+    // If the IPv4 address is shared by multiple CEs, the packet's port determines which one of them it belongs to -
+    //  fragmented packets (which do not carry a port, except for the first fragment) cannot be translated then
+    uint16_t psid = 0;
+    if(rule->psid_length > 0) {
+        uint16_t port = 0;
+        if(!_get_ipv4_side_port(ctx, in_ipv4, &port) || !_get_psid_of_port(rule, port, &psid))
+            return false;
+    }
+
+    _construct_map_ipv6_address(rule, in_ipv4, psid, out_ipv6);
+
+    return true;
+}
+
+// Returns false if no rule matches the IPv6 address, or if it is not a valid MAP IPv6 address of a CE
+static bool _extract_ipv4_address_from_map_ipv6_address(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv6, uint8_t *out_ipv4, const tundra__map_t_rule **out_rule, uint16_t *out_psid) {
+    uint32_t rule_index = 0;
+    if(!utils_lpm__lookup(ctx->map_t_state->ipv6_rule_table, in_ipv6, &rule_index))
+        return false;
+
+    const tundra__map_t_rule *rule = ctx->map_t_state->rules + rule_index;
+
+    uint64_t ipv6_upper_half = 0;
+    for(size_t i = 0; i < 8; i++)
+        ipv6_upper_half = ((ipv6_upper_half << 8) | (uint64_t) in_ipv6[i]);
+
+    const uint64_t ea_bits = (
+        (rule->ea_bits_length > 0) ?
+        ((ipv6_upper_half >> (64 - rule->ipv6_prefix_length - rule->ea_bits_length)) & _get_low_bits_mask(rule->ea_bits_length)) :
+        0
+    );
+
+    uint32_t rule_ipv4_prefix;
+    memcpy(&rule_ipv4_prefix, rule->ipv4_prefix, 4);
+    const uint32_t ipv4 = htonl(ntohl(rule_ipv4_prefix) | (uint32_t) (ea_bits >> rule->psid_length));
+    memcpy(out_ipv4, &ipv4, 4);
+
+    const uint16_t psid = (uint16_t) (ea_bits & _get_low_bits_mask(rule->psid_length));
+
+    // The rest of the address (the subnet ID and interface identifier) must be consistent with the EA bits, so that
+    //  a CE cannot use any other IPv4 address or port set than its own one (RFC 7597, section 8.1)
+    uint8_t expected_ipv6[16];
+    _construct_map_ipv6_address(rule, out_ipv4, psid, expected_ipv6);
+    if(!UTILS_IP__IPV6_ADDR_EQ(in_ipv6, expected_ipv6))
+        return false;
+
+    *out_rule = rule;
+    *out_psid = psid;
+
+    return true;
+}
+
+// Constructs the MAP IPv6 address of a CE (RFC 7597, section 6): the rule's IPv6 prefix, followed by the EA bits, a zero
+//  subnet ID and an interface identifier consisting of 16 zero bits, the IPv4 address and the PSID
+static void _construct_map_ipv6_address(const tundra__map_t_rule *const rule, const uint8_t *ipv4, const uint16_t psid, uint8_t *out_ipv6) {
+    uint32_t ipv4_int;
+    memcpy(&ipv4_int, ipv4, 4);
+
+    const size_t ipv4_suffix_length = (32 - (size_t) rule->ipv4_prefix_length);
+    const uint64_t ipv4_suffix = (((uint64_t) ntohl(ipv4_int)) & _get_low_bits_mask(ipv4_suffix_length));
+    const uint64_t ea_bits = ((ipv4_suffix << rule->psid_length) | (uint64_t) psid);
+
+    memcpy(out_ipv6, rule->ipv6_prefix, 8);
+    if(rule->ea_bits_length > 0) {
+        const uint64_t shifted_ea_bits = (ea_bits << (64 - rule->ipv6_prefix_length - rule->ea_bits_length));
+        for(size_t i = 0; i < 8; i++)
+            out_ipv6[i] |= (uint8_t) (shifted_ea_bits >> (56 - (i * 8)));
+    }
+
+    out_ipv6[8] = 0;
+    out_ipv6[9] = 0;
+    memcpy(out_ipv6 + 10, ipv4, 4);
+    out_ipv6[14] = (uint8_t) (psid >> 8);
+    out_ipv6[15] = (uint8_t) psid;
+}
+
+// Returns false if the port is excluded from all port sets, i.e. if its first 'a' bits are zero (RFC 7597, section 5.1)
+static bool _get_psid_of_port(const tundra__map_t_rule *const rule, const uint16_t port, uint16_t *out_psid) {
+    const uint32_t port_int = (uint32_t) port;
+    if(rule->psid_offset > 0 && (port_int >> (16 - rule->psid_offset)) == 0)
+        return false;
+
+    *out_psid = (uint16_t) ((port_int >> (16 - rule->psid_offset - rule->psid_length)) & (uint32_t) _get_low_bits_mask(rule->psid_length));
+
+    return true;
+}
+
+/*
+ * Returns the port (in host byte order) of the CE an IPv4-side packet is being sent to - the destination TCP/UDP port or
+ * the ICMP Echo identifier; in the case of ICMP error messages, it is the source port of the packet in error (which
+ * has been sent by the CE). Returns false if the packet is fragmented or if it does not carry any port.
+ */
+static bool _get_ipv4_side_port(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint16_t *out_port) {
+    const uint8_t *payload_ptr = ctx->in_transport_payload_ptr;
+    const size_t payload_size = ctx->in_transport_payload_size;
+    if(payload_ptr == NULL)
+        return false;
+
+    uint16_t port;
+    switch(ctx->in_transport_protocol) {
+        case 6: // TCP
+        case 17: // UDP
+            if(payload_size < 8)
+                return false;
+            memcpy(&port, payload_ptr + 2, 2); // Destination port
+            break;
+
+        case 1: // ICMPv4
+            if(payload_size < 8)
+                return false;
+
+            if(payload_ptr[0] == 0 || payload_ptr[0] == 8) { // Echo Reply, Echo Request
+                memcpy(&port, payload_ptr + 4, 2); // Identifier
+                break;
+            }
+
+            if(payload_ptr[0] == 3 || payload_ptr[0] == 11 || payload_ptr[0] == 12) { // Destination Unreachable, Time Exceeded, Parameter Problem
+                const uint8_t *packet_in_error_ptr = (payload_ptr + 8);
+                if(payload_size < (8 + 20) || (packet_in_error_ptr[0] >> 4) != 4)
+                    return false;
+
+                const size_t packet_in_error_header_size = (((size_t) (packet_in_error_ptr[0] & 0x0f)) * 4);
+                if(packet_in_error_header_size < 20 || payload_size < (8 + packet_in_error_header_size + 8))
+                    return false;
+
+                // The packet in error must not be a non-first fragment (the fragment offset is in the lower 13 bits)
+                if(((packet_in_error_ptr[6] & 0x1f) | packet_in_error_ptr[7]) != 0)
+                    return false;
+
+                // The packet in error was sent from the CE's address
+                if(!UTILS_IP__IPV4_ADDR_EQ(packet_in_error_ptr + 12, in_ipv4))
+                    return false;
+
+                const uint8_t *packet_in_error_payload_ptr = (packet_in_error_ptr + packet_in_error_header_size);
+                if(packet_in_error_ptr[9] == 6 || packet_in_error_ptr[9] == 17) { // TCP, UDP
+                    memcpy(&port, packet_in_error_payload_ptr, 2); // Source port
+                } else if(packet_in_error_ptr[9] == 1 && (packet_in_error_payload_ptr[0] == 0 || packet_in_error_payload_ptr[0] == 8)) { // ICMPv4 Echo Reply, Echo Request
+                    memcpy(&port, packet_in_error_payload_ptr + 4, 2); // Identifier
+                } else {
+                    return false;
+                }
+                break;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+
+    *out_port = ntohs(port);
+    return true;
+}
+
+/*
+ * Returns the port (in host byte order) of the CE an IPv6-side packet has been sent from - the source TCP/UDP port or
+ * the ICMPv6 Echo identifier; in the case of ICMPv6 error messages, it is the destination port of the packet in error
+ * (which has been sent to the CE). The packet in error must carry the transport-layer header right after its IPv6
+ * header, i.e. it must not have any extension headers. Returns false if the packet does not carry any port.
+ */
+static bool _get_ipv6_side_port(const tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, uint16_t *out_port) {
+    const uint8_t *payload_ptr = ctx->in_transport_payload_ptr;
+    const size_t payload_size = ctx->in_transport_payload_size;
+    if(payload_ptr == NULL)
+        return false;
+
+    uint16_t port;
+    switch(ctx->in_transport_protocol) {
+        case 6: // TCP
+        case 17: // UDP
+            if(payload_size < 8)
+                return false;
+            memcpy(&port, payload_ptr, 2); // Source port
+            break;
+
+        case 1: // ICMPv6
+            if(payload_size < 8)
+                return false;
+
+            if(payload_ptr[0] == 128 || payload_ptr[0] == 129) { // Echo Request, Echo Reply
+                memcpy(&port, payload_ptr + 4, 2); // Identifier
+                break;
+            }
+
+            if(payload_ptr[0] >= 1 && payload_ptr[0] <= 4) { // Destination Unreachable, Packet Too Big, Time Exceeded, Parameter Problem
+                const uint8_t *packet_in_error_ptr = (payload_ptr + 8);
+                if(payload_size < (8 + 40 + 8) || (packet_in_error_ptr[0] >> 4) != 6)
+                    return false;
+
+                // The packet in error was sent to the CE's address
+                if(!UTILS_IP__IPV6_ADDR_EQ(packet_in_error_ptr + 24, in_src_ipv6))
+                    return false;
+
+                const uint8_t *packet_in_error_payload_ptr = (packet_in_error_ptr + 40);
+                if(packet_in_error_ptr[6] == 6 || packet_in_error_ptr[6] == 17) { // TCP, UDP
+                    memcpy(&port, packet_in_error_payload_ptr + 2, 2); // Destination port
+                } else if(packet_in_error_ptr[6] == 58 && (packet_in_error_payload_ptr[0] == 128 || packet_in_error_payload_ptr[0] == 129)) { // ICMPv6 Echo Request, Echo Reply
+                    memcpy(&port, packet_in_error_payload_ptr + 4, 2); // Identifier
+                } else {
+                    return false;
+                }
+                break;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+
+    *out_port = ntohs(port);
+    return true;
+}
+
+static inline uint64_t _get_low_bits_mask(const size_t bit_count) {
+    return ((bit_count >= 64) ? UINT64_MAX : ((((uint64_t) 1) << bit_count) - 1));
+}
+
+
+#undef _ERROR_MESSAGE_SIZE
+#undef _LPM_TABLE_FIRST_STRIDE_BITS
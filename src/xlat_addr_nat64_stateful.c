@@ -0,0 +1,593 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_nat64_stateful.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"log.h"
+#include"utils_xlat_addr.h"
+#include"xlat_addr_external_timer_wheel.h"
+
+
+#define _SHARD_INDEX_MASK ((uint32_t) (TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS - 1))
+#define _MAX_EVICTIONS_PER_PACKET ((size_t) 8)
+
+#define _TCP_FLAG_FIN ((uint8_t) 0x01)
+#define _TCP_FLAG_SYN ((uint8_t) 0x02)
+#define _TCP_FLAG_RST ((uint8_t) 0x04)
+
+
+// The transport-layer information a session is looked up (and possibly created) by
+typedef struct _packet_transport_info {
+    const uint8_t *ip; // The IPv6 host's address (IPv6 side), or the pool address (IPv4 side)
+    uint16_t port; // In network byte order; the TCP/UDP port or ICMP Echo identifier of the IPv6 host (IPv6 side) or of the pool (IPv4 side)
+    uint8_t protocol; // 1 (ICMP), 6 (TCP) or 17 (UDP)
+    uint8_t tcp_flags; // 0 if the packet is not a TCP one
+    bool is_icmp_error; // The information has been gathered from the packet in error; such packets neither create nor refresh sessions
+} _packet_transport_info;
+
+
+static bool _get_ipv6_side_packet_transport_info(const tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, _packet_transport_info *const out_info);
+static bool _get_ipv4_side_packet_transport_info(const tundra__thread_ctx *const ctx, const uint8_t *in_dst_ipv4, _packet_transport_info *const out_info);
+static uint32_t _find_session_by_ipv6_side(const tundra__nat64_stateful_shard *const shard, const _packet_transport_info *const info, const uint32_t hash);
+static uint32_t _find_session_by_ipv4_side(const tundra__nat64_stateful_shard *const shard, const uint8_t protocol, const uint8_t *ipv4, const uint16_t port);
+static uint32_t _create_session(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard, const uint32_t shard_index, const _packet_transport_info *const info, const uint32_t hash);
+static bool _allocate_pool_port(const tundra__nat64_stateful_shard *const shard, const uint32_t shard_index, const uint8_t protocol, const uint8_t *ipv4, const uint32_t hash, uint16_t *out_port);
+static void _link_session(tundra__nat64_stateful_shard *const shard, const uint32_t session_index);
+static void _delete_session(tundra__nat64_stateful_shard *const shard, const uint32_t session_index);
+static void _refresh_session(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard, const uint32_t session_index, const uint8_t tcp_flags, const bool is_from_ipv4_side);
+static void _evict_expired_sessions(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard);
+static uint32_t _discard_session_if_expired(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard, const uint32_t session_index);
+static bool _is_ipv4_in_pool(const tundra__thread_ctx *const ctx, const uint8_t *ipv4);
+static uint32_t _hash_transport_address(const uint8_t protocol, const uint8_t *ip, const size_t ip_size, const uint16_t port);
+static inline uint32_t _get_ipv6_side_bucket_index(const tundra__nat64_stateful_shard *const shard, const uint32_t hash);
+
+
+tundra__nat64_stateful_state *xlat_addr_nat64_stateful__create_state(const tundra__conf_file *const file_config) {
+    tundra__nat64_stateful_state *nat64_stateful_state = utils__alloc_aligned_zeroed_out_memory(1, sizeof(tundra__nat64_stateful_state), 64);
+
+    const size_t session_count = UTILS__MAXIMUM_UNSAFE(1, (file_config->addressing_nat64_stateful_max_sessions + TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS - 1) / TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS);
+    size_t bucket_count = 1;
+    while(bucket_count < session_count)
+        bucket_count *= 2;
+
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS; i++) {
+        tundra__nat64_stateful_shard *shard = nat64_stateful_state->shards + i;
+
+        if(pthread_mutex_init(&shard->mutex, NULL) != 0)
+            exit(TUNDRA__EXIT_MUTEX_FAILURE);
+
+        // The sessions and buckets are used (i.e. the tables' memory is touched) only as they are needed - the first
+        //  session is never used, so that the zeroed-out buckets are empty (see XLAT_ADDR_NAT64_STATEFUL__NO_SESSION)
+        shard->session_count = (session_count + 1);
+        shard->sessions = utils__alloc_huge_page_backed_zeroed_out_memory(shard->session_count, sizeof(tundra__nat64_stateful_session));
+        shard->ipv6_side_buckets = utils__alloc_huge_page_backed_zeroed_out_memory(bucket_count, sizeof(uint32_t));
+        shard->ipv4_side_buckets = utils__alloc_huge_page_backed_zeroed_out_memory(bucket_count, sizeof(uint32_t));
+        shard->timer_wheel = xlat_addr_external_timer_wheel__create(shard->session_count, utils__get_coarse_monotonic_timestamp());
+        shard->bucket_count = bucket_count;
+        shard->free_session_index = XLAT_ADDR_NAT64_STATEFUL__NO_SESSION;
+        shard->unused_session_index = 1;
+    }
+
+    return nat64_stateful_state;
+}
+
+void xlat_addr_nat64_stateful__free_state(tundra__nat64_stateful_state *nat64_stateful_state) {
+    for(size_t i = 0; i < TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS; i++) {
+        tundra__nat64_stateful_shard *shard = nat64_stateful_state->shards + i;
+
+        pthread_mutex_destroy(&shard->mutex);
+
+        utils__free_huge_page_backed_memory(shard->sessions, shard->session_count, sizeof(tundra__nat64_stateful_session));
+        utils__free_huge_page_backed_memory(shard->ipv6_side_buckets, shard->bucket_count, sizeof(uint32_t));
+        utils__free_huge_page_backed_memory(shard->ipv4_side_buckets, shard->bucket_count, sizeof(uint32_t));
+        xlat_addr_external_timer_wheel__free(shard->timer_wheel);
+    }
+
+    utils__free_memory(nat64_stateful_state);
+}
+
+bool xlat_addr_nat64_stateful__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    if(!_is_ipv4_in_pool(ctx, in_dst_ipv4))
+        return false;
+
+    // A hairpinned packet comes from another IPv6 host's binding, whose pool address is then embedded into the prefix
+    //  (RFC 6146, section 3.8); no other packets may come from the pool
+    if(_is_ipv4_in_pool(ctx, in_src_ipv4)) {
+        if(!ctx->is_in_packet_hairpinned)
+            return false;
+
+        utils_ip__embed_ipv4_into_rfc6052_prefix(ctx->config->addressing_nat64_clat_siit_prefix, ctx->config->addressing_nat64_clat_siit_prefix_length, in_src_ipv4, out_src_ipv6);
+    } else if(!utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(ctx, in_src_ipv4, out_src_ipv6)) {
+        return false;
+    }
+
+    _packet_transport_info info;
+    if(!_get_ipv4_side_packet_transport_info(ctx, in_dst_ipv4, &info))
+        return false;
+
+    // The pool port determines the shard (see tundra__nat64_stateful_shard)
+    const uint32_t shard_index = (((uint32_t) ntohs(info.port)) & _SHARD_INDEX_MASK);
+    tundra__nat64_stateful_shard *shard = ctx->nat64_stateful_state->shards + shard_index;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    _evict_expired_sessions(ctx, shard);
+
+    // Since the mappings are endpoint-independent, so is the filtering - any IPv4 host may reach a mapped IPv6 host
+    //  through its binding (RFC 4787, section 5)
+    const uint32_t session_index = _discard_session_if_expired(ctx, shard, _find_session_by_ipv4_side(shard, info.protocol, info.ip, info.port));
+    if(session_index == XLAT_ADDR_NAT64_STATEFUL__NO_SESSION) {
+        pthread_mutex_unlock(&shard->mutex);
+        return false;
+    }
+
+    if(!info.is_icmp_error)
+        _refresh_session(ctx, shard, session_index, info.tcp_flags, true);
+
+    ctx->nat64_stateful_binding = shard->sessions[session_index].binding;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    memcpy(out_dst_ipv6, ctx->nat64_stateful_binding.ipv6, 16);
+    ctx->out_transport_port = ctx->nat64_stateful_binding.ipv6_port;
+    ctx->is_out_transport_port_set = true;
+
+    return true;
+}
+
+bool xlat_addr_nat64_stateful__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    // The binding has been looked up by the packet in error when the main packet's addresses were translated
+    if(!ctx->is_out_transport_port_set || !UTILS_IP__IPV4_ADDR_EQ(in_src_ipv4, ctx->nat64_stateful_binding.ipv4))
+        return false;
+
+    memcpy(out_src_ipv6, ctx->nat64_stateful_binding.ipv6, 16);
+    utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_dst_ipv4, out_dst_ipv6);
+
+    return true;
+}
+
+bool xlat_addr_nat64_stateful__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    if(!utils_xlat_addr__siit__translate_6to4_prefix_for_main_packet(ctx, in_dst_ipv6, out_dst_ipv4))
+        return false;
+
+    // Packets destined to the pool can only be translated if they are hairpinned
+    if(ctx->hairpin_packet == NULL && _is_ipv4_in_pool(ctx, out_dst_ipv4))
+        return false;
+
+    _packet_transport_info info;
+    if(!_get_ipv6_side_packet_transport_info(ctx, in_src_ipv6, &info))
+        return false;
+
+    // The hash of the IPv6 host's transport address determines the shard (see tundra__nat64_stateful_shard)
+    const uint32_t hash = _hash_transport_address(info.protocol, info.ip, 16, info.port);
+    const uint32_t shard_index = (hash & _SHARD_INDEX_MASK);
+    tundra__nat64_stateful_shard *shard = ctx->nat64_stateful_state->shards + shard_index;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    _evict_expired_sessions(ctx, shard);
+
+    uint32_t session_index = _discard_session_if_expired(ctx, shard, _find_session_by_ipv6_side(shard, &info, hash));
+    if(session_index == XLAT_ADDR_NAT64_STATEFUL__NO_SESSION) {
+        // Only packets which may start a "connection" create sessions: TCP SYNs, UDP datagrams and ICMP Echo Requests
+        if(info.is_icmp_error || (info.protocol == 6 && (info.tcp_flags & (_TCP_FLAG_SYN | _TCP_FLAG_RST)) != _TCP_FLAG_SYN))
+            session_index = XLAT_ADDR_NAT64_STATEFUL__NO_SESSION;
+        else
+            session_index = _create_session(ctx, shard, shard_index, &info, hash);
+
+        if(session_index == XLAT_ADDR_NAT64_STATEFUL__NO_SESSION) {
+            pthread_mutex_unlock(&shard->mutex);
+            return false;
+        }
+    } else if(!info.is_icmp_error) {
+        _refresh_session(ctx, shard, session_index, info.tcp_flags, false);
+    }
+
+    ctx->nat64_stateful_binding = shard->sessions[session_index].binding;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    memcpy(out_src_ipv4, ctx->nat64_stateful_binding.ipv4, 4);
+    ctx->out_transport_port = ctx->nat64_stateful_binding.ipv4_port;
+    ctx->is_out_transport_port_set = true;
+
+    return true;
+}
+
+bool xlat_addr_nat64_stateful__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    // The binding has been looked up by the packet in error when the main packet's addresses were translated
+    if(!ctx->is_out_transport_port_set || !UTILS_IP__IPV6_ADDR_EQ(in_dst_ipv6, ctx->nat64_stateful_binding.ipv6))
+        return false;
+
+    if(!utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_src_ipv6, out_src_ipv4))
+        return false;
+
+    memcpy(out_dst_ipv4, ctx->nat64_stateful_binding.ipv4, 4);
+
+    return true;
+}
+
+bool xlat_addr_nat64_stateful__is_hairpin_destination(const tundra__thread_ctx *const ctx, const uint8_t *ipv4) {
+    return _is_ipv4_in_pool(ctx, ipv4);
+}
+
+/*
+ * Fragmented packets cannot be translated, as only the first fragment carries the transport-layer header (RFC 6146
+ * requires them to be reassembled, which Tundra does not do). The packet in error of an ICMPv6 error message must
+ * carry the TCP/UDP header right after its IPv6 header, i.e. it must not have any extension headers.
+ */
+static bool _get_ipv6_side_packet_transport_info(const tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, _packet_transport_info *const out_info) {
+    const uint8_t *payload_ptr = ctx->in_transport_payload_ptr;
+    const size_t payload_size = ctx->in_transport_payload_size;
+    if(payload_ptr == NULL)
+        return false;
+
+    out_info->ip = in_src_ipv6;
+    out_info->protocol = ctx->in_transport_protocol;
+    out_info->tcp_flags = 0;
+    out_info->is_icmp_error = false;
+
+    switch(ctx->in_transport_protocol) {
+        case 6: // TCP
+            if(payload_size < 20)
+                return false;
+            memcpy(&out_info->port, payload_ptr, 2); // Source port
+            out_info->tcp_flags = payload_ptr[13];
+            return true;
+
+        case 17: // UDP
+            if(payload_size < 8)
+                return false;
+            memcpy(&out_info->port, payload_ptr, 2); // Source port
+            return true;
+
+        case 1: // ICMPv6
+            if(payload_size < 8)
+                return false;
+
+            if(payload_ptr[0] == 128) { // Echo Request
+                memcpy(&out_info->port, payload_ptr + 4, 2); // Identifier
+                return true;
+            }
+
+            if(payload_ptr[0] >= 1 && payload_ptr[0] <= 4) { // Destination Unreachable, Packet Too Big, Time Exceeded, Parameter Problem
+                const uint8_t *packet_in_error_ptr = (payload_ptr + 8);
+                if(payload_size < (8 + 40 + 4) || (packet_in_error_ptr[0] >> 4) != 6)
+                    return false;
+
+                // The packet in error was sent to the IPv6 host - its destination is the host's transport address
+                if(packet_in_error_ptr[6] != 6 && packet_in_error_ptr[6] != 17)
+                    return false;
+                out_info->ip = (packet_in_error_ptr + 24);
+                out_info->protocol = packet_in_error_ptr[6];
+                memcpy(&out_info->port, packet_in_error_ptr + 40 + 2, 2); // Destination port
+                out_info->is_icmp_error = true;
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+static bool _get_ipv4_side_packet_transport_info(const tundra__thread_ctx *const ctx, const uint8_t *in_dst_ipv4, _packet_transport_info *const out_info) {
+    const uint8_t *payload_ptr = ctx->in_transport_payload_ptr;
+    const size_t payload_size = ctx->in_transport_payload_size;
+    if(payload_ptr == NULL)
+        return false;
+
+    out_info->ip = in_dst_ipv4;
+    out_info->protocol = ctx->in_transport_protocol;
+    out_info->tcp_flags = 0;
+    out_info->is_icmp_error = false;
+
+    switch(ctx->in_transport_protocol) {
+        case 6: // TCP
+            if(payload_size < 20)
+                return false;
+            memcpy(&out_info->port, payload_ptr + 2, 2); // Destination port
+            out_info->tcp_flags = payload_ptr[13];
+            return true;
+
+        case 17: // UDP
+            if(payload_size < 8)
+                return false;
+            memcpy(&out_info->port, payload_ptr + 2, 2); // Destination port
+            return true;
+
+        case 1: // ICMPv4
+            if(payload_size < 8)
+                return false;
+
+            if(payload_ptr[0] == 0) { // Echo Reply
+                memcpy(&out_info->port, payload_ptr + 4, 2); // Identifier
+                return true;
+            }
+
+            if(payload_ptr[0] == 3 || payload_ptr[0] == 11 || payload_ptr[0] == 12) { // Destination Unreachable, Time Exceeded, Parameter Problem
+                const uint8_t *packet_in_error_ptr = (payload_ptr + 8);
+                if(payload_size < (8 + 20) || (packet_in_error_ptr[0] >> 4) != 4)
+                    return false;
+
+                const size_t packet_in_error_header_size = (((size_t) (packet_in_error_ptr[0] & 0x0f)) * 4);
+                if(packet_in_error_header_size < 20 || payload_size < (8 + packet_in_error_header_size + 8))
+                    return false;
+
+                // The packet in error must not be a non-first fragment (the fragment offset is in the lower 13 bits)
+                if(((packet_in_error_ptr[6] & 0x1f) | packet_in_error_ptr[7]) != 0)
+                    return false;
+
+                // The packet in error was sent from the pool address the ICMP message has been sent to
+                if(!UTILS_IP__IPV4_ADDR_EQ(packet_in_error_ptr + 12, in_dst_ipv4))
+                    return false;
+
+                const uint8_t *packet_in_error_payload_ptr = (packet_in_error_ptr + packet_in_error_header_size);
+                if(packet_in_error_ptr[9] == 6 || packet_in_error_ptr[9] == 17) { // TCP, UDP
+                    memcpy(&out_info->port, packet_in_error_payload_ptr, 2); // Source port
+                } else if(packet_in_error_ptr[9] == 1 && packet_in_error_payload_ptr[0] == 8) { // ICMPv4 Echo Request
+                    memcpy(&out_info->port, packet_in_error_payload_ptr + 4, 2); // Identifier
+                } else {
+                    return false;
+                }
+                out_info->protocol = packet_in_error_ptr[9];
+                out_info->is_icmp_error = true;
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+static uint32_t _find_session_by_ipv6_side(const tundra__nat64_stateful_shard *const shard, const _packet_transport_info *const info, const uint32_t hash) {
+    uint32_t session_index = shard->ipv6_side_buckets[_get_ipv6_side_bucket_index(shard, hash)];
+
+    while(session_index != XLAT_ADDR_NAT64_STATEFUL__NO_SESSION) {
+        const tundra__nat64_stateful_binding *binding = &shard->sessions[session_index].binding;
+        if(binding->ipv6_port == info->port && binding->protocol == info->protocol && UTILS_IP__IPV6_ADDR_EQ(binding->ipv6, info->ip))
+            return session_index;
+
+        session_index = shard->sessions[session_index].next_ipv6_side_index;
+    }
+
+    return XLAT_ADDR_NAT64_STATEFUL__NO_SESSION;
+}
+
+static uint32_t _find_session_by_ipv4_side(const tundra__nat64_stateful_shard *const shard, const uint8_t protocol, const uint8_t *ipv4, const uint16_t port) {
+    const uint32_t hash = _hash_transport_address(protocol, ipv4, 4, port);
+    uint32_t session_index = shard->ipv4_side_buckets[hash & (shard->bucket_count - 1)];
+
+    while(session_index != XLAT_ADDR_NAT64_STATEFUL__NO_SESSION) {
+        const tundra__nat64_stateful_binding *binding = &shard->sessions[session_index].binding;
+        if(binding->ipv4_port == port && binding->protocol == protocol && UTILS_IP__IPV4_ADDR_EQ(binding->ipv4, ipv4))
+            return session_index;
+
+        session_index = shard->sessions[session_index].next_ipv4_side_index;
+    }
+
+    return XLAT_ADDR_NAT64_STATEFUL__NO_SESSION;
+}
+
+static uint32_t _create_session(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard, const uint32_t shard_index, const _packet_transport_info *const info, const uint32_t hash) {
+    // All the sessions of an IPv6 host use the same pool address ("paired" pooling, see RFC 6146, section 3.5.1.1)
+    const uint32_t ipv6_host_hash = _hash_transport_address(0, info->ip, 16, 0);
+    uint32_t pool_ipv4;
+    memcpy(&pool_ipv4, ctx->config->addressing_nat64_stateful_pool_ipv4, 4);
+    pool_ipv4 = htonl(ntohl(pool_ipv4) + (ipv6_host_hash % ctx->config->addressing_nat64_stateful_pool_size));
+
+    uint16_t pool_port;
+    if(!_allocate_pool_port(shard, shard_index, info->protocol, (const uint8_t *) &pool_ipv4, hash, &pool_port))
+        return XLAT_ADDR_NAT64_STATEFUL__NO_SESSION;
+
+    uint32_t session_index = shard->free_session_index;
+    if(session_index != XLAT_ADDR_NAT64_STATEFUL__NO_SESSION)
+        shard->free_session_index = shard->sessions[session_index].next_ipv6_side_index;
+    else if(shard->unused_session_index < shard->session_count)
+        session_index = (uint32_t) shard->unused_session_index++;
+    else
+        return XLAT_ADDR_NAT64_STATEFUL__NO_SESSION; // The shard is full
+
+    tundra__nat64_stateful_session *session = shard->sessions + session_index;
+    memcpy(session->binding.ipv6, info->ip, 16);
+    memcpy(session->binding.ipv4, &pool_ipv4, 4);
+    session->binding.ipv6_port = info->port;
+    session->binding.ipv4_port = pool_port;
+    session->binding.protocol = info->protocol;
+    session->expiration_timestamp = ctx->current_timestamp;
+    session->tcp_state = XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_OPENING;
+    session->is_in_use = true;
+
+    _link_session(shard, session_index);
+    _refresh_session(ctx, shard, session_index, info->tcp_flags, false);
+
+    return session_index;
+}
+
+// The shard's ports are tried one by one, starting at a position derived from the IPv6 host's transport address
+static bool _allocate_pool_port(const tundra__nat64_stateful_shard *const shard, const uint32_t shard_index, const uint8_t protocol, const uint8_t *ipv4, const uint32_t hash, uint16_t *out_port) {
+    const uint32_t shard_count = (uint32_t) TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS;
+    const uint32_t first_multiple = ((TUNDRA__ADDRESSING_NAT64_STATEFUL_MIN_POOL_PORT + shard_count - 1 - shard_index) / shard_count);
+    const uint32_t port_count = ((((uint32_t) UINT16_MAX - shard_index) / shard_count) - first_multiple + 1);
+    const uint32_t start_offset = ((hash / shard_count) % port_count);
+
+    for(uint32_t i = 0; i < port_count; i++) {
+        const uint32_t port_host_order = (((first_multiple + ((start_offset + i) % port_count)) * shard_count) + shard_index);
+        const uint16_t port = htons((uint16_t) port_host_order);
+
+        if(_find_session_by_ipv4_side(shard, protocol, ipv4, port) == XLAT_ADDR_NAT64_STATEFUL__NO_SESSION) {
+            *out_port = port;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void _link_session(tundra__nat64_stateful_shard *const shard, const uint32_t session_index) {
+    tundra__nat64_stateful_session *session = shard->sessions + session_index;
+
+    const uint32_t ipv6_side_hash = _hash_transport_address(session->binding.protocol, session->binding.ipv6, 16, session->binding.ipv6_port);
+    uint32_t *ipv6_side_bucket = shard->ipv6_side_buckets + _get_ipv6_side_bucket_index(shard, ipv6_side_hash);
+    session->next_ipv6_side_index = *ipv6_side_bucket;
+    *ipv6_side_bucket = session_index;
+
+    const uint32_t ipv4_side_hash = _hash_transport_address(session->binding.protocol, session->binding.ipv4, 4, session->binding.ipv4_port);
+    uint32_t *ipv4_side_bucket = shard->ipv4_side_buckets + (ipv4_side_hash & (shard->bucket_count - 1));
+    session->next_ipv4_side_index = *ipv4_side_bucket;
+    *ipv4_side_bucket = session_index;
+}
+
+static void _delete_session(tundra__nat64_stateful_shard *const shard, const uint32_t session_index) {
+    tundra__nat64_stateful_session *session = shard->sessions + session_index;
+
+    const uint32_t ipv6_side_hash = _hash_transport_address(session->binding.protocol, session->binding.ipv6, 16, session->binding.ipv6_port);
+    uint32_t *ipv6_side_link = shard->ipv6_side_buckets + _get_ipv6_side_bucket_index(shard, ipv6_side_hash);
+    while(*ipv6_side_link != session_index)
+        ipv6_side_link = &shard->sessions[*ipv6_side_link].next_ipv6_side_index;
+    *ipv6_side_link = session->next_ipv6_side_index;
+
+    const uint32_t ipv4_side_hash = _hash_transport_address(session->binding.protocol, session->binding.ipv4, 4, session->binding.ipv4_port);
+    uint32_t *ipv4_side_link = shard->ipv4_side_buckets + (ipv4_side_hash & (shard->bucket_count - 1));
+    while(*ipv4_side_link != session_index)
+        ipv4_side_link = &shard->sessions[*ipv4_side_link].next_ipv4_side_index;
+    *ipv4_side_link = session->next_ipv4_side_index;
+
+    xlat_addr_external_timer_wheel__unschedule(shard->timer_wheel, session_index);
+
+    session->is_in_use = false;
+    session->next_ipv6_side_index = shard->free_session_index;
+    shard->free_session_index = session_index;
+}
+
+/*
+ * The TCP state machine is a simplified version of the one in RFC 6146, section 3.5.2: a session is established once a
+ * packet from the IPv4 side (e.g. SYN+ACK) follows the IPv6 host's SYN, and it becomes transitory again once a FIN or
+ * RST is seen in either direction (until the IPv6 host sends a SYN again).
+ */
+static void _refresh_session(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard, const uint32_t session_index, const uint8_t tcp_flags, const bool is_from_ipv4_side) {
+    tundra__nat64_stateful_session *session = shard->sessions + session_index;
+
+    time_t timeout;
+    switch(session->binding.protocol) {
+        case 6: // TCP
+            if(tcp_flags & (_TCP_FLAG_FIN | _TCP_FLAG_RST))
+                session->tcp_state = XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_CLOSING;
+            else if(session->tcp_state == XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_OPENING && is_from_ipv4_side)
+                session->tcp_state = XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_ESTABLISHED;
+            else if(session->tcp_state == XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_CLOSING && !is_from_ipv4_side && (tcp_flags & _TCP_FLAG_SYN))
+                session->tcp_state = XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_OPENING;
+
+            timeout = (
+                (session->tcp_state == XLAT_ADDR_NAT64_STATEFUL__TCP_STATE_ESTABLISHED) ?
+                ctx->config->addressing_nat64_stateful_tcp_established_timeout :
+                ctx->config->addressing_nat64_stateful_tcp_transitory_timeout
+            );
+            break;
+
+        case 17: // UDP
+            timeout = ctx->config->addressing_nat64_stateful_udp_timeout;
+            break;
+
+        case 1: // ICMP
+            timeout = ctx->config->addressing_nat64_stateful_icmp_timeout;
+            break;
+
+        default:
+            log__thread_crash_invalid_internal_state(ctx->thread_id, "Invalid stateful NAT64 session protocol");
+    }
+
+    // Extending the lifetime does not require the session to be rescheduled, as the expiration timestamp is checked
+    //  again once the session's eviction is due (see _evict_expired_sessions()); shortening it, however, does
+    const time_t new_expiration_timestamp = (ctx->current_timestamp + timeout);
+    const time_t old_expiration_timestamp = session->expiration_timestamp;
+    session->expiration_timestamp = new_expiration_timestamp;
+
+    if(new_expiration_timestamp < old_expiration_timestamp || old_expiration_timestamp <= ctx->current_timestamp)
+        xlat_addr_external_timer_wheel__schedule(shard->timer_wheel, session_index, new_expiration_timestamp);
+}
+
+// At most _MAX_EVICTIONS_PER_PACKET due sessions are processed per packet, so that the translation of a single packet
+//  never stalls for long; the rest are processed while the following packets are being translated
+static void _evict_expired_sessions(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard) {
+    size_t session_index;
+
+    for(size_t i = 0; i < _MAX_EVICTIONS_PER_PACKET && xlat_addr_external_timer_wheel__pop_due_entry(shard->timer_wheel, ctx->current_timestamp, &session_index); i++) {
+        tundra__nat64_stateful_session *session = shard->sessions + session_index;
+        if(!session->is_in_use)
+            continue;
+
+        if(session->expiration_timestamp > ctx->current_timestamp)
+            xlat_addr_external_timer_wheel__schedule(shard->timer_wheel, session_index, session->expiration_timestamp);
+        else
+            _delete_session(shard, (uint32_t) session_index);
+    }
+}
+
+// Expired sessions whose eviction has not been processed yet (see above) must not be used
+static uint32_t _discard_session_if_expired(const tundra__thread_ctx *const ctx, tundra__nat64_stateful_shard *const shard, const uint32_t session_index) {
+    if(session_index == XLAT_ADDR_NAT64_STATEFUL__NO_SESSION || shard->sessions[session_index].expiration_timestamp > ctx->current_timestamp)
+        return session_index;
+
+    _delete_session(shard, session_index);
+    return XLAT_ADDR_NAT64_STATEFUL__NO_SESSION;
+}
+
+static bool _is_ipv4_in_pool(const tundra__thread_ctx *const ctx, const uint8_t *ipv4) {
+    uint32_t ipv4_host_order, pool_ipv4_host_order;
+    memcpy(&ipv4_host_order, ipv4, 4);
+    memcpy(&pool_ipv4_host_order, ctx->config->addressing_nat64_stateful_pool_ipv4, 4);
+
+    // If the address precedes the pool, the subtraction wraps around to a number greater than the pool size
+    return (bool) ((ntohl(ipv4_host_order) - ntohl(pool_ipv4_host_order)) < ctx->config->addressing_nat64_stateful_pool_size);
+}
+
+static uint32_t _hash_transport_address(const uint8_t protocol, const uint8_t *ip, const size_t ip_size, const uint16_t port) {
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261;
+
+    hash = (hash ^ protocol) * 16777619;
+    for(size_t i = 0; i < ip_size; i++)
+        hash = (hash ^ ip[i]) * 16777619;
+    hash = (hash ^ (uint32_t) (port & 0xff)) * 16777619;
+    hash = (hash ^ (uint32_t) (port >> 8)) * 16777619;
+
+    return hash;
+}
+
+// The lowest bits of the hash have already been used to select the shard
+static inline uint32_t _get_ipv6_side_bucket_index(const tundra__nat64_stateful_shard *const shard, const uint32_t hash) {
+    return ((hash / (uint32_t) TUNDRA__ADDRESSING_NAT64_STATEFUL_SHARDS) & (uint32_t) (shard->bucket_count - 1));
+}
+
+
+#undef _SHARD_INDEX_MASK
+#undef _MAX_EVICTIONS_PER_PACKET
+
+#undef _TCP_FLAG_FIN
+#undef _TCP_FLAG_SYN
+#undef _TCP_FLAG_RST
@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_plugin.h"
+
+#include"utils.h"
+#include"log.h"
+
+
+static const char *_get_dl_error_string(void);
+
+
+// This function must be called before the program's privileges are dropped, so that the plugin is able to access
+//  files which are not accessible by the unprivileged user during its initialization.
+tundra__addr_xlat_plugin *xlat_addr_plugin__load(const tundra__conf_file *const file_config) {
+    tundra__addr_xlat_plugin *addr_xlat_plugin = utils__alloc_zeroed_out_memory(1, sizeof(tundra__addr_xlat_plugin));
+
+    // RTLD_NOW makes sure that all the plugin's undefined symbols are resolved here, and not while translating packets
+    addr_xlat_plugin->library_handle = dlopen(file_config->addressing_plugin_path, RTLD_NOW | RTLD_LOCAL);
+    if(addr_xlat_plugin->library_handle == NULL)
+        log__crash(false, "Failed to load the address translation plugin '%s': %s", file_config->addressing_plugin_path, _get_dl_error_string());
+
+    // The plugin's definition is an object, not a function, so it can be obtained from dlsym() without any
+    //  (non-standard) conversions between object and function pointers
+    addr_xlat_plugin->definition = dlsym(addr_xlat_plugin->library_handle, TUNDRA_ADDR_XLAT_PLUGIN_DEFINITION_SYMBOL);
+    if(addr_xlat_plugin->definition == NULL)
+        log__crash(false, "The address translation plugin '%s' does not export the '%s' symbol: %s", file_config->addressing_plugin_path, TUNDRA_ADDR_XLAT_PLUGIN_DEFINITION_SYMBOL, _get_dl_error_string());
+
+    if(addr_xlat_plugin->definition->api_version != TUNDRA_ADDR_XLAT_PLUGIN_API_VERSION)
+        log__crash(false, "The address translation plugin '%s' uses API version %"PRIu32", but this version of Tundra only supports API version %"PRIu32"!", file_config->addressing_plugin_path, addr_xlat_plugin->definition->api_version, TUNDRA_ADDR_XLAT_PLUGIN_API_VERSION);
+
+    if(
+        addr_xlat_plugin->definition->translate_4to6_addr_for_main_packet == NULL ||
+        addr_xlat_plugin->definition->translate_4to6_addr_for_icmp_error_packet == NULL ||
+        addr_xlat_plugin->definition->translate_6to4_addr_for_main_packet == NULL ||
+        addr_xlat_plugin->definition->translate_6to4_addr_for_icmp_error_packet == NULL
+    ) log__crash(false, "The address translation plugin '%s' does not define all the translation callbacks!", file_config->addressing_plugin_path);
+
+    addr_xlat_plugin->plugin_data = NULL;
+    if(addr_xlat_plugin->definition->init != NULL && !addr_xlat_plugin->definition->init(file_config->addressing_plugin_argument, &addr_xlat_plugin->plugin_data))
+        log__crash(false, "The address translation plugin '%s' failed to initialize itself!", file_config->addressing_plugin_path);
+
+    log__info("The address translation plugin '%s' has been loaded.", file_config->addressing_plugin_path);
+
+    return addr_xlat_plugin;
+}
+
+// This function must be called after all the translator threads have been terminated, and after all their data have
+//  been finalized!
+void xlat_addr_plugin__unload(tundra__addr_xlat_plugin *addr_xlat_plugin) {
+    if(addr_xlat_plugin->definition->finalize != NULL)
+        addr_xlat_plugin->definition->finalize(addr_xlat_plugin->plugin_data);
+
+    // The return value is ignored, as there is nothing that could be done if unloading the plugin fails
+    dlclose(addr_xlat_plugin->library_handle);
+
+    utils__free_memory(addr_xlat_plugin);
+}
+
+void *xlat_addr_plugin__initialize_thread_data(tundra__addr_xlat_plugin *addr_xlat_plugin, const size_t thread_id) {
+    void *thread_data = NULL;
+
+    if(addr_xlat_plugin->definition->thread_init != NULL && !addr_xlat_plugin->definition->thread_init(addr_xlat_plugin->plugin_data, thread_id, &thread_data))
+        log__crash(false, "The address translation plugin failed to initialize the data of translator thread %zu!", thread_id);
+
+    return thread_data;
+}
+
+void xlat_addr_plugin__finalize_thread_data(tundra__addr_xlat_plugin *addr_xlat_plugin, void *thread_data) {
+    if(addr_xlat_plugin->definition->thread_finalize != NULL)
+        addr_xlat_plugin->definition->thread_finalize(addr_xlat_plugin->plugin_data, thread_data);
+}
+
+// This function is called from the main thread, i.e. concurrently with the translation callbacks!
+void xlat_addr_plugin__reload(tundra__addr_xlat_plugin *addr_xlat_plugin) {
+    if(addr_xlat_plugin->definition->reload == NULL) {
+        log__info("The address translation plugin does not support reloading.");
+        return;
+    }
+
+    if(addr_xlat_plugin->definition->reload(addr_xlat_plugin->plugin_data))
+        log__info("The address translation plugin has been reloaded.");
+    else
+        log__info("The address translation plugin failed to reload itself; it keeps running with its previous state.");
+}
+
+bool xlat_addr_plugin__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    return ctx->addr_xlat_plugin->definition->translate_4to6_addr_for_main_packet(ctx->addr_xlat_plugin_thread_data, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+}
+
+bool xlat_addr_plugin__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
+    return ctx->addr_xlat_plugin->definition->translate_4to6_addr_for_icmp_error_packet(ctx->addr_xlat_plugin_thread_data, in_src_ipv4, in_dst_ipv4, out_src_ipv6, out_dst_ipv6);
+}
+
+bool xlat_addr_plugin__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    return ctx->addr_xlat_plugin->definition->translate_6to4_addr_for_main_packet(ctx->addr_xlat_plugin_thread_data, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+}
+
+bool xlat_addr_plugin__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
+    return ctx->addr_xlat_plugin->definition->translate_6to4_addr_for_icmp_error_packet(ctx->addr_xlat_plugin_thread_data, in_src_ipv6, in_dst_ipv6, out_src_ipv4, out_dst_ipv4);
+}
+
+static const char *_get_dl_error_string(void) {
+    const char *const dl_error_string = dlerror();
+
+    return ((dl_error_string == NULL) ? "Unknown error" : dl_error_string);
+}
@@ -22,33 +22,96 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include"tundra.h"
 #include"xlat_addr_siit.h"
 
+#include"utils_ip.h"
 #include"utils_xlat_addr.h"
+#include"xlat_addr_siit_eam.h"
+
+
+static bool _translate_4to6_addr_for_main_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint8_t *out_ipv6);
+static bool _translate_6to4_addr_for_main_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv6, uint8_t *out_ipv4, bool *out_is_prefix_translated);
 
 
 bool xlat_addr_siit__translate_4to6_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
-    if(!utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(ctx, in_src_ipv4, out_src_ipv6))
+    if(!_translate_4to6_addr_for_main_packet(ctx, in_src_ipv4, out_src_ipv6))
         return false;
 
-    return utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(ctx, in_dst_ipv4, out_dst_ipv6);
+    return _translate_4to6_addr_for_main_packet(ctx, in_dst_ipv4, out_dst_ipv6);
 }
 
 bool xlat_addr_siit__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6) {
-    utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_src_ipv4, out_src_ipv6);
-    utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_dst_ipv4, out_dst_ipv6);
+    if(ctx->siit_eam_state == NULL || !xlat_addr_siit_eam__translate_4to6_addr(ctx->siit_eam_state, in_src_ipv4, out_src_ipv6))
+        utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_src_ipv4, out_src_ipv6);
+
+    if(ctx->siit_eam_state == NULL || !xlat_addr_siit_eam__translate_4to6_addr(ctx->siit_eam_state, in_dst_ipv4, out_dst_ipv6))
+        utils_xlat_addr__nat64_clat_siit__translate_4to6_prefix_for_icmp_error_packet(ctx, in_dst_ipv4, out_dst_ipv6);
 
     return true;
 }
 
 bool xlat_addr_siit__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
-    if(!utils_xlat_addr__siit__translate_6to4_prefix_for_main_packet(ctx, in_src_ipv6, out_src_ipv4))
+    ctx->is_siit_hairpin_destination = false;
+
+    bool is_src_prefix_translated = false;
+    if(!_translate_6to4_addr_for_main_packet(ctx, in_src_ipv6, out_src_ipv4, &is_src_prefix_translated))
+        return false;
+
+    bool is_dst_prefix_translated = false;
+    if(!_translate_6to4_addr_for_main_packet(ctx, in_dst_ipv6, out_dst_ipv4, &is_dst_prefix_translated))
         return false;
 
-    return utils_xlat_addr__siit__translate_6to4_prefix_for_main_packet(ctx, in_dst_ipv6, out_dst_ipv4);
+    // An IPv4 address of an explicit address mapping is represented by the translator only if it has been embedded into
+    //  the translation prefix; if the destination matched the mapping's IPv6 side, the packet is destined to IPv6
+    //  anyway and is sent out to IPv4 (RFC 7757, section 4.2)
+    if(is_dst_prefix_translated && ctx->siit_eam_state != NULL) {
+        uint8_t eam_ipv6[16];
+        ctx->is_siit_hairpin_destination = xlat_addr_siit_eam__translate_4to6_addr(ctx->siit_eam_state, out_dst_ipv4, eam_ipv6);
+    }
+
+    return true;
 }
 
 bool xlat_addr_siit__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4) {
-    if(!utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_src_ipv6, out_src_ipv4))
-        return false;
+    if(ctx->siit_eam_state == NULL || !xlat_addr_siit_eam__translate_6to4_addr(ctx->siit_eam_state, in_src_ipv6, out_src_ipv4)) {
+        if(!utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_src_ipv6, out_src_ipv4))
+            return false;
+    }
+
+    if(ctx->siit_eam_state == NULL || !xlat_addr_siit_eam__translate_6to4_addr(ctx->siit_eam_state, in_dst_ipv6, out_dst_ipv4))
+        return utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_dst_ipv6, out_dst_ipv4);
+
+    return true;
+}
+
+// Decided when the main packet's addresses are translated (see xlat_addr_siit__translate_6to4_addr_for_main_packet()),
+//  as it depends on how the IPv6 destination address has been translated, not only on the resulting IPv4 one
+bool xlat_addr_siit__is_hairpin_destination(const tundra__thread_ctx *const ctx, __attribute__((unused)) const uint8_t *ipv4) {
+    return ctx->is_siit_hairpin_destination;
+}
+
+// The explicit address mappings take precedence over the translation prefix (RFC 7757, section 3.2). Since they are
+//  configured explicitly, the 'allow_translation_of_private_ips' option does not apply to them.
+static bool _translate_4to6_addr_for_main_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv4, uint8_t *out_ipv6) {
+    if(ctx->siit_eam_state == NULL || !xlat_addr_siit_eam__translate_4to6_addr(ctx->siit_eam_state, in_ipv4, out_ipv6))
+        return utils_xlat_addr__siit__translate_4to6_prefix_for_main_packet(ctx, in_ipv4, out_ipv6);
+
+    return (
+        !UTILS_IP__IPV4_ADDR_EQ(in_ipv4, ctx->config->router_ipv4) &&
+        !utils_ip__is_ipv4_addr_unusable(in_ipv4) &&
+        !UTILS_IP__IPV6_ADDR_EQ(out_ipv6, ctx->config->router_ipv6)
+    );
+}
+
+static bool _translate_6to4_addr_for_main_packet(const tundra__thread_ctx *const ctx, const uint8_t *in_ipv6, uint8_t *out_ipv4, bool *out_is_prefix_translated) {
+    if(ctx->siit_eam_state == NULL || !xlat_addr_siit_eam__translate_6to4_addr(ctx->siit_eam_state, in_ipv6, out_ipv4)) {
+        *out_is_prefix_translated = true;
+        return utils_xlat_addr__siit__translate_6to4_prefix_for_main_packet(ctx, in_ipv6, out_ipv4);
+    }
+
+    *out_is_prefix_translated = false;
 
-    return utils_xlat_addr__nat64_clat_siit__translate_6to4_prefix_for_icmp_error_packet(ctx, in_dst_ipv6, out_dst_ipv4);
+    return (
+        !UTILS_IP__IPV6_ADDR_EQ(in_ipv6, ctx->config->router_ipv6) &&
+        !UTILS_IP__IPV4_ADDR_EQ(out_ipv4, ctx->config->router_ipv4) &&
+        !utils_ip__is_ipv4_addr_unusable(out_ipv4)
+    );
 }
@@ -27,3 +27,4 @@ extern bool xlat_addr_siit__translate_4to6_addr_for_main_packet(tundra__thread_c
 extern bool xlat_addr_siit__translate_4to6_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv4, const uint8_t *in_dst_ipv4, uint8_t *out_src_ipv6, uint8_t *out_dst_ipv6);
 extern bool xlat_addr_siit__translate_6to4_addr_for_main_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
 extern bool xlat_addr_siit__translate_6to4_addr_for_icmp_error_packet(tundra__thread_ctx *const ctx, const uint8_t *in_src_ipv6, const uint8_t *in_dst_ipv6, uint8_t *out_src_ipv4, uint8_t *out_dst_ipv4);
+extern bool xlat_addr_siit__is_hairpin_destination(const tundra__thread_ctx *const ctx, const uint8_t *ipv4);
@@ -0,0 +1,269 @@
+/*
+Copyright (c) 2024 Vít Labuda. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+    disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+    following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+    products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include"tundra.h"
+#include"xlat_addr_siit_eam.h"
+
+#include"utils.h"
+#include"utils_ip.h"
+#include"log.h"
+#include"utils_lpm.h"
+
+
+#define _ERROR_MESSAGE_SIZE ((size_t) 512)
+
+// With 16-bit first stride, an IPv4 lookup needs at most 3 memory accesses (16 + 8 + 8 bits), while the root node
+//  takes up only 256 KiB (a 24-bit one would take up 64 MiB); IPv6 lookups skip the bytes which the entries' prefixes
+//  share (usually the first 96 bits), so they mostly need 2 or 3 memory accesses as well (see utils_lpm__lookup())
+#define _LPM_TABLE_FIRST_STRIDE_BITS ((size_t) 16)
+
+
+static bool _load_entries(tundra__siit_eam_state *siit_eam_state, const char *const eam_file_path, char *error_message, const size_t error_message_size);
+static bool _parse_entry_line(tundra__siit_eam_entry *entry, char *line, bool *out_is_empty);
+static int _compare_entries_by_ipv6_prefix(const void *entry1, const void *entry2);
+static int _compare_entries_by_ipv4_prefix(const void *entry1, const void *entry2);
+static inline uint32_t _get_ipv4_suffix_mask(const tundra__siit_eam_entry *const entry);
+
+
+// This function must be called before the program's working directory is changed and its privileges are dropped.
+tundra__siit_eam_state *xlat_addr_siit_eam__create_state(const tundra__conf_file *const file_config) {
+    char error_message[_ERROR_MESSAGE_SIZE];
+    tundra__siit_eam_state *siit_eam_state = xlat_addr_siit_eam__load_state(file_config, error_message, _ERROR_MESSAGE_SIZE);
+    if(siit_eam_state == NULL)
+        log__crash(false, "%s", error_message);
+
+    return siit_eam_state;
+}
+
+// Unlike xlat_addr_siit_eam__create_state(), this function does not crash the program if the EAM file cannot be
+//  loaded - it returns NULL, and the reason is stored into 'error_message'.
+tundra__siit_eam_state *xlat_addr_siit_eam__load_state(const tundra__conf_file *const file_config, char *error_message, const size_t error_message_size) {
+    tundra__siit_eam_state *siit_eam_state = utils__alloc_zeroed_out_memory(1, sizeof(tundra__siit_eam_state));
+
+    if(!_load_entries(siit_eam_state, file_config->addressing_siit_eam_file, error_message, error_message_size)) {
+        if(siit_eam_state->entries != NULL)
+            utils__free_memory(siit_eam_state->entries);
+
+        utils__free_memory(siit_eam_state);
+        return NULL;
+    }
+
+    siit_eam_state->ipv4_entry_table = utils_lpm__create_table(4, _LPM_TABLE_FIRST_STRIDE_BITS);
+    siit_eam_state->ipv6_entry_table = utils_lpm__create_table(16, _LPM_TABLE_FIRST_STRIDE_BITS);
+    for(size_t i = 0; i < siit_eam_state->entry_count; i++) {
+        const tundra__siit_eam_entry *entry = siit_eam_state->entries + i;
+        utils_lpm__insert(siit_eam_state->ipv4_entry_table, entry->ipv4_prefix, entry->ipv4_prefix_length, (uint32_t) i);
+        utils_lpm__insert(siit_eam_state->ipv6_entry_table, entry->ipv6_prefix, (96 + (size_t) entry->ipv4_prefix_length), (uint32_t) i);
+    }
+    utils_lpm__build(siit_eam_state->ipv4_entry_table);
+    utils_lpm__build(siit_eam_state->ipv6_entry_table);
+
+    log__info("%zu explicit address mappings have been loaded from the file '%s'.", siit_eam_state->entry_count, file_config->addressing_siit_eam_file);
+
+    return siit_eam_state;
+}
+
+void xlat_addr_siit_eam__free_state(tundra__siit_eam_state *siit_eam_state) {
+    utils_lpm__free_table(siit_eam_state->ipv4_entry_table);
+    utils_lpm__free_table(siit_eam_state->ipv6_entry_table);
+    utils__free_memory(siit_eam_state->entries);
+    utils__free_memory(siit_eam_state);
+}
+
+// Returns false if the address does not belong to any explicit address mapping
+bool xlat_addr_siit_eam__translate_4to6_addr(const tundra__siit_eam_state *const siit_eam_state, const uint8_t *in_ipv4, uint8_t *out_ipv6) {
+    uint32_t entry_index = 0;
+    if(!utils_lpm__lookup(siit_eam_state->ipv4_entry_table, in_ipv4, &entry_index))
+        return false;
+
+    const tundra__siit_eam_entry *entry = siit_eam_state->entries + entry_index;
+
+    uint32_t ipv4_suffix;
+    memcpy(&ipv4_suffix, in_ipv4, 4);
+    ipv4_suffix &= _get_ipv4_suffix_mask(entry);
+
+    uint32_t ipv6_last_word;
+    memcpy(&ipv6_last_word, entry->ipv6_prefix + 12, 4);
+    ipv6_last_word |= ipv4_suffix;
+
+    memcpy(out_ipv6, entry->ipv6_prefix, 12);
+    memcpy(out_ipv6 + 12, &ipv6_last_word, 4);
+
+    return true;
+}
+
+// Returns false if the address does not belong to any explicit address mapping
+bool xlat_addr_siit_eam__translate_6to4_addr(const tundra__siit_eam_state *const siit_eam_state, const uint8_t *in_ipv6, uint8_t *out_ipv4) {
+    uint32_t entry_index = 0;
+    if(!utils_lpm__lookup(siit_eam_state->ipv6_entry_table, in_ipv6, &entry_index))
+        return false;
+
+    const tundra__siit_eam_entry *entry = siit_eam_state->entries + entry_index;
+
+    uint32_t ipv6_suffix;
+    memcpy(&ipv6_suffix, in_ipv6 + 12, 4);
+    ipv6_suffix &= _get_ipv4_suffix_mask(entry);
+
+    uint32_t ipv4;
+    memcpy(&ipv4, entry->ipv4_prefix, 4);
+    ipv4 |= ipv6_suffix;
+
+    memcpy(out_ipv4, &ipv4, 4);
+
+    return true;
+}
+
+/*
+ * The EAM file contains one explicit address mapping per line, in the following format:
+ *   <IPv4 prefix>/<length> <IPv6 prefix>/<length>
+ * The IPv6 prefix has to be exactly 96 bits longer than the IPv4 one (RFC 7757, section 3.2). Empty lines are ignored,
+ * and '#' starts a comment which extends to the end of the line.
+ */
+static bool _load_entries(tundra__siit_eam_state *siit_eam_state, const char *const eam_file_path, char *error_message, const size_t error_message_size) {
+    size_t file_size = 0;
+    char *file_data = (char *) utils__read_whole_file(eam_file_path, &file_size);
+    if(file_data == NULL) {
+        snprintf(error_message, error_message_size, "Failed to read the EAM file '%s': %s", eam_file_path, strerror(errno));
+        return false;
+    }
+
+    if(strlen(file_data) != file_size) {
+        snprintf(error_message, error_message_size, "The EAM file '%s' is not a text file!", eam_file_path);
+        utils__free_memory(file_data);
+        return false;
+    }
+
+    size_t allocated_entry_count = 16;
+    siit_eam_state->entries = utils__alloc_zeroed_out_memory(allocated_entry_count, sizeof(tundra__siit_eam_entry));
+    siit_eam_state->entry_count = 0;
+
+    size_t line_number = 0;
+    for(char *line = file_data; line != NULL; ) {
+        line_number++;
+
+        char *next_line = strchr(line, '\n');
+        if(next_line != NULL)
+            *(next_line++) = '\0';
+
+        if(siit_eam_state->entry_count >= allocated_entry_count) {
+            allocated_entry_count *= 2;
+            siit_eam_state->entries = utils__realloc_memory(siit_eam_state->entries, allocated_entry_count, sizeof(tundra__siit_eam_entry));
+        }
+
+        bool is_empty = false;
+        if(!_parse_entry_line(siit_eam_state->entries + siit_eam_state->entry_count, line, &is_empty)) {
+            snprintf(error_message, error_message_size, "The EAM file '%s' contains an invalid mapping on line %zu!", eam_file_path, line_number);
+            utils__free_memory(file_data);
+            return false;
+        }
+
+        if(!is_empty && ++siit_eam_state->entry_count > TUNDRA__MAX_ADDRESSING_SIIT_EAM_ENTRIES) {
+            snprintf(error_message, error_message_size, "The EAM file '%s' must not contain more than %zu mappings!", eam_file_path, TUNDRA__MAX_ADDRESSING_SIIT_EAM_ENTRIES);
+            utils__free_memory(file_data);
+            return false;
+        }
+
+        line = next_line;
+    }
+
+    utils__free_memory(file_data);
+
+    // Mappings with the same prefix would be ambiguous (overlapping prefixes of different lengths are fine though - the
+    //  longest matching one is used, as per RFC 7757, section 3.2)
+    qsort(siit_eam_state->entries, siit_eam_state->entry_count, sizeof(tundra__siit_eam_entry), _compare_entries_by_ipv6_prefix);
+    for(size_t i = 1; i < siit_eam_state->entry_count; i++) {
+        if(_compare_entries_by_ipv6_prefix(siit_eam_state->entries + (i - 1), siit_eam_state->entries + i) == 0) {
+            snprintf(error_message, error_message_size, "The EAM file '%s' contains multiple mappings with the same IPv6 prefix!", eam_file_path);
+            return false;
+        }
+    }
+
+    qsort(siit_eam_state->entries, siit_eam_state->entry_count, sizeof(tundra__siit_eam_entry), _compare_entries_by_ipv4_prefix);
+    for(size_t i = 1; i < siit_eam_state->entry_count; i++) {
+        if(_compare_entries_by_ipv4_prefix(siit_eam_state->entries + (i - 1), siit_eam_state->entries + i) == 0) {
+            snprintf(error_message, error_message_size, "The EAM file '%s' contains multiple mappings with the same IPv4 prefix!", eam_file_path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool _parse_entry_line(tundra__siit_eam_entry *entry, char *line, bool *out_is_empty) {
+    char *comment_start = strchr(line, '#');
+    if(comment_start != NULL)
+        *comment_start = '\0';
+
+    char *fields[3];
+    size_t field_count = 0;
+    char *save_ptr = NULL;
+    for(char *field = strtok_r(line, " \t\r", &save_ptr); field != NULL; field = strtok_r(NULL, " \t\r", &save_ptr)) {
+        if(field_count >= 3)
+            return false;
+
+        fields[field_count++] = field;
+    }
+
+    *out_is_empty = (field_count == 0);
+    if(*out_is_empty)
+        return true;
+
+    if(field_count != 2)
+        return false;
+
+    UTILS__MEM_ZERO_OUT(entry, sizeof(tundra__siit_eam_entry));
+    uint8_t ipv6_prefix_length = 0;
+    return (
+        utils_ip__parse_prefix_string(fields[0], AF_INET, entry->ipv4_prefix, &entry->ipv4_prefix_length) &&
+        utils_ip__parse_prefix_string(fields[1], AF_INET6, entry->ipv6_prefix, &ipv6_prefix_length) &&
+        (size_t) ipv6_prefix_length == (96 + (size_t) entry->ipv4_prefix_length)
+    );
+}
+
+static int _compare_entries_by_ipv6_prefix(const void *entry1, const void *entry2) {
+    const tundra__siit_eam_entry *e1 = (const tundra__siit_eam_entry *) entry1;
+    const tundra__siit_eam_entry *e2 = (const tundra__siit_eam_entry *) entry2;
+
+    // The IPv6 prefix's length is derived from the IPv4 prefix's one
+    if(e1->ipv4_prefix_length != e2->ipv4_prefix_length)
+        return ((e1->ipv4_prefix_length < e2->ipv4_prefix_length) ? -1 : 1);
+
+    return memcmp(e1->ipv6_prefix, e2->ipv6_prefix, 16);
+}
+
+static int _compare_entries_by_ipv4_prefix(const void *entry1, const void *entry2) {
+    const tundra__siit_eam_entry *e1 = (const tundra__siit_eam_entry *) entry1;
+    const tundra__siit_eam_entry *e2 = (const tundra__siit_eam_entry *) entry2;
+
+    if(e1->ipv4_prefix_length != e2->ipv4_prefix_length)
+        return ((e1->ipv4_prefix_length < e2->ipv4_prefix_length) ? -1 : 1);
+
+    return memcmp(e1->ipv4_prefix, e2->ipv4_prefix, 4);
+}
+
+// In network byte order
+static inline uint32_t _get_ipv4_suffix_mask(const tundra__siit_eam_entry *const entry) {
+    return htonl((entry->ipv4_prefix_length >= 32) ? 0 : (UINT32_MAX >> entry->ipv4_prefix_length));
+}
+
+
+#undef _ERROR_MESSAGE_SIZE
+#undef _LPM_TABLE_FIRST_STRIDE_BITS
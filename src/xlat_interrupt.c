@@ -39,12 +39,12 @@ ssize_t xlat_interrupt__read(const int fd, void *buf, const size_t count) {
     }
 }
 
-ssize_t xlat_interrupt__write(const int fd, const void *buf, const size_t count) {
+ssize_t xlat_interrupt__recv(const int sockfd, void *buf, const size_t len, const int flags) {
     for(;;) {
         if(!signals__should_this_thread_keep_running())
             pthread_exit(NULL);
 
-        const ssize_t ret_value = write(fd, buf, count);
+        const ssize_t ret_value = recv(sockfd, buf, len, flags);
 
         if(ret_value < 0 && errno == EINTR)
             continue;
@@ -53,12 +53,46 @@ ssize_t xlat_interrupt__write(const int fd, const void *buf, const size_t count)
     }
 }
 
+// Unlike the other functions, the writing ones try to perform the system call even if the thread has been asked to
+//  terminate - the packet being written has already been received and translated, so it is sent out instead of being
+//  dropped (this is what lets the translator drain its in-flight packets when it is terminating, e.g. after handing
+//  its file descriptors over to another process). The thread exits only if the write blocks and gets interrupted.
+ssize_t xlat_interrupt__write(const int fd, const void *buf, const size_t count) {
+    for(;;) {
+        const ssize_t ret_value = write(fd, buf, count);
+
+        if(ret_value < 0 && errno == EINTR) {
+            if(!signals__should_this_thread_keep_running())
+                pthread_exit(NULL);
+
+            continue;
+        }
+
+        return ret_value;
+    }
+}
+
 ssize_t xlat_interrupt__writev(const int fd, const struct iovec *iov, const int iovcnt) {
+    for(;;) {
+        const ssize_t ret_value = writev(fd, iov, iovcnt);
+
+        if(ret_value < 0 && errno == EINTR) {
+            if(!signals__should_this_thread_keep_running())
+                pthread_exit(NULL);
+
+            continue;
+        }
+
+        return ret_value;
+    }
+}
+
+int xlat_interrupt__poll(struct pollfd *fds, const nfds_t nfds, const int timeout) {
     for(;;) {
         if(!signals__should_this_thread_keep_running())
             pthread_exit(NULL);
 
-        const ssize_t ret_value = writev(fd, iov, iovcnt);
+        const int ret_value = poll(fds, nfds, timeout);
 
         if(ret_value < 0 && errno == EINTR)
             continue;
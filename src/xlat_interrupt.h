@@ -24,7 +24,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 extern ssize_t xlat_interrupt__read(const int fd, void *buf, const size_t count);
+extern ssize_t xlat_interrupt__recv(const int sockfd, void *buf, const size_t len, const int flags);
 extern ssize_t xlat_interrupt__write(const int fd, const void *buf, const size_t count);
 extern ssize_t xlat_interrupt__writev(const int fd, const struct iovec *iov, const int iovcnt);
+extern int xlat_interrupt__poll(struct pollfd *fds, const nfds_t nfds, const int timeout);
 extern int xlat_interrupt__connect(const int sockfd, const struct sockaddr *addr, const socklen_t addrlen, const bool close_sockfd_before_exiting);
 extern int xlat_interrupt__close(const int fd);
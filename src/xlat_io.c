@@ -29,6 +29,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 static void _send_packet(const tundra__thread_ctx *const ctx, const struct iovec *iov, const int iovcnt, const size_t total_packet_size);
+static void _store_hairpinned_packet(const tundra__thread_ctx *const ctx, const struct iovec *iov, const int iovcnt, const size_t total_packet_size);
 
 
 void xlat_io__recv_packet_into_in_packet_buffer(tundra__thread_ctx *const ctx) {
@@ -75,7 +76,8 @@ void xlat_io__send_ipv4_packet(const tundra__thread_ctx *const ctx, struct iphdr
     }
     #pragma GCC diagnostic pop
 
-    if(total_packet_size > ctx->config->translator_ipv4_outbound_mtu)
+    // Hairpinned packets never leave the program, so the outbound MTU does not apply to them
+    if(total_packet_size > (ctx->is_hairpinning ? TUNDRA__MAX_PACKET_SIZE : ctx->config->translator_ipv4_outbound_mtu))
         return;
 
     // Fill in the missing parts of the IPv4 header
@@ -83,8 +85,11 @@ void xlat_io__send_ipv4_packet(const tundra__thread_ctx *const ctx, struct iphdr
     ipv4_header->check = 0;
     ipv4_header->check = checksum__calculate_ipv4_header_checksum(ipv4_header);
 
-    // Send the packet out
-    _send_packet(ctx, iov, iovcnt, total_packet_size);
+    // Send the packet out (or keep it, so that it can be translated back to IPv6)
+    if(ctx->is_hairpinning)
+        _store_hairpinned_packet(ctx, iov, iovcnt, total_packet_size);
+    else
+        _send_packet(ctx, iov, iovcnt, total_packet_size);
 }
 
 void xlat_io__send_ipv6_packet(const tundra__thread_ctx *const ctx, struct ipv6hdr *ipv6_header, const tundra__ipv6_frag_header *nullable_ipv6_fragment_header, const uint8_t *nullable_payload1_ptr, const size_t zeroable_payload1_size, const uint8_t *nullable_payload2_ptr, const size_t zeroable_payload2_size) {
@@ -144,3 +149,13 @@ static void _send_packet(const tundra__thread_ctx *const ctx, const struct iovec
     if(((size_t) ret_value) != total_packet_size)
         log__thread_crash(ctx->thread_id, false, "Only a part of the packet could be sent out (sent = %zu, total packet size = %zu)!", (size_t) ret_value, total_packet_size);
 }
+
+static void _store_hairpinned_packet(const tundra__thread_ctx *const ctx, const struct iovec *iov, const int iovcnt, const size_t total_packet_size) {
+    size_t offset = 0;
+    for(int i = 0; i < iovcnt; i++) {
+        memcpy(ctx->hairpin_packet->buffer + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    ctx->hairpin_packet->size = total_packet_size;
+}